@@ -5,7 +5,9 @@
 //----------------------------------------------------------------------------------------------------
 #include "Game/Framework/App.hpp"
 //----------------------------------------------------------------------------------------------------
+#include "Game/Framework/FrameArena.hpp"
 #include "Game/Framework/GameCommon.hpp"
+#include "Game/Framework/TaskScheduler.hpp"
 #include "Game/Gameplay/Game.hpp"
 //----------------------------------------------------------------------------------------------------
 #include "Engine/Audio/AudioSystem.hpp"
@@ -13,14 +15,16 @@
 #include "Engine/Core/DevConsole.hpp"
 #include "Engine/Core/Engine.hpp"
 #include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
 #include "Engine/Input/InputSystem.hpp"
 #include "Engine/Platform/Window.hpp"
 #include "Engine/Renderer/DebugRenderSystem.hpp"
 #include "Engine/Resource/ResourceSubsystem.hpp"
 
 //----------------------------------------------------------------------------------------------------
-App*  g_app  = nullptr;     // Created and owned by Main_Windows.cpp
-Game* g_game = nullptr;     // Created and owned by the App
+App*           g_app           = nullptr; // Created and owned by Main_Windows.cpp
+Game*          g_game          = nullptr; // Created and owned by the App
+TaskScheduler* g_taskScheduler = nullptr; // Created and owned by the App
 
 //----------------------------------------------------------------------------------------------------
 STATIC bool App::m_isQuitting = false;
@@ -46,6 +50,11 @@ void App::Startup()
 
     g_eventSystem->SubscribeEventCallbackFunction("OnCloseButtonClicked", OnCloseButtonClicked);
     g_eventSystem->SubscribeEventCallbackFunction("quit", OnCloseButtonClicked);
+    g_eventSystem->SubscribeEventCallbackFunction("TaskWorkers", OnTaskWorkersCommand);
+
+    // Shared by every parallel feature in the game layer; the game may use it from its constructor
+    g_taskScheduler = new TaskScheduler(sTaskSchedulerConfig());
+    g_taskScheduler->Startup();
 
     g_game = new Game();
 }
@@ -57,6 +66,10 @@ void App::Shutdown()
 {
     GAME_SAFE_RELEASE(g_game);
 
+    g_taskScheduler->Shutdown();
+    GAME_SAFE_RELEASE(g_taskScheduler);
+
+    g_eventSystem->UnsubscribeEventCallbackFunction("TaskWorkers", OnTaskWorkersCommand);
     g_eventSystem->UnsubscribeEventCallbackFunction("quit", OnCloseButtonClicked);
     g_eventSystem->UnsubscribeEventCallbackFunction("OnCloseButtonClicked", OnCloseButtonClicked);
 
@@ -95,6 +108,31 @@ STATIC bool App::OnCloseButtonClicked(EventArgs& args)
     return false;
 }
 
+//----------------------------------------------------------------------------------------------------
+// OnTaskWorkersCommand - Restart the task scheduler with count background workers (-1 = one per
+// hardware thread, minus the main thread). Console commands run between the main thread's tasks, but
+// the query server's batcher thread submits work at any time, so the restart is refused while it runs.
+//----------------------------------------------------------------------------------------------------
+STATIC bool App::OnTaskWorkersCommand(EventArgs& args)
+{
+    sTaskSchedulerConfig config;
+    config.m_numWorkers = args.GetValue("count", config.m_numWorkers);
+
+    if (g_game != nullptr && g_game->IsQueryServerRunning())
+    {
+        g_devConsole->AddLine(DevConsole::ERROR, "Error: StopQueryServer before restarting the task scheduler");
+        return false;
+    }
+
+    g_taskScheduler->Shutdown();
+    GAME_SAFE_RELEASE(g_taskScheduler);
+    g_taskScheduler = new TaskScheduler(config);
+    g_taskScheduler->Startup();
+
+    g_devConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Task scheduler running %d workers + main thread", g_taskScheduler->GetNumWorkers()));
+    return true;
+}
+
 //----------------------------------------------------------------------------------------------------
 STATIC void App::RequestQuit()
 {
@@ -104,6 +142,7 @@ STATIC void App::RequestQuit()
 //----------------------------------------------------------------------------------------------------
 void App::BeginFrame() const
 {
+    FrameArena::BeginFrame(); // Before anything can allocate frame memory for the new frame
     g_eventSystem->BeginFrame();
     g_window->BeginFrame();
     g_renderer->BeginFrame();
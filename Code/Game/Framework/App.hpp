@@ -24,6 +24,7 @@ public:
     void RunFrame();
 
     static bool OnCloseButtonClicked(EventArgs& args);
+    static bool OnTaskWorkersCommand(EventArgs& args);
     static void RequestQuit();
     static bool m_isQuitting;
     void        DeleteAndCreateNewGame();
@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------------------------------
+// FrameArena.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/FrameArena.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/EngineCommon.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <mutex>
+
+//----------------------------------------------------------------------------------------------------
+constexpr size_t FRAME_ARENA_BLOCK_SIZE         = 256 * 1024;
+constexpr size_t FRAME_ARENA_MAX_RETAINED_BYTES = 16 * 1024 * 1024; // Per thread; a spike beyond this is given back
+
+//----------------------------------------------------------------------------------------------------
+// Every live arena, for BeginFrame's stats; s_frameIndex is what tells owners to rewind
+//----------------------------------------------------------------------------------------------------
+static std::mutex               s_registryMutex;
+static std::vector<FrameArena*> s_arenas;
+static sFrameArenaStats         s_lastFrameStats;
+static std::atomic<uint32_t>    s_frameIndex = 0;
+
+//----------------------------------------------------------------------------------------------------
+FrameArena::FrameArena()
+    : m_frameIndex(s_frameIndex.load(std::memory_order_acquire))
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    s_arenas.push_back(this);
+}
+
+//----------------------------------------------------------------------------------------------------
+FrameArena::~FrameArena()
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    s_arenas.erase(std::remove(s_arenas.begin(), s_arenas.end(), this), s_arenas.end());
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC FrameArena& FrameArena::GetForThisThread()
+{
+    static thread_local FrameArena s_arena;
+    return s_arena;
+}
+
+//----------------------------------------------------------------------------------------------------
+// BeginFrame - Records how the frame that just ended used its arenas, then starts the next one
+//----------------------------------------------------------------------------------------------------
+STATIC void FrameArena::BeginFrame()
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    uint32_t endingFrame = s_frameIndex.load(std::memory_order_relaxed);
+
+    sFrameArenaStats stats;
+    stats.m_numArenas = static_cast<int>(s_arenas.size());
+    for (FrameArena const* arena : s_arenas)
+    {
+        size_t highWaterBytes = arena->m_highWaterBytes.load(std::memory_order_relaxed);
+        if (arena->m_frameIndex.load(std::memory_order_relaxed) == endingFrame)
+        {
+            size_t usedBytes = arena->m_usedBytes.load(std::memory_order_relaxed);
+            highWaterBytes = std::max(highWaterBytes, usedBytes);
+            stats.m_bytesLastFrame += usedBytes;
+            ++stats.m_numActiveArenas;
+        }
+        stats.m_highWaterBytes      += highWaterBytes;
+        stats.m_capacityBytes       += arena->m_capacityBytes.load(std::memory_order_relaxed);
+        stats.m_numBlockAllocations += arena->m_numBlockAllocations.load(std::memory_order_relaxed);
+    }
+    s_lastFrameStats = stats;
+
+    s_frameIndex.store(endingFrame + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC sFrameArenaStats FrameArena::GetStats()
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    return s_lastFrameStats;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Allocate - Bump within the current block, chaining a new one when it is full. The first allocation
+// of a frame rewinds whatever the owner allocated in an earlier one.
+//----------------------------------------------------------------------------------------------------
+void* FrameArena::Allocate(size_t numBytes, size_t alignment)
+{
+    uint32_t frameIndex = s_frameIndex.load(std::memory_order_acquire);
+    if (frameIndex != m_frameIndex.load(std::memory_order_relaxed))
+    {
+        RewindForNewFrame(frameIndex);
+    }
+
+    for (;;)
+    {
+        if (m_blockIndex < static_cast<int>(m_blocks.size()))
+        {
+            Block&    block   = m_blocks[m_blockIndex];
+            uintptr_t base    = reinterpret_cast<uintptr_t>(block.m_bytes.get());
+            size_t    aligned = ((base + m_offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+            if (aligned + numBytes <= block.m_size)
+            {
+                m_offset = aligned + numBytes;
+                m_usedBytes.store(GetUsedBytes(), std::memory_order_relaxed);
+                return block.m_bytes.get() + aligned;
+            }
+            m_fullBlockBytes += block.m_size;
+            ++m_blockIndex;
+            m_offset = 0;
+            continue;
+        }
+
+        AddBlock(std::max(FRAME_ARENA_BLOCK_SIZE, numBytes + alignment));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+// RewindForNewFrame - If the last frame spilled into extra blocks, or held more than we retain, swap
+// them for one block that fits it, so the next frame like it allocates nothing
+//----------------------------------------------------------------------------------------------------
+void FrameArena::RewindForNewFrame(uint32_t frameIndex)
+{
+    size_t usedBytes = GetUsedBytes();
+    if (usedBytes > m_highWaterBytes.load(std::memory_order_relaxed))
+    {
+        m_highWaterBytes.store(usedBytes, std::memory_order_relaxed);
+    }
+
+    if (m_blocks.size() > 1 || m_capacityBytes.load(std::memory_order_relaxed) > FRAME_ARENA_MAX_RETAINED_BYTES)
+    {
+        m_blocks.clear();
+        m_capacityBytes.store(0, std::memory_order_relaxed);
+        AddBlock(std::clamp(usedBytes + usedBytes / 4, FRAME_ARENA_BLOCK_SIZE, FRAME_ARENA_MAX_RETAINED_BYTES));
+    }
+
+    m_blockIndex     = 0;
+    m_offset         = 0;
+    m_fullBlockBytes = 0;
+    m_usedBytes.store(0, std::memory_order_relaxed);
+    m_frameIndex.store(frameIndex, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------------------
+void FrameArena::AddBlock(size_t size)
+{
+    Block block;
+    block.m_size  = size;
+    block.m_bytes = std::make_unique_for_overwrite<uint8_t[]>(size);
+    m_blocks.push_back(std::move(block));
+    m_capacityBytes.fetch_add(size, std::memory_order_relaxed);
+    m_numBlockAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t FrameArena::GetUsedBytes() const
+{
+    return m_fullBlockBytes + m_offset;
+}
@@ -0,0 +1,113 @@
+//----------------------------------------------------------------------------------------------------
+// FrameArena.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct sFrameArenaStats
+{
+    int      m_numArenas           = 0; // Threads that have allocated frame memory at least once
+    int      m_numActiveArenas     = 0; // ...and did so last frame
+    size_t   m_bytesLastFrame      = 0; // Summed over the threads active last frame
+    size_t   m_highWaterBytes      = 0; // Largest frame of each thread, summed
+    size_t   m_capacityBytes       = 0; // Held by all arenas between frames
+    uint64_t m_numBlockAllocations = 0; // Heap allocations by arenas since startup; flat once warmed up
+};
+
+//----------------------------------------------------------------------------------------------------
+// FrameArena - Per-thread bump allocator whose memory lives until the end of the current frame
+//
+// Each thread that allocates gets its own arena, so allocating takes no lock. App::BeginFrame starts
+// a new frame; every arena then rewinds the next time its owner allocates. An arena that needed more
+// than one block in a frame is rebuilt as a single block big enough for that frame (capped), so a
+// steady frame loop stops touching the heap after its first few frames.
+//
+// That covers the arena's own memory and the per-frame work routed through it, plus the HUD text,
+// which is formatted into fixed buffers and reused strings (Game::AddHudLine). It does not make a
+// frame allocation-free: query futures and the scheduler's request queues still use the heap on frames
+// that submit queries, and the debug render system keeps its own copy of each screen text.
+//
+// Frame memory must not be held past the frame that allocated it: only code that finishes within the
+// frame (the game update and render, tasks it waits for) may use it. Threads that run independently
+// of frames, like the query server's, should use TaskScratch instead. Destructors never run.
+//----------------------------------------------------------------------------------------------------
+class FrameArena
+{
+public:
+    FrameArena();
+    ~FrameArena();
+    FrameArena(FrameArena const&)            = delete;
+    FrameArena& operator=(FrameArena const&) = delete;
+
+    static FrameArena&      GetForThisThread();
+    static void             BeginFrame(); // Main thread, with no frame work still in flight
+    static sFrameArenaStats GetStats();   // As of the last BeginFrame
+
+    void* Allocate(size_t numBytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    std::span<T> AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+        return std::span<T>(static_cast<T*>(Allocate(count * sizeof(T), alignof(T))), count);
+    }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> m_bytes;
+        size_t                     m_size = 0;
+    };
+
+    void   RewindForNewFrame(uint32_t frameIndex);
+    void   AddBlock(size_t size);
+    size_t GetUsedBytes() const;
+
+    std::vector<Block>    m_blocks;
+    int                   m_blockIndex     = 0;
+    size_t                m_offset         = 0;
+    size_t                m_fullBlockBytes = 0; // Sizes of the blocks before m_blockIndex
+
+    // Written by the owner, read by BeginFrame for stats
+    std::atomic<uint32_t> m_frameIndex          = 0;
+    std::atomic<size_t>   m_usedBytes           = 0;
+    std::atomic<size_t>   m_highWaterBytes      = 0;
+    std::atomic<size_t>   m_capacityBytes       = 0;
+    std::atomic<uint64_t> m_numBlockAllocations = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+// FrameAllocator - STL allocator over the calling thread's FrameArena
+//
+// Deallocation is a no-op, so a container that grows leaves its old buffers behind until the frame
+// ends; reserve when the size is known. Any thread's frame memory may be freed from any other.
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+struct FrameAllocator
+{
+    using value_type = T;
+
+    FrameAllocator() = default;
+    template <typename U>
+    FrameAllocator(FrameAllocator<U> const&) noexcept {}
+
+    T*   allocate(size_t count) { return static_cast<T*>(FrameArena::GetForThisThread().Allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) noexcept {}
+
+    template <typename U>
+    bool operator==(FrameAllocator<U> const&) const noexcept { return true; }
+};
+
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -12,11 +12,13 @@ struct Vec2;
 class App;
 class BitmapFont;
 class Game;
+class TaskScheduler;
 
 // one-time declaration
 extern App*                   g_app;
 extern BitmapFont*            g_bitmapFont;
 extern Game*                  g_game;
+extern TaskScheduler*         g_taskScheduler;
 
 //----------------------------------------------------------------------------------------------------
 // DebugRender-related
@@ -6,11 +6,101 @@
 #include "Game/Framework/App.hpp"
 //----------------------------------------------------------------------------------------------------
 #include "Game/Framework/GameCommon.hpp"
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/QueryServer.hpp"
 //----------------------------------------------------------------------------------------------------
 #include "Engine/Core/EngineCommon.hpp"
 //----------------------------------------------------------------------------------------------------
 #define WIN32_LEAN_AND_MEAN		// Always #define this before #including <windows.h>
 #include <windows.h>			// #include this (massive, platform-specific) header in VERY few places (and .CPPs only)
+//----------------------------------------------------------------------------------------------------
+#include <charconv>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------
+// Value of a "key=value" token on the command line, or defaultValue
+//----------------------------------------------------------------------------------------------------
+static std::string GetCommandLineValue(std::string const& commandLine, std::string const& key, std::string const& defaultValue)
+{
+    std::istringstream tokens(commandLine);
+    std::string        token;
+    while (tokens >> token)
+    {
+        if (token.size() > key.size() && token.compare(0, key.size(), key) == 0 && token[key.size()] == '=')
+        {
+            return token.substr(key.size() + 1);
+        }
+    }
+    return defaultValue;
+}
+
+//----------------------------------------------------------------------------------------------------
+// A whole-token decimal port in 1-65535; anything else is rejected rather than truncated
+//----------------------------------------------------------------------------------------------------
+static bool ParsePort(std::string const& text, uint16_t& out_port)
+{
+    int                    value  = 0;
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size() || value < 1 || value > 65535)
+    {
+        return false;
+    }
+    out_port = static_cast<uint16_t>(value);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RunHeadlessQueryServer - "-QueryServer scene=<path> port=<n> socket=<path>" serves a scene without a
+// window or renderer, until a client sends SHUTDOWN
+//----------------------------------------------------------------------------------------------------
+static int RunHeadlessQueryServer(std::string const& commandLine)
+{
+    if (AttachConsole(ATTACH_PARENT_PROCESS) || AllocConsole())
+    {
+        FILE* stream = nullptr;
+        freopen_s(&stream, "CONOUT$", "w", stdout);
+        freopen_s(&stream, "CONOUT$", "w", stderr);
+    }
+
+    QueryServerConfig config;
+    config.m_scenePath                 = GetCommandLineValue(commandLine, "scene", "Data/Scenes/default.ghcs");
+    config.m_endpoint.m_unixSocketPath = GetCommandLineValue(commandLine, "socket", "");
+
+    std::string const portText = GetCommandLineValue(commandLine, "port", std::to_string(config.m_endpoint.m_port));
+    if (!ParsePort(portText, config.m_endpoint.m_port))
+    {
+        std::fprintf(stderr, "Invalid port=%s; usage: -QueryServer scene=<path> port=<1-65535> socket=<path>\n", portText.c_str());
+        return 1;
+    }
+
+    g_taskScheduler = new TaskScheduler(sTaskSchedulerConfig());
+    g_taskScheduler->Startup();
+
+    int         exitCode = 0;
+    QueryServer server;
+    std::string error;
+    if (server.Start(config, error))
+    {
+        std::printf("%s\n", server.GetDescription().c_str());
+        while (!server.IsShutdownRequested())
+        {
+            Sleep(100);
+        }
+        std::printf("%s\n", server.GetDescription().c_str());
+        server.Stop();
+    }
+    else
+    {
+        std::fprintf(stderr, "Query server failed to start: %s\n", error.c_str());
+        exitCode = 1;
+    }
+
+    g_taskScheduler->Shutdown();
+    GAME_SAFE_RELEASE(g_taskScheduler);
+    return exitCode;
+}
 
 //-----------------------------------------------------------------------------------------------
 int WINAPI WinMain(HINSTANCE const applicationInstanceHandle,
@@ -19,7 +109,12 @@ int WINAPI WinMain(HINSTANCE const applicationInstanceHandle,
                    int)
 {
     UNUSED(applicationInstanceHandle)
-    UNUSED(commandLineString)
+
+    std::string const commandLine = (commandLineString != nullptr) ? commandLineString : "";
+    if (commandLine.find("-QueryServer") != std::string::npos)
+    {
+        return RunHeadlessQueryServer(commandLine);
+    }
 
     g_app = new App();
     g_app->Startup();
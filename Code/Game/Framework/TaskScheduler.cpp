@@ -0,0 +1,299 @@
+//----------------------------------------------------------------------------------------------------
+// TaskScheduler.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+//----------------------------------------------------------------------------------------------------
+constexpr size_t TASK_SCRATCH_BLOCK_SIZE = 64 * 1024;
+
+//----------------------------------------------------------------------------------------------------
+// Which scheduler (if any) owns this thread, and its queue there; threads it does not own use queue 0
+//----------------------------------------------------------------------------------------------------
+static thread_local TaskScheduler const* s_ownerScheduler = nullptr;
+static thread_local int                  s_ownerQueueIndex = 0;
+
+//----------------------------------------------------------------------------------------------------
+TaskGroup::TaskGroup()
+    : m_scheduler(g_taskScheduler)
+{
+}
+
+//----------------------------------------------------------------------------------------------------
+TaskGroup::~TaskGroup()
+{
+    // Queued tasks point at this group; never let it die under them
+    Wait();
+}
+
+//----------------------------------------------------------------------------------------------------
+void TaskGroup::Run(TaskFunction task)
+{
+    if (m_scheduler == nullptr)
+    {
+        task();
+        return;
+    }
+    m_scheduler->Submit(*this, std::move(task));
+}
+
+//----------------------------------------------------------------------------------------------------
+void TaskGroup::Wait()
+{
+    if (m_scheduler != nullptr)
+    {
+        m_scheduler->Wait(*this);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+TaskScheduler::TaskScheduler(sTaskSchedulerConfig const& config)
+    : m_config(config)
+{
+}
+
+//----------------------------------------------------------------------------------------------------
+TaskScheduler::~TaskScheduler()
+{
+    Shutdown();
+}
+
+//----------------------------------------------------------------------------------------------------
+void TaskScheduler::Startup()
+{
+    int numWorkers = m_config.m_numWorkers;
+    if (numWorkers < 0)
+    {
+        numWorkers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    }
+    numWorkers = std::max(numWorkers, 0);
+
+    m_isStopping = false;
+    m_queues.clear();
+    for (int i = 0; i <= numWorkers; ++i)
+    {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    m_workers.reserve(numWorkers);
+    for (int i = 1; i <= numWorkers; ++i)
+    {
+        m_workers.emplace_back(&TaskScheduler::WorkerMain, this, i);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+// Shutdown - Callers wait on their groups, so nothing is queued by the time the game shuts down
+//----------------------------------------------------------------------------------------------------
+void TaskScheduler::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_isStopping = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+//----------------------------------------------------------------------------------------------------
+void TaskScheduler::Submit(TaskGroup& group, TaskFunction task)
+{
+    group.m_numPending.fetch_add(1, std::memory_order_relaxed);
+
+    WorkerQueue& queue = *m_queues[GetQueueIndexForThisThread()];
+    {
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        queue.m_tasks.push_back(Task{std::move(task), &group});
+    }
+    m_numQueuedTasks.fetch_add(1, std::memory_order_release);
+
+    // Taking the sleep mutex orders this wake-up after any worker's check of the queued count
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wakeCondition.notify_one();
+}
+
+//----------------------------------------------------------------------------------------------------
+void TaskScheduler::Wait(TaskGroup& group)
+{
+    int queueIndex = GetQueueIndexForThisThread();
+    while (!group.IsDone())
+    {
+        if (!TryRunOneTask(queueIndex))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+void TaskScheduler::WorkerMain(int queueIndex)
+{
+    s_ownerScheduler  = this;
+    s_ownerQueueIndex = queueIndex;
+
+    while (!m_isStopping.load(std::memory_order_acquire))
+    {
+        if (TryRunOneTask(queueIndex))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeCondition.wait(lock, [this]()
+        {
+            return m_isStopping.load(std::memory_order_acquire) || m_numQueuedTasks.load(std::memory_order_acquire) > 0;
+        });
+    }
+
+    s_ownerScheduler = nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool TaskScheduler::TryRunOneTask(int queueIndex)
+{
+    Task task;
+    if (!PopOrSteal(queueIndex, task))
+    {
+        return false;
+    }
+
+    task.m_function();
+    task.m_group->m_numPending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// PopOrSteal - Newest task from our own queue, else the oldest from the next non-empty victim
+//----------------------------------------------------------------------------------------------------
+bool TaskScheduler::PopOrSteal(int queueIndex, Task& out_task)
+{
+    if (m_numQueuedTasks.load(std::memory_order_acquire) <= 0)
+    {
+        return false;
+    }
+
+    {
+        WorkerQueue& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        if (!queue.m_tasks.empty())
+        {
+            out_task = std::move(queue.m_tasks.back());
+            queue.m_tasks.pop_back();
+            m_numQueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    int numQueues = static_cast<int>(m_queues.size());
+    for (int offset = 1; offset < numQueues; ++offset)
+    {
+        WorkerQueue& victim = *m_queues[(queueIndex + offset) % numQueues];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (!victim.m_tasks.empty())
+        {
+            out_task = std::move(victim.m_tasks.front());
+            victim.m_tasks.pop_front();
+            m_numQueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            m_numStolenTasks.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------------------------------------
+int TaskScheduler::GetQueueIndexForThisThread() const
+{
+    return (s_ownerScheduler == this) ? s_ownerQueueIndex : 0;
+}
+
+//----------------------------------------------------------------------------------------------------
+int GetNumTaskThreads()
+{
+    return (g_taskScheduler != nullptr) ? g_taskScheduler->GetNumThreads() : 1;
+}
+
+//----------------------------------------------------------------------------------------------------
+void RunOnWorkers(int numWorkers, std::function<void(int)> const& worker)
+{
+    TaskGroup group;
+    for (int workerIndex = 1; workerIndex < numWorkers; ++workerIndex)
+    {
+        group.Run([&worker, workerIndex]() { worker(workerIndex); });
+    }
+    worker(0);
+    group.Wait();
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC TaskScratch& TaskScratch::GetForThisThread()
+{
+    static thread_local TaskScratch s_scratch;
+    return s_scratch;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Allocate - Bump within the current block; move on to the next block (reused or new) when it is full
+//----------------------------------------------------------------------------------------------------
+void* TaskScratch::Allocate(size_t numBytes, size_t alignment)
+{
+    for (;;)
+    {
+        if (m_blockIndex < static_cast<int>(m_blocks.size()))
+        {
+            Block&    block   = m_blocks[m_blockIndex];
+            uintptr_t base    = reinterpret_cast<uintptr_t>(block.m_bytes.get());
+            size_t    aligned = ((base + m_offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+            if (aligned + numBytes <= block.m_size)
+            {
+                m_offset = aligned + numBytes;
+                return block.m_bytes.get() + aligned;
+            }
+            if (m_offset == 0 && m_blockIndex + 1 == static_cast<int>(m_blocks.size()))
+            {
+                // A fresh block too small for this request: replace it rather than skipping it forever
+                m_blocks.pop_back();
+                continue;
+            }
+            ++m_blockIndex;
+            m_offset = 0;
+            continue;
+        }
+
+        Block block;
+        block.m_size  = std::max(TASK_SCRATCH_BLOCK_SIZE, numBytes + alignment);
+        block.m_bytes = std::make_unique<uint8_t[]>(block.m_size);
+        m_blocks.push_back(std::move(block));
+        m_offset = 0;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+void TaskScratch::RewindToMarker(Marker const& marker)
+{
+    GUARANTEE_OR_DIE(marker.m_blockIndex < m_blockIndex || (marker.m_blockIndex == m_blockIndex && marker.m_offset <= m_offset), "TaskScratch rewound past its top");
+    m_blockIndex = marker.m_blockIndex;
+    m_offset     = marker.m_offset;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t TaskScratch::GetCapacity() const
+{
+    size_t capacity = 0;
+    for (Block const& block : m_blocks)
+    {
+        capacity += block.m_size;
+    }
+    return capacity;
+}
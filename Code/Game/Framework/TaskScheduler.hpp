@@ -0,0 +1,227 @@
+//----------------------------------------------------------------------------------------------------
+// TaskScheduler.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/GameCommon.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+using TaskFunction = std::function<void()>;
+
+//----------------------------------------------------------------------------------------------------
+struct sTaskSchedulerConfig
+{
+    int m_numWorkers = -1; // Background threads; negative = hardware threads - 1 (the waiting thread also runs tasks)
+};
+
+//----------------------------------------------------------------------------------------------------
+// TaskGroup - Counts a batch of tasks so the submitting thread can wait for all of them
+//
+// Without a running scheduler, Run executes the task inline, so callers need no serial fallback.
+//----------------------------------------------------------------------------------------------------
+class TaskGroup
+{
+public:
+    TaskGroup();
+    explicit TaskGroup(TaskScheduler* scheduler) : m_scheduler(scheduler) {}
+    TaskGroup(TaskGroup const&)            = delete;
+    TaskGroup& operator=(TaskGroup const&) = delete;
+    ~TaskGroup();
+
+    void Run(TaskFunction task);
+    void Wait();
+    bool IsDone() const { return m_numPending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class TaskScheduler;
+
+    TaskScheduler*   m_scheduler  = nullptr;
+    std::atomic<int> m_numPending = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+// TaskScheduler - Work-stealing pool shared by every parallel feature of the game layer
+//
+// Each worker owns a deque: it pushes and pops at the back (newest first, cache-warm), idle workers
+// steal from the front of others (oldest first, usually the biggest pieces of a split range).
+// Threads that are not workers, such as the main thread, share queue 0. Waiting never blocks a
+// thread that could be running tasks: Wait runs queued tasks until its group is done.
+//----------------------------------------------------------------------------------------------------
+class TaskScheduler
+{
+public:
+    explicit TaskScheduler(sTaskSchedulerConfig const& config);
+    ~TaskScheduler();
+
+    void Startup();
+    void Shutdown();
+
+    int      GetNumWorkers() const { return static_cast<int>(m_workers.size()); }
+    int      GetNumThreads() const { return GetNumWorkers() + 1; }
+    uint64_t GetNumStolenTasks() const { return m_numStolenTasks.load(std::memory_order_relaxed); }
+
+    void Submit(TaskGroup& group, TaskFunction task);
+    void Wait(TaskGroup& group);
+
+    // func(first, last) over [begin, end) in chunks of at least minGrain. The grain adapts to the range:
+    // about four chunks per thread, so stealing can even out uneven work without drowning it in tasks.
+    template <typename Func>
+    void ParallelFor(int begin, int end, int minGrain, Func const& func);
+
+private:
+    struct Task
+    {
+        TaskFunction m_function;
+        TaskGroup*   m_group = nullptr;
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex       m_mutex;
+        std::deque<Task> m_tasks;
+    };
+
+    void WorkerMain(int queueIndex);
+    bool TryRunOneTask(int queueIndex);
+    bool PopOrSteal(int queueIndex, Task& out_task);
+    int  GetQueueIndexForThisThread() const;
+
+    sTaskSchedulerConfig                      m_config;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues; // [0] = non-worker threads, [i] = worker i
+    std::vector<std::thread>                  m_workers;
+    std::mutex                                m_sleepMutex;
+    std::condition_variable                   m_wakeCondition;
+    std::atomic<int>                          m_numQueuedTasks = 0;
+    std::atomic<bool>                         m_isStopping     = false;
+    std::atomic<uint64_t>                     m_numStolenTasks = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+template <typename Func>
+void TaskScheduler::ParallelFor(int begin, int end, int minGrain, Func const& func)
+{
+    int count = end - begin;
+    if (count <= 0)
+    {
+        return;
+    }
+
+    int grain = std::max(std::max(minGrain, 1), count / (GetNumThreads() * 4));
+    if (count <= grain)
+    {
+        func(begin, end);
+        return;
+    }
+
+    // Lazy binary splitting: keep the front half, offer the back half to thieves, repeat
+    TaskGroup group(this);
+    std::function<void(int, int)> runRange = [&](int first, int last)
+    {
+        while (last - first > grain)
+        {
+            int middle = first + (last - first) / 2;
+            Submit(group, [&runRange, middle, last]() { runRange(middle, last); });
+            last = middle;
+        }
+        func(first, last);
+    };
+    runRange(begin, end);
+    Wait(group);
+}
+
+//----------------------------------------------------------------------------------------------------
+// ParallelFor - Over g_taskScheduler, or inline when no scheduler is running (tools, early startup)
+//----------------------------------------------------------------------------------------------------
+template <typename Func>
+void ParallelFor(int begin, int end, int minGrain, Func const& func)
+{
+    if (g_taskScheduler != nullptr)
+    {
+        g_taskScheduler->ParallelFor(begin, end, minGrain, func);
+    }
+    else if (begin < end)
+    {
+        func(begin, end);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+// RunOnWorkers - worker(workerIndex) for every index below numWorkers: index 0 on the calling thread,
+// the rest as tasks. Workers typically pull blocks from a shared counter, so a worker that starts
+// late simply finds nothing left. Size numWorkers with GetNumTaskThreads.
+//----------------------------------------------------------------------------------------------------
+int  GetNumTaskThreads();
+void RunOnWorkers(int numWorkers, std::function<void(int)> const& worker);
+
+//----------------------------------------------------------------------------------------------------
+// TaskScratch - Per-thread bump allocator for temporary arrays inside tasks
+//
+// Memory comes from chained blocks that are kept between uses; a TaskScratchScope rewinds everything
+// allocated after it was opened. Only trivially destructible types belong here.
+//----------------------------------------------------------------------------------------------------
+class TaskScratch
+{
+public:
+    struct Marker
+    {
+        int    m_blockIndex = 0;
+        size_t m_offset     = 0;
+    };
+
+    static TaskScratch& GetForThisThread();
+
+    void*  Allocate(size_t numBytes, size_t alignment = alignof(std::max_align_t));
+    Marker GetMarker() const { return Marker{m_blockIndex, m_offset}; }
+    void   RewindToMarker(Marker const& marker);
+    size_t GetCapacity() const;
+
+    template <typename T>
+    std::span<T> AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "TaskScratch never runs destructors");
+        return std::span<T>(static_cast<T*>(Allocate(count * sizeof(T), alignof(T))), count);
+    }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> m_bytes;
+        size_t                     m_size = 0;
+    };
+
+    std::vector<Block> m_blocks;
+    int                m_blockIndex = 0;
+    size_t             m_offset     = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+class TaskScratchScope
+{
+public:
+    TaskScratchScope() : m_scratch(TaskScratch::GetForThisThread()), m_marker(m_scratch.GetMarker()) {}
+    ~TaskScratchScope() { m_scratch.RewindToMarker(m_marker); }
+    TaskScratchScope(TaskScratchScope const&)            = delete;
+    TaskScratchScope& operator=(TaskScratchScope const&) = delete;
+
+    TaskScratch& GetScratch() const { return m_scratch; }
+
+private:
+    TaskScratch&        m_scratch;
+    TaskScratch::Marker m_marker;
+};
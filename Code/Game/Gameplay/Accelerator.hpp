@@ -0,0 +1,226 @@
+//----------------------------------------------------------------------------------------------------
+// Accelerator.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/BVH.hpp"
+#include "Game/Gameplay/NearestQuery.hpp"
+#include "Game/Gameplay/PartitionedTree.hpp"
+#include "Game/Gameplay/QuadTree.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+#include "Game/Gameplay/SceneQuery.hpp"
+#include "Game/Gameplay/ShapeCast.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+// SpatialAccelerator - What a broad-phase structure must offer to be benchmarked and queried.
+// Ray queries are seeded: a hit already in inout_best bounds the search. Every query takes a
+// QueryFilter and only reports objects whose category it accepts.
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+concept SpatialAccelerator = requires(T& accelerator, T const& constAccelerator, std::vector<Convex2*> const& convexes, AABB2 const& bounds,
+									  Vec2 const& point, float distance, QueryScratch& scratch, ClosestRayHit& hit,
+									  RegionQueryShape const& shape, RegionOverlapCollector& collector, RayPenetrationCollector& penetrations, NearestConvexCollector& nearest,
+									  ShapeCastCollector& shapeCast, QueryFilter const& filter)
+{
+	{ T::GetName() } -> std::convertible_to<char const*>;
+	{ T::QUERY_MODE } -> std::convertible_to<eQueryMode>;
+	accelerator.Build(convexes, bounds);
+	accelerator.Refit();
+	{ constAccelerator.RaycastClosest(point, point, distance, scratch, hit, filter) } -> std::same_as<bool>;
+	{ constAccelerator.RaycastAny(point, point, distance, scratch, filter) } -> std::same_as<bool>;
+	constAccelerator.CollectRegionOverlaps(shape, scratch, collector, filter);
+	constAccelerator.CollectRayPenetrations(point, point, distance, scratch, penetrations, filter);
+	constAccelerator.CollectNearestConvexes(scratch, nearest, filter);
+	constAccelerator.CollectShapeCastHits(scratch, shapeCast, filter);
+	{ constAccelerator.GetStats() } -> std::same_as<AcceleratorStats>;
+	{ constAccelerator.GetMemoryBytes() } -> std::convertible_to<size_t>;
+};
+
+//----------------------------------------------------------------------------------------------------
+// BruteForceScan - The no-tree baselines: every convex, behind an optional bounding-volume rejection
+//----------------------------------------------------------------------------------------------------
+template <eQueryMode MODE>
+class BruteForceScan
+{
+public:
+	static constexpr eQueryMode QUERY_MODE     = MODE;
+	static constexpr bool       DISC_REJECTION = (MODE != eQueryMode::NO_OPTIMIZATION);
+	static constexpr bool       BOX_REJECTION  = (MODE == eQueryMode::AABB_REJECTION);
+
+	BruteForceScan() = default;
+	explicit BruteForceScan(std::vector<Convex2*> const& convexes) : m_convexes(&convexes) {}
+
+	static char const* GetName()
+	{
+		if constexpr (MODE == eQueryMode::NO_OPTIMIZATION) return "None";
+		else if constexpr (MODE == eQueryMode::DISC_REJECTION) return "Disc";
+		else return "AABB";
+	}
+
+	void Build(std::vector<Convex2*> const& convexes, AABB2 const&) { m_convexes = &convexes; }
+	void Refit() {}
+
+	bool RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch&, ClosestRayHit& inout_best, QueryFilter const& filter = QueryFilter()) const
+	{
+		NarrowPhaseClosestHit(*m_convexes, startPos, forwardVec, std::min(maxDist, inout_best.m_dist), DISC_REJECTION, BOX_REJECTION, inout_best, filter);
+		return inout_best.m_objectId != -1;
+	}
+
+	bool RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch&, QueryFilter const& filter = QueryFilter()) const
+	{
+		return NarrowPhaseAnyHit(*m_convexes, startPos, forwardVec, maxDist, DISC_REJECTION, BOX_REJECTION, filter);
+	}
+
+	void CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch&, RayPenetrationCollector& collector, QueryFilter const& filter = QueryFilter()) const
+	{
+		CollectRayPenetrationsBruteForce(*m_convexes, startPos, forwardVec, maxDist, DISC_REJECTION, BOX_REJECTION, collector, filter);
+	}
+
+	void CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch&, RegionOverlapCollector& collector, QueryFilter const& filter = QueryFilter()) const
+	{
+		CollectRegionOverlapsBruteForce(*m_convexes, MODE, shape, collector, filter);
+	}
+
+	void CollectNearestConvexes(QueryScratch&, NearestConvexCollector& collector, QueryFilter const& filter = QueryFilter()) const
+	{
+		CollectNearestConvexesBruteForce(*m_convexes, MODE, collector, filter);
+	}
+
+	void CollectShapeCastHits(QueryScratch&, ShapeCastCollector& collector, QueryFilter const& filter = QueryFilter()) const
+	{
+		CollectShapeCastHitsBruteForce(*m_convexes, MODE, collector, filter);
+	}
+
+	AcceleratorStats GetStats() const
+	{
+		AcceleratorStats stats;
+		stats.m_numLeaves      = 1;
+		stats.m_numObjectRefs  = static_cast<int>(m_convexes->size());
+		stats.m_maxLeafObjects = stats.m_numObjectRefs;
+		return stats;
+	}
+
+	size_t GetMemoryBytes() const { return 0; }
+
+private:
+	std::vector<Convex2*> const* m_convexes = nullptr;
+};
+
+//----------------------------------------------------------------------------------------------------
+// AcceleratorRegistry - Compile-time list of accelerators; enumeration and runtime selection both
+// instantiate the caller's templated lambda per type, so inner loops never go through a virtual call
+//----------------------------------------------------------------------------------------------------
+template <SpatialAccelerator... Accelerators>
+struct AcceleratorRegistry
+{
+	static constexpr int COUNT = static_cast<int>(sizeof...(Accelerators));
+
+	// One private instance of every accelerator; std::get<T> picks one out inside ForEach
+	using Instances = std::tuple<Accelerators...>;
+
+	template <typename Func>
+	static void ForEach(Func&& func)
+	{
+		(func.template operator()<Accelerators>(), ...);
+	}
+
+	template <typename Func>
+	static void Dispatch(int index, Func&& func)
+	{
+		int i = 0;
+		static_cast<void>(((i++ == index ? (func.template operator()<Accelerators>(), true) : false) || ...));
+	}
+
+	static constexpr bool IsInQueryModeOrder()
+	{
+		int i = 0;
+		return ((static_cast<int>(Accelerators::QUERY_MODE) == i++) && ...);
+	}
+
+	static char const* GetName(int index)
+	{
+		char const* names[] = {Accelerators::GetName()...};
+		return (index >= 0 && index < COUNT) ? names[index] : "";
+	}
+};
+
+//----------------------------------------------------------------------------------------------------
+// SceneAccelerators - Registration order is eQueryMode order, so a mode is also a registry index
+//----------------------------------------------------------------------------------------------------
+using SceneAccelerators = AcceleratorRegistry<BruteForceScan<eQueryMode::NO_OPTIMIZATION>,
+											  BruteForceScan<eQueryMode::DISC_REJECTION>,
+											  BruteForceScan<eQueryMode::AABB_REJECTION>,
+											  SymmetricQuadTree,
+											  AABB2Tree,
+											  PartitionedTree>;
+
+static_assert(SceneAccelerators::COUNT == static_cast<int>(eQueryMode::COUNT), "Every query mode needs a registered accelerator");
+static_assert(SceneAccelerators::IsInQueryModeOrder(), "Accelerators must be registered in eQueryMode order");
+
+//----------------------------------------------------------------------------------------------------
+// GetSceneAccelerator - The scene's instance of T: a reference to its tree, or a scan over its convexes
+//----------------------------------------------------------------------------------------------------
+template <SpatialAccelerator T>
+decltype(auto) GetSceneAccelerator(SceneQueryView const& scene)
+{
+	if constexpr (std::is_same_v<T, AABB2Tree>)
+	{
+		return *scene.m_AABB2Tree;
+	}
+	else if constexpr (std::is_same_v<T, SymmetricQuadTree>)
+	{
+		return *scene.m_symQuadTree;
+	}
+	else if constexpr (std::is_same_v<T, PartitionedTree>)
+	{
+		return *scene.m_partitionedTree;
+	}
+	else
+	{
+		return T(*scene.m_convexes);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// Dispatch a query mode to its accelerator; func is a templated lambda taking the accelerator
+//----------------------------------------------------------------------------------------------------
+template <typename Func>
+void DispatchSceneAccelerator(SceneQueryView const& scene, eQueryMode mode, Func&& func)
+{
+	SceneAccelerators::Dispatch(static_cast<int>(mode), [&]<typename T>()
+	{
+		func(GetSceneAccelerator<T>(scene));
+	});
+}
+
+//----------------------------------------------------------------------------------------------------
+// Closest hit for every ray through one statically known accelerator
+//----------------------------------------------------------------------------------------------------
+template <SpatialAccelerator T>
+int RaycastBatchWith(T const& accelerator, RayBatch const& rays, RayHitBatch const& out_hits, QueryFilter const& filter = QueryFilter())
+{
+	QueryScratch& scratch = QueryScratch::GetForThisThread();
+	int           numHits = 0;
+	for (int j = 0; j < rays.GetNumRays(); ++j)
+	{
+		ClosestRayHit best;
+		if (accelerator.RaycastClosest(rays.m_startPositions[j], rays.m_forwardNormals[j], rays.m_maxDists[j], scratch, best, filter))
+		{
+			++numHits;
+		}
+		out_hits.m_impactDists[j]     = best.m_dist;
+		out_hits.m_impactObjectIds[j] = best.m_objectId;
+		out_hits.m_impactNormals[j]   = best.m_normal;
+	}
+	return numHits;
+}
@@ -0,0 +1,160 @@
+//----------------------------------------------------------------------------------------------------
+// AcceleratorTuner.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/AcceleratorTuner.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/Time.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+
+//----------------------------------------------------------------------------------------------------
+// Accelerators with a build depth are timed at each depth in their range; the rest once, as built
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+concept DepthTunableAccelerator = SpatialAccelerator<T> && requires(T& accelerator, int depth)
+{
+	{ T::MIN_BUILD_DEPTH } -> std::convertible_to<int>;
+	{ T::MAX_BUILD_DEPTH } -> std::convertible_to<int>;
+	accelerator.SetBuildDepth(depth);
+};
+
+//----------------------------------------------------------------------------------------------------
+template <SpatialAccelerator T>
+static float TimeWorkload(T const& accelerator, RayBatch const& workload, RayHitBatch const& hits, int numPasses)
+{
+	float bestTimeMs = FLT_MAX;
+	for (int pass = 0; pass < numPasses; ++pass)
+	{
+		double startTime = GetCurrentTimeSeconds();
+		RaycastBatchWith(accelerator, workload, hits);
+		double endTime   = GetCurrentTimeSeconds();
+		bestTimeMs = std::min(bestTimeMs, static_cast<float>((endTime - startTime) * 1000.0));
+	}
+	return bestTimeMs;
+}
+
+//----------------------------------------------------------------------------------------------------
+// TuneSceneAccelerators - Depths are tried shallow to deep. Memory only grows with depth, so the
+// first candidate over budget ends that accelerator's sweep, as does a level where no leaf holds
+// more than one object (deeper levels could only add empty nodes).
+//----------------------------------------------------------------------------------------------------
+AcceleratorTuning TuneSceneAccelerators(std::vector<Convex2*> const& convexes, AABB2 const& bounds, RayBatch const& workload,
+										AcceleratorTunerConfig const& config, std::vector<AcceleratorTuningCandidate>* out_candidates)
+{
+	AcceleratorTuning tuning;
+	tuning.m_numObjects = static_cast<int>(convexes.size());
+	if (out_candidates)
+	{
+		out_candidates->clear();
+	}
+
+	// Subsample long workloads evenly so brute-force candidates stay affordable
+	int numRays = std::min(workload.GetNumRays(), std::max(config.m_maxWorkloadRays, 1));
+	if (numRays == 0)
+	{
+		return tuning;
+	}
+	std::vector<Vec2>  startPositions(numRays);
+	std::vector<Vec2>  forwardNormals(numRays);
+	std::vector<float> maxDists(numRays);
+	for (int j = 0; j < numRays; ++j)
+	{
+		int source = static_cast<int>(static_cast<int64_t>(j) * workload.GetNumRays() / numRays);
+		startPositions[j] = workload.m_startPositions[source];
+		forwardNormals[j] = workload.m_forwardNormals[source];
+		maxDists[j]       = workload.m_maxDists[source];
+	}
+	tuning.m_numRays = numRays;
+
+	std::vector<float> hitDists(numRays);
+	std::vector<int>   hitObjectIds(numRays);
+	std::vector<Vec2>  hitNormals(numRays);
+	RayBatch    rays{startPositions, forwardNormals, maxDists};
+	RayHitBatch hits{hitDists, hitObjectIds, hitNormals};
+	int const   numPasses = std::max(config.m_numTimedPasses, 1);
+
+	auto consider = [&](AcceleratorTuningCandidate const& candidate)
+	{
+		if (out_candidates)
+		{
+			out_candidates->push_back(candidate);
+		}
+		if (!candidate.m_isOverBudget && (!tuning.m_isValid || candidate.m_queryTimeMs < tuning.m_bestTimeMs))
+		{
+			tuning.m_queryMode  = candidate.m_queryMode;
+			tuning.m_bestTimeMs = candidate.m_queryTimeMs;
+			tuning.m_isValid    = true;
+		}
+	};
+
+	SceneAccelerators::ForEach([&]<typename Accelerator>()
+	{
+		if constexpr (DepthTunableAccelerator<Accelerator>)
+		{
+			int const modeIndex = static_cast<int>(Accelerator::QUERY_MODE);
+			int   bestDepth  = 0;
+			float bestTimeMs = FLT_MAX;
+			for (int depth = Accelerator::MIN_BUILD_DEPTH; depth <= Accelerator::MAX_BUILD_DEPTH; ++depth)
+			{
+				Accelerator accelerator;
+				accelerator.SetBuildDepth(depth);
+				double buildStartTime = GetCurrentTimeSeconds();
+				accelerator.Build(convexes, bounds);
+				double buildEndTime   = GetCurrentTimeSeconds();
+
+				AcceleratorTuningCandidate candidate;
+				candidate.m_queryMode    = Accelerator::QUERY_MODE;
+				candidate.m_buildDepth   = depth;
+				candidate.m_buildTimeMs  = static_cast<float>((buildEndTime - buildStartTime) * 1000.0);
+				candidate.m_memoryBytes  = accelerator.GetMemoryBytes();
+				candidate.m_isOverBudget = candidate.m_memoryBytes > config.m_memoryBudgetBytes;
+				if (candidate.m_isOverBudget)
+				{
+					if (out_candidates)
+					{
+						out_candidates->push_back(candidate);
+					}
+					break;
+				}
+
+				candidate.m_queryTimeMs = TimeWorkload(accelerator, rays, hits, numPasses);
+				if (candidate.m_queryTimeMs < bestTimeMs)
+				{
+					bestTimeMs = candidate.m_queryTimeMs;
+					bestDepth  = depth;
+				}
+				consider(candidate);
+				if (accelerator.GetStats().m_maxLeafObjects <= 1)
+				{
+					break;
+				}
+			}
+
+			// Kept even when another accelerator wins, so switching modes still gets a tuned tree
+			tuning.m_buildDepths[modeIndex] = static_cast<uint8_t>(bestDepth);
+		}
+		else
+		{
+			Accelerator accelerator;
+			accelerator.Build(convexes, bounds);
+
+			AcceleratorTuningCandidate candidate;
+			candidate.m_queryMode    = Accelerator::QUERY_MODE;
+			candidate.m_memoryBytes  = accelerator.GetMemoryBytes();
+			candidate.m_isOverBudget = candidate.m_memoryBytes > config.m_memoryBudgetBytes;
+			if (!candidate.m_isOverBudget)
+			{
+				candidate.m_queryTimeMs = TimeWorkload(accelerator, rays, hits, numPasses);
+			}
+			consider(candidate);
+		}
+	});
+
+	return tuning;
+}
@@ -0,0 +1,64 @@
+//----------------------------------------------------------------------------------------------------
+// AcceleratorTuner.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct Convex2;
+struct RayBatch;
+
+//----------------------------------------------------------------------------------------------------
+// AcceleratorTuning - The accelerator and build parameters picked for one scene
+//
+// Build depths are indexed by query mode; 0 means the accelerator's own default (and is the only
+// value for accelerators without a depth). Saved with the scene so loading skips the tuning pass.
+//----------------------------------------------------------------------------------------------------
+struct AcceleratorTuning
+{
+	eQueryMode m_queryMode   = eQueryMode::AABB2_TREE;
+	uint8_t    m_buildDepths[static_cast<int>(eQueryMode::COUNT)] = {};
+	int        m_numObjects  = 0;    // Scene size the workload was timed on
+	int        m_numRays     = 0;    // Workload size the timings are for
+	float      m_bestTimeMs  = 0.f;
+	bool       m_isValid     = false;
+
+	int GetBuildDepth(eQueryMode mode) const { return m_buildDepths[static_cast<int>(mode)]; }
+};
+
+//----------------------------------------------------------------------------------------------------
+struct AcceleratorTuningCandidate
+{
+	eQueryMode m_queryMode    = eQueryMode::NO_OPTIMIZATION;
+	int        m_buildDepth   = 0;
+	float      m_buildTimeMs  = 0.f;
+	float      m_queryTimeMs  = 0.f; // Best of the timed passes over the workload
+	size_t     m_memoryBytes  = 0;
+	bool       m_isOverBudget = false;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct AcceleratorTunerConfig
+{
+	size_t m_memoryBudgetBytes = 16 * 1024 * 1024;
+	int    m_maxWorkloadRays   = 4096; // Longer workloads are subsampled evenly
+	int    m_numTimedPasses    = 3;
+};
+
+//----------------------------------------------------------------------------------------------------
+// TuneSceneAccelerators - Build every registered accelerator at each of its candidate depths on the
+// given scene, time closest-hit queries over the workload and keep the fastest that fits the budget.
+// Candidates are built in private instances; the scene's own trees are not touched.
+//----------------------------------------------------------------------------------------------------
+AcceleratorTuning TuneSceneAccelerators(std::vector<Convex2*> const& convexes, AABB2 const& bounds, RayBatch const& workload,
+										AcceleratorTunerConfig const& config = AcceleratorTunerConfig(),
+										std::vector<AcceleratorTuningCandidate>* out_candidates = nullptr);
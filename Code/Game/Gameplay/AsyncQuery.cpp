@@ -0,0 +1,350 @@
+//----------------------------------------------------------------------------------------------------
+// AsyncQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/AsyncQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Accelerator.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/Time.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int ASYNC_QUERIES_PER_TASK = 64;
+constexpr int ASYNC_MIN_RAYS_TO_SORT = 256; // Below this the sort costs more than the coherence saves
+
+//----------------------------------------------------------------------------------------------------
+// Interleaves the low 16 bits of x and y into a Z-order key
+//----------------------------------------------------------------------------------------------------
+static uint32_t GetMortonKey(uint32_t x, uint32_t y)
+{
+	auto spread = [](uint32_t v)
+	{
+		v = (v | (v << 8)) & 0x00FF00FFu;
+		v = (v | (v << 4)) & 0x0F0F0F0Fu;
+		v = (v | (v << 2)) & 0x33333333u;
+		v = (v | (v << 1)) & 0x55555555u;
+		return v;
+	};
+	return spread(x & 0xFFFFu) | (spread(y & 0xFFFFu) << 1);
+}
+
+//----------------------------------------------------------------------------------------------------
+void AsyncSceneQueries::Batch::Clear()
+{
+	m_closestStarts.clear();
+	m_closestForwards.clear();
+	m_closestMaxDists.clear();
+	m_closestStates.clear();
+	m_anyStarts.clear();
+	m_anyForwards.clear();
+	m_anyMaxDists.clear();
+	m_anyStates.clear();
+	m_regionShapes.clear();
+	m_regionStates.clear();
+}
+
+//----------------------------------------------------------------------------------------------------
+AsyncSceneQueries::AsyncSceneQueries(AsyncQueryConfig const& config)
+	: m_config(config)
+	, m_pending(std::make_unique<Batch>())
+{
+}
+
+//----------------------------------------------------------------------------------------------------
+AsyncSceneQueries::~AsyncSceneQueries()
+{
+	// Nothing may be left waiting on a future that can no longer complete
+	if (m_scene.m_convexes != nullptr)
+	{
+		Flush();
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void AsyncSceneQueries::SetScene(SceneQueryView const& scene, eQueryMode mode)
+{
+	m_scene     = scene;
+	m_queryMode = mode;
+}
+
+//----------------------------------------------------------------------------------------------------
+void AsyncSceneQueries::SetConfig(AsyncQueryConfig const& config)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_config = config;
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryFuture<ClosestRayHit> AsyncSceneQueries::SubmitRaycast(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist)
+{
+	std::shared_ptr<QueryFutureState<ClosestRayHit>> state = std::make_shared<QueryFutureState<ClosestRayHit>>();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_pending->m_closestStarts.push_back(startPos);
+	m_pending->m_closestForwards.push_back(forwardNormal);
+	m_pending->m_closestMaxDists.push_back(maxDist);
+	m_pending->m_closestStates.push_back(state);
+	OnSubmitted(lock);
+	return QueryFuture<ClosestRayHit>(std::move(state), this);
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryFuture<bool> AsyncSceneQueries::SubmitRaycastAny(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist)
+{
+	std::shared_ptr<QueryFutureState<bool>> state = std::make_shared<QueryFutureState<bool>>();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_pending->m_anyStarts.push_back(startPos);
+	m_pending->m_anyForwards.push_back(forwardNormal);
+	m_pending->m_anyMaxDists.push_back(maxDist);
+	m_pending->m_anyStates.push_back(state);
+	OnSubmitted(lock);
+	return QueryFuture<bool>(std::move(state), this);
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryFuture<std::vector<int>> AsyncSceneQueries::SubmitRegion(RegionQueryShape const& shape)
+{
+	std::shared_ptr<QueryFutureState<std::vector<int>>> state = std::make_shared<QueryFutureState<std::vector<int>>>();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_pending->m_regionShapes.push_back(shape);
+	m_pending->m_regionStates.push_back(state);
+	OnSubmitted(lock);
+	return QueryFuture<std::vector<int>>(std::move(state), this);
+}
+
+//----------------------------------------------------------------------------------------------------
+// OnSubmitted - Called with the lock held after a query was queued; may flush inline
+//----------------------------------------------------------------------------------------------------
+void AsyncSceneQueries::OnSubmitted(std::unique_lock<std::mutex>& lock)
+{
+	++m_stats.m_numSubmitted;
+	int    numPending = m_pending->GetNumQueries();
+	double now        = GetCurrentTimeSeconds();
+	if (numPending == 1)
+	{
+		m_oldestPendingTime = now;
+	}
+
+	bool isFull    = numPending >= m_config.m_maxBatchQueries;
+	bool isOverdue = (now - m_oldestPendingTime) * 1000.0 >= static_cast<double>(m_config.m_maxLatencyMs);
+	if (isFull || isOverdue)
+	{
+		lock.unlock();
+		Flush();
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+int AsyncSceneQueries::Poll()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_pending->GetNumQueries() == 0 || (GetCurrentTimeSeconds() - m_oldestPendingTime) * 1000.0 < static_cast<double>(m_config.m_batchWindowMs))
+		{
+			return 0;
+		}
+	}
+	return Flush();
+}
+
+//----------------------------------------------------------------------------------------------------
+int AsyncSceneQueries::Flush()
+{
+	// Take the whole queue, leaving a recycled batch for new submissions
+	std::unique_ptr<Batch> batch;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_pending->GetNumQueries() == 0)
+		{
+			return 0;
+		}
+		batch = std::move(m_pending);
+		if (m_spareBatches.empty())
+		{
+			m_pending = std::make_unique<Batch>();
+		}
+		else
+		{
+			m_pending = std::move(m_spareBatches.back());
+			m_spareBatches.pop_back();
+		}
+	}
+
+	int numQueries = batch->GetNumQueries();
+	std::vector<std::coroutine_handle<>> awaiters;
+	RunClosestRaycasts(*batch, awaiters);
+	RunAnyRaycasts(*batch, awaiters);
+	RunRegions(*batch, awaiters);
+
+	batch->Clear();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_spareBatches.push_back(std::move(batch));
+		++m_stats.m_numBatches;
+		m_stats.m_numBatchedQueries += numQueries;
+		m_stats.m_largestBatch = std::max(m_stats.m_largestBatch, numQueries);
+	}
+
+	// Only after every future in the batch is ready, so a resumed script sees all of its answers
+	for (std::coroutine_handle<> awaiter : awaiters)
+	{
+		awaiter.resume();
+	}
+	return numQueries;
+}
+
+//----------------------------------------------------------------------------------------------------
+int AsyncSceneQueries::GetNumPending() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending->GetNumQueries();
+}
+
+//----------------------------------------------------------------------------------------------------
+AsyncQueryStats AsyncSceneQueries::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RunClosestRaycasts - One RaycastBatchParallel over every closest-hit ray, optionally reordered along a
+// Z-order curve of the ray origins so rays traced by the same task walk the same part of the tree
+//----------------------------------------------------------------------------------------------------
+void AsyncSceneQueries::RunClosestRaycasts(Batch& batch, std::vector<std::coroutine_handle<>>& out_awaiters)
+{
+	int numRays = static_cast<int>(batch.m_closestStates.size());
+	if (numRays == 0)
+	{
+		return;
+	}
+
+	// Flushes can run on any thread, so temporaries come from its task scratch rather than the frame arena
+	TaskScratchScope scratchScope;
+	TaskScratch&     taskScratch = scratchScope.GetScratch();
+	std::span<int>   order       = taskScratch.AllocateArray<int>(numRays);
+	for (int i = 0; i < numRays; ++i)
+	{
+		order[i] = i;
+	}
+
+	RayBatch rays{batch.m_closestStarts, batch.m_closestForwards, batch.m_closestMaxDists};
+	if (m_config.m_sortRaysByOrigin && numRays >= ASYNC_MIN_RAYS_TO_SORT)
+	{
+		Vec2 mins = batch.m_closestStarts[0];
+		Vec2 maxs = mins;
+		for (Vec2 const& start : batch.m_closestStarts)
+		{
+			mins = Vec2(std::min(mins.x, start.x), std::min(mins.y, start.y));
+			maxs = Vec2(std::max(maxs.x, start.x), std::max(maxs.y, start.y));
+		}
+		float scaleX = 65535.f / std::max(maxs.x - mins.x, FLT_EPSILON);
+		float scaleY = 65535.f / std::max(maxs.y - mins.y, FLT_EPSILON);
+
+		std::span<uint32_t> keys = taskScratch.AllocateArray<uint32_t>(numRays);
+		for (int i = 0; i < numRays; ++i)
+		{
+			Vec2 const& start = batch.m_closestStarts[i];
+			keys[i] = GetMortonKey(static_cast<uint32_t>((start.x - mins.x) * scaleX), static_cast<uint32_t>((start.y - mins.y) * scaleY));
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+
+		std::span<Vec2>  sortedStarts   = taskScratch.AllocateArray<Vec2>(numRays);
+		std::span<Vec2>  sortedForwards = taskScratch.AllocateArray<Vec2>(numRays);
+		std::span<float> sortedMaxDists = taskScratch.AllocateArray<float>(numRays);
+		for (int i = 0; i < numRays; ++i)
+		{
+			sortedStarts[i]   = batch.m_closestStarts[order[i]];
+			sortedForwards[i] = batch.m_closestForwards[order[i]];
+			sortedMaxDists[i] = batch.m_closestMaxDists[order[i]];
+		}
+		rays = RayBatch{sortedStarts, sortedForwards, sortedMaxDists};
+	}
+
+	std::span<float> impactDists     = taskScratch.AllocateArray<float>(numRays);
+	std::span<int>   impactObjectIds = taskScratch.AllocateArray<int>(numRays);
+	std::span<Vec2>  impactNormals   = taskScratch.AllocateArray<Vec2>(numRays);
+	RaycastBatchParallel(m_scene, m_queryMode, rays, RayHitBatch{impactDists, impactObjectIds, impactNormals});
+
+	for (int i = 0; i < numRays; ++i)
+	{
+		ClosestRayHit hit;
+		hit.m_dist     = impactDists[i];
+		hit.m_objectId = impactObjectIds[i];
+		hit.m_normal   = impactNormals[i];
+		if (std::coroutine_handle<> awaiter = batch.m_closestStates[order[i]]->Complete(std::move(hit)))
+		{
+			out_awaiters.push_back(awaiter);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void AsyncSceneQueries::RunAnyRaycasts(Batch& batch, std::vector<std::coroutine_handle<>>& out_awaiters)
+{
+	int numRays = static_cast<int>(batch.m_anyStates.size());
+	if (numRays == 0)
+	{
+		return;
+	}
+
+	TaskScratchScope   scratchScope;
+	std::span<uint8_t> isBlocked = scratchScope.GetScratch().AllocateArray<uint8_t>(numRays);
+	DispatchSceneAccelerator(m_scene, m_queryMode, [&](auto const& accelerator)
+	{
+		ParallelFor(0, numRays, ASYNC_QUERIES_PER_TASK, [&](int first, int last)
+		{
+			QueryScratch& scratch = QueryScratch::GetForThisThread();
+			for (int j = first; j < last; ++j)
+			{
+				isBlocked[j] = accelerator.RaycastAny(batch.m_anyStarts[j], batch.m_anyForwards[j], batch.m_anyMaxDists[j], scratch, m_scene.m_filter) ? 1 : 0;
+			}
+		});
+	});
+
+	for (int i = 0; i < numRays; ++i)
+	{
+		if (std::coroutine_handle<> awaiter = batch.m_anyStates[i]->Complete(isBlocked[i] != 0))
+		{
+			out_awaiters.push_back(awaiter);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// RunRegions - Each query writes into its own fixed slot of one shared buffer, then is trimmed
+//----------------------------------------------------------------------------------------------------
+void AsyncSceneQueries::RunRegions(Batch& batch, std::vector<std::coroutine_handle<>>& out_awaiters)
+{
+	int numRegions = static_cast<int>(batch.m_regionStates.size());
+	if (numRegions == 0)
+	{
+		return;
+	}
+
+	int const        slotSize   = std::max(m_config.m_maxRegionResults, 1);
+	TaskScratchScope scratchScope;
+	std::span<int>   objectIds  = scratchScope.GetScratch().AllocateArray<int>(static_cast<size_t>(numRegions) * slotSize);
+	std::span<int>   numResults = scratchScope.GetScratch().AllocateArray<int>(numRegions);
+	ParallelFor(0, numRegions, ASYNC_QUERIES_PER_TASK, [&](int first, int last)
+	{
+		for (int r = first; r < last; ++r)
+		{
+			std::span<int> slot(objectIds.data() + static_cast<size_t>(r) * slotSize, slotSize);
+			numResults[r] = QueryRegionOverlaps(m_scene, m_queryMode, batch.m_regionShapes[r], slot);
+		}
+	});
+
+	for (int r = 0; r < numRegions; ++r)
+	{
+		int const* slot = objectIds.data() + static_cast<size_t>(r) * slotSize;
+		if (std::coroutine_handle<> awaiter = batch.m_regionStates[r]->Complete(std::vector<int>(slot, slot + numResults[r])))
+		{
+			out_awaiters.push_back(awaiter);
+		}
+	}
+}
@@ -0,0 +1,220 @@
+//----------------------------------------------------------------------------------------------------
+// AsyncQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+// QueryExecutor - Whatever answers a QueryFuture; a blocking Get asks it to run pending work now
+//----------------------------------------------------------------------------------------------------
+class QueryExecutor
+{
+public:
+	virtual ~QueryExecutor() = default;
+	virtual int Flush() = 0; // Answers everything pending; returns the number of queries answered
+};
+
+//----------------------------------------------------------------------------------------------------
+struct AsyncQueryConfig
+{
+	float m_batchWindowMs    = 1.f;  // Poll flushes pending queries once the oldest has waited this long
+	float m_maxLatencyMs     = 4.f;  // A Submit flushes inline once the oldest pending query is this old
+	int   m_maxBatchQueries  = 4096; // ...or once this many queries are pending
+	int   m_maxRegionResults = 256;  // Ids kept per region query; the rest are dropped
+	bool  m_sortRaysByOrigin = true; // Morton-order closest-hit rays so neighbours share tree nodes
+};
+
+//----------------------------------------------------------------------------------------------------
+struct AsyncQueryStats
+{
+	int64_t m_numSubmitted      = 0;
+	int64_t m_numBatches        = 0;
+	int64_t m_numBatchedQueries = 0;
+	int     m_largestBatch      = 0;
+
+	float GetAverageBatchSize() const { return (m_numBatches > 0) ? static_cast<float>(m_numBatchedQueries) / static_cast<float>(m_numBatches) : 0.f; }
+};
+
+//----------------------------------------------------------------------------------------------------
+// QueryFutureState - Result slot shared by one submission and its future
+//
+// m_state goes PENDING -> READY, or PENDING -> AWAITED -> READY when a coroutine suspends on it first.
+// Whoever loses the race to READY owns resuming: the awaiter skips suspending, the flush resumes it.
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+struct QueryFutureState
+{
+	static constexpr int PENDING = 0;
+	static constexpr int AWAITED = 1;
+	static constexpr int READY   = 2;
+
+	// Returns the coroutine to resume, if one was waiting
+	std::coroutine_handle<> Complete(T&& result)
+	{
+		m_result = std::move(result);
+		int previous = m_state.exchange(READY, std::memory_order_acq_rel);
+		m_state.notify_all();
+		return (previous == AWAITED) ? m_awaiter : std::coroutine_handle<>();
+	}
+
+	std::atomic<int>        m_state = PENDING;
+	std::coroutine_handle<> m_awaiter;
+	T                       m_result{};
+};
+
+//----------------------------------------------------------------------------------------------------
+// QueryFuture - Handle to one submitted query: poll it, block on it, or co_await it
+//
+// Get on a pending future flushes the batch it is in, so blocking never waits out the batch window.
+// Only one coroutine may await a given future.
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+class QueryFuture
+{
+public:
+	QueryFuture() = default;
+	QueryFuture(std::shared_ptr<QueryFutureState<T>> state, QueryExecutor* owner) : m_state(std::move(state)), m_owner(owner) {}
+
+	bool     IsValid() const { return m_state != nullptr; }
+	bool     IsReady() const { return m_state->m_state.load(std::memory_order_acquire) == QueryFutureState<T>::READY; }
+	T const& Get() const;
+
+	// Awaitable
+	bool     await_ready() const noexcept { return IsReady(); }
+	bool     await_suspend(std::coroutine_handle<> awaiter) const noexcept;
+	T const& await_resume() const noexcept { return m_state->m_result; }
+
+private:
+	std::shared_ptr<QueryFutureState<T>> m_state;
+	QueryExecutor*                       m_owner = nullptr;
+};
+
+//----------------------------------------------------------------------------------------------------
+// AsyncQueryTask - Fire-and-forget coroutine for gameplay scripts that co_await query futures
+//
+// Starts running at the call and frees itself when it returns. After a co_await it continues on the
+// thread that flushed the batch, so code after an await must be safe to run there.
+//----------------------------------------------------------------------------------------------------
+struct AsyncQueryTask
+{
+	struct promise_type
+	{
+		AsyncQueryTask      get_return_object() noexcept { return {}; }
+		std::suspend_never  initial_suspend() noexcept { return {}; }
+		std::suspend_never  final_suspend() noexcept { return {}; }
+		void                return_void() noexcept {}
+		void                unhandled_exception() { std::terminate(); }
+	};
+};
+
+//----------------------------------------------------------------------------------------------------
+// AsyncSceneQueries - Collects single queries from many callers into batches
+//
+// Submits are thread safe and cheap: they append to structure-of-arrays queues. A flush takes the
+// whole queue, runs each query kind as one batch over the task scheduler and completes the futures,
+// then resumes any coroutines awaiting them. Flushes happen when the owner polls after the batch window,
+// inline in a Submit that fills the batch or finds the oldest query past the max latency, on Get of a
+// pending future, and whenever the owner calls Flush.
+//
+// Queries read the scene during the flush, so the owner must Flush before editing it and must not
+// let anything submit while an edit is in progress. Region shapes made from a vertex span must keep
+// that span alive until their future is ready.
+//----------------------------------------------------------------------------------------------------
+class AsyncSceneQueries : public QueryExecutor
+{
+public:
+	explicit AsyncSceneQueries(AsyncQueryConfig const& config = AsyncQueryConfig());
+	~AsyncSceneQueries() override;
+	AsyncSceneQueries(AsyncSceneQueries const&)            = delete;
+	AsyncSceneQueries& operator=(AsyncSceneQueries const&) = delete;
+
+	void SetScene(SceneQueryView const& scene, eQueryMode mode);
+	void SetConfig(AsyncQueryConfig const& config);
+
+	QueryFuture<ClosestRayHit>    SubmitRaycast(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist);
+	QueryFuture<bool>             SubmitRaycastAny(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist);
+	QueryFuture<std::vector<int>> SubmitRegion(RegionQueryShape const& shape);
+
+	int             Poll(); // Flushes if the oldest pending query has waited out the batch window
+	int             Flush() override;
+	int             GetNumPending() const;
+	AsyncQueryStats GetStats() const;
+
+private:
+	struct Batch
+	{
+		std::vector<Vec2>                                                m_closestStarts;
+		std::vector<Vec2>                                                m_closestForwards;
+		std::vector<float>                                               m_closestMaxDists;
+		std::vector<std::shared_ptr<QueryFutureState<ClosestRayHit>>>    m_closestStates;
+
+		std::vector<Vec2>                                                m_anyStarts;
+		std::vector<Vec2>                                                m_anyForwards;
+		std::vector<float>                                               m_anyMaxDists;
+		std::vector<std::shared_ptr<QueryFutureState<bool>>>             m_anyStates;
+
+		std::vector<RegionQueryShape>                                    m_regionShapes;
+		std::vector<std::shared_ptr<QueryFutureState<std::vector<int>>>> m_regionStates;
+
+		int  GetNumQueries() const { return static_cast<int>(m_closestStates.size() + m_anyStates.size() + m_regionStates.size()); }
+		void Clear();
+	};
+
+	void OnSubmitted(std::unique_lock<std::mutex>& lock);
+	void RunClosestRaycasts(Batch& batch, std::vector<std::coroutine_handle<>>& out_awaiters);
+	void RunAnyRaycasts(Batch& batch, std::vector<std::coroutine_handle<>>& out_awaiters);
+	void RunRegions(Batch& batch, std::vector<std::coroutine_handle<>>& out_awaiters);
+
+	AsyncQueryConfig                    m_config;
+	SceneQueryView                      m_scene;
+	eQueryMode                          m_queryMode = eQueryMode::AABB2_TREE;
+
+	mutable std::mutex                  m_mutex;
+	std::unique_ptr<Batch>              m_pending;
+	std::vector<std::unique_ptr<Batch>> m_spareBatches; // Flushed batches keep their capacity for reuse
+	double                              m_oldestPendingTime = 0.0;
+	AsyncQueryStats                     m_stats;
+};
+
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+T const& QueryFuture<T>::Get() const
+{
+	if (!IsReady())
+	{
+		m_owner->Flush();
+
+		// Another thread may have taken our query into its own flush; wait for that one to finish
+		int state = m_state->m_state.load(std::memory_order_acquire);
+		while (state != QueryFutureState<T>::READY)
+		{
+			m_state->m_state.wait(state, std::memory_order_acquire);
+			state = m_state->m_state.load(std::memory_order_acquire);
+		}
+	}
+	return m_state->m_result;
+}
+
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+bool QueryFuture<T>::await_suspend(std::coroutine_handle<> awaiter) const noexcept
+{
+	m_state->m_awaiter = awaiter;
+	int expected = QueryFutureState<T>::PENDING;
+	return m_state->m_state.compare_exchange_strong(expected, QueryFutureState<T>::AWAITED, std::memory_order_acq_rel);
+}
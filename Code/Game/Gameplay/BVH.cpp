@@ -3,12 +3,22 @@
 //----------------------------------------------------------------------------------------------------
 
 //----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
 #include "Game/Gameplay/Convex.hpp"
 #include "Game/Gameplay/BVH.hpp"
+#include "Game/Gameplay/NearestQuery.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+#include "Game/Gameplay/ShapeCast.hpp"
 
 #include "Engine/Math/RaycastUtils.hpp"
 
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int BVH_NODES_PER_TASK = 4;
 
 //----------------------------------------------------------------------------------------------------
 static int IntPow(int x, unsigned int p)
@@ -37,6 +47,11 @@ void AABB2Tree::BuildTree(std::vector<Convex2*> const& convexArray, int numOfRec
 		return;
 	}
 	m_nodes[0].m_containingConvex = convexArray;
+	m_nodes[0].m_categoryMask     = 0;
+	for (Convex2 const* convex : convexArray)
+	{
+		m_nodes[0].m_categoryMask |= convex->m_categoryMask;
+	}
 
 	int sumK = 0;
 	for (int i = 0; i < numOfRecursive; ++i)
@@ -53,61 +68,71 @@ void AABB2Tree::BuildTree(std::vector<Convex2*> const& convexArray, int numOfRec
 			{
 				m_startOfLastLevel = sumK;
 			}
-			for (int j = 0; j < numOfJInLevel; ++j)
+			// Nodes of one level only read their parents, so a level splits across tasks
+			int firstOfLevel = sumK;
+			ParallelFor(0, numOfJInLevel, BVH_NODES_PER_TASK, [&](int firstJ, int lastJ)
 			{
-				int parentIndex = GetParentIndex(sumK);
-				AABB2 const& parentBounds = m_nodes[parentIndex].m_bounds;
-				bool isLeftChild = (sumK == parentIndex * 2 + 1);
-				bool isVerticalSplit = (i % 2 == 1);
-
-				if (isVerticalSplit)
+				for (int j = firstJ; j < lastJ; ++j)
 				{
-					float xPivot = (parentBounds.m_maxs.x + parentBounds.m_mins.x) * 0.5f;
-					for (auto convex : m_nodes[parentIndex].m_containingConvex)
+					int nodeIndex = firstOfLevel + j;
+					int parentIndex = GetParentIndex(nodeIndex);
+					AABB2 const& parentBounds = m_nodes[parentIndex].m_bounds;
+					bool isLeftChild = (nodeIndex == parentIndex * 2 + 1);
+					bool isVerticalSplit = (i % 2 == 1);
+
+					if (isVerticalSplit)
 					{
-						bool goesLeft = convex->m_boundingDiscCenter.x < xPivot;
-						if (isLeftChild == goesLeft)
+						float xPivot = (parentBounds.m_maxs.x + parentBounds.m_mins.x) * 0.5f;
+						for (auto convex : m_nodes[parentIndex].m_containingConvex)
 						{
-							m_nodes[sumK].m_containingConvex.push_back(convex);
+							bool goesLeft = convex->m_boundingDiscCenter.x < xPivot;
+							if (isLeftChild == goesLeft)
+							{
+								m_nodes[nodeIndex].m_containingConvex.push_back(convex);
+							}
 						}
 					}
-				}
-				else
-				{
-					float yPivot = (parentBounds.m_maxs.y + parentBounds.m_mins.y) * 0.5f;
-					for (auto convex : m_nodes[parentIndex].m_containingConvex)
+					else
 					{
-						bool goesTop = convex->m_boundingDiscCenter.y >= yPivot;
-						if (isLeftChild == goesTop)
+						float yPivot = (parentBounds.m_maxs.y + parentBounds.m_mins.y) * 0.5f;
+						for (auto convex : m_nodes[parentIndex].m_containingConvex)
 						{
-							m_nodes[sumK].m_containingConvex.push_back(convex);
+							bool goesTop = convex->m_boundingDiscCenter.y >= yPivot;
+							if (isLeftChild == goesTop)
+							{
+								m_nodes[nodeIndex].m_containingConvex.push_back(convex);
+							}
 						}
 					}
-				}
 
-				// Compute tight AABB from contained convex vertices
-				if (!m_nodes[sumK].m_containingConvex.empty())
-				{
-					float minX = FLT_MAX, maxX = -FLT_MAX;
-					float minY = FLT_MAX, maxY = -FLT_MAX;
-					for (auto convex : m_nodes[sumK].m_containingConvex)
+					// Compute tight AABB from contained convex vertices
+					if (!m_nodes[nodeIndex].m_containingConvex.empty())
 					{
-						for (auto const& vert : convex->m_convexPoly.GetVertexArray())
+						float minX = FLT_MAX, maxX = -FLT_MAX;
+						float minY = FLT_MAX, maxY = -FLT_MAX;
+						uint16_t categoryMask = 0;
+						for (auto convex : m_nodes[nodeIndex].m_containingConvex)
 						{
-							if (vert.x > maxX) maxX = vert.x;
-							if (vert.x < minX) minX = vert.x;
-							if (vert.y < minY) minY = vert.y;
-							if (vert.y > maxY) maxY = vert.y;
+							categoryMask |= convex->m_categoryMask;
+							for (Vec2 const& vert : convex->GetVertices())
+							{
+								if (vert.x > maxX) maxX = vert.x;
+								if (vert.x < minX) minX = vert.x;
+								if (vert.y < minY) minY = vert.y;
+								if (vert.y > maxY) maxY = vert.y;
+							}
 						}
+						m_nodes[nodeIndex].m_bounds       = AABB2(Vec2(minX, minY), Vec2(maxX, maxY));
+						m_nodes[nodeIndex].m_categoryMask = categoryMask;
+					}
+					else
+					{
+						m_nodes[nodeIndex].m_bounds       = AABB2(Vec2(-1.f, -1.f), Vec2(0.f, 0.f));
+						m_nodes[nodeIndex].m_categoryMask = 0;
 					}
-					m_nodes[sumK].m_bounds = AABB2(Vec2(minX, minY), Vec2(maxX, maxY));
-				}
-				else
-				{
-					m_nodes[sumK].m_bounds = AABB2(Vec2(-1.f, -1.f), Vec2(0.f, 0.f));
 				}
-				++sumK;
-			}
+			});
+			sumK += numOfJInLevel;
 		}
 	}
 }
@@ -120,19 +145,29 @@ static bool RayHitsAABB2D(Vec2 const& startPos, Vec2 const& forwardVec, float ma
 }
 
 //----------------------------------------------------------------------------------------------------
-void AABB2Tree::SolveRayResult(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, std::vector<Convex2*>& out_latentRes)
+void AABB2Tree::GatherRayCandidates(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter) const
 {
 	int ptr = 0;
 	while (ptr < static_cast<int>(m_nodes.size()))
 	{
-		if (RayHitsAABB2D(startPos, forwardVec, maxDist, m_nodes[ptr].m_bounds))
+		if (filter.MayAcceptAny(m_nodes[ptr].m_categoryMask) && RayHitsAABB2D(startPos, forwardVec, maxDist, m_nodes[ptr].m_bounds))
 		{
 			if (ptr >= m_startOfLastLevel)
 			{
 				// Leaf node: collect convexes
-				for (auto convex : m_nodes[ptr].m_containingConvex)
+				if (filter.AcceptsAll())
 				{
-					out_latentRes.push_back(convex);
+					scratch.m_candidates.insert(scratch.m_candidates.end(), m_nodes[ptr].m_containingConvex.begin(), m_nodes[ptr].m_containingConvex.end());
+				}
+				else
+				{
+					for (Convex2* convex : m_nodes[ptr].m_containingConvex)
+					{
+						if (filter.Accepts(convex->m_categoryMask))
+						{
+							scratch.m_candidates.push_back(convex);
+						}
+					}
 				}
 				// Backtrack to next unvisited sibling
 				while (ptr % 2 == 0 && ptr != 0)
@@ -175,7 +210,243 @@ void AABB2Tree::SolveRayResult(Vec2 const& startPos, Vec2 const& forwardVec, flo
 }
 
 //----------------------------------------------------------------------------------------------------
-int AABB2Tree::GetParentIndex(int index)
+// CollectRayPenetrations - Near-to-far stack traversal so hits arrive almost sorted
+//----------------------------------------------------------------------------------------------------
+void AABB2Tree::CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	float rootEntry = 0.f;
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask) || !GetRayEntryDistVsAABB2D(rootEntry, startPos, forwardVec, maxDist, m_nodes[0].m_bounds))
+	{
+		return;
+	}
+	stack.push_back({0, rootEntry});
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	RayPenetration penetration;
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.m_entryDist > collector.GetPruneDist())
+		{
+			continue;
+		}
+
+		AABB2TreeNode const& node = m_nodes[entry.m_nodeIndex];
+		int leftChild = entry.m_nodeIndex * 2 + 1;
+		if (entry.m_nodeIndex >= m_startOfLastLevel || leftChild >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask) && convex->GetRayPenetration(penetration, startPos, forwardVec, maxDist))
+				{
+					collector.Insert(penetration);
+				}
+			}
+			continue;
+		}
+
+		float leftEntry  = 0.f;
+		float rightEntry = 0.f;
+		bool  hitsLeft   = filter.MayAcceptAny(m_nodes[leftChild].m_categoryMask) && GetRayEntryDistVsAABB2D(leftEntry, startPos, forwardVec, maxDist, m_nodes[leftChild].m_bounds);
+		bool  hitsRight  = leftChild + 1 < numNodes && filter.MayAcceptAny(m_nodes[leftChild + 1].m_categoryMask) && GetRayEntryDistVsAABB2D(rightEntry, startPos, forwardVec, maxDist, m_nodes[leftChild + 1].m_bounds);
+
+		// Push the farther child first so the nearer one is processed next
+		if (hitsLeft && hitsRight && leftEntry < rightEntry)
+		{
+			stack.push_back({leftChild + 1, rightEntry});
+			stack.push_back({leftChild, leftEntry});
+		}
+		else
+		{
+			if (hitsLeft)  stack.push_back({leftChild, leftEntry});
+			if (hitsRight) stack.push_back({leftChild + 1, rightEntry});
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectShapeCastHits - Near-to-far over node bounds inflated by the swept shape's extent
+//----------------------------------------------------------------------------------------------------
+void AABB2Tree::CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	float rootEntry = 0.f;
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask) || !collector.GetEntryDistVsBounds(rootEntry, m_nodes[0].m_bounds))
+	{
+		return;
+	}
+	stack.push_back({0, rootEntry});
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.m_entryDist > collector.GetPruneDist())
+		{
+			continue;
+		}
+
+		AABB2TreeNode const& node = m_nodes[entry.m_nodeIndex];
+		int leftChild = entry.m_nodeIndex * 2 + 1;
+		if (entry.m_nodeIndex >= m_startOfLastLevel || leftChild >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask))
+				{
+					collector.Consider(*convex);
+				}
+			}
+			continue;
+		}
+
+		float leftEntry  = 0.f;
+		float rightEntry = 0.f;
+		bool  hitsLeft   = filter.MayAcceptAny(m_nodes[leftChild].m_categoryMask) && collector.GetEntryDistVsBounds(leftEntry, m_nodes[leftChild].m_bounds);
+		bool  hitsRight  = leftChild + 1 < numNodes && filter.MayAcceptAny(m_nodes[leftChild + 1].m_categoryMask) && collector.GetEntryDistVsBounds(rightEntry, m_nodes[leftChild + 1].m_bounds);
+
+		if (hitsLeft && hitsRight && leftEntry < rightEntry)
+		{
+			stack.push_back({leftChild + 1, rightEntry});
+			stack.push_back({leftChild, leftEntry});
+		}
+		else
+		{
+			if (hitsLeft)  stack.push_back({leftChild, leftEntry});
+			if (hitsRight) stack.push_back({leftChild + 1, rightEntry});
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectRegionOverlaps - Depth-first cull of node bounds against the query shape
+//----------------------------------------------------------------------------------------------------
+void AABB2Tree::CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask))
+	{
+		return;
+	}
+	stack.push_back({0, 0.f});
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	while (!stack.empty())
+	{
+		int nodeIndex = stack.back().m_nodeIndex;
+		stack.pop_back();
+
+		AABB2TreeNode const& node = m_nodes[nodeIndex];
+		if (!shape.OverlapsBounds(node.m_bounds))
+		{
+			continue;
+		}
+
+		if (nodeIndex >= m_startOfLastLevel || nodeIndex * 2 + 1 >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask) && shape.OverlapsBounds(convex->m_boundingAABB) && shape.OverlapsConvex(*convex))
+				{
+					collector.Add(convex->m_objectId);
+					if (collector.m_isDone)
+					{
+						return;
+					}
+				}
+			}
+			continue;
+		}
+
+		for (int child = nodeIndex * 2 + 1; child <= nodeIndex * 2 + 2 && child < numNodes; ++child)
+		{
+			if (filter.MayAcceptAny(m_nodes[child].m_categoryMask))
+			{
+				stack.push_back({child, 0.f});
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+static bool IsFartherEntry(QueryStackEntry const& a, QueryStackEntry const& b)
+{
+	return a.m_entryDist > b.m_entryDist;
+}
+
+//----------------------------------------------------------------------------------------------------
+// PushNearestEntry - m_nodeStack doubles as a min-heap on distance for best-first queries
+//----------------------------------------------------------------------------------------------------
+static void PushNearestEntry(std::vector<QueryStackEntry>& heap, int nodeIndex, float dist)
+{
+	heap.push_back({nodeIndex, dist});
+	std::push_heap(heap.begin(), heap.end(), IsFartherEntry);
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectNearestConvexes - Best-first descent ordered by distance to node bounds
+//----------------------------------------------------------------------------------------------------
+void AABB2Tree::CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask))
+	{
+		return;
+	}
+
+	Vec2 const& point = collector.m_queryPoint;
+	PushNearestEntry(stack, 0, GetDistanceToAABB2(point, m_nodes[0].m_bounds));
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	while (!stack.empty())
+	{
+		std::pop_heap(stack.begin(), stack.end(), IsFartherEntry);
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+
+		// Every remaining node is at least this far away
+		if (entry.m_entryDist > collector.GetSearchRadius())
+		{
+			return;
+		}
+
+		int nodeIndex = entry.m_nodeIndex;
+		AABB2TreeNode const& node = m_nodes[nodeIndex];
+		if (nodeIndex >= m_startOfLastLevel || nodeIndex * 2 + 1 >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask))
+				{
+					collector.Consider(*convex);
+				}
+			}
+			continue;
+		}
+
+		for (int child = nodeIndex * 2 + 1; child <= nodeIndex * 2 + 2 && child < numNodes; ++child)
+		{
+			if (filter.MayAcceptAny(m_nodes[child].m_categoryMask))
+			{
+				PushNearestEntry(stack, child, GetDistanceToAABB2(point, m_nodes[child].m_bounds));
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+int AABB2Tree::GetParentIndex(int index) const
 {
 	if (index % 2 == 0)
 	{
@@ -183,3 +454,147 @@ int AABB2Tree::GetParentIndex(int index)
 	}
 	return index >> 1;
 }
+
+//----------------------------------------------------------------------------------------------------
+static AABB2 GetUnionOfBounds(AABB2 const& boundsA, AABB2 const& boundsB)
+{
+	return AABB2(Vec2(std::min(boundsA.m_mins.x, boundsB.m_mins.x), std::min(boundsA.m_mins.y, boundsB.m_mins.y)),
+				 Vec2(std::max(boundsA.m_maxs.x, boundsB.m_maxs.x), std::max(boundsA.m_maxs.y, boundsB.m_maxs.y)));
+}
+
+//----------------------------------------------------------------------------------------------------
+// Build - Uses the tuned depth when one is set; otherwise depth grows with the object count, about
+// 16 objects per leaf and never under 3 levels
+//----------------------------------------------------------------------------------------------------
+void AABB2Tree::Build(std::vector<Convex2*> const& convexArray, AABB2 const& totalBounds)
+{
+	int numOfRecursive = 0;
+	if (m_buildDepth > 0)
+	{
+		numOfRecursive = m_buildDepth;
+	}
+	else if (!convexArray.empty())
+	{
+		numOfRecursive = std::max(static_cast<int>(log2(static_cast<double>(convexArray.size()))) - 3, 3);
+	}
+	BuildTree(convexArray, numOfRecursive, totalBounds);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Refit - Recompute bounds bottom-up and keep the partition. Queries stay exact after objects move;
+// only the culling loosens as they drift from where the tree was built.
+//----------------------------------------------------------------------------------------------------
+void AABB2Tree::Refit()
+{
+	int numNodes = static_cast<int>(m_nodes.size());
+	for (int i = numNodes - 1; i >= 0; --i)
+	{
+		AABB2TreeNode& node = m_nodes[i];
+		if (node.m_containingConvex.empty())
+		{
+			if (i != 0)
+			{
+				node.m_bounds = AABB2(Vec2(-1.f, -1.f), Vec2(0.f, 0.f));
+			}
+			continue;
+		}
+
+		int  firstChild = i * 2 + 1;
+		bool isLeaf     = (i >= m_startOfLastLevel || firstChild >= numNodes);
+		if (isLeaf)
+		{
+			node.m_bounds = node.m_containingConvex[0]->m_boundingAABB;
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				node.m_bounds = GetUnionOfBounds(node.m_bounds, convex->m_boundingAABB);
+			}
+			continue;
+		}
+
+		bool hasBounds = false;
+		for (int child = firstChild; child <= firstChild + 1 && child < numNodes; ++child)
+		{
+			if (!m_nodes[child].m_containingConvex.empty())
+			{
+				node.m_bounds = hasBounds ? GetUnionOfBounds(node.m_bounds, m_nodes[child].m_bounds) : m_nodes[child].m_bounds;
+				hasBounds     = true;
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateCategoryMasks - Recompute the node masks bottom-up after objects change category; Refit
+// leaves them alone since moving never changes a category
+//----------------------------------------------------------------------------------------------------
+void AABB2Tree::UpdateCategoryMasks()
+{
+	int numNodes = static_cast<int>(m_nodes.size());
+	for (int i = numNodes - 1; i >= 0; --i)
+	{
+		AABB2TreeNode& node = m_nodes[i];
+		node.m_categoryMask = 0;
+
+		int firstChild = i * 2 + 1;
+		if (i >= m_startOfLastLevel || firstChild >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				node.m_categoryMask |= convex->m_categoryMask;
+			}
+			continue;
+		}
+		for (int child = firstChild; child <= firstChild + 1 && child < numNodes; ++child)
+		{
+			node.m_categoryMask |= m_nodes[child].m_categoryMask;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+bool AABB2Tree::RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter) const
+{
+	float searchDist = std::min(maxDist, inout_best.m_dist);
+	scratch.m_candidates.clear();
+	GatherRayCandidates(startPos, forwardVec, searchDist, scratch, filter);
+	NarrowPhaseClosestHit(scratch.m_candidates, startPos, forwardVec, searchDist, true, true, inout_best);
+	return inout_best.m_objectId != -1;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool AABB2Tree::RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter) const
+{
+	scratch.m_candidates.clear();
+	GatherRayCandidates(startPos, forwardVec, maxDist, scratch, filter);
+	return NarrowPhaseAnyHit(scratch.m_candidates, startPos, forwardVec, maxDist, true, true);
+}
+
+//----------------------------------------------------------------------------------------------------
+AcceleratorStats AABB2Tree::GetStats() const
+{
+	int numNodes  = static_cast<int>(m_nodes.size());
+	int firstLeaf = std::min(m_startOfLastLevel, numNodes);
+
+	AcceleratorStats stats;
+	stats.m_numNodes  = numNodes;
+	stats.m_numLeaves = numNodes - firstLeaf;
+	for (int i = firstLeaf; i < numNodes; ++i)
+	{
+		int numObjects = static_cast<int>(m_nodes[i].m_containingConvex.size());
+		stats.m_numObjectRefs += numObjects;
+		stats.m_maxLeafObjects = std::max(stats.m_maxLeafObjects, numObjects);
+	}
+	return stats;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t AABB2Tree::GetMemoryBytes() const
+{
+	// Every level keeps its own object list, so inner nodes count too
+	size_t bytes = m_nodes.capacity() * sizeof(AABB2TreeNode);
+	for (AABB2TreeNode const& node : m_nodes)
+	{
+		bytes += node.m_containingConvex.capacity() * sizeof(Convex2*);
+	}
+	return bytes;
+}
@@ -5,12 +5,21 @@
 //----------------------------------------------------------------------------------------------------
 #pragma once
 //----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
 #include "Engine/Math/AABB2.hpp"
 //----------------------------------------------------------------------------------------------------
 #include <vector>
 
 //----------------------------------------------------------------------------------------------------
+struct ClosestRayHit;
 struct Convex2;
+struct NearestConvexCollector;
+struct RayPenetrationCollector;
+struct RegionOverlapCollector;
+struct RegionQueryShape;
+struct ShapeCastCollector;
+struct QueryScratch;
 struct Vec2;
 
 //----------------------------------------------------------------------------------------------------
@@ -18,14 +27,37 @@ struct AABB2TreeNode
 {
 	AABB2                  m_bounds;
 	std::vector<Convex2*>  m_containingConvex;
+	uint16_t               m_categoryMask = QUERY_CATEGORY_ALL; // OR of the objects' masks
 };
 
 //----------------------------------------------------------------------------------------------------
 class AABB2Tree
 {
 public:
+	static constexpr eQueryMode QUERY_MODE = eQueryMode::AABB2_TREE;
+	static char const*          GetName() { return "BVH"; }
+
 	void BuildTree(std::vector<Convex2*> const& convexArray, int numOfRecursive, AABB2 const& totalBounds);
-	void SolveRayResult(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, std::vector<Convex2*>& out_latentRes);
+	void GatherRayCandidates(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter = QueryFilter()) const;
+	void CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void UpdateCategoryMasks();
+
+	// SpatialAccelerator interface (see Accelerator.hpp)
+	void             Build(std::vector<Convex2*> const& convexArray, AABB2 const& totalBounds);
+	void             Refit();
+	bool             RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter = QueryFilter()) const;
+	bool             RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter = QueryFilter()) const;
+	AcceleratorStats GetStats() const;
+	size_t           GetMemoryBytes() const;
+
+	// Tunable build parameter (see AcceleratorTuner.hpp): depth in levels; 0 derives it from the object count
+	static constexpr int MIN_BUILD_DEPTH = 2;
+	static constexpr int MAX_BUILD_DEPTH = 16;
+	int  GetBuildDepth() const { return m_buildDepth; }
+	void SetBuildDepth(int depth) { m_buildDepth = depth; }
 
 	std::vector<AABB2TreeNode> m_nodes;
 
@@ -33,6 +65,7 @@ public:
 	void SetStartOfLastLevel(int value) { m_startOfLastLevel = value; }
 
 protected:
-	int GetParentIndex(int index);
+	int GetParentIndex(int index) const;
 	int m_startOfLastLevel = 0;
+	int m_buildDepth       = 0;
 };
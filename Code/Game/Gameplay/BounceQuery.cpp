@@ -0,0 +1,100 @@
+//----------------------------------------------------------------------------------------------------
+// BounceQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/BounceQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/MathUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int BOUNCE_BLOCK_SIZE = 64;
+
+//----------------------------------------------------------------------------------------------------
+// TraceRayRange - Every leg is a one-ray batch over stack locals, so bounces never allocate
+//----------------------------------------------------------------------------------------------------
+static int TraceRayRange(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, BounceTraceSettings const& settings, BouncePathBatch const& out_paths, int firstRay, int lastRay)
+{
+	int stride       = BouncePathBatch::GetPathStride(settings);
+	int totalBounces = 0;
+
+	for (int j = firstRay; j < lastRay; ++j)
+	{
+		Vec2  position   = rays.m_startPositions[j];
+		Vec2  forwardVec = rays.m_forwardNormals[j];
+		float legBudget  = rays.m_maxDists[j];
+		float energy     = 1.f;
+		int   numBounces = 0;
+
+		std::span<Vec2> path = out_paths.m_pathPoints.subspan(static_cast<size_t>(j) * stride, stride);
+		int numPoints = 0;
+		path[numPoints++] = position;
+
+		for (;;)
+		{
+			float hitDist     = 0.f;
+			int   hitObjectId = -1;
+			Vec2  hitNormal;
+			RayBatch    leg{std::span<Vec2 const>(&position, 1), std::span<Vec2 const>(&forwardVec, 1), std::span<float const>(&legBudget, 1)};
+			RayHitBatch legHit{std::span<float>(&hitDist, 1), std::span<int>(&hitObjectId, 1), std::span<Vec2>(&hitNormal, 1)};
+			RaycastBatch(scene, mode, leg, legHit);
+
+			float legLength = (hitObjectId != -1) ? hitDist : legBudget;
+			energy *= expf(-settings.m_attenuationPerUnit * legLength);
+			position = position + forwardVec * legLength;
+			path[numPoints++] = position;
+
+			if (hitObjectId == -1 || numBounces == settings.m_maxBounces)
+			{
+				break;
+			}
+
+			// Specular reflection about the surface normal
+			forwardVec = forwardVec - hitNormal * (2.f * DotProduct2D(forwardVec, hitNormal));
+			position   = position + hitNormal * settings.m_surfaceOffset;
+			energy    *= settings.m_reflectance;
+			++numBounces;
+		}
+
+		out_paths.m_numPathPoints[j] = numPoints;
+		out_paths.m_numBounces[j]    = numBounces;
+		out_paths.m_energies[j]      = energy;
+		totalBounces += numBounces;
+	}
+	return totalBounces;
+}
+
+//----------------------------------------------------------------------------------------------------
+// TraceBouncedRays - Workers pull blocks of rays from a shared counter
+//----------------------------------------------------------------------------------------------------
+int TraceBouncedRays(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, BounceTraceSettings const& settings, BouncePathBatch const& out_paths, int numThreads)
+{
+	int numRays = rays.GetNumRays();
+	if (numThreads <= 0)
+	{
+		numThreads = GetNumTaskThreads();
+	}
+	numThreads = std::clamp(numThreads, 1, std::max((numRays + BOUNCE_BLOCK_SIZE - 1) / BOUNCE_BLOCK_SIZE, 1));
+
+	std::atomic<int> nextBlockStart = 0;
+	std::atomic<int> totalBounces   = 0;
+	auto worker = [&](int)
+	{
+		int bounces = 0;
+		for (int first = nextBlockStart.fetch_add(BOUNCE_BLOCK_SIZE); first < numRays; first = nextBlockStart.fetch_add(BOUNCE_BLOCK_SIZE))
+		{
+			bounces += TraceRayRange(scene, mode, rays, settings, out_paths, first, std::min(first + BOUNCE_BLOCK_SIZE, numRays));
+		}
+		totalBounces += bounces;
+	};
+
+	RunOnWorkers(numThreads, worker);
+	return totalBounces;
+}
@@ -0,0 +1,46 @@
+//----------------------------------------------------------------------------------------------------
+// BounceQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+
+//----------------------------------------------------------------------------------------------------
+struct RayBatch;
+
+//----------------------------------------------------------------------------------------------------
+struct BounceTraceSettings
+{
+	int   m_maxBounces         = 4;
+	float m_reflectance        = 0.8f;   // Energy kept per reflection
+	float m_attenuationPerUnit = 0.f;    // Exponential falloff along the path
+	float m_surfaceOffset      = 0.001f; // Push off the surface so the next leg does not re-hit it
+};
+
+//----------------------------------------------------------------------------------------------------
+// BouncePathBatch - Caller-owned output for a batch of bounced rays
+//
+// Each ray owns GetPathStride() consecutive path points: its start, then one point per leg end.
+// A path ends at a miss (the end of the leg's budget) or after the last allowed bounce.
+//----------------------------------------------------------------------------------------------------
+struct BouncePathBatch
+{
+	std::span<Vec2>  m_pathPoints;     // numRays * GetPathStride(settings)
+	std::span<int>   m_numPathPoints;  // Points written per ray
+	std::span<int>   m_numBounces;     // Reflections per ray
+	std::span<float> m_energies;       // Energy left at the end of the path (starts at 1)
+
+	static int GetPathStride(BounceTraceSettings const& settings) { return settings.m_maxBounces + 2; }
+};
+
+//----------------------------------------------------------------------------------------------------
+// Follow each ray through specular reflections; rays.m_maxDists is the length budget of every leg.
+// Returns the total number of reflections across the batch.
+//----------------------------------------------------------------------------------------------------
+int TraceBouncedRays(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, BounceTraceSettings const& settings, BouncePathBatch const& out_paths, int numThreads = 0);
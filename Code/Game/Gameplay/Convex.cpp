@@ -4,6 +4,7 @@
 
 //----------------------------------------------------------------------------------------------------
 #include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
 #include "Engine/Math/RaycastUtils.hpp"
 #include "Engine/Math/MathUtils.hpp"
 #include <float.h>
@@ -12,7 +13,6 @@
 // Default Constructor
 //----------------------------------------------------------------------------------------------------
 Convex2::Convex2()
-	: m_convexPoly(ConvexPoly2({Vec2(), Vec2()}))
 {
 }
 
@@ -20,39 +20,98 @@ Convex2::Convex2()
 // Constructor from ConvexPoly2
 //----------------------------------------------------------------------------------------------------
 Convex2::Convex2(ConvexPoly2 const& convexPoly2)
-	: m_convexPoly(convexPoly2)
-	, m_convexHull(convexPoly2)
 {
+	SetVertices(convexPoly2.GetVertexArray());
 	RebuildBoundingVolumes();
 }
 
 //----------------------------------------------------------------------------------------------------
-// Constructor from ConvexHull2
+// Constructor from ConvexHull2 - The Engine intersects adjacent planes to recover the vertices
 //----------------------------------------------------------------------------------------------------
 Convex2::Convex2(ConvexHull2 const& convexHull2)
-	: m_convexHull(convexHull2)
-	, m_convexPoly(convexHull2)
 {
+	SetVertices(ConvexPoly2(convexHull2).GetVertexArray());
 	RebuildBoundingVolumes();
 }
 
 //----------------------------------------------------------------------------------------------------
 // Constructor from vertex list
 //----------------------------------------------------------------------------------------------------
-Convex2::Convex2(std::vector<Vec2> const& vertices)
-	: m_convexPoly(ConvexPoly2(vertices))
-	, m_convexHull(ConvexHull2(m_convexPoly))
+Convex2::Convex2(std::span<Vec2 const> vertices)
 {
+	SetVertices(vertices);
 	RebuildBoundingVolumes();
 }
 
 //----------------------------------------------------------------------------------------------------
-// Translate - Move convex shape by offset
+// SetVertices - Replace the shape and derive each edge's outward normal from it
+//
+// Bounding volumes are left alone so a loader can restore saved ones; call RebuildBoundingVolumes
+// when they should follow the new shape.
+//----------------------------------------------------------------------------------------------------
+void Convex2::SetVertices(std::span<Vec2 const> ccwVertices)
+{
+	int numVerts = static_cast<int>(ccwVertices.size());
+	m_vertsAndNormals.resize(2 * numVerts);
+	for (int i = 0; i < numVerts; ++i)
+	{
+		Vec2 const edge = ccwVertices[(i + 1) % numVerts] - ccwVertices[i];
+		m_vertsAndNormals[i]            = ccwVertices[i];
+		m_vertsAndNormals[numVerts + i] = Vec2(edge.y, -edge.x).GetNormalized();
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetPlane - Supporting plane of the edge leaving vertex edgeIndex
+//----------------------------------------------------------------------------------------------------
+Plane2 Convex2::GetPlane(int edgeIndex) const
+{
+	Vec2 const& normal = GetEdgeNormals()[edgeIndex];
+	return Plane2(normal, DotProduct2D(normal, GetVertices()[edgeIndex]));
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetConvexPoly - Vertex-based copy for Engine APIs; allocates
+//----------------------------------------------------------------------------------------------------
+ConvexPoly2 Convex2::GetConvexPoly() const
+{
+	std::span<Vec2 const> verts = GetVertices();
+	return ConvexPoly2(std::vector<Vec2>(verts.begin(), verts.end()));
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetConvexHull - Plane-based copy for Engine APIs; allocates
+//----------------------------------------------------------------------------------------------------
+ConvexHull2 Convex2::GetConvexHull() const
+{
+	int numVerts = GetNumVertices();
+	std::vector<Plane2> planes;
+	planes.reserve(numVerts);
+	for (int i = 0; i < numVerts; ++i)
+	{
+		planes.push_back(GetPlane(i));
+	}
+	return ConvexHull2(planes);
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetMemoryBytes - Footprint of one convex, counting the vector's reserved capacity
+//----------------------------------------------------------------------------------------------------
+size_t Convex2::GetMemoryBytes() const
+{
+	return sizeof(Convex2) + m_vertsAndNormals.capacity() * sizeof(Vec2);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Translate - Move convex shape by offset; edge normals are unaffected
 //----------------------------------------------------------------------------------------------------
 void Convex2::Translate(Vec2 const& offset)
 {
-	m_convexHull.Translate(offset);
-	m_convexPoly.Translate(offset);
+	int numVerts = GetNumVertices();
+	for (int i = 0; i < numVerts; ++i)
+	{
+		m_vertsAndNormals[i] += offset;
+	}
 	m_boundingAABB.Translate(offset);
 	m_boundingDiscCenter += offset;
 }
@@ -67,9 +126,16 @@ void Convex2::Rotate(float degrees, Vec2 const& refPoint)
 	m_boundingDiscCenter.RotateDegrees(degrees);
 	m_boundingDiscCenter += refPoint;
 
-	// Rotate both representations
-	m_convexHull.Rotate(degrees, refPoint);
-	m_convexPoly.Rotate(degrees, refPoint);
+	// Vertices rotate around the reference point, normals only turn
+	int numVerts = GetNumVertices();
+	for (int i = 0; i < numVerts; ++i)
+	{
+		Vec2& vert = m_vertsAndNormals[i];
+		vert -= refPoint;
+		vert.RotateDegrees(degrees);
+		vert += refPoint;
+		m_vertsAndNormals[numVerts + i].RotateDegrees(degrees);
+	}
 
 	// Rebuild AABB since rotation changes axis-aligned bounds
 	RebuildBoundingBox();
@@ -90,9 +156,13 @@ void Convex2::Scale(float scaleFactor, Vec2 const& refPoint)
 	m_boundingDiscCenter *= actualFactor;
 	m_boundingDiscCenter += refPoint;
 
-	// Scale both representations
-	m_convexHull.Scale(actualFactor, refPoint);
-	m_convexPoly.Scale(actualFactor, refPoint);
+	// Uniform scaling moves the vertices but keeps every edge direction, so normals stay valid
+	int numVerts = GetNumVertices();
+	for (int i = 0; i < numVerts; ++i)
+	{
+		Vec2& vert = m_vertsAndNormals[i];
+		vert = refPoint + (vert - refPoint) * actualFactor;
+	}
 
 	// Rebuild AABB since scaling changes bounds
 	RebuildBoundingBox();
@@ -109,7 +179,7 @@ void Convex2::RebuildBoundingBox()
 	float maxY = -FLT_MAX;
 
 	// Find min/max coordinates from all vertices
-	for (auto const& vert : m_convexPoly.GetVertexArray())
+	for (Vec2 const& vert : GetVertices())
 	{
 		if (vert.x < minX)
 		{
@@ -140,7 +210,11 @@ void Convex2::RebuildBoundingVolumes()
 	RebuildBoundingBox();
 
 	// Compute bounding disc center as centroid of vertices
-	std::vector<Vec2> const& verts = m_convexPoly.GetVertexArray();
+	std::span<Vec2 const> verts = GetVertices();
+	if (verts.empty())
+	{
+		return;
+	}
 	Vec2 center = Vec2(0.f, 0.f);
 	for (auto const& vert : verts)
 	{
@@ -167,13 +241,23 @@ void Convex2::RebuildBoundingVolumes()
 //----------------------------------------------------------------------------------------------------
 bool Convex2::IsPointInside(Vec2 const& point) const
 {
-	return IsPointInsideConvexHull2D(point, m_convexHull);
+	std::span<Vec2 const> verts   = GetVertices();
+	std::span<Vec2 const> normals = GetEdgeNormals();
+	int numVerts = static_cast<int>(verts.size());
+	for (int i = 0; i < numVerts; ++i)
+	{
+		if (DotProduct2D(point - verts[i], normals[i]) > 0.f)
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
 //----------------------------------------------------------------------------------------------------
-// RayCastVsConvex2D - Raycast against convex polygon with optional optimizations
+// PassesRayBroadPhase - Cheap bounding-volume test; false means the ray cannot touch this convex
 //----------------------------------------------------------------------------------------------------
-bool Convex2::RayCastVsConvex2D(RaycastResult2D& out_rayCastRes, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, bool discRejection, bool boxRejection)
+bool Convex2::PassesRayBroadPhase(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, bool discRejection, bool boxRejection) const
 {
 	// Optional: Broad-phase disc rejection
 	if (discRejection)
@@ -182,25 +266,13 @@ bool Convex2::RayCastVsConvex2D(RaycastResult2D& out_rayCastRes, Vec2 const& sta
 		// returns m_didImpact=false for this case, so we must handle it explicitly)
 		Vec2 startToCenter = m_boundingDiscCenter - startPos;
 		float distSqToCenter = startToCenter.GetLengthSquared();
-		bool startInsideDisc = (distSqToCenter < m_boundingRadius * m_boundingRadius);
-
-		if (startInsideDisc)
+		if (distSqToCenter < m_boundingRadius * m_boundingRadius)
 		{
-			// Ray starts inside bounding disc, must test narrow-phase
-			out_rayCastRes = RaycastVsConvexHull2D(startPos, forwardNormal, maxDist, m_convexHull);
-			return out_rayCastRes.m_didImpact;
+			return true;
 		}
 
 		RaycastResult2D discResult = RaycastVsDisc2D(startPos, forwardNormal, maxDist, m_boundingDiscCenter, m_boundingRadius);
-		if (discResult.m_didImpact)
-		{
-			// Disc hit, proceed to narrow-phase test
-			out_rayCastRes = RaycastVsConvexHull2D(startPos, forwardNormal, maxDist, m_convexHull);
-			return out_rayCastRes.m_didImpact;
-		}
-		// Disc miss and ray starts outside, safe to reject
-		out_rayCastRes.m_didImpact = false;
-		return false;
+		return discResult.m_didImpact;
 	}
 	// Optional: Broad-phase AABB rejection
 	else if (boxRejection)
@@ -208,18 +280,251 @@ bool Convex2::RayCastVsConvex2D(RaycastResult2D& out_rayCastRes, Vec2 const& sta
 		Vec2 aabb2Mins = m_boundingAABB.m_mins;
 		Vec2 aabb2Maxs = m_boundingAABB.m_maxs;
 		RaycastResult2D aabbResult = RaycastVsAABB2D(startPos, forwardNormal, maxDist, aabb2Mins, aabb2Maxs);
-		if (aabbResult.m_didImpact)
+		return aabbResult.m_didImpact;
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetNearestPointOnBoundary - Closest point on any edge and the outward normal there
+//
+// Returns the unsigned distance to the boundary, so points inside get a positive value too.
+//----------------------------------------------------------------------------------------------------
+float Convex2::GetNearestPointOnBoundary(Vec2 const& point, Vec2& out_nearestPoint, Vec2& out_normal) const
+{
+	std::span<Vec2 const> verts = GetVertices();
+	int   numVerts      = static_cast<int>(verts.size());
+	float bestDistSq    = FLT_MAX;
+	int   bestEdgeIndex = 0;
+
+	for (int i = 0; i < numVerts; ++i)
+	{
+		Vec2 const& edgeStart    = verts[i];
+		Vec2 const  edge         = verts[(i + 1) % numVerts] - edgeStart;
+		float       edgeLengthSq = edge.GetLengthSquared();
+		float       t            = (edgeLengthSq > 0.f) ? DotProduct2D(point - edgeStart, edge) / edgeLengthSq : 0.f;
+		if (t < 0.f) t = 0.f;
+		if (t > 1.f) t = 1.f;
+
+		Vec2  nearestOnEdge = edgeStart + edge * t;
+		float distSq        = (nearestOnEdge - point).GetLengthSquared();
+		if (distSq < bestDistSq)
 		{
-			// AABB hit, proceed to narrow-phase test
-			out_rayCastRes = RaycastVsConvexHull2D(startPos, forwardNormal, maxDist, m_convexHull);
-			return out_rayCastRes.m_didImpact;
+			bestDistSq       = distSq;
+			bestEdgeIndex    = i;
+			out_nearestPoint = nearestOnEdge;
 		}
-		// AABB miss, early exit
+	}
+
+	// Outside near a vertex the edge normal is wrong; point away from the surface instead
+	float dist = sqrtf(bestDistSq);
+	if (dist > 0.f && !IsPointInside(point))
+	{
+		out_normal = (point - out_nearestPoint) / dist;
+	}
+	else if (numVerts > 1)
+	{
+		out_normal = GetEdgeNormals()[bestEdgeIndex];
+	}
+	return dist;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RayCastVsConvex2D - Raycast against convex polygon with optional optimizations
+//----------------------------------------------------------------------------------------------------
+bool Convex2::RayCastVsConvex2D(RaycastResult2D& out_rayCastRes, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, bool discRejection, bool boxRejection) const
+{
+	if (!PassesRayBroadPhase(startPos, forwardNormal, maxDist, discRejection, boxRejection))
+	{
 		out_rayCastRes.m_didImpact = false;
 		return false;
 	}
 
-	// No optimization, direct narrow-phase test
-	out_rayCastRes = RaycastVsConvexHull2D(startPos, forwardNormal, maxDist, m_convexHull);
+	// Same plane clip as the Engine's hull raycast, run on our own edges
+	RayPenetration penetration;
+	out_rayCastRes.m_didImpact = GetRayPenetration(penetration, startPos, forwardNormal, maxDist);
+	if (out_rayCastRes.m_didImpact)
+	{
+		out_rayCastRes.m_impactLength   = penetration.m_entryDist;
+		out_rayCastRes.m_impactPosition = startPos + forwardNormal * penetration.m_entryDist;
+		out_rayCastRes.m_impactNormal   = penetration.m_entryNormal;
+	}
 	return out_rayCastRes.m_didImpact;
 }
+
+//----------------------------------------------------------------------------------------------------
+// GetRayPenetration - Clip the ray against every edge plane to get both entry and exit
+//
+// A ray starting inside enters at 0 with normal -forward. The exit distance is the true
+// exit and may lie beyond maxDist.
+//----------------------------------------------------------------------------------------------------
+bool Convex2::GetRayPenetration(RayPenetration& out_penetration, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const
+{
+	float entryDist   = 0.f;
+	float exitDist    = FLT_MAX;
+	Vec2  entryNormal = -forwardNormal;
+	Vec2  exitNormal  = forwardNormal;
+
+	std::span<Vec2 const> verts   = GetVertices();
+	std::span<Vec2 const> normals = GetEdgeNormals();
+	int numVerts = static_cast<int>(verts.size());
+	for (int i = 0; i < numVerts; ++i)
+	{
+		Vec2 const& normal   = normals[i];
+		float       altitude = DotProduct2D(startPos - verts[i], normal);
+		float       NdotF    = DotProduct2D(normal, forwardNormal);
+
+		if (NdotF == 0.f)
+		{
+			// Parallel to this plane: either always outside it or never constrained by it
+			if (altitude > 0.f)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float planeDist = -altitude / NdotF;
+		if (NdotF < 0.f)
+		{
+			if (planeDist > entryDist)
+			{
+				entryDist   = planeDist;
+				entryNormal = normal;
+			}
+		}
+		else if (planeDist < exitDist)
+		{
+			exitDist   = planeDist;
+			exitNormal = normal;
+		}
+
+		if (entryDist > exitDist || entryDist > maxDist)
+		{
+			return false;
+		}
+	}
+
+	out_penetration.m_entryDist   = entryDist;
+	out_penetration.m_exitDist    = exitDist;
+	out_penetration.m_entryNormal = entryNormal;
+	out_penetration.m_exitNormal  = exitNormal;
+	out_penetration.m_objectId    = m_objectId;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// OverlapsAABB2 - Exact test; the box is treated as a 4-sided convex polygon
+//----------------------------------------------------------------------------------------------------
+bool Convex2::OverlapsAABB2(AABB2 const& box) const
+{
+	Vec2 const boxVerts[4] = {
+		box.m_mins,
+		Vec2(box.m_maxs.x, box.m_mins.y),
+		box.m_maxs,
+		Vec2(box.m_mins.x, box.m_maxs.y)
+	};
+	return OverlapsConvexVerts(boxVerts);
+}
+
+//----------------------------------------------------------------------------------------------------
+// OverlapsDisc - Exact test: center inside the hull, or within radius of the boundary
+//----------------------------------------------------------------------------------------------------
+bool Convex2::OverlapsDisc(Vec2 const& center, float radius) const
+{
+	if (IsPointInside(center))
+	{
+		return true;
+	}
+
+	Vec2 nearestPoint;
+	Vec2 normal;
+	return GetNearestPointOnBoundary(center, nearestPoint, normal) <= radius;
+}
+
+//----------------------------------------------------------------------------------------------------
+// OverlapsConvexVerts - Separating-axis test against a CCW convex polygon
+//
+// Our own axes are the edge normals (our support along an edge normal is that edge's plane
+// distance); the query's axes are its outward edge normals.
+//----------------------------------------------------------------------------------------------------
+bool Convex2::OverlapsConvexVerts(std::span<Vec2 const> ccwVerts) const
+{
+	std::span<Vec2 const> ourVerts   = GetVertices();
+	std::span<Vec2 const> ourNormals = GetEdgeNormals();
+	int numOurVerts = static_cast<int>(ourVerts.size());
+	for (int e = 0; e < numOurVerts; ++e)
+	{
+		float queryMin = FLT_MAX;
+		for (Vec2 const& vert : ccwVerts)
+		{
+			float proj = DotProduct2D(vert, ourNormals[e]);
+			if (proj < queryMin) queryMin = proj;
+		}
+		if (queryMin > DotProduct2D(ourVerts[e], ourNormals[e]))
+		{
+			return false;
+		}
+	}
+
+	int numQueryVerts = static_cast<int>(ccwVerts.size());
+	for (int i = 0; i < numQueryVerts; ++i)
+	{
+		Vec2 const edge     = ccwVerts[(i + 1) % numQueryVerts] - ccwVerts[i];
+		Vec2 const axis     = Vec2(edge.y, -edge.x);
+		float      queryMax = DotProduct2D(ccwVerts[i], axis);
+		float      ourMin   = FLT_MAX;
+		for (Vec2 const& vert : ourVerts)
+		{
+			float proj = DotProduct2D(vert, axis);
+			if (proj < ourMin) ourMin = proj;
+		}
+		if (ourMin > queryMax)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// IsSeparatedByEdgePlanes - True if every vertex lies outside one of the convex's edge planes
+//----------------------------------------------------------------------------------------------------
+static bool IsSeparatedByEdgePlanes(Convex2 const& convex, std::span<Vec2 const> verts)
+{
+	std::span<Vec2 const> edgeVerts = convex.GetVertices();
+	std::span<Vec2 const> normals   = convex.GetEdgeNormals();
+	int numEdges = static_cast<int>(edgeVerts.size());
+	for (int e = 0; e < numEdges; ++e)
+	{
+		Vec2 const& normal     = normals[e];
+		float       planeDist  = DotProduct2D(edgeVerts[e], normal);
+		bool        allOutside = true;
+		for (Vec2 const& vert : verts)
+		{
+			if (DotProduct2D(vert, normal) <= planeDist)
+			{
+				allOutside = false;
+				break;
+			}
+		}
+		if (allOutside)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------------------------------
+// OverlapsConvex - Separating-axis test using both convexes' edge normals as the candidate axes
+//
+// For two convex polygons the edge normals of either side are the only axes to check, and
+// they are already stored alongside the vertices, so no edge vectors need to be built.
+//----------------------------------------------------------------------------------------------------
+bool Convex2::OverlapsConvex(Convex2 const& other) const
+{
+	return !IsSeparatedByEdgePlanes(*this, other.GetVertices()) &&
+		   !IsSeparatedByEdgePlanes(other, GetVertices());
+}
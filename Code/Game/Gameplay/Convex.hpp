@@ -4,21 +4,31 @@
 
 //----------------------------------------------------------------------------------------------------
 #pragma once
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
 #include "Engine/Math/ConvexHull2.hpp"
-// #include "Engine/Math/ConvexPoly2.hpp"
+#include "Engine/Math/ConvexPoly2.hpp"
 #include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Plane2.hpp"
 #include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+#include <vector>
 
 //----------------------------------------------------------------------------------------------------
 // Forward Declarations
 //----------------------------------------------------------------------------------------------------
 struct RaycastResult2D;
+struct RayPenetration;
 
 //----------------------------------------------------------------------------------------------------
-// Convex2 - 2D Convex Polygon with dual representation
+// Convex2 - 2D Convex Polygon stored once as vertices plus edge normals
 //
-// Maintains both plane-based (ConvexHull2) and vertex-based (ConvexPoly2) representations
-// for efficient raycasting and rendering. Includes bounding volumes for optimization.
+// One array holds the CCW vertices followed by the outward unit normal of the edge leaving each
+// vertex. Vertex readers (rendering, SAT, tree builds) get a contiguous span, and plane readers get
+// edge i's plane as (normal i, normal i . vertex i), so raycasts never normalize and no second copy
+// of the shape has to be kept in step. ConvexPoly2 and ConvexHull2 are built on demand for Engine
+// APIs that need them. Includes bounding volumes for optimization.
 //----------------------------------------------------------------------------------------------------
 struct Convex2
 {
@@ -29,13 +39,32 @@ public:
 	Convex2();
 	Convex2(ConvexPoly2 const& convexPoly2);
 	Convex2(ConvexHull2 const& convexHull2);
-	explicit Convex2(std::vector<Vec2> const& vertices);
+	explicit Convex2(std::span<Vec2 const> vertices);
+
+	//------------------------------------------------------------------------------------------------
+	// Geometry Access
+	//------------------------------------------------------------------------------------------------
+	void                  SetVertices(std::span<Vec2 const> ccwVertices);
+	int                   GetNumVertices() const { return static_cast<int>(m_vertsAndNormals.size() / 2); }
+	std::span<Vec2 const> GetVertices() const { return std::span<Vec2 const>(m_vertsAndNormals.data(), m_vertsAndNormals.size() / 2); }
+	std::span<Vec2 const> GetEdgeNormals() const { return std::span<Vec2 const>(m_vertsAndNormals.data() + m_vertsAndNormals.size() / 2, m_vertsAndNormals.size() / 2); }
+	Plane2                GetPlane(int edgeIndex) const;
+	ConvexPoly2           GetConvexPoly() const;
+	ConvexHull2           GetConvexHull() const;
+	size_t                GetMemoryBytes() const; // This object plus its heap storage
 
 	//------------------------------------------------------------------------------------------------
 	// Query Methods
 	//------------------------------------------------------------------------------------------------
 	bool IsPointInside(Vec2 const& point) const;
-	bool RayCastVsConvex2D(RaycastResult2D& out_rayCastRes, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, bool discRejection = true, bool boxRejection = false);
+	float GetNearestPointOnBoundary(Vec2 const& point, Vec2& out_nearestPoint, Vec2& out_normal) const;
+	bool RayCastVsConvex2D(RaycastResult2D& out_rayCastRes, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, bool discRejection = true, bool boxRejection = false) const;
+	bool PassesRayBroadPhase(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, bool discRejection, bool boxRejection) const;
+	bool GetRayPenetration(RayPenetration& out_penetration, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const;
+	bool OverlapsAABB2(AABB2 const& box) const;
+	bool OverlapsDisc(Vec2 const& center, float radius) const;
+	bool OverlapsConvexVerts(std::span<Vec2 const> ccwVerts) const;
+	bool OverlapsConvex(Convex2 const& other) const;
 
 	//------------------------------------------------------------------------------------------------
 	// Transform Methods
@@ -49,11 +78,12 @@ public:
 	//------------------------------------------------------------------------------------------------
 	// Data Members
 	//------------------------------------------------------------------------------------------------
-	ConvexHull2 m_convexHull;              // Plane-based representation (for raycasting)
-	ConvexPoly2 m_convexPoly;              // Vertex-based representation (for rendering)
-	AABB2       m_boundingAABB;            // Axis-aligned bounding box
-	Vec2        m_boundingDiscCenter;      // Bounding disc center
-	float       m_boundingRadius = 0.f;    // Bounding disc radius
-	float       m_scale = 1.f;             // Current scale factor
-	bool        m_symmetricQuadTreeFlag = false; // For QuadTree deduplication
+	std::vector<Vec2> m_vertsAndNormals;         // N CCW vertices, then the N outward edge normals
+	AABB2             m_boundingAABB;            // Axis-aligned bounding box
+	Vec2              m_boundingDiscCenter;      // Bounding disc center
+	float             m_boundingRadius = 0.f;    // Bounding disc radius
+	float             m_scale = 1.f;             // Current scale factor
+	int               m_objectId = -1;           // Index in the owning scene array (assigned on tree rebuild)
+	bool              m_isDynamic = false;       // Expected to move; kept out of PartitionedTree's static tree
+	uint16_t          m_categoryMask = QUERY_CATEGORY_DEFAULT; // QUERY_CATEGORY_ bits, matched against a QueryFilter
 };
@@ -0,0 +1,283 @@
+//----------------------------------------------------------------------------------------------------
+// DistanceField.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/DistanceField.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/NearestQuery.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/MathUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int   SDF_TILE_SIZE       = 16;     // Samples per tile edge; the unit of dirty tracking
+constexpr int   SDF_MAX_TRACE_STEPS = 256;
+constexpr float SDF_HIT_FRACTION    = 0.01f;  // Hit threshold and minimum step, in cells
+
+//----------------------------------------------------------------------------------------------------
+// Bake - A degenerate bounds axis still gets two samples, so SampleDistance always has a cell
+//----------------------------------------------------------------------------------------------------
+void SceneDistanceField::Bake(SceneQueryView const& scene, eQueryMode mode, AABB2 const& bounds, float cellSize, float maxDistance, int numThreads)
+{
+	m_bounds      = bounds;
+	m_queryMode   = mode;
+	m_cellSize    = cellSize;
+	m_maxDistance = maxDistance;
+	m_numSamplesX = std::max(static_cast<int>(ceilf((bounds.m_maxs.x - bounds.m_mins.x) / cellSize)) + 1, 2);
+	m_numSamplesY = std::max(static_cast<int>(ceilf((bounds.m_maxs.y - bounds.m_mins.y) / cellSize)) + 1, 2);
+	m_numTilesX   = (m_numSamplesX + SDF_TILE_SIZE - 1) / SDF_TILE_SIZE;
+	m_numTilesY   = (m_numSamplesY + SDF_TILE_SIZE - 1) / SDF_TILE_SIZE;
+
+	m_distances.assign(static_cast<size_t>(m_numSamplesX) * m_numSamplesY, maxDistance);
+	m_nearestIds.assign(m_distances.size(), -1);
+	m_isTileDirty.assign(static_cast<size_t>(m_numTilesX) * m_numTilesY, 1);
+
+	m_dirtyTiles.clear();
+	for (int tile = 0; tile < m_numTilesX * m_numTilesY; ++tile)
+	{
+		m_dirtyTiles.push_back(tile);
+	}
+	RebakeDirty(scene, numThreads);
+}
+
+//----------------------------------------------------------------------------------------------------
+// MarkDirty - Grown by the max distance: an edit changes every sample that could see it
+//----------------------------------------------------------------------------------------------------
+void SceneDistanceField::MarkDirty(AABB2 const& region)
+{
+	if (!IsBaked())
+	{
+		return;
+	}
+
+	float tileExtent = m_cellSize * static_cast<float>(SDF_TILE_SIZE);
+	int   minTileX   = static_cast<int>(floorf((region.m_mins.x - m_maxDistance - m_bounds.m_mins.x) / tileExtent));
+	int   minTileY   = static_cast<int>(floorf((region.m_mins.y - m_maxDistance - m_bounds.m_mins.y) / tileExtent));
+	int   maxTileX   = static_cast<int>(floorf((region.m_maxs.x + m_maxDistance - m_bounds.m_mins.x) / tileExtent));
+	int   maxTileY   = static_cast<int>(floorf((region.m_maxs.y + m_maxDistance - m_bounds.m_mins.y) / tileExtent));
+	minTileX = std::max(minTileX, 0);
+	minTileY = std::max(minTileY, 0);
+	maxTileX = std::min(maxTileX, m_numTilesX - 1);
+	maxTileY = std::min(maxTileY, m_numTilesY - 1);
+
+	for (int tileY = minTileY; tileY <= maxTileY; ++tileY)
+	{
+		for (int tileX = minTileX; tileX <= maxTileX; ++tileX)
+		{
+			int tile = tileY * m_numTilesX + tileX;
+			if (!m_isTileDirty[tile])
+			{
+				m_isTileDirty[tile] = 1;
+				m_dirtyTiles.push_back(tile);
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// RebakeDirty - Returns the number of tiles rebaked; needs the scene's trees to be current
+//----------------------------------------------------------------------------------------------------
+int SceneDistanceField::RebakeDirty(SceneQueryView const& scene, int numThreads)
+{
+	int numDirty = static_cast<int>(m_dirtyTiles.size());
+	if (numDirty == 0)
+	{
+		return 0;
+	}
+
+	BakeTiles(scene, m_dirtyTiles, numThreads);
+	for (int tile : m_dirtyTiles)
+	{
+		m_isTileDirty[tile] = 0;
+	}
+	m_dirtyTiles.clear();
+	return numDirty;
+}
+
+//----------------------------------------------------------------------------------------------------
+void SceneDistanceField::Clear()
+{
+	m_distances.clear();
+	m_nearestIds.clear();
+	m_isTileDirty.clear();
+	m_dirtyTiles.clear();
+	m_numSamplesX = 0;
+	m_numSamplesY = 0;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t SceneDistanceField::GetMemoryBytes() const
+{
+	return m_distances.capacity() * sizeof(float) + m_nearestIds.capacity() * sizeof(int) + m_isTileDirty.capacity() + m_dirtyTiles.capacity() * sizeof(int);
+}
+
+//----------------------------------------------------------------------------------------------------
+// BakeTiles - Tiles write disjoint samples, so workers only share the tile counter
+//----------------------------------------------------------------------------------------------------
+void SceneDistanceField::BakeTiles(SceneQueryView const& scene, std::vector<int> const& tileIndices, int numThreads)
+{
+	int numTiles = static_cast<int>(tileIndices.size());
+	if (numThreads <= 0)
+	{
+		numThreads = GetNumTaskThreads();
+	}
+	numThreads = std::clamp(numThreads, 1, std::max(numTiles, 1));
+
+	std::atomic<int> nextTile = 0;
+	auto worker = [&](int)
+	{
+		for (int i = nextTile.fetch_add(1); i < numTiles; i = nextTile.fetch_add(1))
+		{
+			BakeTile(scene, tileIndices[i]);
+		}
+	};
+
+	RunOnWorkers(numThreads, worker);
+}
+
+//----------------------------------------------------------------------------------------------------
+// BakeTile - Outside: exact boundary distance from the nearest query. Inside: the largest hull
+// plane altitude, which for a convex is exactly minus the distance to its boundary.
+//----------------------------------------------------------------------------------------------------
+void SceneDistanceField::BakeTile(SceneQueryView const& scene, int tileIndex)
+{
+	int firstX = (tileIndex % m_numTilesX) * SDF_TILE_SIZE;
+	int firstY = (tileIndex / m_numTilesX) * SDF_TILE_SIZE;
+	int lastX  = std::min(firstX + SDF_TILE_SIZE, m_numSamplesX);
+	int lastY  = std::min(firstY + SDF_TILE_SIZE, m_numSamplesY);
+
+	QueryScratch& scratch = QueryScratch::GetForThisThread();
+	DispatchSceneAccelerator(scene, m_queryMode, [&](auto const& accelerator)
+	{
+		NearestConvexResult nearest;
+		for (int y = firstY; y < lastY; ++y)
+		{
+			for (int x = firstX; x < lastX; ++x)
+			{
+				Vec2  samplePos = m_bounds.m_mins + Vec2(static_cast<float>(x), static_cast<float>(y)) * m_cellSize;
+				int   index     = y * m_numSamplesX + x;
+				float distance  = m_maxDistance;
+				int   objectId  = -1;
+
+				NearestConvexCollector collector(std::span<NearestConvexResult>(&nearest, 1), m_maxDistance);
+				collector.m_queryPoint = samplePos;
+				accelerator.CollectNearestConvexes(scratch, collector, scene.m_filter);
+				if (collector.m_numResults > 0)
+				{
+					objectId = nearest.m_objectId;
+					distance = nearest.m_distance;
+					if (distance == 0.f)
+					{
+						Convex2 const&        convex      = *(*scene.m_convexes)[objectId];
+						std::span<Vec2 const> verts       = convex.GetVertices();
+						std::span<Vec2 const> normals     = convex.GetEdgeNormals();
+						float                 maxAltitude = -FLT_MAX;
+						for (int e = 0; e < static_cast<int>(verts.size()); ++e)
+						{
+							maxAltitude = std::max(maxAltitude, DotProduct2D(samplePos - verts[e], normals[e]));
+						}
+						distance = std::max(maxAltitude, -m_maxDistance);
+					}
+				}
+
+				m_distances[index]  = distance;
+				m_nearestIds[index] = objectId;
+			}
+		}
+	});
+}
+
+//----------------------------------------------------------------------------------------------------
+// SampleDistance - Bilinear inside the grid; outside it, at least the distance to the grid.
+// Unbaked, nothing is known, so nothing is reported as closer than the position itself.
+//----------------------------------------------------------------------------------------------------
+float SceneDistanceField::SampleDistance(Vec2 const& position) const
+{
+	if (m_numSamplesX < 2 || m_numSamplesY < 2)
+	{
+		return FLT_MAX;
+	}
+
+	Vec2 clamped(GetClamped(position.x, m_bounds.m_mins.x, m_bounds.m_maxs.x),
+				 GetClamped(position.y, m_bounds.m_mins.y, m_bounds.m_maxs.y));
+
+	float gridX = (clamped.x - m_bounds.m_mins.x) / m_cellSize;
+	float gridY = (clamped.y - m_bounds.m_mins.y) / m_cellSize;
+	int   x0    = GetClamped(static_cast<int>(gridX), 0, m_numSamplesX - 2);
+	int   y0    = GetClamped(static_cast<int>(gridY), 0, m_numSamplesY - 2);
+	float fracX = gridX - static_cast<float>(x0);
+	float fracY = gridY - static_cast<float>(y0);
+
+	float bottom = Interpolate(GetSampleAt(x0, y0), GetSampleAt(x0 + 1, y0), fracX);
+	float top    = Interpolate(GetSampleAt(x0, y0 + 1), GetSampleAt(x0 + 1, y0 + 1), fracX);
+	float inside = Interpolate(bottom, top, fracY);
+
+	float outsideDist = (position - clamped).GetLength();
+	if (outsideDist == 0.f)
+	{
+		return inside;
+	}
+	return std::max(inside - outsideDist, outsideDist);
+}
+
+//----------------------------------------------------------------------------------------------------
+Vec2 SceneDistanceField::SampleGradient(Vec2 const& position) const
+{
+	float h = m_cellSize * 0.5f;
+	Vec2  gradient(SampleDistance(position + Vec2(h, 0.f)) - SampleDistance(position - Vec2(h, 0.f)),
+				   SampleDistance(position + Vec2(0.f, h)) - SampleDistance(position - Vec2(0.f, h)));
+	return gradient.GetNormalized();
+}
+
+//----------------------------------------------------------------------------------------------------
+int SceneDistanceField::GetNearestObjectId(Vec2 const& position) const
+{
+	int x = GetClamped(static_cast<int>(roundf((position.x - m_bounds.m_mins.x) / m_cellSize)), 0, m_numSamplesX - 1);
+	int y = GetClamped(static_cast<int>(roundf((position.y - m_bounds.m_mins.y) / m_cellSize)), 0, m_numSamplesY - 1);
+	return m_nearestIds[y * m_numSamplesX + x];
+}
+
+//----------------------------------------------------------------------------------------------------
+int SceneDistanceField::RaycastBatchSphereTrace(RayBatch const& rays, RayHitBatch const& out_hits) const
+{
+	float hitDistance = m_cellSize * SDF_HIT_FRACTION;
+	int   numRays     = rays.GetNumRays();
+	int   numHits     = 0;
+
+	for (int j = 0; j < numRays; ++j)
+	{
+		Vec2 const& startPos   = rays.m_startPositions[j];
+		Vec2 const& forwardVec = rays.m_forwardNormals[j];
+		float       maxDist    = rays.m_maxDists[j];
+
+		out_hits.m_impactDists[j]     = FLT_MAX;
+		out_hits.m_impactObjectIds[j] = -1;
+		out_hits.m_impactNormals[j]   = Vec2();
+
+		float travelled = 0.f;
+		for (int step = 0; step < SDF_MAX_TRACE_STEPS && travelled <= maxDist; ++step)
+		{
+			Vec2  position = startPos + forwardVec * travelled;
+			float distance = SampleDistance(position);
+			if (distance <= hitDistance)
+			{
+				out_hits.m_impactDists[j]     = travelled;
+				out_hits.m_impactObjectIds[j] = GetNearestObjectId(position);
+				out_hits.m_impactNormals[j]   = SampleGradient(position);
+				++numHits;
+				break;
+			}
+			travelled += std::max(distance, hitDistance);
+		}
+	}
+	return numHits;
+}
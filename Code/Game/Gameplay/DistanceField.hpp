@@ -0,0 +1,64 @@
+//----------------------------------------------------------------------------------------------------
+// DistanceField.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct RayBatch;
+struct RayHitBatch;
+
+//----------------------------------------------------------------------------------------------------
+// SceneDistanceField - Baked grid of signed distances to the nearest convex boundary
+//
+// Samples sit on cell corners; negative inside a convex, clamped to +/- m_maxDistance so the bake
+// only needs a bounded nearest-convex search. Edits mark tiles dirty and only those are rebaked.
+// Lookups are bilinear, so a sampled distance may overshoot the true one by up to a cell diagonal
+// near corners: good for clearance checks and soft rays, not for exact hits. The grid always has at
+// least 2x2 samples, so bilinear lookups have a cell to interpolate in.
+//----------------------------------------------------------------------------------------------------
+class SceneDistanceField
+{
+public:
+	void Bake(SceneQueryView const& scene, eQueryMode mode, AABB2 const& bounds, float cellSize, float maxDistance, int numThreads = 0);
+	void MarkDirty(AABB2 const& region);
+	int  RebakeDirty(SceneQueryView const& scene, int numThreads = 0);
+	void Clear();
+
+	bool   IsBaked() const { return !m_distances.empty(); }
+	float  GetCellSize() const { return m_cellSize; }
+	size_t GetMemoryBytes() const;
+
+	float SampleDistance(Vec2 const& position) const;
+	Vec2  SampleGradient(Vec2 const& position) const;
+	int   GetNearestObjectId(Vec2 const& position) const;
+
+	// Sphere tracing: step by the sampled distance until within a small fraction of a cell
+	int RaycastBatchSphereTrace(RayBatch const& rays, RayHitBatch const& out_hits) const;
+
+private:
+	void  BakeTiles(SceneQueryView const& scene, std::vector<int> const& tileIndices, int numThreads);
+	void  BakeTile(SceneQueryView const& scene, int tileIndex);
+	float GetSampleAt(int x, int y) const { return m_distances[y * m_numSamplesX + x]; }
+
+	AABB2                m_bounds;
+	eQueryMode           m_queryMode   = eQueryMode::AABB2_TREE; // Accelerator the nearest searches go through
+	float                m_cellSize    = 1.f;
+	float                m_maxDistance = 1.f;
+	int                  m_numSamplesX = 0;
+	int                  m_numSamplesY = 0;
+	int                  m_numTilesX   = 0;
+	int                  m_numTilesY   = 0;
+	std::vector<float>   m_distances;   // Row-major, m_numSamplesX * m_numSamplesY
+	std::vector<int>     m_nearestIds;  // Closest object per sample (-1 beyond m_maxDistance)
+	std::vector<uint8_t> m_isTileDirty;
+	std::vector<int>     m_dirtyTiles;
+};
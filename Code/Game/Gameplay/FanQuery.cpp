@@ -0,0 +1,154 @@
+//----------------------------------------------------------------------------------------------------
+// FanQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/FanQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/RaycastUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------
+constexpr float FAN_TWO_PI       = 6.28318530718f;
+constexpr int   FAN_MIN_NUM_BINS = 64;
+constexpr int   FAN_MAX_NUM_BINS = 8192;
+
+//----------------------------------------------------------------------------------------------------
+struct FanBinEntry
+{
+	float          m_minDist = 0.f;    // Origin to the bounding disc; the walk's early-out key
+	Convex2 const* m_convex  = nullptr;
+};
+
+//----------------------------------------------------------------------------------------------------
+// FanScratch - Per-thread bins in compressed form (offsets into one entry array)
+//----------------------------------------------------------------------------------------------------
+struct FanScratch
+{
+	std::vector<int>         m_objectIds;
+	std::vector<int>         m_firstBins;
+	std::vector<int>         m_numBinsCovered;
+	std::vector<int>         m_binOffsets;
+	std::vector<int>         m_binFill;
+	std::vector<FanBinEntry> m_entries;
+
+	static FanScratch& GetForThisThread()
+	{
+		thread_local FanScratch s_scratch;
+		return s_scratch;
+	}
+};
+
+//----------------------------------------------------------------------------------------------------
+static int GetAngleBin(float radians, int numBins)
+{
+	float turns = radians / FAN_TWO_PI;
+	turns -= floorf(turns);
+	return std::min(static_cast<int>(turns * static_cast<float>(numBins)), numBins - 1);
+}
+
+//----------------------------------------------------------------------------------------------------
+int RaycastFanBatch(SceneQueryView const& scene, eQueryMode mode, Vec2 const& origin, std::span<Vec2 const> forwardNormals, float maxDist, RayHitBatch const& out_hits)
+{
+	FanScratch&                  scratch  = FanScratch::GetForThisThread();
+	std::vector<Convex2*> const& convexes = *scene.m_convexes;
+	int                          numRays  = static_cast<int>(forwardNormals.size());
+	int                          numBins  = std::clamp(numRays, FAN_MIN_NUM_BINS, FAN_MAX_NUM_BINS);
+	float                        binWidth = FAN_TWO_PI / static_cast<float>(numBins);
+
+	// Cull once for the whole fan
+	scratch.m_objectIds.resize(convexes.size());
+	int numNearby = QueryRegionOverlaps(scene, mode, RegionQueryShape::MakeDisc(origin, maxDist), scratch.m_objectIds);
+
+	// Project each bounding disc to the run of bins its angular interval covers
+	scratch.m_firstBins.resize(numNearby);
+	scratch.m_numBinsCovered.resize(numNearby);
+	scratch.m_binOffsets.assign(numBins + 1, 0);
+	for (int i = 0; i < numNearby; ++i)
+	{
+		Convex2 const& convex   = *convexes[scratch.m_objectIds[i]];
+		Vec2           toCenter = convex.m_boundingDiscCenter - origin;
+		float          dist     = toCenter.GetLength();
+
+		int firstBin = 0;
+		int numCovered = numBins;
+		if (dist > convex.m_boundingRadius)
+		{
+			float centerAngle = atan2f(toCenter.y, toCenter.x);
+			float halfWidth   = asinf(convex.m_boundingRadius / dist);
+			firstBin   = GetAngleBin(centerAngle - halfWidth, numBins);
+			numCovered = std::min(static_cast<int>(ceilf(2.f * halfWidth / binWidth)) + 2, numBins);
+		}
+		scratch.m_firstBins[i]      = firstBin;
+		scratch.m_numBinsCovered[i] = numCovered;
+		for (int b = 0; b < numCovered; ++b)
+		{
+			++scratch.m_binOffsets[(firstBin + b) % numBins + 1];
+		}
+	}
+	for (int b = 0; b < numBins; ++b)
+	{
+		scratch.m_binOffsets[b + 1] += scratch.m_binOffsets[b];
+	}
+
+	scratch.m_entries.resize(scratch.m_binOffsets[numBins]);
+	scratch.m_binFill.assign(scratch.m_binOffsets.begin(), scratch.m_binOffsets.end() - 1);
+	for (int i = 0; i < numNearby; ++i)
+	{
+		Convex2 const* convex  = convexes[scratch.m_objectIds[i]];
+		float          minDist = std::max((convex->m_boundingDiscCenter - origin).GetLength() - convex->m_boundingRadius, 0.f);
+		for (int b = 0; b < scratch.m_numBinsCovered[i]; ++b)
+		{
+			int bin = (scratch.m_firstBins[i] + b) % numBins;
+			scratch.m_entries[scratch.m_binFill[bin]++] = {minDist, convex};
+		}
+	}
+	for (int b = 0; b < numBins; ++b)
+	{
+		std::sort(scratch.m_entries.begin() + scratch.m_binOffsets[b], scratch.m_entries.begin() + scratch.m_binOffsets[b + 1],
+				  [](FanBinEntry const& a, FanBinEntry const& c) { return a.m_minDist < c.m_minDist; });
+	}
+
+	// Resolve each ray against its bin only, nearest first
+	int             numHits = 0;
+	RaycastResult2D rayRes;
+	for (int j = 0; j < numRays; ++j)
+	{
+		Vec2 const& forwardVec = forwardNormals[j];
+		int         bin        = GetAngleBin(atan2f(forwardVec.y, forwardVec.x), numBins);
+
+		float bestDist     = FLT_MAX;
+		int   bestObjectId = -1;
+		Vec2  bestNormal;
+		for (int e = scratch.m_binOffsets[bin]; e < scratch.m_binOffsets[bin + 1]; ++e)
+		{
+			FanBinEntry const& entry = scratch.m_entries[e];
+			if (entry.m_minDist > bestDist)
+			{
+				break;
+			}
+			if (entry.m_convex->RayCastVsConvex2D(rayRes, origin, forwardVec, maxDist, false, false) && rayRes.m_impactLength < bestDist)
+			{
+				bestDist     = rayRes.m_impactLength;
+				bestObjectId = entry.m_convex->m_objectId;
+				bestNormal   = rayRes.m_impactNormal;
+			}
+		}
+
+		out_hits.m_impactDists[j]     = bestDist;
+		out_hits.m_impactObjectIds[j] = bestObjectId;
+		out_hits.m_impactNormals[j]   = bestNormal;
+		if (bestObjectId != -1)
+		{
+			++numHits;
+		}
+	}
+	return numHits;
+}
@@ -0,0 +1,25 @@
+//----------------------------------------------------------------------------------------------------
+// FanQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+
+//----------------------------------------------------------------------------------------------------
+struct RayHitBatch;
+
+//----------------------------------------------------------------------------------------------------
+// Closest hit for a fan of rays sharing one origin and max distance (lidar sweeps, sensor rings).
+//
+// Nearby convexes are culled once through the spatial index, their bounding discs projected to
+// angular intervals around the origin, and binned by angle with each bin sorted by distance. A
+// ray then walks only its bin, nearest first, and stops as soon as the next object starts beyond
+// its current hit. Returns the number of rays that hit something; misses match RaycastBatch.
+//----------------------------------------------------------------------------------------------------
+int RaycastFanBatch(SceneQueryView const& scene, eQueryMode mode, Vec2 const& origin, std::span<Vec2 const> forwardNormals, float maxDist, RayHitBatch const& out_hits);
@@ -0,0 +1,470 @@
+//----------------------------------------------------------------------------------------------------
+// FrameQueryScheduler.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/FrameQueryScheduler.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Accelerator.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/Time.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <climits>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int   FRAME_QUERIES_PER_TASK = 64;
+constexpr float INITIAL_QUERY_COST_US  = 5.f;  // Until the first chunk of a kind has been measured
+constexpr float LATENCY_SMOOTHING      = 0.05f;
+constexpr float OVER_BUDGET_TOLERANCE  = 1.1f; // Overshooting by part of one query is expected, not an overrun
+
+//----------------------------------------------------------------------------------------------------
+int FrameQueryStats::GetTotalQueueDepth() const
+{
+	int total = 0;
+	for (int depth : m_queueDepths)
+	{
+		total += depth;
+	}
+	return total;
+}
+
+//----------------------------------------------------------------------------------------------------
+FrameQueryScheduler::FrameQueryScheduler(FrameQuerySchedulerConfig const& config)
+	: m_config(config)
+{
+	for (float& cost : m_stats.m_costEstimatesUs)
+	{
+		cost = INITIAL_QUERY_COST_US;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+FrameQueryScheduler::~FrameQueryScheduler()
+{
+	// Nothing may be left waiting on a future that can no longer complete
+	if (m_scene.m_convexes != nullptr)
+	{
+		Flush();
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void FrameQueryScheduler::SetScene(SceneQueryView const& scene, eQueryMode mode)
+{
+	m_scene     = scene;
+	m_queryMode = mode;
+}
+
+//----------------------------------------------------------------------------------------------------
+void FrameQueryScheduler::SetConfig(FrameQuerySchedulerConfig const& config)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_config = config;
+}
+
+//----------------------------------------------------------------------------------------------------
+FrameQuerySchedulerConfig FrameQueryScheduler::GetConfig() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_config;
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryFuture<ClosestRayHit> FrameQueryScheduler::SubmitRaycast(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, eQueryPriority priority)
+{
+	ClosestRequest request;
+	request.m_startPos      = startPos;
+	request.m_forwardNormal = forwardNormal;
+	request.m_maxDist       = maxDist;
+	request.m_submitTime    = GetCurrentTimeSeconds();
+	request.m_state         = std::make_shared<QueryFutureState<ClosestRayHit>>();
+	QueryFuture<ClosestRayHit> future(request.m_state, this);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	request.m_submitFrame = m_frameIndex;
+	m_queues[static_cast<int>(priority)].m_closest.push_back(std::move(request));
+	return future;
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryFuture<bool> FrameQueryScheduler::SubmitRaycastAny(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, eQueryPriority priority)
+{
+	AnyRequest request;
+	request.m_startPos      = startPos;
+	request.m_forwardNormal = forwardNormal;
+	request.m_maxDist       = maxDist;
+	request.m_submitTime    = GetCurrentTimeSeconds();
+	request.m_state         = std::make_shared<QueryFutureState<bool>>();
+	QueryFuture<bool> future(request.m_state, this);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	request.m_submitFrame = m_frameIndex;
+	m_queues[static_cast<int>(priority)].m_any.push_back(std::move(request));
+	return future;
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryFuture<std::vector<int>> FrameQueryScheduler::SubmitRegion(RegionQueryShape const& shape, eQueryPriority priority)
+{
+	RegionRequest request;
+	request.m_shape      = shape;
+	request.m_submitTime = GetCurrentTimeSeconds();
+	request.m_state      = std::make_shared<QueryFutureState<std::vector<int>>>();
+	QueryFuture<std::vector<int>> future(request.m_state, this);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	request.m_submitFrame = m_frameIndex;
+	m_queues[static_cast<int>(priority)].m_regions.push_back(std::move(request));
+	return future;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RunFrame - CRITICAL first and unconditionally, then budgeted chunks from HIGH down to LOW
+//----------------------------------------------------------------------------------------------------
+int FrameQueryScheduler::RunFrame()
+{
+	// One copy per frame: chunks read it unlocked while SetConfig may run on another thread
+	FrameQuerySchedulerConfig config;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		config = m_config;
+	}
+
+	double const frameStartTime = GetCurrentTimeSeconds();
+	int          numExecuted    = 0;
+	int          numChunks      = 0;
+	std::vector<std::coroutine_handle<>> awaiters;
+
+	// Each chunk resumes its own awaiters, which may queue follow-up queries in the same frame
+	auto runChunkAndResume = [&](int priority, eFrameQueryKind kind, int maxQueries)
+	{
+		int numRun = RunChunk(config, priority, kind, maxQueries, awaiters);
+		for (std::coroutine_handle<> awaiter : awaiters)
+		{
+			awaiter.resume();
+		}
+		awaiters.clear();
+		numExecuted += numRun;
+		numChunks   += (numRun > 0) ? 1 : 0;
+		return numRun;
+	};
+
+	int const critical = static_cast<int>(eQueryPriority::CRITICAL);
+	for (int kind = 0; kind < static_cast<int>(eFrameQueryKind::COUNT); ++kind)
+	{
+		while (runChunkAndResume(critical, static_cast<eFrameQueryKind>(kind), INT_MAX) > 0)
+		{
+		}
+	}
+
+	// The budget covers only the work it can defer, so a CRITICAL burst does not starve the rest forever
+	double const budgetStartTime = GetCurrentTimeSeconds();
+	double const budgetSeconds   = static_cast<double>(config.m_budgetMs) / 1000.0;
+	for (;;)
+	{
+		int             priority;
+		eFrameQueryKind kind;
+		float           costUs;
+		bool            isCostMeasured;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!SelectNextQueue(priority, kind))
+			{
+				break;
+			}
+			costUs         = m_stats.m_costEstimatesUs[static_cast<int>(kind)];
+			isCostMeasured = m_isCostMeasured[static_cast<int>(kind)];
+		}
+
+		// Only what is predicted to fit, except that every frame answers at least one query
+		double remainingUs = (budgetSeconds - (GetCurrentTimeSeconds() - budgetStartTime)) * 1e6;
+		int    numFit      = static_cast<int>(remainingUs / std::max(static_cast<double>(costUs), 0.01));
+		if (numFit <= 0)
+		{
+			if (numExecuted > 0)
+			{
+				break;
+			}
+			numFit = 1;
+		}
+		int maxQueries = std::min(numFit, isCostMeasured ? std::max(config.m_maxChunkQueries, 1) : std::max(config.m_probeChunkQueries, 1));
+		runChunkAndResume(priority, kind, maxQueries);
+	}
+
+	double frameEndTime = GetCurrentTimeSeconds();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.m_numExecutedLastFrame = numExecuted;
+	m_stats.m_numChunksLastFrame   = numChunks;
+	m_stats.m_usedMsLastFrame      = static_cast<float>((frameEndTime - frameStartTime) * 1000.0);
+	m_stats.m_numFramesOverBudget += ((frameEndTime - budgetStartTime) > budgetSeconds * OVER_BUDGET_TOLERANCE) ? 1 : 0;
+	++m_frameIndex;
+	return numExecuted;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Flush - Everything queued, every priority, no budget; a blocking Get lands here
+//----------------------------------------------------------------------------------------------------
+int FrameQueryScheduler::Flush()
+{
+	FrameQuerySchedulerConfig config = GetConfig();
+	int numExecuted = 0;
+	std::vector<std::coroutine_handle<>> awaiters;
+	for (int priority = 0; priority < static_cast<int>(eQueryPriority::COUNT); ++priority)
+	{
+		for (int kind = 0; kind < static_cast<int>(eFrameQueryKind::COUNT); ++kind)
+		{
+			int numRun = 0;
+			do
+			{
+				numRun = RunChunk(config, priority, static_cast<eFrameQueryKind>(kind), INT_MAX, awaiters);
+				numExecuted += numRun;
+				for (std::coroutine_handle<> awaiter : awaiters)
+				{
+					awaiter.resume();
+				}
+				awaiters.clear();
+			} while (numRun > 0);
+		}
+	}
+	return numExecuted;
+}
+
+//----------------------------------------------------------------------------------------------------
+FrameQueryStats FrameQueryScheduler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	FrameQueryStats stats = m_stats;
+	for (int priority = 0; priority < static_cast<int>(eQueryPriority::COUNT); ++priority)
+	{
+		stats.m_queueDepths[priority] = m_queues[priority].GetSize();
+	}
+	return stats;
+}
+
+//----------------------------------------------------------------------------------------------------
+FrameQueryScheduler::ChunkBuffers& FrameQueryScheduler::GetChunkBuffersForThisThread()
+{
+	thread_local ChunkBuffers s_buffers;
+	return s_buffers;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RunChunk - Takes up to maxQueries of one kind from the front of one queue, runs them as a batch and
+// folds the measured time into that kind's per-query cost. The thread's buffers are moved out for the
+// chunk, so a Flush nested on this thread (a task waiting on a future) starts from empty ones.
+//----------------------------------------------------------------------------------------------------
+int FrameQueryScheduler::RunChunk(FrameQuerySchedulerConfig const& config, int priority, eFrameQueryKind kind, int maxQueries, std::vector<std::coroutine_handle<>>& out_awaiters)
+{
+	ChunkBuffers& threadBuffers = GetChunkBuffersForThisThread();
+	ChunkBuffers  buffers       = std::move(threadBuffers);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		PriorityQueue& queue = m_queues[priority];
+		auto take = [maxQueries](auto& source, auto& destination)
+		{
+			size_t count = std::min(source.size(), static_cast<size_t>(maxQueries));
+			destination.assign(std::make_move_iterator(source.begin()), std::make_move_iterator(source.begin() + static_cast<ptrdiff_t>(count)));
+			source.erase(source.begin(), source.begin() + static_cast<ptrdiff_t>(count));
+		};
+		switch (kind)
+		{
+		case eFrameQueryKind::RAYCAST_CLOSEST: take(queue.m_closest, buffers.m_closest); break;
+		case eFrameQueryKind::RAYCAST_ANY:     take(queue.m_any, buffers.m_any);         break;
+		case eFrameQueryKind::REGION:          take(queue.m_regions, buffers.m_regions); break;
+		default: break;
+		}
+	}
+
+	int numQueries = static_cast<int>(buffers.m_closest.size() + buffers.m_any.size() + buffers.m_regions.size());
+	if (numQueries > 0)
+	{
+		double startTime = GetCurrentTimeSeconds();
+		RunClosest(buffers.m_closest, out_awaiters);
+		RunAny(buffers.m_any, out_awaiters);
+		RunRegions(buffers.m_regions, config.m_maxRegionResults, out_awaiters);
+		double endTime = GetCurrentTimeSeconds();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		float  measuredUs = static_cast<float>((endTime - startTime) * 1e6 / static_cast<double>(numQueries));
+		float& estimateUs = m_stats.m_costEstimatesUs[static_cast<int>(kind)];
+		estimateUs = m_isCostMeasured[static_cast<int>(kind)] ? estimateUs + config.m_costSmoothing * (measuredUs - estimateUs) : measuredUs;
+		m_isCostMeasured[static_cast<int>(kind)] = true;
+		m_stats.m_numExecuted += numQueries;
+		for (ClosestRequest const& request : buffers.m_closest)
+		{
+			RecordLatency(request.m_submitTime, request.m_submitFrame, endTime);
+		}
+		for (AnyRequest const& request : buffers.m_any)
+		{
+			RecordLatency(request.m_submitTime, request.m_submitFrame, endTime);
+		}
+		for (RegionRequest const& request : buffers.m_regions)
+		{
+			RecordLatency(request.m_submitTime, request.m_submitFrame, endTime);
+		}
+	}
+
+	// Drop the future states now; keep the capacity for the next chunk
+	buffers.m_closest.clear();
+	buffers.m_any.clear();
+	buffers.m_regions.clear();
+	threadBuffers = std::move(buffers);
+	return numQueries;
+}
+
+//----------------------------------------------------------------------------------------------------
+void FrameQueryScheduler::RunClosest(std::vector<ClosestRequest>& requests, std::vector<std::coroutine_handle<>>& out_awaiters)
+{
+	int numRays = static_cast<int>(requests.size());
+	if (numRays == 0)
+	{
+		return;
+	}
+
+	// Flush can run on any thread, so temporaries come from its task scratch rather than the frame arena
+	TaskScratchScope scratchScope;
+	TaskScratch&     taskScratch    = scratchScope.GetScratch();
+	std::span<Vec2>  startPositions = taskScratch.AllocateArray<Vec2>(numRays);
+	std::span<Vec2>  forwardNormals = taskScratch.AllocateArray<Vec2>(numRays);
+	std::span<float> maxDists       = taskScratch.AllocateArray<float>(numRays);
+	for (int i = 0; i < numRays; ++i)
+	{
+		startPositions[i] = requests[i].m_startPos;
+		forwardNormals[i] = requests[i].m_forwardNormal;
+		maxDists[i]       = requests[i].m_maxDist;
+	}
+
+	std::span<float> impactDists     = taskScratch.AllocateArray<float>(numRays);
+	std::span<int>   impactObjectIds = taskScratch.AllocateArray<int>(numRays);
+	std::span<Vec2>  impactNormals   = taskScratch.AllocateArray<Vec2>(numRays);
+	RaycastBatchParallel(m_scene, m_queryMode, RayBatch{startPositions, forwardNormals, maxDists}, RayHitBatch{impactDists, impactObjectIds, impactNormals});
+
+	for (int i = 0; i < numRays; ++i)
+	{
+		ClosestRayHit hit;
+		hit.m_dist     = impactDists[i];
+		hit.m_objectId = impactObjectIds[i];
+		hit.m_normal   = impactNormals[i];
+		if (std::coroutine_handle<> awaiter = requests[i].m_state->Complete(std::move(hit)))
+		{
+			out_awaiters.push_back(awaiter);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void FrameQueryScheduler::RunAny(std::vector<AnyRequest>& requests, std::vector<std::coroutine_handle<>>& out_awaiters)
+{
+	int numRays = static_cast<int>(requests.size());
+	if (numRays == 0)
+	{
+		return;
+	}
+
+	TaskScratchScope   scratchScope;
+	std::span<uint8_t> isBlocked = scratchScope.GetScratch().AllocateArray<uint8_t>(numRays);
+	DispatchSceneAccelerator(m_scene, m_queryMode, [&](auto const& accelerator)
+	{
+		ParallelFor(0, numRays, FRAME_QUERIES_PER_TASK, [&](int first, int last)
+		{
+			QueryScratch& scratch = QueryScratch::GetForThisThread();
+			for (int j = first; j < last; ++j)
+			{
+				isBlocked[j] = accelerator.RaycastAny(requests[j].m_startPos, requests[j].m_forwardNormal, requests[j].m_maxDist, scratch, m_scene.m_filter) ? 1 : 0;
+			}
+		});
+	});
+
+	for (int i = 0; i < numRays; ++i)
+	{
+		if (std::coroutine_handle<> awaiter = requests[i].m_state->Complete(isBlocked[i] != 0))
+		{
+			out_awaiters.push_back(awaiter);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void FrameQueryScheduler::RunRegions(std::vector<RegionRequest>& requests, int maxRegionResults, std::vector<std::coroutine_handle<>>& out_awaiters)
+{
+	int numRegions = static_cast<int>(requests.size());
+	if (numRegions == 0)
+	{
+		return;
+	}
+
+	int const        slotSize   = std::max(maxRegionResults, 1);
+	TaskScratchScope scratchScope;
+	std::span<int>   objectIds  = scratchScope.GetScratch().AllocateArray<int>(static_cast<size_t>(numRegions) * slotSize);
+	std::span<int>   numResults = scratchScope.GetScratch().AllocateArray<int>(numRegions);
+	ParallelFor(0, numRegions, FRAME_QUERIES_PER_TASK, [&](int first, int last)
+	{
+		for (int r = first; r < last; ++r)
+		{
+			std::span<int> slot(objectIds.data() + static_cast<size_t>(r) * slotSize, slotSize);
+			numResults[r] = QueryRegionOverlaps(m_scene, m_queryMode, requests[r].m_shape, slot);
+		}
+	});
+
+	for (int r = 0; r < numRegions; ++r)
+	{
+		int const* slot = objectIds.data() + static_cast<size_t>(r) * slotSize;
+		if (std::coroutine_handle<> awaiter = requests[r].m_state->Complete(std::vector<int>(slot, slot + numResults[r])))
+		{
+			out_awaiters.push_back(awaiter);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// RecordLatency - Caller holds m_mutex
+//----------------------------------------------------------------------------------------------------
+void FrameQueryScheduler::RecordLatency(double submitTime, int submitFrame, double now)
+{
+	float latencyMs     = static_cast<float>((now - submitTime) * 1000.0);
+	int   latencyFrames = m_frameIndex - submitFrame;
+	m_stats.m_avgLatencyMs     += LATENCY_SMOOTHING * (latencyMs - m_stats.m_avgLatencyMs);
+	m_stats.m_avgLatencyFrames += LATENCY_SMOOTHING * (static_cast<float>(latencyFrames) - m_stats.m_avgLatencyFrames);
+	m_stats.m_maxLatencyMs      = std::max(m_stats.m_maxLatencyMs, latencyMs);
+	m_stats.m_maxLatencyFrames  = std::max(m_stats.m_maxLatencyFrames, latencyFrames);
+}
+
+//----------------------------------------------------------------------------------------------------
+// SelectNextQueue - The non-empty queue with the best effective priority. A queue gains one level for
+// every m_maxDeferFrames its oldest request has waited, up to HIGH, so LOW work cannot starve but
+// aged work never competes with CRITICAL. Queues are FIFO, so the oldest request is at the front.
+// Caller holds m_mutex.
+//----------------------------------------------------------------------------------------------------
+bool FrameQueryScheduler::SelectNextQueue(int& out_priority, eFrameQueryKind& out_kind) const
+{
+	int const highest      = static_cast<int>(eQueryPriority::HIGH);
+	int       bestPriority = static_cast<int>(eQueryPriority::COUNT);
+	auto consider = [&](int priority, eFrameQueryKind kind, auto const& queue)
+	{
+		if (queue.empty())
+		{
+			return;
+		}
+		int effectivePriority = priority;
+		if (m_config.m_maxDeferFrames > 0)
+		{
+			effectivePriority = std::max(highest, priority - (m_frameIndex - queue.front().m_submitFrame) / m_config.m_maxDeferFrames);
+		}
+		if (effectivePriority < bestPriority)
+		{
+			bestPriority = effectivePriority;
+			out_priority = priority;
+			out_kind     = kind;
+		}
+	};
+
+	for (int priority = highest; priority < static_cast<int>(eQueryPriority::COUNT); ++priority)
+	{
+		consider(priority, eFrameQueryKind::RAYCAST_CLOSEST, m_queues[priority].m_closest);
+		consider(priority, eFrameQueryKind::RAYCAST_ANY, m_queues[priority].m_any);
+		consider(priority, eFrameQueryKind::REGION, m_queues[priority].m_regions);
+	}
+	return bestPriority < static_cast<int>(eQueryPriority::COUNT);
+}
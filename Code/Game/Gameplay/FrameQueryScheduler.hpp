@@ -0,0 +1,160 @@
+//----------------------------------------------------------------------------------------------------
+// FrameQueryScheduler.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/AsyncQuery.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+// eQueryPriority - CRITICAL work always runs in the frame it was submitted, over budget if need be;
+// the rest runs highest first while the frame budget lasts
+//----------------------------------------------------------------------------------------------------
+enum class eQueryPriority : uint8_t
+{
+	CRITICAL,
+	HIGH,
+	NORMAL,
+	LOW,
+	COUNT
+};
+
+//----------------------------------------------------------------------------------------------------
+enum class eFrameQueryKind : uint8_t
+{
+	RAYCAST_CLOSEST,
+	RAYCAST_ANY,
+	REGION,
+	COUNT
+};
+
+//----------------------------------------------------------------------------------------------------
+struct FrameQuerySchedulerConfig
+{
+	float m_budgetMs          = 2.f;   // Time per frame for everything below CRITICAL
+	int   m_probeChunkQueries = 16;    // First chunk of each kind, kept small until its cost is measured
+	int   m_maxChunkQueries   = 8192;  // Largest, so the cost estimate is corrected often within a frame
+	float m_costSmoothing     = 0.25f; // Weight of the newest chunk in each per-query cost estimate
+	int   m_maxDeferFrames    = 30;    // Queued work gains one priority level per this many frames waited
+	int   m_maxRegionResults  = 256;   // Ids kept per region query; the rest are dropped
+};
+
+//----------------------------------------------------------------------------------------------------
+struct FrameQueryStats
+{
+	int     m_queueDepths[static_cast<int>(eQueryPriority::COUNT)] = {};
+	float   m_costEstimatesUs[static_cast<int>(eFrameQueryKind::COUNT)] = {}; // Measured per query
+	int     m_numExecutedLastFrame = 0;
+	int     m_numChunksLastFrame   = 0;
+	float   m_usedMsLastFrame      = 0.f; // Including CRITICAL work
+	int64_t m_numExecuted          = 0;
+	int     m_numFramesOverBudget  = 0;   // Frames where budgeted work alone overran by over 10%
+	float   m_avgLatencyMs         = 0.f; // Smoothed submit-to-answer time
+	float   m_maxLatencyMs         = 0.f;
+	float   m_avgLatencyFrames     = 0.f;
+	int     m_maxLatencyFrames     = 0;
+
+	int GetTotalQueueDepth() const;
+};
+
+//----------------------------------------------------------------------------------------------------
+// FrameQueryScheduler - Prioritized query queues drained within a per-frame time budget
+//
+// Systems submit from any thread and get the same futures as AsyncSceneQueries. Once per frame the
+// owner calls RunFrame at a point where the scene is stable: CRITICAL queries all run, then the other
+// queues are drained highest priority first, in chunks sized from each kind's measured per-query cost
+// so the predicted chunk fits in what is left of the budget. Whatever does not fit waits for a later
+// frame, and waiting work ages toward HIGH so LOW work cannot starve.
+//
+// A blocking Get runs everything queued regardless of budget; budgeted callers should poll IsReady
+// or co_await instead. Awaiting coroutines resume inside RunFrame, after the chunk that answered them.
+//----------------------------------------------------------------------------------------------------
+class FrameQueryScheduler : public QueryExecutor
+{
+public:
+	explicit FrameQueryScheduler(FrameQuerySchedulerConfig const& config = FrameQuerySchedulerConfig());
+	~FrameQueryScheduler() override;
+	FrameQueryScheduler(FrameQueryScheduler const&)            = delete;
+	FrameQueryScheduler& operator=(FrameQueryScheduler const&) = delete;
+
+	void SetScene(SceneQueryView const& scene, eQueryMode mode);
+	void SetConfig(FrameQuerySchedulerConfig const& config);
+	FrameQuerySchedulerConfig GetConfig() const;
+
+	QueryFuture<ClosestRayHit>    SubmitRaycast(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, eQueryPriority priority = eQueryPriority::NORMAL);
+	QueryFuture<bool>             SubmitRaycastAny(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, eQueryPriority priority = eQueryPriority::NORMAL);
+	QueryFuture<std::vector<int>> SubmitRegion(RegionQueryShape const& shape, eQueryPriority priority = eQueryPriority::NORMAL);
+
+	int             RunFrame(); // Returns the number of queries answered this frame
+	int             Flush() override;
+	FrameQueryStats GetStats() const;
+
+private:
+	struct RayRequest
+	{
+		Vec2   m_startPos;
+		Vec2   m_forwardNormal;
+		float  m_maxDist     = 0.f;
+		double m_submitTime  = 0.0;
+		int    m_submitFrame = 0;
+	};
+
+	struct ClosestRequest : RayRequest { std::shared_ptr<QueryFutureState<ClosestRayHit>> m_state; };
+	struct AnyRequest     : RayRequest { std::shared_ptr<QueryFutureState<bool>>          m_state; };
+	struct RegionRequest
+	{
+		RegionQueryShape                                    m_shape;
+		double                                              m_submitTime  = 0.0;
+		int                                                 m_submitFrame = 0;
+		std::shared_ptr<QueryFutureState<std::vector<int>>> m_state;
+	};
+
+	struct PriorityQueue
+	{
+		std::deque<ClosestRequest> m_closest;
+		std::deque<AnyRequest>     m_any;
+		std::deque<RegionRequest>  m_regions;
+
+		int GetSize() const { return static_cast<int>(m_closest.size() + m_any.size() + m_regions.size()); }
+	};
+
+	// Requests taken for one chunk; kept per thread so steady frames reuse their capacity
+	struct ChunkBuffers
+	{
+		std::vector<ClosestRequest> m_closest;
+		std::vector<AnyRequest>     m_any;
+		std::vector<RegionRequest>  m_regions;
+	};
+
+	static ChunkBuffers& GetChunkBuffersForThisThread();
+
+	int  RunChunk(FrameQuerySchedulerConfig const& config, int priority, eFrameQueryKind kind, int maxQueries, std::vector<std::coroutine_handle<>>& out_awaiters);
+	void RunClosest(std::vector<ClosestRequest>& requests, std::vector<std::coroutine_handle<>>& out_awaiters);
+	void RunAny(std::vector<AnyRequest>& requests, std::vector<std::coroutine_handle<>>& out_awaiters);
+	void RunRegions(std::vector<RegionRequest>& requests, int maxRegionResults, std::vector<std::coroutine_handle<>>& out_awaiters);
+	void RecordLatency(double submitTime, int submitFrame, double now);
+	bool SelectNextQueue(int& out_priority, eFrameQueryKind& out_kind) const;
+
+	FrameQuerySchedulerConfig m_config;
+	SceneQueryView            m_scene;
+	eQueryMode                m_queryMode = eQueryMode::AABB2_TREE;
+
+	mutable std::mutex        m_mutex;
+	PriorityQueue             m_queues[static_cast<int>(eQueryPriority::COUNT)];
+	int                       m_frameIndex = 0;
+	FrameQueryStats           m_stats;
+	bool                      m_isCostMeasured[static_cast<int>(eFrameQueryKind::COUNT)] = {};
+};
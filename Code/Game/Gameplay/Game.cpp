@@ -7,9 +7,21 @@
 //----------------------------------------------------------------------------------------------------
 #include "Game/Framework/App.hpp"
 #include "Game/Framework/GameCommon.hpp"
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/AcceleratorTuner.hpp"
+#include "Game/Gameplay/AsyncQuery.hpp"
+#include "Game/Gameplay/BounceQuery.hpp"
 #include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/FanQuery.hpp"
+#include "Game/Gameplay/InstancedScene.hpp"
 #include "Game/Gameplay/BVH.hpp"
 #include "Game/Gameplay/QuadTree.hpp"
+#include "Game/Gameplay/QueryLoadClient.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+#include "Game/Gameplay/ShapeCast.hpp"
+#include "Game/Gameplay/VisibilityQuery.hpp"
 //----------------------------------------------------------------------------------------------------
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Core/Clock.hpp"
@@ -31,7 +43,11 @@
 #include "Engine/Core/FileUtils.hpp"
 //----------------------------------------------------------------------------------------------------
 #include <algorithm>
+#include <cctype>
 #include <cfloat>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
 #include <filesystem>
 #include <unordered_map>
 
@@ -43,6 +59,142 @@ constexpr float WORLD_SIZE_Y = 100.f;
 constexpr float MIN_CONVEX_RADIUS = 2.f;
 constexpr float MAX_CONVEX_RADIUS = 8.f;
 constexpr int   INITIAL_CONVEX_COUNT = 8;
+constexpr float DISTANCE_FIELD_CELL_SIZE = 0.5f;
+constexpr float DISTANCE_FIELD_MAX_DIST  = 8.f;
+constexpr float FAN_TEST_MAX_DIST        = 50.f;
+constexpr float OCCUPANCY_CELL_SIZE      = 1.f;
+constexpr int   VISIBILITY_TEST_ARC_STEPS = 256;
+constexpr int   ALL_HITS_TEST_RAYS       = 256;
+constexpr int   ALL_HITS_TEST_MAX_HITS   = 64;
+constexpr int   SHAPE_CAST_TEST_RAYS     = 256;
+constexpr float SHAPE_CAST_TEST_RADIUS   = 0.5f;
+constexpr int   BOUNCE_TEST_RAYS         = 256;
+constexpr float BOUNCE_TEST_TOLERANCE    = 1e-3f;
+constexpr float VISIBILITY_TEST_TOLERANCE = 0.01f;
+constexpr int   TUNER_WORKLOAD_RAYS      = 4096;
+constexpr int   CONVEXES_PER_TASK        = 32;
+constexpr int   VERTEX_CHUNK_MIN_CONVEXES = 64;
+constexpr float MIN_INSTANCE_SCALE       = 0.5f;
+constexpr float MAX_INSTANCE_SCALE       = 1.5f;
+
+//----------------------------------------------------------------------------------------------------
+// A segment between two random points in the world, the distribution TestRays uses
+//----------------------------------------------------------------------------------------------------
+static void RollRandomWorldRay(Vec2& out_startPos, Vec2& out_forwardNormal, float& out_maxDist)
+{
+    Vec2 p1(g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_X), g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_Y));
+    Vec2 p2(g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_X), g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_Y));
+    Vec2 disp = p2 - p1;
+    out_startPos      = p1;
+    out_forwardNormal = disp.GetNormalized();
+    out_maxDist       = disp.GetLength();
+}
+
+//----------------------------------------------------------------------------------------------------
+// Query categories by console name; a mask is written as names joined by ',' or as a plain number
+//----------------------------------------------------------------------------------------------------
+struct QueryCategoryName
+{
+    char const* m_name;
+    uint16_t    m_mask;
+};
+
+static QueryCategoryName constexpr QUERY_CATEGORY_NAMES[] =
+{
+    {"default", QUERY_CATEGORY_DEFAULT},
+    {"wall",    QUERY_CATEGORY_WALL},
+    {"glass",   QUERY_CATEGORY_GLASS},
+    {"foliage", QUERY_CATEGORY_FOLIAGE},
+    {"trigger", QUERY_CATEGORY_TRIGGER},
+};
+
+//----------------------------------------------------------------------------------------------------
+static bool ParseQueryCategoryMask(String const& text, uint16_t& out_mask)
+{
+    if (text == "all")
+    {
+        out_mask = QUERY_CATEGORY_ALL;
+        return true;
+    }
+    if (!text.empty() && isdigit(static_cast<unsigned char>(text[0])))
+    {
+        out_mask = static_cast<uint16_t>(strtoul(text.c_str(), nullptr, 0));
+        return true;
+    }
+
+    uint16_t mask  = 0;
+    size_t   first = 0;
+    while (first <= text.size())
+    {
+        size_t last = text.find(',', first);
+        if (last == String::npos)
+        {
+            last = text.size();
+        }
+        String name  = text.substr(first, last - first);
+        bool   found = false;
+        for (QueryCategoryName const& category : QUERY_CATEGORY_NAMES)
+        {
+            if (name == category.m_name)
+            {
+                mask |= category.m_mask;
+                found = true;
+            }
+        }
+        if (!found && !name.empty())
+        {
+            return false;
+        }
+        first = last + 1;
+    }
+    out_mask = mask;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Comma-separated names of the categories in mask, written without allocating for the HUD
+//----------------------------------------------------------------------------------------------------
+static void FormatQueryCategoryNames(uint16_t mask, std::span<char> out_names)
+{
+    if (out_names.empty())
+    {
+        return;
+    }
+    if (mask == QUERY_CATEGORY_ALL)
+    {
+        std::snprintf(out_names.data(), out_names.size(), "all");
+        return;
+    }
+    int const capacity = static_cast<int>(out_names.size());
+    int       length   = 0;
+    out_names[0] = '\0';
+    for (QueryCategoryName const& category : QUERY_CATEGORY_NAMES)
+    {
+        if ((mask & category.m_mask) != 0)
+        {
+            length += std::snprintf(out_names.data() + length, capacity - length, "%s%s", length == 0 ? "" : ",", category.m_name);
+            length  = std::min(length, capacity - 1);
+            mask   &= static_cast<uint16_t>(~category.m_mask);
+        }
+    }
+    if (mask != 0)
+    {
+        length += std::snprintf(out_names.data() + length, capacity - length, "%s0x%x", length == 0 ? "" : ",", static_cast<unsigned int>(mask));
+        length  = std::min(length, capacity - 1);
+    }
+    if (length == 0)
+    {
+        std::snprintf(out_names.data(), out_names.size(), "none");
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+static String GetQueryCategoryNames(uint16_t mask)
+{
+    char names[128];
+    FormatQueryCategoryNames(mask, names);
+    return names;
+}
 
 //----------------------------------------------------------------------------------------------------
 Game::Game()
@@ -52,6 +204,19 @@ Game::Game()
     g_eventSystem->SubscribeEventCallbackFunction("OnGameStateChanged", OnGameStateChanged);
     g_eventSystem->SubscribeEventCallbackFunction("SaveConvexScene", SaveConvexSceneCommand);
     g_eventSystem->SubscribeEventCallbackFunction("LoadConvexScene", LoadConvexSceneCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("FindOverlapPairs", FindOverlapPairsCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("TuneAccelerators", TuneAcceleratorsCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("StartQueryServer", StartQueryServerCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("StopQueryServer", StopQueryServerCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("QueryLoadTest", QueryLoadTestCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("AsyncQueryTest", AsyncQueryTestCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("QueryBudget", QueryBudgetCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("BudgetedRays", BudgetedRaysCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("SpawnInstances", SpawnInstancesCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("TagDynamic", TagDynamicCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("SetQueryFilter", SetQueryFilterCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("TagCategory", TagCategoryCommand);
+    g_eventSystem->SubscribeEventCallbackFunction("SimulateMotion", SimulateMotionCommand);
 
     m_screenCamera = new Camera();
     m_worldCamera = new Camera();
@@ -70,15 +235,7 @@ Game::Game()
     ValidateTestBinary();
 
     // Spawn initial random convexes
-    for (int i = 0; i < INITIAL_CONVEX_COUNT; ++i)
-    {
-        Vec2 randomPos = Vec2(
-            g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_X),
-            g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_Y)
-        );
-        Convex2* convex = CreateRandomConvex(randomPos, MIN_CONVEX_RADIUS, MAX_CONVEX_RADIUS);
-        m_convexes.push_back(convex);
-    }
+    SpawnRandomConvexes(INITIAL_CONVEX_COUNT);
 
     // Initialize ray with random start/end points
     m_rayStart = Vec2(
@@ -101,6 +258,11 @@ Game::~Game()
 {
     DAEMON_LOG(LogGame, eLogVerbosity::Display, "(~Game)(start)");
 
+    // Its batches run on the task scheduler, which the App shuts down after the game
+    m_queryServer.Stop();
+    m_asyncQueries.Flush();
+    m_frameQueries.Flush();
+
     // Clean up convexes
     for (Convex2* convex : m_convexes)
     {
@@ -113,6 +275,19 @@ Game::~Game()
     g_eventSystem->UnsubscribeEventCallbackFunction("OnGameStateChanged", OnGameStateChanged);
     g_eventSystem->UnsubscribeEventCallbackFunction("SaveConvexScene", SaveConvexSceneCommand);
     g_eventSystem->UnsubscribeEventCallbackFunction("LoadConvexScene", LoadConvexSceneCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("FindOverlapPairs", FindOverlapPairsCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("TuneAccelerators", TuneAcceleratorsCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("StartQueryServer", StartQueryServerCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("StopQueryServer", StopQueryServerCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("QueryLoadTest", QueryLoadTestCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("AsyncQueryTest", AsyncQueryTestCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("QueryBudget", QueryBudgetCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("BudgetedRays", BudgetedRaysCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("SpawnInstances", SpawnInstancesCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("TagDynamic", TagDynamicCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("SetQueryFilter", SetQueryFilterCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("TagCategory", TagCategoryCommand);
+    g_eventSystem->UnsubscribeEventCallbackFunction("SimulateMotion", SimulateMotionCommand);
 
     DAEMON_LOG(LogGame, eLogVerbosity::Display, "(~Game)(end)");
 }
@@ -120,37 +295,166 @@ Game::~Game()
 //----------------------------------------------------------------------------------------------------
 void Game::Update()
 {
-    Vec2 const      screenTopLeft = m_screenCamera->GetOrthographicTopLeft();
-    float constexpr textHeight    = 15.f;
-    int             lineIndex     = 1;
+    int lineIndex = 1;
 
-    DebugAddScreenText(Stringf("Time: %.2f FPS: %.2f Scale: %.1f", m_gameClock->GetTotalSeconds(), 1.f / m_gameClock->GetDeltaSeconds(), m_gameClock->GetTimeScale()), screenTopLeft - Vec2(0.f, textHeight * static_cast<float>(lineIndex)), textHeight, Vec2(1, 1), 0.f);
-    ++lineIndex;
+    AddHudLine(lineIndex, Rgba8::WHITE, "Time: %.2f FPS: %.2f Scale: %.1f", m_gameClock->GetTotalSeconds(), 1.f / m_gameClock->GetDeltaSeconds(), m_gameClock->GetTimeScale());
+    AddHudLine(lineIndex, Rgba8::WHITE, "LMB/RMB=RayStart/End, W/R=Rotate, L/K=Scale, F1=Discs, F3=BVH, F4=AABB, F2=DrawMode, F8=Randomize, F9=Opt(%s)", SceneAccelerators::GetName(m_rayOptimizationMode));
 
-    char const* optModeNames[] = {"None", "Disc", "AABB"};
-    DebugAddScreenText(Stringf("LMB/RMB=RayStart/End, W/R=Rotate, L/K=Scale, F1=Discs, F3=BVH, F4=AABB, F2=DrawMode, F8=Randomize, F9=Opt(%s)", optModeNames[m_rayOptimizationMode]), screenTopLeft - Vec2(0.f, textHeight * static_cast<float>(lineIndex)), textHeight, Vec2(1, 1), 0.f);
-    ++lineIndex;
+    size_t convexBytes     = 0;
+    int    numFilterPassed = 0;
+    for (Convex2 const* convex : m_convexes)
+    {
+        convexBytes     += convex->GetMemoryBytes();
+        numFilterPassed += m_rayTestFilter.Accepts(convex->m_categoryMask) ? 1 : 0;
+    }
+    int avgConvexBytes = m_convexes.empty() ? 0 : static_cast<int>(convexBytes / m_convexes.size());
+    AddHudLine(lineIndex, Rgba8::WHITE, "%d convex shapes, %d B each (Y/U to double/halve); T=Test with %d random rays (M/N to double/halve)", static_cast<int>(m_convexes.size()), avgConvexBytes, m_numOfRandomRays);
+
+    if (!m_instancedScene.IsEmpty())
+    {
+        AddHudLine(lineIndex, Rgba8::WHITE, "%d instances of %d prototypes: %d KB with top-level BVH (%d KB as separate convexes); SpawnInstances to reroll", m_instancedScene.GetNumInstances(),
+                   m_instancedScene.GetNumPrototypes(), static_cast<int>(m_instancedScene.GetMemoryBytes() / 1024), static_cast<int>(m_instancedScene.GetFlattenedMemoryBytes() / 1024));
+    }
+
+    AddHudLine(lineIndex, Rgba8::WHITE, "Split tree: %d static (SAH), %d dynamic, %d static rebuilds; edits demote, TagDynamic fraction= to retag", m_partitionedTree.GetNumStatic(),
+               m_partitionedTree.GetNumDynamic(), m_partitionedTree.GetNumStaticRebuilds());
+
+    if (m_motionSimulation.IsRunning())
+    {
+        AddHudLine(lineIndex, Rgba8::WHITE, "Motion: %d of %d convexes moving, tick %d, update %.2fms, %d rays per tick; SimulateMotion fraction=0 to stop", m_motionSimulation.GetNumMovers(),
+                   static_cast<int>(m_convexes.size()), m_motionSimulation.GetNumTicks(), m_motionSimulation.GetAvgUpdateTimeMs(), m_motionSimulation.GetRaysPerTick());
+        for (int mode = 0; mode < SceneAccelerators::COUNT; ++mode)
+        {
+            char description[256];
+            m_motionSimulation.FormatStrategyDescription(static_cast<eQueryMode>(mode), description);
+            AddHudLine(lineIndex, Rgba8::WHITE, "  %s", description);
+        }
+    }
+
+    char includeNames[128];
+    char excludeNames[128];
+    FormatQueryCategoryNames(m_rayTestFilter.m_includeMask, includeNames);
+    FormatQueryCategoryNames(m_rayTestFilter.m_excludeMask, excludeNames);
+    AddHudLine(lineIndex, Rgba8::WHITE, "Query filter: include %s, exclude %s (%d of %d convexes pass); SetQueryFilter include= exclude=, TagCategory category= fraction=",
+               includeNames, excludeNames, numFilterPassed, static_cast<int>(m_convexes.size()));
+
+    sFrameArenaStats const arenaStats = FrameArena::GetStats();
+    AddHudLine(lineIndex, Rgba8::WHITE, "Frame arenas: %d KB last frame on %d of %d threads, high water %d KB, %d KB held, %llu heap blocks so far",
+               static_cast<int>(arenaStats.m_bytesLastFrame / 1024), arenaStats.m_numActiveArenas, arenaStats.m_numArenas, static_cast<int>(arenaStats.m_highWaterBytes / 1024),
+               static_cast<int>(arenaStats.m_capacityBytes / 1024), static_cast<unsigned long long>(arenaStats.m_numBlockAllocations));
+
+    if (m_acceleratorTuning.m_isValid)
+    {
+        AddHudLine(lineIndex, Rgba8::WHITE, "Tuned for %d objects: %s (BVH depth %d, QuadTree depth %d) %.2fms per %d rays", m_acceleratorTuning.m_numObjects,
+                   SceneAccelerators::GetName(static_cast<int>(m_acceleratorTuning.m_queryMode)),
+                   m_acceleratorTuning.GetBuildDepth(AABB2Tree::QUERY_MODE), m_acceleratorTuning.GetBuildDepth(SymmetricQuadTree::QUERY_MODE),
+                   m_acceleratorTuning.m_bestTimeMs, m_acceleratorTuning.m_numRays);
+    }
 
-    DebugAddScreenText(Stringf("%d convex shapes (Y/U to double/halve); T=Test with %d random rays (M/N to double/halve)", static_cast<int>(m_convexes.size()), m_numOfRandomRays), screenTopLeft - Vec2(0.f, textHeight * static_cast<float>(lineIndex)), textHeight, Vec2(1, 1), 0.f);
-    ++lineIndex;
+    if (m_queryServer.IsShutdownRequested())
+    {
+        m_queryServer.Stop();
+        g_devConsole->AddLine(DevConsole::INFO_MAJOR, "Query server stopped by a client");
+    }
+
+    FrameQueryStats const queryStats = m_frameQueries.GetStats();
+    if (queryStats.m_numExecuted > 0)
+    {
+        AddHudLine(lineIndex, Rgba8::WHITE, "Query budget %.1fms: used %.2fms for %d queries in %d chunks, queued C/H/N/L %d/%d/%d/%d, latency %.2fms (%.1f frames), ray %.2fus",
+                   m_frameQueries.GetConfig().m_budgetMs, queryStats.m_usedMsLastFrame, queryStats.m_numExecutedLastFrame, queryStats.m_numChunksLastFrame,
+                   queryStats.m_queueDepths[0], queryStats.m_queueDepths[1], queryStats.m_queueDepths[2], queryStats.m_queueDepths[3],
+                   queryStats.m_avgLatencyMs, queryStats.m_avgLatencyFrames, queryStats.m_costEstimatesUs[static_cast<int>(eFrameQueryKind::RAYCAST_CLOSEST)]);
+    }
+
+    if (m_queryServer.IsRunning())
+    {
+        char serverDescription[512];
+        m_queryServer.FormatDescription(serverDescription);
+        AddHudLine(lineIndex, Rgba8::WHITE, "%s", serverDescription);
+    }
 
     if (m_avgDist != 0.f)
     {
-        DebugAddScreenText(Stringf("%d Rays Vs. %d objects: avg dist %.3f", m_numOfRandomRays, static_cast<int>(m_convexes.size()), m_avgDist), screenTopLeft - Vec2(0.f, textHeight * static_cast<float>(lineIndex)), textHeight, Vec2(1, 1), 0.f, Rgba8::YELLOW, Rgba8::YELLOW);
-        ++lineIndex;
+        AddHudLine(lineIndex, Rgba8::YELLOW, "%d Rays Vs. %d objects: avg dist %.3f", m_numOfRandomRays, static_cast<int>(m_convexes.size()), m_avgDist);
+
+        char acceleratorTimes[512];
+        int  length = 0;
+        acceleratorTimes[0] = '\0';
+        SceneAccelerators::ForEach([&]<typename Accelerator>()
+        {
+            size_t memoryBytes = GetSceneAccelerator<Accelerator>(GetSceneQueryView()).GetMemoryBytes();
+            float  timeMs      = m_lastRayTestTimes[static_cast<int>(Accelerator::QUERY_MODE)];
+            int    capacity    = static_cast<int>(sizeof(acceleratorTimes)) - length;
+            length += (memoryBytes > 0) ? std::snprintf(acceleratorTimes + length, capacity, "%s: %.2fms (%d KB)  ", Accelerator::GetName(), timeMs, static_cast<int>(memoryBytes / 1024))
+                                        : std::snprintf(acceleratorTimes + length, capacity, "%s: %.2fms  ", Accelerator::GetName(), timeMs);
+            length  = std::min(length, static_cast<int>(sizeof(acceleratorTimes)) - 1);
+        });
+        AddHudLine(lineIndex, Rgba8::YELLOW, "%s", acceleratorTimes);
+
+        AddHudLine(lineIndex, Rgba8::YELLOW, "Parallel BVH: %.2fms on %d threads", m_lastRayTestParallelTime, GetNumTaskThreads());
+
+        if (!m_instancedScene.IsEmpty())
+        {
+            AddHudLine(lineIndex, Rgba8::YELLOW, "Instanced layer (%d instances): %.2fms", m_instancedScene.GetNumInstances(), m_lastRayTestInstancedTime);
+        }
+
+        AddHudLine(lineIndex, Rgba8::YELLOW, "SDF bake: %.2fms  Sphere trace: %.2fms (%.1f%% agree)", m_lastDistanceFieldBakeTime, m_lastRayTestSphereTraceTime, m_lastSphereTraceAgreement);
+
+        RayQueryCacheStats const& cacheStats = m_rayQueryCache.GetStats();
+        AddHudLine(lineIndex, Rgba8::YELLOW, "Ray cache: cold %.2fms  warm %.2fms  hit rate %.1f%%  (%d entries, %d invalidated)", m_lastRayTestCacheColdTime, m_lastRayTestCacheWarmTime,
+                   100.f * cacheStats.GetHitRate(), m_rayQueryCache.GetNumEntries(), static_cast<int>(cacheStats.m_numInvalidations));
 
-        DebugAddScreenText(Stringf("No Opt: %.2fms  Disc: %.2fms  AABB: %.2fms", m_lastRayTestNormalTime, m_lastRayTestDiscRejectionTime, m_lastRayTestAABBRejectionTime), screenTopLeft - Vec2(0.f, textHeight * static_cast<float>(lineIndex)), textHeight, Vec2(1, 1), 0.f, Rgba8::YELLOW, Rgba8::YELLOW);
-        ++lineIndex;
+        AddHudLine(lineIndex, Rgba8::YELLOW, "Hinted BVH: no hints %.2fms  last hit as hint %.2fms", m_lastRayTestHintColdTime, m_lastRayTestHintWarmTime);
 
-        DebugAddScreenText(Stringf("QuadTree: %.2fms  BVH: %.2fms", m_lastRayTestSymmetricTreeTime, m_lastRayTestAABBTreeTime), screenTopLeft - Vec2(0.f, textHeight * static_cast<float>(lineIndex)), textHeight, Vec2(1, 1), 0.f, Rgba8::YELLOW, Rgba8::YELLOW);
-        ++lineIndex;
+        AddHudLine(lineIndex, Rgba8::YELLOW, "Occupancy grid: raster %.2fms (%d KB)  LOS walk: %.2fms", m_lastOccupancyRasterTime, static_cast<int>(m_occupancyGrid.GetMemoryBytes() / 1024),
+                   m_lastRayTestOccupancyTime);
+
+        AddHudLine(lineIndex, Rgba8::YELLOW, "Fan of %d: BVH per ray: %.2fms  Angular: %.2fms", m_numOfRandomRays, m_lastFanTestBVHTime, m_lastFanTestAngularTime);
     }
 
     UpdateGame();
+
+    // Everything submitted this frame is answered before the next edit or scene load can touch the scene
+    m_asyncQueries.SetScene(GetSceneQueryView(), static_cast<eQueryMode>(m_rayOptimizationMode));
+    m_asyncQueries.Flush();
+
+    // Then as much deferrable work as fits in the frame's query budget
+    m_frameQueries.SetScene(GetSceneQueryView(), static_cast<eQueryMode>(m_rayOptimizationMode));
+    m_frameQueries.RunFrame();
+    UpdateBudgetedRays();
+    ++m_frameCount;
+
     UpdateTime();
     UpdateWindow();
 }
 
+//----------------------------------------------------------------------------------------------------
+// AddHudLine - printf-style screen text at the next HUD line. The text is formatted on the stack and
+// copied into a line string kept from frame to frame, so once each line's capacity has grown the HUD
+// stops allocating on our side; DebugAddScreenText's own storage is up to the debug render system.
+//----------------------------------------------------------------------------------------------------
+void Game::AddHudLine(int& inout_lineIndex, Rgba8 const& color, char const* format, ...)
+{
+    char    text[512];
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    length = std::clamp(length, 0, static_cast<int>(sizeof(text)) - 1);
+
+    if (static_cast<int>(m_hudLines.size()) <= inout_lineIndex)
+    {
+        m_hudLines.resize(static_cast<size_t>(inout_lineIndex) + 1);
+    }
+    String& line = m_hudLines[inout_lineIndex];
+    line.assign(text, static_cast<size_t>(length));
+
+    Vec2 const      screenTopLeft = m_screenCamera->GetOrthographicTopLeft();
+    float constexpr textHeight    = 15.f;
+    DebugAddScreenText(line, screenTopLeft - Vec2(0.f, textHeight * static_cast<float>(inout_lineIndex)), textHeight, Vec2(1, 1), 0.f, color, color);
+    ++inout_lineIndex;
+}
+
 //----------------------------------------------------------------------------------------------------
 void Game::Render() const
 {
@@ -229,6 +533,14 @@ bool Game::IsGameState() const
     return m_gameState == eGameState::GAME;
 }
 
+//----------------------------------------------------------------------------------------------------
+// IsQueryServerRunning - Its batcher thread submits to g_taskScheduler whenever a request arrives
+//----------------------------------------------------------------------------------------------------
+bool Game::IsQueryServerRunning() const
+{
+    return m_queryServer.IsRunning();
+}
+
 //----------------------------------------------------------------------------------------------------
 /// @brief Event call back handler when changing game state.
 /// @param args Event arguments.
@@ -277,6 +589,287 @@ STATIC bool Game::LoadConvexSceneCommand(EventArgs& args)
     return true;
 }
 
+//----------------------------------------------------------------------------------------------------
+// FindOverlapPairsCommand - Reports every intersecting convex pair (e.g. overlapping blockers)
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::FindOverlapPairsCommand(EventArgs& args)
+{
+    int numThreads = args.GetValue("threads", 0);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> FindOverlapPairs threads=%d", numThreads));
+
+    double startTime = GetCurrentTimeSeconds();
+    g_game->m_overlapPairFinder.FindAllPairs(g_game->m_convexes, g_game->m_overlapPairs, numThreads);
+    g_game->m_trackOverlapPairs = true;
+    double endTime   = GetCurrentTimeSeconds();
+
+    g_devConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Found %d overlapping pairs among %d convexes in %.3f ms (sweep axis %s)",
+                          static_cast<int>(g_game->m_overlapPairs.size()), static_cast<int>(g_game->m_convexes.size()),
+                          (endTime - startTime) * 1000.0, g_game->m_overlapPairFinder.GetSweepAxis() == eSweepAxis::X ? "X" : "Y"));
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// TuneAcceleratorsCommand - Times every accelerator and tree depth on the current scene and keeps the
+// fastest within the memory budget
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::TuneAcceleratorsCommand(EventArgs& args)
+{
+    AcceleratorTunerConfig config;
+    int budgetKB = args.GetValue("budgetKB", static_cast<int>(config.m_memoryBudgetBytes / 1024));
+    config.m_memoryBudgetBytes = static_cast<size_t>(std::max(budgetKB, 0)) * 1024;
+    config.m_numTimedPasses    = args.GetValue("passes", config.m_numTimedPasses);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> TuneAccelerators budgetKB=%d passes=%d", budgetKB, config.m_numTimedPasses));
+
+    g_game->TuneAccelerators(config);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// StartQueryServerCommand - Serves Data/Scenes/<name>.ghcs to local processes, reloading it when it is
+// saved again
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::StartQueryServerCommand(EventArgs& args)
+{
+    QueryServerConfig config;
+    String name = args.GetValue("name", "default");
+    config.m_scenePath                 = "Data/Scenes/" + name + ".ghcs";
+    config.m_endpoint.m_port           = static_cast<uint16_t>(args.GetValue("port", static_cast<int>(config.m_endpoint.m_port)));
+    config.m_endpoint.m_unixSocketPath = args.GetValue("socket", "");
+    config.m_batchWindowMs             = args.GetValue("windowMs", config.m_batchWindowMs);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> StartQueryServer name=%s %s", name.c_str(), config.m_endpoint.GetDescription().c_str()));
+
+    g_game->m_queryServer.Stop();
+    String error;
+    if (!g_game->m_queryServer.Start(config, error))
+    {
+        g_devConsole->AddLine(DevConsole::ERROR, Stringf("Query server failed to start: %s", error.c_str()));
+        return true;
+    }
+    g_devConsole->AddLine(DevConsole::INFO_MAJOR, g_game->m_queryServer.GetDescription());
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::StopQueryServerCommand(EventArgs& args)
+{
+    UNUSED(args)
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, "> StopQueryServer");
+    g_game->m_queryServer.Stop();
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// QueryLoadTestCommand - Drives a query server (this one or another process) and reports throughput
+// and latency. Blocks the frame until it finishes.
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::QueryLoadTestCommand(EventArgs& args)
+{
+    QueryLoadTestConfig config;
+    String type = args.GetValue("type", "closest");
+    config.m_endpoint.m_port           = static_cast<uint16_t>(args.GetValue("port", static_cast<int>(config.m_endpoint.m_port)));
+    config.m_endpoint.m_unixSocketPath = args.GetValue("socket", "");
+    config.m_numClients                = args.GetValue("clients", config.m_numClients);
+    config.m_requestsPerClient         = args.GetValue("requests", config.m_requestsPerClient);
+    config.m_recordsPerRequest         = args.GetValue("records", config.m_recordsPerRequest);
+    config.m_maxInFlight               = args.GetValue("inflight", config.m_maxInFlight);
+    config.m_requestType               = (type == "any") ? eQueryRequestType::RAYCAST_ANY : (type == "region") ? eQueryRequestType::REGION_AABB : eQueryRequestType::RAYCAST_CLOSEST;
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> QueryLoadTest type=%s clients=%d requests=%d records=%d inflight=%d %s", type.c_str(), config.m_numClients,
+                          config.m_requestsPerClient, config.m_recordsPerRequest, config.m_maxInFlight, config.m_endpoint.GetDescription().c_str()));
+
+    QueryLoadTestReport report = RunQueryLoadTest(config);
+    g_devConsole->AddLine(report.m_isValid ? DevConsole::INFO_MAJOR : DevConsole::ERROR, report.GetDescription());
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// AsyncQueryTestCommand - Compares one-query-per-call raycasts with the same calls through the batched
+// future API, then runs coroutine scripts that await a ray and a region query each
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::AsyncQueryTestCommand(EventArgs& args)
+{
+    AsyncQueryConfig config;
+    int numRays    = args.GetValue("rays", g_game->m_numOfRandomRays);
+    int numScripts = args.GetValue("scripts", 256);
+    config.m_batchWindowMs   = args.GetValue("windowMs", config.m_batchWindowMs);
+    config.m_maxLatencyMs    = args.GetValue("maxLatencyMs", config.m_maxLatencyMs);
+    config.m_maxBatchQueries = args.GetValue("maxBatch", config.m_maxBatchQueries);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> AsyncQueryTest rays=%d scripts=%d windowMs=%.2f maxLatencyMs=%.2f maxBatch=%d", numRays, numScripts,
+                          config.m_batchWindowMs, config.m_maxLatencyMs, config.m_maxBatchQueries));
+
+    g_game->RunAsyncQueryTest(std::max(numRays, 1), std::max(numScripts, 0), config);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// QueryBudgetCommand - Milliseconds per frame the query scheduler may spend on deferrable work
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::QueryBudgetCommand(EventArgs& args)
+{
+    FrameQuerySchedulerConfig config = g_game->m_frameQueries.GetConfig();
+    config.m_budgetMs       = args.GetValue("ms", config.m_budgetMs);
+    config.m_maxDeferFrames = args.GetValue("maxDefer", config.m_maxDeferFrames);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> QueryBudget ms=%.2f maxDefer=%d", config.m_budgetMs, config.m_maxDeferFrames));
+    g_game->m_frameQueries.SetConfig(config);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// BudgetedRaysCommand - Queues random closest-hit rays on the frame scheduler instead of running them
+// all at once the way TestRays does
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::BudgetedRaysCommand(EventArgs& args)
+{
+    int    numRays  = args.GetValue("rays", g_game->m_numOfRandomRays);
+    String priority = args.GetValue("priority", "low");
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> BudgetedRays rays=%d priority=%s", numRays, priority.c_str()));
+
+    eQueryPriority queryPriority = eQueryPriority::LOW;
+    if (priority == "critical")    queryPriority = eQueryPriority::CRITICAL;
+    else if (priority == "high")   queryPriority = eQueryPriority::HIGH;
+    else if (priority == "normal") queryPriority = eQueryPriority::NORMAL;
+
+    Game* game = g_game;
+    if (game->m_budgetedRayFutures.empty())
+    {
+        game->m_budgetedRayStartTime  = GetCurrentTimeSeconds();
+        game->m_budgetedRayStartFrame = game->m_frameCount;
+    }
+    game->m_budgetedRayFutures.reserve(game->m_budgetedRayFutures.size() + static_cast<size_t>(std::max(numRays, 0)));
+    for (int j = 0; j < numRays; ++j)
+    {
+        Vec2  startPos;
+        Vec2  forwardNormal;
+        float maxDist;
+        RollRandomWorldRay(startPos, forwardNormal, maxDist);
+        game->m_budgetedRayFutures.push_back(game->m_frameQueries.SubmitRaycast(startPos, forwardNormal, maxDist, queryPriority));
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// SpawnInstancesCommand - Replaces the instanced layer with random placements of a few random shapes
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::SpawnInstancesCommand(EventArgs& args)
+{
+    int numPrototypes = args.GetValue("prototypes", 8);
+    int numInstances  = args.GetValue("instances", 1024);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> SpawnInstances prototypes=%d instances=%d", numPrototypes, numInstances));
+
+    g_game->SpawnRandomInstances(std::clamp(numPrototypes, 1, 65535), std::max(numInstances, 0));
+    g_game->m_sceneModified = true;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// TagDynamicCommand - Retags a random fraction of the convexes dynamic and promotes the rest; the
+// partitioned tree decides for itself whether the promotions are worth a static rebuild yet
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::TagDynamicCommand(EventArgs& args)
+{
+    float fraction = std::clamp(args.GetValue("fraction", 0.01f), 0.f, 1.f);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> TagDynamic fraction=%.3f", fraction));
+
+    Game* game = g_game;
+    for (Convex2* convex : game->m_convexes)
+    {
+        if (g_rng->RollRandomFloatZeroToOne() < fraction)
+        {
+            game->m_partitionedTree.Demote(*convex);
+        }
+        else
+        {
+            game->m_partitionedTree.Promote(*convex);
+        }
+    }
+    game->m_partitionedTree.Refit();
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("%d static, %d dynamic", game->m_partitionedTree.GetNumStatic(), game->m_partitionedTree.GetNumDynamic()));
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// SetQueryFilterCommand - Category include/exclude masks for TestRays and the interactive ray;
+// no arguments resets to everything
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::SetQueryFilterCommand(EventArgs& args)
+{
+    String include = args.GetValue("include", "all");
+    String exclude = args.GetValue("exclude", "");
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> SetQueryFilter include=%s exclude=%s", include.c_str(), exclude.c_str()));
+
+    QueryFilter filter;
+    if (!ParseQueryCategoryMask(include, filter.m_includeMask) || !ParseQueryCategoryMask(exclude, filter.m_excludeMask))
+    {
+        g_devConsole->AddLine(DevConsole::ERROR, "Error: Categories are default, wall, glass, foliage, trigger, all or a number");
+        return false;
+    }
+    g_game->m_rayTestFilter = filter;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// TagCategoryCommand - Gives a random fraction of the convexes the category mask; fraction=1 tags all
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::TagCategoryCommand(EventArgs& args)
+{
+    String category = args.GetValue("category", "default");
+    float  fraction = std::clamp(args.GetValue("fraction", 0.1f), 0.f, 1.f);
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> TagCategory category=%s fraction=%.3f", category.c_str(), fraction));
+
+    uint16_t mask = 0;
+    if (!ParseQueryCategoryMask(category, mask))
+    {
+        g_devConsole->AddLine(DevConsole::ERROR, "Error: Categories are default, wall, glass, foliage, trigger, all or a number");
+        return false;
+    }
+
+    Game* game      = g_game;
+    int   numTagged = 0;
+    for (Convex2* convex : game->m_convexes)
+    {
+        if (g_rng->RollRandomFloatZeroToOne() < fraction)
+        {
+            convex->m_categoryMask = mask;
+            ++numTagged;
+        }
+    }
+    game->OnCategoriesChanged();
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("%d convexes tagged %s", numTagged, GetQueryCategoryNames(mask).c_str()));
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// SimulateMotionCommand - Sets a random fraction of the convexes moving; fraction=0 stops. A run
+// with ticks= stops by itself and prints its per-tick averages to the console.
+//----------------------------------------------------------------------------------------------------
+STATIC bool Game::SimulateMotionCommand(EventArgs& args)
+{
+    MotionSimulationConfig config;
+    config.m_dynamicFraction = std::clamp(args.GetValue("fraction", config.m_dynamicFraction), 0.f, 1.f);
+    config.m_maxSpeed        = std::max(args.GetValue("speed", config.m_maxSpeed), 0.f);
+    config.m_maxSpinDegrees  = std::max(args.GetValue("spin", config.m_maxSpinDegrees), 0.f);
+    config.m_raysPerTick     = std::max(args.GetValue("rays", config.m_raysPerTick), 0);
+    config.m_numTicks        = std::max(args.GetValue("ticks", config.m_numTicks), 0);
+    config.m_seed            = g_game->m_seed;
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("> SimulateMotion fraction=%.3f speed=%.1f spin=%.1f rays=%d ticks=%d", config.m_dynamicFraction,
+                                                          config.m_maxSpeed, config.m_maxSpinDegrees, config.m_raysPerTick, config.m_numTicks));
+
+    Game* game = g_game;
+    if (config.m_dynamicFraction <= 0.f)
+    {
+        game->m_motionSimulation.Stop();
+        return true;
+    }
+
+    // Ids first, the simulation's split tree indexes by them; then rebuild so the scene's own split
+    // tree also starts with the movers in its dynamic tree
+    game->AssignConvexObjectIds();
+    game->m_motionSimulation.Start(game->m_convexes, AABB2(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y)), config);
+    game->RebuildAllTrees();
+    game->InvalidateSceneCaches();
+    g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("%d of %d convexes moving", game->m_motionSimulation.GetNumMovers(), static_cast<int>(game->m_convexes.size())));
+    return true;
+}
+
 //----------------------------------------------------------------------------------------------------
 void Game::UpdateGame()
 {
@@ -297,19 +890,21 @@ void Game::UpdateGame()
         Vec2 cursorUV = g_window->GetNormalizedMouseUV();
         Vec2 cursorPos = m_worldCamera->GetCursorWorldPosition(cursorUV);
         float deltaSeconds = (float)m_gameClock->GetDeltaSeconds();
+        bool  hoveringConvexEdited = false;
+        AABB2 editedBoundsBefore   = m_hoveringConvex ? m_hoveringConvex->m_boundingAABB : AABB2();
 
         // Handle object scaling
         if (m_hoveringConvex && g_input->IsKeyDown('L'))
         {
             m_hoveringConvex->Scale(1.f * deltaSeconds, cursorPos);
             m_sceneModified = true;
-            RebuildAllTrees();
+            hoveringConvexEdited = true;
         }
         if (m_hoveringConvex && g_input->IsKeyDown('K'))
         {
             m_hoveringConvex->Scale(-1.f * deltaSeconds, cursorPos);
             m_sceneModified = true;
-            RebuildAllTrees();
+            hoveringConvexEdited = true;
         }
 
         // Handle object rotation
@@ -317,13 +912,13 @@ void Game::UpdateGame()
         {
             m_hoveringConvex->Rotate(90.f * deltaSeconds, cursorPos);
             m_sceneModified = true;
-            RebuildAllTrees();
+            hoveringConvexEdited = true;
         }
         if (m_hoveringConvex && g_input->IsKeyDown('R'))
         {
             m_hoveringConvex->Rotate(-90.f * deltaSeconds, cursorPos);
             m_sceneModified = true;
-            RebuildAllTrees();
+            hoveringConvexEdited = true;
         }
 
         // Handle object dragging
@@ -337,8 +932,8 @@ void Game::UpdateGame()
             Vec2 delta = cursorPos - m_cursorPrevPos;
             m_hoveringConvex->Translate(delta);
             m_sceneModified = true;
+            hoveringConvexEdited = true;
             m_cursorPrevPos = cursorPos;
-            RebuildAllTrees();
         }
 
         if (g_input->WasKeyJustReleased(KEYCODE_LEFT_MOUSE))
@@ -346,6 +941,16 @@ void Game::UpdateGame()
             m_isDragging = false;
         }
 
+        UpdateMotionSimulation(deltaSeconds);
+
+        if (hoveringConvexEdited)
+        {
+            // Anything the user moves is likely to move again; keep it out of the static tree
+            m_partitionedTree.Demote(*m_hoveringConvex);
+            RefitAllTrees();
+            OnHoveringConvexEdited(editedBoundsBefore);
+        }
+
         // Update hover detection (skipped during drag for sticky focus)
         UpdateHoverDetection();
 
@@ -375,20 +980,18 @@ void Game::UpdateGame()
                 m_worldCamera->SetOrthoGraphicView(Vec2::ZERO, Vec2(WORLD_SIZE_X, WORLD_SIZE_Y));
             }
             // Re-randomize all shapes, keeping current count
-            int numShapes = static_cast<int>(m_convexes.size());
+            int numShapes     = static_cast<int>(m_convexes.size());
+            int numPrototypes = m_instancedScene.GetNumPrototypes();
+            int numInstances  = m_instancedScene.GetNumInstances();
             ClearScene();
             m_sceneModified = true;
             m_seed += 1;
-            for (int i = 0; i < numShapes; ++i)
+            SpawnRandomConvexes(numShapes);
+            RebuildAllTrees();
+            if (numInstances > 0)
             {
-                Vec2 randomPos = Vec2(
-                    g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_X),
-                    g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_Y)
-                );
-                Convex2* convex = CreateRandomConvex(randomPos, MIN_CONVEX_RADIUS, MAX_CONVEX_RADIUS);
-                m_convexes.push_back(convex);
+                SpawnRandomInstances(numPrototypes, numInstances);
             }
-            RebuildAllTrees();
         }
         else if (g_input->WasKeyJustPressed(KEYCODE_F1))
         {
@@ -408,7 +1011,7 @@ void Game::UpdateGame()
         }
         else if (g_input->WasKeyJustPressed(KEYCODE_F9))
         {
-            m_rayOptimizationMode = (m_rayOptimizationMode + 1) % 3;
+            m_rayOptimizationMode = (m_rayOptimizationMode + 1) % SceneAccelerators::COUNT;
         }
         else if (g_input->WasKeyJustPressed('C'))
         {
@@ -418,6 +1021,8 @@ void Game::UpdateGame()
             Convex2* convex = CreateRandomConvex(worldPos, MIN_CONVEX_RADIUS, MAX_CONVEX_RADIUS);
             m_convexes.push_back(convex);
             m_sceneModified = true;
+            InvalidateSceneCaches();
+            RebuildAllTrees();
         }
         else if (g_input->WasKeyJustPressed('Y'))
         {
@@ -429,16 +1034,9 @@ void Game::UpdateGame()
             }
             if (static_cast<int>(m_convexes.size()) < 2048)
             {
-                for (int i = 0; i < numOfShapesToAdd && static_cast<int>(m_convexes.size()) < 2048; ++i)
-                {
-                    Vec2 randomPos = Vec2(
-                        g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_X),
-                        g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_Y)
-                    );
-                    Convex2* convex = CreateRandomConvex(randomPos, MIN_CONVEX_RADIUS, MAX_CONVEX_RADIUS);
-                    m_convexes.push_back(convex);
-                }
+                SpawnRandomConvexes(std::min(numOfShapesToAdd, 2048 - static_cast<int>(m_convexes.size())));
                 m_sceneModified = true;
+                InvalidateSceneCaches();
                 RebuildAllTrees();
             }
         }
@@ -450,6 +1048,7 @@ void Game::UpdateGame()
             {
                 numOfShapesToRemove = 1;
             }
+            m_motionSimulation.Stop();
             for (int i = 0; i < numOfShapesToRemove; ++i)
             {
                 if (m_convexes.back() == m_hoveringConvex)
@@ -460,6 +1059,7 @@ void Game::UpdateGame()
                 m_convexes.pop_back();
             }
             m_sceneModified = true;
+            InvalidateSceneCaches();
             RebuildAllTrees();
         }
         else if (g_input->WasKeyJustPressed('M'))
@@ -532,7 +1132,8 @@ void Game::RenderAttract() const
 {
     Vec2 const clientDimensions = Window::s_mainWindow->GetClientDimensions();
 
-    VertexList_PCU verts;
+    VertexList_PCU& verts = m_renderVerts;
+    verts.clear();
 
     AddVertsForDisc2D(verts, Vec2(clientDimensions.x * 0.5f, clientDimensions.y * 0.5f), 300.f, 10.f, Rgba8::YELLOW);
 
@@ -547,65 +1148,122 @@ void Game::RenderAttract() const
 }
 
 //----------------------------------------------------------------------------------------------------
-///
-/// @brief Render convex polygons in GAME state.
-//
-void Game::RenderGame() const
+// AddVertsForConvexesInParallel - Each task fills its own list for a contiguous run of convexes; the
+// lists are appended in order afterwards, so draw order matches a serial pass exactly. The chunk
+// lists are the caller's and keep their capacity from frame to frame.
+//----------------------------------------------------------------------------------------------------
+template <typename AddVertsForConvex>
+static void AddVertsForConvexesInParallel(VertexList_PCU& verts, std::vector<VertexList_PCU>& chunkVerts, std::vector<Convex2*> const& convexes, AddVertsForConvex const& addVertsForConvex)
 {
-    VertexList_PCU verts;
-
-    if (m_drawEdgesMode)
+    int numConvexes = static_cast<int>(convexes.size());
+    int numChunks   = std::clamp(numConvexes / VERTEX_CHUNK_MIN_CONVEXES, 1, GetNumTaskThreads() * 4);
+    if (numChunks == 1)
     {
-        // Mode B (F2 on): Thick edges first, then opaque fill (composite concave appearance)
-        // Pass 1: All non-hovered edges
-        for (Convex2 const* convex : m_convexes)
+        for (Convex2 const* convex : convexes)
         {
-            if (convex == m_hoveringConvex) continue;
-            AddVertsForConvexPolyEdges(verts, convex->m_convexPoly, 0.8f, Rgba8(0, 0, 153));
+            addVertsForConvex(verts, convex);
         }
-        // Pass 2: All non-hovered fills (drawn on top of edges)
-        for (Convex2 const* convex : m_convexes)
-        {
-            if (convex == m_hoveringConvex) continue;
-            AddVertsForConvexPoly2D(verts, convex->m_convexPoly, Rgba8(153, 204, 255));
+        return;
+    }
+
+    if (static_cast<int>(chunkVerts.size()) < numChunks)
+    {
+        chunkVerts.resize(numChunks);
+    }
+    ParallelFor(0, numChunks, 1, [&](int firstChunk, int lastChunk)
+    {
+        for (int chunk = firstChunk; chunk < lastChunk; ++chunk)
+        {
+            chunkVerts[chunk].clear();
+            int first = static_cast<int>(static_cast<int64_t>(numConvexes) * chunk / numChunks);
+            int last  = static_cast<int>(static_cast<int64_t>(numConvexes) * (chunk + 1) / numChunks);
+            for (int i = first; i < last; ++i)
+            {
+                addVertsForConvex(chunkVerts[chunk], convexes[i]);
+            }
         }
+    });
+
+    size_t totalVerts = verts.size();
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+    {
+        totalVerts += chunkVerts[chunk].size();
+    }
+    verts.reserve(totalVerts);
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+    {
+        verts.insert(verts.end(), chunkVerts[chunk].begin(), chunkVerts[chunk].end());
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+///
+/// @brief Render convex polygons in GAME state.
+//
+void Game::RenderGame() const
+{
+    // The Engine's AddVertsFor* helpers take a std::vector, so the list is a member that keeps its capacity
+    VertexList_PCU& verts = m_renderVerts;
+    verts.clear();
+
+    if (m_drawEdgesMode)
+    {
+        // Mode B (F2 on): Thick edges first, then opaque fill (composite concave appearance)
+        // Pass 1: All non-hovered edges
+        AddVertsForConvexesInParallel(verts, m_renderChunkVerts, m_convexes, [this](VertexList_PCU& out_verts, Convex2 const* convex)
+        {
+            if (convex == m_hoveringConvex) return;
+            AddVertsForConvexEdges(out_verts, *convex, 0.8f, Rgba8(0, 0, 153));
+        });
+        // Pass 2: All non-hovered fills (drawn on top of edges)
+        AddVertsForConvexesInParallel(verts, m_renderChunkVerts, m_convexes, [this](VertexList_PCU& out_verts, Convex2 const* convex)
+        {
+            if (convex == m_hoveringConvex) return;
+            AddVertsForConvexFill(out_verts, *convex, Rgba8(153, 204, 255));
+        });
         // Pass 3: Hovered convex on top
         if (m_hoveringConvex)
         {
-            AddVertsForConvexPoly2D(verts, m_hoveringConvex->m_convexPoly, Rgba8(255, 255, 153));
-            AddVertsForConvexPolyEdges(verts, m_hoveringConvex->m_convexPoly, 0.8f, Rgba8(255, 153, 0));
+            AddVertsForConvexFill(verts, *m_hoveringConvex, Rgba8(255, 255, 153));
+            AddVertsForConvexEdges(verts, *m_hoveringConvex, 0.8f, Rgba8(255, 153, 0));
         }
     }
     else
     {
         // Mode A (F2 off): Translucent fill first, then opaque edges
         // Pass 1: All non-hovered fills
-        for (Convex2 const* convex : m_convexes)
+        AddVertsForConvexesInParallel(verts, m_renderChunkVerts, m_convexes, [this](VertexList_PCU& out_verts, Convex2 const* convex)
         {
-            if (convex == m_hoveringConvex) continue;
-            AddVertsForConvexPoly2D(verts, convex->m_convexPoly, Rgba8(204, 229, 255, 128));
-        }
+            if (convex == m_hoveringConvex) return;
+            AddVertsForConvexFill(out_verts, *convex, Rgba8(204, 229, 255, 128));
+        });
         // Pass 2: All non-hovered edges
-        for (Convex2 const* convex : m_convexes)
+        AddVertsForConvexesInParallel(verts, m_renderChunkVerts, m_convexes, [this](VertexList_PCU& out_verts, Convex2 const* convex)
         {
-            if (convex == m_hoveringConvex) continue;
-            AddVertsForConvexPolyEdges(verts, convex->m_convexPoly, 0.5f, Rgba8(0, 0, 153));
-        }
+            if (convex == m_hoveringConvex) return;
+            AddVertsForConvexEdges(out_verts, *convex, 0.5f, Rgba8(0, 0, 153));
+        });
         // Pass 3: Hovered convex on top
         if (m_hoveringConvex)
         {
-            AddVertsForConvexPoly2D(verts, m_hoveringConvex->m_convexPoly, Rgba8(255, 255, 153, 128));
-            AddVertsForConvexPolyEdges(verts, m_hoveringConvex->m_convexPoly, 0.5f, Rgba8(255, 153, 0));
+            AddVertsForConvexFill(verts, *m_hoveringConvex, Rgba8(255, 255, 153, 128));
+            AddVertsForConvexEdges(verts, *m_hoveringConvex, 0.5f, Rgba8(255, 153, 0));
         }
     }
 
+    // Instanced layer, drawn under the hovered convex's highlight but over the rest
+    if (!m_instancedScene.IsEmpty())
+    {
+        AddVertsForInstances(verts, m_drawEdgesMode ? 0.8f : 0.5f, Rgba8(204, 255, 204, 128), Rgba8(0, 102, 0));
+    }
+
     // Debug visualization: bounding discs (F1)
     if (m_showBoundingDiscs)
     {
-        for (Convex2 const* convex : m_convexes)
+        AddVertsForConvexesInParallel(verts, m_renderChunkVerts, m_convexes, [](VertexList_PCU& out_verts, Convex2 const* convex)
         {
-            AddVertsForDisc2D(verts, convex->m_boundingDiscCenter, convex->m_boundingRadius, 0.3f, Rgba8(0, 255, 0, 128));
-        }
+            AddVertsForDisc2D(out_verts, convex->m_boundingDiscCenter, convex->m_boundingRadius, 0.3f, Rgba8(0, 255, 0, 128));
+        });
     }
 
     // Debug visualization: per-object bounding volumes (F4)
@@ -663,9 +1321,35 @@ void Game::RenderGame() const
 }
 
 //----------------------------------------------------------------------------------------------------
-void Game::AddVertsForConvexPolyEdges(std::vector<Vertex_PCU>& verts, ConvexPoly2 const& convexPoly2, float thickness, Rgba8 const& color) const
+void Game::AddVertsForConvexFill(std::vector<Vertex_PCU>& verts, Convex2 const& convex, Rgba8 const& color) const
+{
+    AddVertsForConvexFill(verts, convex.GetVertices(), color);
+}
+
+//----------------------------------------------------------------------------------------------------
+// AddVertsForConvexFill - Triangle fan from the first vertex; CCW vertices keep CCW triangles
+//----------------------------------------------------------------------------------------------------
+void Game::AddVertsForConvexFill(std::vector<Vertex_PCU>& verts, std::span<Vec2 const> points, Rgba8 const& color) const
+{
+    int numPoints = static_cast<int>(points.size());
+
+    for (int i = 1; i + 1 < numPoints; ++i)
+    {
+        verts.push_back(Vertex_PCU(Vec3(points[0].x, points[0].y, 0.f), color, Vec2(0.f, 0.f)));
+        verts.push_back(Vertex_PCU(Vec3(points[i].x, points[i].y, 0.f), color, Vec2(0.f, 0.f)));
+        verts.push_back(Vertex_PCU(Vec3(points[i + 1].x, points[i + 1].y, 0.f), color, Vec2(0.f, 0.f)));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+void Game::AddVertsForConvexEdges(std::vector<Vertex_PCU>& verts, Convex2 const& convex, float thickness, Rgba8 const& color) const
+{
+    AddVertsForConvexEdges(verts, convex.GetVertices(), thickness, color);
+}
+
+//----------------------------------------------------------------------------------------------------
+void Game::AddVertsForConvexEdges(std::vector<Vertex_PCU>& verts, std::span<Vec2 const> points, float thickness, Rgba8 const& color) const
 {
-    std::vector<Vec2> const& points = convexPoly2.GetVertexArray();
     int numPoints = static_cast<int>(points.size());
 
     for (int i = 0; i < numPoints; ++i)
@@ -676,6 +1360,23 @@ void Game::AddVertsForConvexPolyEdges(std::vector<Vertex_PCU>& verts, ConvexPoly
     }
 }
 
+//----------------------------------------------------------------------------------------------------
+// AddVertsForInstances - Each instance's world vertices are rebuilt from its prototype into one
+// frame buffer, so drawing never expands the layer into per-instance shapes
+//----------------------------------------------------------------------------------------------------
+void Game::AddVertsForInstances(std::vector<Vertex_PCU>& verts, float edgeThickness, Rgba8 const& fillColor, Rgba8 const& edgeColor) const
+{
+    FrameVector<Vec2> worldPoints;
+    for (int i = 0; i < m_instancedScene.GetNumInstances(); ++i)
+    {
+        int prototypeId = m_instancedScene.GetInstance(i).m_prototypeId;
+        worldPoints.resize(m_instancedScene.GetPrototype(prototypeId).GetNumVertices());
+        m_instancedScene.GetInstanceVertices(i, worldPoints);
+        AddVertsForConvexFill(verts, worldPoints, fillColor);
+        AddVertsForConvexEdges(verts, worldPoints, edgeThickness, edgeColor);
+    }
+}
+
 //----------------------------------------------------------------------------------------------------
 void Game::RenderRaycast(std::vector<Vertex_PCU>& verts) const
 {
@@ -692,29 +1393,20 @@ void Game::RenderRaycast(std::vector<Vertex_PCU>& verts) const
     }
     Vec2 rayNormal = (m_rayEnd - m_rayStart) / rayMaxLength;
 
-    // Find closest raycast hit across all convexes
-    RaycastResult2D closestResult;
-    closestResult.m_didImpact = false;
-
-    for (Convex2* convex : m_convexes)
+    // Find closest raycast hit through the accelerator selected with F9
+    ClosestRayHit closestHit;
+    DispatchSceneAccelerator(GetSceneQueryView(), static_cast<eQueryMode>(m_rayOptimizationMode), [&](auto const& accelerator)
     {
-        RaycastResult2D result;
-        bool discRejection = (m_rayOptimizationMode == 1);
-        bool boxRejection  = (m_rayOptimizationMode == 2);
-        bool didHit = convex->RayCastVsConvex2D(result, m_rayStart, rayNormal, rayMaxLength, discRejection, boxRejection);
-        if (didHit && (!closestResult.m_didImpact || result.m_impactLength < closestResult.m_impactLength))
-        {
-            closestResult = result;
-        }
-    }
+        accelerator.RaycastClosest(m_rayStart, rayNormal, rayMaxLength, QueryScratch::GetForThisThread(), closestHit, m_rayTestFilter);
+    });
 
     // Always draw the full ray arrow (black, behind everything)
     AddVertsForArrow2D(verts, m_rayStart, m_rayEnd, normalArrowSize, rayThickness, Rgba8(0, 0, 0));
 
-    if (closestResult.m_didImpact)
+    if (closestHit.m_objectId != -1)
     {
-        Vec2 const& impactPos = closestResult.m_impactPosition;
-        Vec2 const& impactNormal = closestResult.m_impactNormal;
+        Vec2 const  impactPos    = m_rayStart + rayNormal * closestHit.m_dist;
+        Vec2 const& impactNormal = closestHit.m_normal;
 
         // Green segment from start to impact (drawn on top of black arrow)
         AddVertsForLineSegment2D(verts, m_rayStart, impactPos, rayThickness, false, Rgba8(0, 255, 0));
@@ -727,8 +1419,9 @@ void Game::RenderRaycast(std::vector<Vertex_PCU>& verts) const
     // Single object mode: draw infinite lines for each bounding plane, color-coded by status/rejection
     if (m_convexes.size() == 1)
     {
-        for (auto const& plane : m_convexes[0]->m_convexHull.m_boundingPlanes)
+        for (int edgeIndex = 0; edgeIndex < m_convexes[0]->GetNumVertices(); ++edgeIndex)
         {
+            Plane2 const plane = m_convexes[0]->GetPlane(edgeIndex);
             float altitude = plane.GetAltitudeOfPoint(m_rayStart);
             float NdotF    = DotProduct2D(rayNormal, plane.m_normal);
 
@@ -770,249 +1463,803 @@ void Game::RenderRaycast(std::vector<Vertex_PCU>& verts) const
 }
 
 //----------------------------------------------------------------------------------------------------
-Convex2* Game::CreateRandomConvex(Vec2 const& center, float minRadius, float maxRadius)
+FrameVector<Vec2> Game::RollRandomConvexVertices(Vec2 const& center, float minRadius, float maxRadius)
+{
+    // Generate random number of sides (3-8)
+    int numSides = g_rng->RollRandomIntInRange(3, 8);
+
+    // Generate random radius
+    float radius = g_rng->RollRandomFloatInRange(minRadius, maxRadius);
+
+    // Generate random angles with variation, then sort to guarantee CCW winding
+    float angleStep = 360.f / static_cast<float>(numSides);
+    FrameVector<float> angles;
+    angles.reserve(numSides);
+    for (int i = 0; i < numSides; ++i)
+    {
+        float baseAngle = angleStep * static_cast<float>(i);
+        float angleVariation = g_rng->RollRandomFloatInRange(-angleStep * 0.3f, angleStep * 0.3f);
+        angles.push_back(baseAngle + angleVariation);
+    }
+    std::sort(angles.begin(), angles.end());
+
+    // Create vertices from sorted angles with uniform radius
+    FrameVector<Vec2> vertices;
+    vertices.reserve(numSides);
+    for (int i = 0; i < numSides; ++i)
+    {
+        Vec2 vertex = center + Vec2::MakeFromPolarDegrees(angles[i], radius);
+        vertices.push_back(vertex);
+    }
+    return vertices;
+}
+
+//----------------------------------------------------------------------------------------------------
+Convex2* Game::CreateRandomConvex(Vec2 const& center, float minRadius, float maxRadius)
+{
+    return new Convex2(RollRandomConvexVertices(center, minRadius, maxRadius));
+}
+
+//----------------------------------------------------------------------------------------------------
+// SpawnRandomConvexes - The RNG is not thread-safe and must roll in the same order for a seed to
+// reproduce its scene, so shapes are rolled serially; building the hulls and bounding volumes, the
+// expensive part, runs on the task scheduler.
+//----------------------------------------------------------------------------------------------------
+void Game::SpawnRandomConvexes(int numConvexes)
+{
+    FrameVector<FrameVector<Vec2>> vertexLists(numConvexes);
+    for (int i = 0; i < numConvexes; ++i)
+    {
+        Vec2 randomPos = Vec2(
+            g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_X),
+            g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_Y)
+        );
+        vertexLists[i] = RollRandomConvexVertices(randomPos, MIN_CONVEX_RADIUS, MAX_CONVEX_RADIUS);
+    }
+
+    size_t firstNew = m_convexes.size();
+    m_convexes.resize(firstNew + numConvexes, nullptr);
+    ParallelFor(0, numConvexes, CONVEXES_PER_TASK, [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            m_convexes[firstNew + i] = new Convex2(vertexLists[i]);
+        }
+    });
+}
+
+//----------------------------------------------------------------------------------------------------
+// SpawnRandomInstances - Prototypes are rolled around the origin, then placed with a random position,
+// orientation and scale each
+//----------------------------------------------------------------------------------------------------
+void Game::SpawnRandomInstances(int numPrototypes, int numInstances)
+{
+    m_instancedScene.Clear();
+    for (int p = 0; p < numPrototypes; ++p)
+    {
+        m_instancedScene.AddPrototype(RollRandomConvexVertices(Vec2::ZERO, MIN_CONVEX_RADIUS, MAX_CONVEX_RADIUS));
+    }
+    for (int i = 0; i < numInstances; ++i)
+    {
+        Vec2 randomPos(g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_X), g_rng->RollRandomFloatInRange(0.f, WORLD_SIZE_Y));
+        m_instancedScene.AddInstance(g_rng->RollRandomIntInRange(0, numPrototypes - 1), randomPos, g_rng->RollRandomFloatInRange(0.f, 360.f),
+                                     g_rng->RollRandomFloatInRange(MIN_INSTANCE_SCALE, MAX_INSTANCE_SCALE));
+    }
+    m_instancedScene.BuildTree();
+}
+
+//----------------------------------------------------------------------------------------------------
+// Distance from center to the outline of a polygon star-shaped around it, along a unit direction;
+// -1 when the ray leaves through no edge
+//----------------------------------------------------------------------------------------------------
+static float GetStarPolygonDistAlongRay(std::span<Vec2 const> polygon, Vec2 const& center, Vec2 const& direction)
+{
+    float bestDist = -1.f;
+    int   numVerts = static_cast<int>(polygon.size());
+    for (int i = 0; i < numVerts; ++i)
+    {
+        Vec2  from  = polygon[i] - center;
+        Vec2  edge  = polygon[(i + 1) % numVerts] - polygon[i];
+        float denom = CrossProduct2D(direction, edge);
+        if (denom == 0.f)
+        {
+            continue;
+        }
+        float dist      = CrossProduct2D(from, edge) / denom;
+        float edgeParam = CrossProduct2D(from, direction) / denom;
+        if (dist > 0.f && edgeParam >= -1e-5f && edgeParam <= 1.f + 1e-5f && (bestDist < 0.f || dist < bestDist))
+        {
+            bestDist = dist;
+        }
+    }
+    return bestDist;
+}
+
+//----------------------------------------------------------------------------------------------------
+void Game::TestRays()
+{
+    RebuildAllTrees();
+    VerifyRefitAfterDrag();
+
+    int numRays = m_numOfRandomRays;
+
+    // Generate random rays; every buffer in the test lives in the frame arena
+    FrameVector<Vec2> rayStartPos(numRays);
+    FrameVector<Vec2> rayForwardNormal(numRays);
+    FrameVector<float> rayMaxDist(numRays);
+
+    AABB2 worldBounds(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y));
+    for (int j = 0; j < numRays; ++j)
+    {
+        Vec2 p1(g_rng->RollRandomFloatInRange(worldBounds.m_mins.x, worldBounds.m_maxs.x),
+                g_rng->RollRandomFloatInRange(worldBounds.m_mins.y, worldBounds.m_maxs.y));
+        Vec2 p2(g_rng->RollRandomFloatInRange(worldBounds.m_mins.x, worldBounds.m_maxs.x),
+                g_rng->RollRandomFloatInRange(worldBounds.m_mins.y, worldBounds.m_maxs.y));
+        rayStartPos[j] = p1;
+        Vec2 disp = p2 - p1;
+        rayMaxDist[j] = disp.GetLength();
+        rayForwardNormal[j] = disp.GetNormalized();
+    }
+
+    // Keep an even subsample as the workload the accelerator tuner replays
+    int numRecordedRays = std::min(numRays, TUNER_WORKLOAD_RAYS);
+    m_recordedRayStartPos.resize(numRecordedRays);
+    m_recordedRayForwardNormal.resize(numRecordedRays);
+    m_recordedRayMaxDist.resize(numRecordedRays);
+    for (int j = 0; j < numRecordedRays; ++j)
+    {
+        int source = static_cast<int>(static_cast<int64_t>(j) * numRays / numRecordedRays);
+        m_recordedRayStartPos[j]      = rayStartPos[source];
+        m_recordedRayForwardNormal[j] = rayForwardNormal[source];
+        m_recordedRayMaxDist[j]       = rayMaxDist[source];
+    }
+
+    // Hit buffers are allocated once per test and shared by every mode
+    FrameVector<float> hitDists(numRays);
+    FrameVector<int>   hitObjectIds(numRays);
+    FrameVector<Vec2>  hitNormals(numRays);
+
+    RayBatch       rays{rayStartPos, rayForwardNormal, rayMaxDist};
+    RayHitBatch    hits{hitDists, hitObjectIds, hitNormals};
+    SceneQueryView scene = GetSceneQueryView();
+    scene.m_filter       = m_rayTestFilter;
+
+    // Every registered accelerator runs the same batch; the first one is the reference the rest must match
+    int correctNumOfRayHit = 0;
+    SceneAccelerators::ForEach([&]<typename Accelerator>()
+    {
+        int const modeIndex = static_cast<int>(Accelerator::QUERY_MODE);
+
+        double startTime   = GetCurrentTimeSeconds();
+        int    numOfRayHit = RaycastBatchWith(GetSceneAccelerator<Accelerator>(scene), rays, hits, scene.m_filter);
+        double endTime     = GetCurrentTimeSeconds();
+        m_lastRayTestTimes[modeIndex] = static_cast<float>((endTime - startTime) * 1000.0);
+
+        if (modeIndex == 0)
+        {
+            float sumDist = 0.f;
+            for (int j = 0; j < numRays; ++j)
+            {
+                if (hitObjectIds[j] != -1)
+                {
+                    sumDist += hitDists[j];
+                }
+            }
+            m_avgDist          = sumDist / static_cast<float>(numOfRayHit);
+            correctNumOfRayHit = numOfRayHit;
+        }
+        else
+        {
+            GUARANTEE_OR_DIE(numOfRayHit == correctNumOfRayHit, Stringf("%s mismatch", Accelerator::GetName()));
+        }
+    });
+
+    // Every crossed convex for a subsample of the rays, in entry order, must match the brute-force scan
+    int const                   numAllHitsRays = std::min(numRays, ALL_HITS_TEST_RAYS);
+    FrameVector<RayPenetration> referencePenetrations(ALL_HITS_TEST_MAX_HITS);
+    FrameVector<RayPenetration> penetrations(ALL_HITS_TEST_MAX_HITS);
+    for (int j = 0; j < numAllHitsRays; ++j)
+    {
+        int const numReference = RaycastAllHits(scene, eQueryMode::NO_OPTIMIZATION, rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], referencePenetrations);
+        for (int k = 0; k < numReference; ++k)
+        {
+            GUARANTEE_OR_DIE(referencePenetrations[k].m_entryDist <= referencePenetrations[k].m_exitDist && (k == 0 || referencePenetrations[k - 1].m_entryDist <= referencePenetrations[k].m_entryDist),
+                             "RaycastAllHits entries out of order");
+        }
+        SceneAccelerators::ForEach([&]<typename Accelerator>()
+        {
+            int const numPenetrations = RaycastAllHits(scene, Accelerator::QUERY_MODE, rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], penetrations);
+            bool      isMatch         = (numPenetrations == numReference);
+            for (int k = 0; isMatch && k < numPenetrations; ++k)
+            {
+                isMatch = penetrations[k].m_objectId == referencePenetrations[k].m_objectId && fabsf(penetrations[k].m_entryDist - referencePenetrations[k].m_entryDist) <= 1e-4f &&
+                          fabsf(penetrations[k].m_exitDist - referencePenetrations[k].m_exitDist) <= 1e-4f;
+            }
+            GUARANTEE_OR_DIE(isMatch, Stringf("%s all-hits mismatch", Accelerator::GetName()));
+        });
+    }
+
+    // A disc and a square swept along a subsample of the rays must make first contact at the same
+    // distance through every accelerator as through the brute-force scan
+    int const numShapeCastRays = std::min(numRays, SHAPE_CAST_TEST_RAYS);
+    for (int j = 0; j < numShapeCastRays; ++j)
+    {
+        Vec2 const     start          = rayStartPos[j];
+        Vec2 const     squareVerts[4] = {start + Vec2(-SHAPE_CAST_TEST_RADIUS, -SHAPE_CAST_TEST_RADIUS), start + Vec2(SHAPE_CAST_TEST_RADIUS, -SHAPE_CAST_TEST_RADIUS),
+                                         start + Vec2(SHAPE_CAST_TEST_RADIUS, SHAPE_CAST_TEST_RADIUS), start + Vec2(-SHAPE_CAST_TEST_RADIUS, SHAPE_CAST_TEST_RADIUS)};
+        ShapeCastShape shapes[2]      = {ShapeCastShape::MakeDisc(start, SHAPE_CAST_TEST_RADIUS), ShapeCastShape::MakeConvexPoly(squareVerts)};
+        for (ShapeCastShape const& shape : shapes)
+        {
+            ShapeCastResult reference;
+            ShapeCast(scene, eQueryMode::NO_OPTIMIZATION, shape, rayForwardNormal[j], rayMaxDist[j], reference);
+            SceneAccelerators::ForEach([&]<typename Accelerator>()
+            {
+                ShapeCastResult result;
+                ShapeCast(scene, Accelerator::QUERY_MODE, shape, rayForwardNormal[j], rayMaxDist[j], result);
+                GUARANTEE_OR_DIE(result.m_didImpact == reference.m_didImpact && (!reference.m_didImpact || fabsf(result.m_timeOfImpact - reference.m_timeOfImpact) <= 1e-4f),
+                                 Stringf("%s shape cast mismatch", Accelerator::GetName()));
+            });
+        }
+    }
+
+    // Bounce chains for a subsample of the rays: every accelerator, on the task scheduler, must follow
+    // the same reflections to the same points as the brute-force scan on one thread
+    int const           numBounceRays = std::min(numRays, BOUNCE_TEST_RAYS);
+    BounceTraceSettings bounceSettings;
+    int const           bounceStride  = BouncePathBatch::GetPathStride(bounceSettings);
+    RayBatch const      bounceRays{std::span<Vec2 const>(rayStartPos).first(numBounceRays), std::span<Vec2 const>(rayForwardNormal).first(numBounceRays),
+                                   std::span<float const>(rayMaxDist).first(numBounceRays)};
+    FrameVector<Vec2>   referencePathPoints(static_cast<size_t>(numBounceRays) * bounceStride);
+    FrameVector<int>    referenceNumPathPoints(numBounceRays);
+    FrameVector<int>    referenceNumBounces(numBounceRays);
+    FrameVector<float>  referenceEnergies(numBounceRays);
+    FrameVector<Vec2>   pathPoints(referencePathPoints.size());
+    FrameVector<int>    numPathPoints(numBounceRays);
+    FrameVector<int>    numBounces(numBounceRays);
+    FrameVector<float>  energies(numBounceRays);
+    int const numReferenceBounces = TraceBouncedRays(scene, eQueryMode::NO_OPTIMIZATION, bounceRays, bounceSettings,
+                                                     BouncePathBatch{referencePathPoints, referenceNumPathPoints, referenceNumBounces, referenceEnergies}, 1);
+    SceneAccelerators::ForEach([&]<typename Accelerator>()
+    {
+        int const numTracedBounces = TraceBouncedRays(scene, Accelerator::QUERY_MODE, bounceRays, bounceSettings, BouncePathBatch{pathPoints, numPathPoints, numBounces, energies});
+        bool      isMatch          = (numTracedBounces == numReferenceBounces);
+        for (int j = 0; isMatch && j < numBounceRays; ++j)
+        {
+            isMatch = numPathPoints[j] == referenceNumPathPoints[j] && numBounces[j] == referenceNumBounces[j];
+            for (int k = j * bounceStride; isMatch && k < j * bounceStride + numPathPoints[j]; ++k)
+            {
+                isMatch = (pathPoints[k] - referencePathPoints[k]).GetLengthSquared() <= BOUNCE_TEST_TOLERANCE * BOUNCE_TEST_TOLERANCE;
+            }
+        }
+        GUARANTEE_OR_DIE(isMatch, Stringf("%s bounce chain mismatch", Accelerator::GetName()));
+    });
+
+    // The same BVH batch split across the task scheduler
+    double parallelStartTime = GetCurrentTimeSeconds();
+    int    numOfParallelHit  = RaycastBatchParallel(scene, eQueryMode::AABB2_TREE, rays, hits);
+    double parallelEndTime   = GetCurrentTimeSeconds();
+    m_lastRayTestParallelTime = static_cast<float>((parallelEndTime - parallelStartTime) * 1000.0);
+    GUARANTEE_OR_DIE(numOfParallelHit == correctNumOfRayHit, "Parallel raycast mismatch");
+
+    // The instanced layer answers the same rays on its own; its hits are not comparable with the convexes'
+    if (!m_instancedScene.IsEmpty())
+    {
+        FrameVector<float> instanceHitDists(numRays);
+        FrameVector<int>   instanceHitIds(numRays);
+        FrameVector<Vec2>  instanceHitNormals(numRays);
+        double instancedStartTime = GetCurrentTimeSeconds();
+        m_instancedScene.RaycastBatch(rays, RayHitBatch{instanceHitDists, instanceHitIds, instanceHitNormals});
+        double instancedEndTime   = GetCurrentTimeSeconds();
+        m_lastRayTestInstancedTime = static_cast<float>((instancedEndTime - instancedStartTime) * 1000.0);
+    }
+
+    // Cached closest hit: the cold pass fills the cache, the warm pass repeats the same probes
+    m_rayQueryCache.ResetStats();
+    double cacheColdStartTime = GetCurrentTimeSeconds();
+    int    numOfColdCacheHit  = m_rayQueryCache.RaycastBatch(scene, eQueryMode::AABB2_TREE, rays, hits);
+    double cacheWarmStartTime = GetCurrentTimeSeconds();
+    int    numOfWarmCacheHit  = m_rayQueryCache.RaycastBatch(scene, eQueryMode::AABB2_TREE, rays, hits);
+    double cacheWarmEndTime   = GetCurrentTimeSeconds();
+    m_lastRayTestCacheColdTime = static_cast<float>((cacheWarmStartTime - cacheColdStartTime) * 1000.0);
+    m_lastRayTestCacheWarmTime = static_cast<float>((cacheWarmEndTime - cacheWarmStartTime) * 1000.0);
+    GUARANTEE_OR_DIE(numOfColdCacheHit == correctNumOfRayHit && numOfWarmCacheHit == correctNumOfRayHit, "Ray cache mismatch");
+
+    // Temporal hints: the first pass fills one hint per ray slot, the second reuses them as a tracked sensor would
+    FrameVector<int> hintObjectIds(numRays, -1);
+    double hintColdStartTime = GetCurrentTimeSeconds();
+    int    numOfColdHintHit  = RaycastBatchWithHints(scene, eQueryMode::AABB2_TREE, rays, hintObjectIds, hits);
+    double hintWarmStartTime = GetCurrentTimeSeconds();
+    int    numOfWarmHintHit  = RaycastBatchWithHints(scene, eQueryMode::AABB2_TREE, rays, hintObjectIds, hits);
+    double hintWarmEndTime   = GetCurrentTimeSeconds();
+    m_lastRayTestHintColdTime = static_cast<float>((hintWarmStartTime - hintColdStartTime) * 1000.0);
+    m_lastRayTestHintWarmTime = static_cast<float>((hintWarmEndTime - hintWarmStartTime) * 1000.0);
+    GUARANTEE_OR_DIE(numOfColdHintHit == correctNumOfRayHit && numOfWarmHintHit == correctNumOfRayHit, "Hinted raycast mismatch");
+
+    // Occupancy bitset line of sight must agree exactly with "no closest hit"
+    double rasterStartTime = GetCurrentTimeSeconds();
+    m_occupancyGrid.Rasterize(scene, worldBounds, OCCUPANCY_CELL_SIZE);
+    double losStartTime    = GetCurrentTimeSeconds();
+    FrameVector<uint8_t> isVisible(numRays);
+    int    numVisible      = m_occupancyGrid.LineOfSightBatch(scene, eQueryMode::AABB2_TREE, rays, isVisible);
+    double losEndTime      = GetCurrentTimeSeconds();
+    m_lastOccupancyRasterTime  = static_cast<float>((losStartTime - rasterStartTime) * 1000.0);
+    m_lastRayTestOccupancyTime = static_cast<float>((losEndTime - losStartTime) * 1000.0);
+    GUARANTEE_OR_DIE(numVisible == numRays - correctNumOfRayHit, "Occupancy line of sight mismatch");
+
+    // Sphere tracing is approximate (features thinner than a cell can be stepped over), so it is
+    // scored for agreement with the exact result instead of being required to match it
+    FrameVector<float> referenceDists(hitDists);
+    FrameVector<int>   referenceObjectIds(hitObjectIds);
+
+    double bakeStartTime = GetCurrentTimeSeconds();
+    m_distanceField.Bake(scene, eQueryMode::AABB2_TREE, worldBounds, DISTANCE_FIELD_CELL_SIZE, DISTANCE_FIELD_MAX_DIST);
+    double bakeEndTime   = GetCurrentTimeSeconds();
+    m_lastDistanceFieldBakeTime = static_cast<float>((bakeEndTime - bakeStartTime) * 1000.0);
+
+    double traceStartTime = GetCurrentTimeSeconds();
+    m_distanceField.RaycastBatchSphereTrace(rays, hits);
+    double traceEndTime   = GetCurrentTimeSeconds();
+    m_lastRayTestSphereTraceTime = static_cast<float>((traceEndTime - traceStartTime) * 1000.0);
+
+    int numAgreeing = 0;
+    for (int j = 0; j < numRays; ++j)
+    {
+        bool referenceHit = (referenceObjectIds[j] != -1);
+        bool traceHit     = (hitObjectIds[j] != -1);
+        if (referenceHit == traceHit && (!referenceHit || fabsf(referenceDists[j] - hitDists[j]) <= DISTANCE_FIELD_CELL_SIZE))
+        {
+            ++numAgreeing;
+        }
+    }
+    m_lastSphereTraceAgreement = (numRays > 0) ? 100.f * static_cast<float>(numAgreeing) / static_cast<float>(numRays) : 0.f;
+
+    // Fan distribution: every ray leaves one emitter, evenly spread over the full circle
+    Vec2 fanOrigin(g_rng->RollRandomFloatInRange(worldBounds.m_mins.x, worldBounds.m_maxs.x),
+                   g_rng->RollRandomFloatInRange(worldBounds.m_mins.y, worldBounds.m_maxs.y));
+    for (int j = 0; j < numRays; ++j)
+    {
+        float degrees = 360.f * static_cast<float>(j) / static_cast<float>(numRays);
+        rayStartPos[j]      = fanOrigin;
+        rayForwardNormal[j] = Vec2::MakeFromPolarDegrees(degrees);
+        rayMaxDist[j]       = FAN_TEST_MAX_DIST;
+    }
+
+    double fanBVHStartTime = GetCurrentTimeSeconds();
+    int    numOfFanRayHit  = RaycastBatch(scene, eQueryMode::AABB2_TREE, rays, hits);
+    double fanBVHEndTime   = GetCurrentTimeSeconds();
+    m_lastFanTestBVHTime   = static_cast<float>((fanBVHEndTime - fanBVHStartTime) * 1000.0);
+
+    double fanStartTime       = GetCurrentTimeSeconds();
+    int    numOfAngularFanHit = RaycastFanBatch(scene, eQueryMode::AABB2_TREE, fanOrigin, rayForwardNormal, FAN_TEST_MAX_DIST, hits);
+    double fanEndTime         = GetCurrentTimeSeconds();
+    m_lastFanTestAngularTime  = static_cast<float>((fanEndTime - fanStartTime) * 1000.0);
+
+    GUARANTEE_OR_DIE(numOfAngularFanHit == numOfFanRayHit, "Angular fan mismatch");
+
+    // The visibility polygon from the fan origin must follow the fan's closest hits: along each ray
+    // its outline sits at the hit, or on the circle (within an arc step's chord) on a miss. It is
+    // empty when the origin is inside a convex.
+    std::vector<Vec2> visibilityPolygon;
+    ComputeVisibilityPolygon(scene, eQueryMode::AABB2_TREE, fanOrigin, FAN_TEST_MAX_DIST, visibilityPolygon, VISIBILITY_TEST_ARC_STEPS);
+    if (!visibilityPolygon.empty())
+    {
+        float const arcTolerance = FAN_TEST_MAX_DIST * (1.f - CosDegrees(180.f / static_cast<float>(VISIBILITY_TEST_ARC_STEPS))) + VISIBILITY_TEST_TOLERANCE;
+        int         numOutlineMismatches = 0;
+        for (int j = 0; j < numRays; ++j)
+        {
+            bool const  isHit        = (hitObjectIds[j] != -1);
+            float const expectedDist = isHit ? hitDists[j] : FAN_TEST_MAX_DIST;
+            float const outlineDist  = GetStarPolygonDistAlongRay(visibilityPolygon, fanOrigin, rayForwardNormal[j]);
+            if (outlineDist < 0.f || fabsf(outlineDist - expectedDist) > (isHit ? VISIBILITY_TEST_TOLERANCE : arcTolerance))
+            {
+                ++numOutlineMismatches;
+            }
+        }
+        GUARANTEE_OR_DIE(numOutlineMismatches == 0, Stringf("Visibility polygon mismatch on %d of %d rays", numOutlineMismatches, numRays));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+// VerifyRefitAfterDrag - Drags one convex out of the world and back with only refits in between, as
+// interactive edits and the motion simulation do; every accelerator must then report the same
+// overlaps with its bounds as the brute-force scan, including the dragged convex itself. The probe
+// is clipped to the world, which is all the quadtree's cells cover.
+//----------------------------------------------------------------------------------------------------
+void Game::VerifyRefitAfterDrag()
+{
+    if (m_convexes.empty())
+    {
+        return;
+    }
+
+    Convex2*   dragged = m_convexes[g_rng->RollRandomIntInRange(0, static_cast<int>(m_convexes.size()) - 1)];
+    Vec2 const offset(2.f * WORLD_SIZE_X, 0.f);
+    dragged->Translate(offset);
+    RefitAllTrees();
+    dragged->Translate(-offset);
+    RefitAllTrees();
+
+    AABB2 const probeBounds(Vec2(std::max(dragged->m_boundingAABB.m_mins.x, 0.f), std::max(dragged->m_boundingAABB.m_mins.y, 0.f)),
+                            Vec2(std::min(dragged->m_boundingAABB.m_maxs.x, WORLD_SIZE_X), std::min(dragged->m_boundingAABB.m_maxs.y, WORLD_SIZE_Y)));
+    if (probeBounds.m_mins.x > probeBounds.m_maxs.x || probeBounds.m_mins.y > probeBounds.m_maxs.y)
+    {
+        return;
+    }
+
+    SceneQueryView const   scene = GetSceneQueryView();
+    RegionQueryShape const probe = RegionQueryShape::MakeAABB(probeBounds);
+    FrameVector<int>       objectIds(m_convexes.size());
+    int                    correctNumOverlaps = 0;
+    bool                   correctHasDragged  = false;
+    SceneAccelerators::ForEach([&]<typename Accelerator>()
+    {
+        int const  numOverlaps = QueryRegionOverlaps(scene, Accelerator::QUERY_MODE, probe, objectIds);
+        bool const hasDragged  = std::find(objectIds.begin(), objectIds.begin() + numOverlaps, dragged->m_objectId) != objectIds.begin() + numOverlaps;
+        if (Accelerator::QUERY_MODE == eQueryMode::NO_OPTIMIZATION)
+        {
+            correctNumOverlaps = numOverlaps;
+            correctHasDragged  = hasDragged;
+        }
+        GUARANTEE_OR_DIE(numOverlaps == correctNumOverlaps && hasDragged == correctHasDragged, Stringf("%s lost track of a convex dragged out of the world and back", Accelerator::GetName()));
+    });
+}
+
+//----------------------------------------------------------------------------------------------------
+void Game::RebuildAllTrees()
+{
+    AABB2 totalBounds = AABB2(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y));
+
+    AssignConvexObjectIds();
+    m_AABB2Tree.Build(m_convexes, totalBounds);
+    m_symQuadTree.Build(m_convexes, totalBounds);
+    m_partitionedTree.Build(m_convexes, totalBounds);
+}
+
+//----------------------------------------------------------------------------------------------------
+// RefitAllTrees - Keep the structure, update bounds. Only for moved objects; adding or removing any
+// needs RebuildAllTrees, which also assigns the object ids the trees index by
+//----------------------------------------------------------------------------------------------------
+void Game::RefitAllTrees()
+{
+    m_AABB2Tree.Refit();
+    m_symQuadTree.Refit();
+    m_partitionedTree.Refit();
+}
+
+//----------------------------------------------------------------------------------------------------
+// Object ids are array indices; batch queries report hits by id and dedup visits with them
+//----------------------------------------------------------------------------------------------------
+void Game::AssignConvexObjectIds()
+{
+    for (int i = 0; i < static_cast<int>(m_convexes.size()); ++i)
+    {
+        m_convexes[i]->m_objectId = i;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+SceneQueryView Game::GetSceneQueryView() const
+{
+    SceneQueryView scene;
+    scene.m_convexes        = &m_convexes;
+    scene.m_symQuadTree     = &m_symQuadTree;
+    scene.m_AABB2Tree       = &m_AABB2Tree;
+    scene.m_partitionedTree = &m_partitionedTree;
+    return scene;
+}
+
+//----------------------------------------------------------------------------------------------------
+void Game::ClearScene()
+{
+    m_motionSimulation.Stop();
+
+    // Delete all convexes
+    for (Convex2* convex : m_convexes)
+    {
+        delete convex;
+    }
+    m_convexes.clear();
+    m_instancedScene.Clear();
+
+    // Clear preserved chunks from loaded file
+    m_preservedChunks.clear();
+
+    // Derived data refers to objects that no longer exist
+    InvalidateSceneCaches();
+
+    // Tuning belongs to the old scene; trees fall back to their default depths
+    m_acceleratorTuning = AcceleratorTuning();
+    ApplyAcceleratorTuning();
+
+    // Reset interaction state
+    m_hoveringConvex = nullptr;
+    m_isDragging = false;
+}
+
+//----------------------------------------------------------------------------------------------------
+// OnHoveringConvexEdited - Patch derived scene data after a single object moved, rotated or scaled
+//----------------------------------------------------------------------------------------------------
+void Game::OnHoveringConvexEdited(AABB2 const& boundsBefore)
+{
+    int const movedObjectId = m_hoveringConvex->m_objectId;
+    OnConvexesMoved(std::span<int const>(&movedObjectId, 1), std::span<AABB2 const>(&boundsBefore, 1));
+}
+
+//----------------------------------------------------------------------------------------------------
+// OnConvexesMoved - Patch derived scene data after objects moved, rotated or scaled
+//
+// The trees must already be refit; pair lists, the distance field, the occupancy grid and the ray
+// cache are updated in place around each object's old and new bounds rather than recomputed.
+//----------------------------------------------------------------------------------------------------
+void Game::OnConvexesMoved(std::span<int const> movedObjectIds, std::span<AABB2 const> boundsBefore)
 {
-    // Generate random number of sides (3-8)
-    int numSides = g_rng->RollRandomIntInRange(3, 8);
-
-    // Generate random radius
-    float radius = g_rng->RollRandomFloatInRange(minRadius, maxRadius);
+    if (m_trackOverlapPairs)
+    {
+        m_overlapPairFinder.UpdateMovedPairs(m_convexes, movedObjectIds, m_overlapPairs);
+    }
 
-    // Generate random angles with variation, then sort to guarantee CCW winding
-    float angleStep = 360.f / static_cast<float>(numSides);
-    std::vector<float> angles;
-    for (int i = 0; i < numSides; ++i)
+    bool const           isFieldBaked     = m_distanceField.IsBaked();
+    bool const           isGridRasterized = m_occupancyGrid.IsRasterized();
+    SceneQueryView const scene            = GetSceneQueryView();
+    for (size_t i = 0; i < movedObjectIds.size(); ++i)
     {
-        float baseAngle = angleStep * static_cast<float>(i);
-        float angleVariation = g_rng->RollRandomFloatInRange(-angleStep * 0.3f, angleStep * 0.3f);
-        angles.push_back(baseAngle + angleVariation);
+        AABB2 const& boundsAfter = m_convexes[movedObjectIds[i]]->m_boundingAABB;
+        if (isFieldBaked)
+        {
+            m_distanceField.MarkDirty(boundsBefore[i]);
+            m_distanceField.MarkDirty(boundsAfter);
+        }
+        if (isGridRasterized)
+        {
+            m_occupancyGrid.UpdateRegion(scene, eQueryMode::AABB2_TREE, boundsBefore[i]);
+            m_occupancyGrid.UpdateRegion(scene, eQueryMode::AABB2_TREE, boundsAfter);
+        }
+        m_rayQueryCache.InvalidateRegion(boundsBefore[i]);
+        m_rayQueryCache.InvalidateRegion(boundsAfter);
     }
-    std::sort(angles.begin(), angles.end());
 
-    // Create vertices from sorted angles with uniform radius
-    std::vector<Vec2> vertices;
-    for (int i = 0; i < numSides; ++i)
+    if (isFieldBaked)
     {
-        Vec2 vertex = center + Vec2::MakeFromPolarDegrees(angles[i], radius);
-        vertices.push_back(vertex);
+        m_distanceField.RebakeDirty(scene);
     }
+}
 
-    // Create ConvexPoly2 from sorted vertices, then construct Convex2
-    ConvexPoly2 poly(vertices);
-    return new Convex2(poly);
+//----------------------------------------------------------------------------------------------------
+// InvalidateSceneCaches - Objects were added or removed; drop data that cannot be patched
+//----------------------------------------------------------------------------------------------------
+void Game::InvalidateSceneCaches()
+{
+    m_overlapPairs.clear();
+    m_trackOverlapPairs = false;
+    m_distanceField.Clear();
+    m_rayQueryCache.Clear();
+    m_occupancyGrid.Clear();
 }
 
 //----------------------------------------------------------------------------------------------------
-void Game::TestRays()
+// OnCategoriesChanged - Node masks are only derived at build time. Cached and baked data hold
+// unfiltered answers, so none of it goes stale.
+//----------------------------------------------------------------------------------------------------
+void Game::OnCategoriesChanged()
+{
+    m_AABB2Tree.UpdateCategoryMasks();
+    m_symQuadTree.UpdateCategoryMasks();
+    m_partitionedTree.UpdateCategoryMasks();
+    m_sceneModified = true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Gameplay-style script for AsyncQueryTest: look along a ray, then gather what is near the hit
+//----------------------------------------------------------------------------------------------------
+static AsyncQueryTask RunSightlineScript(AsyncSceneQueries& queries, Vec2 startPos, Vec2 forwardNormal, float maxDist, int& inout_numFinished)
+{
+    ClosestRayHit hit = co_await queries.SubmitRaycast(startPos, forwardNormal, maxDist);
+    if (hit.m_objectId >= 0)
+    {
+        std::vector<int> nearbyObjectIds = co_await queries.SubmitRegion(RegionQueryShape::MakeDisc(startPos + forwardNormal * hit.m_dist, MAX_CONVEX_RADIUS));
+        UNUSED(nearbyObjectIds)
+    }
+    ++inout_numFinished;
+}
+
+//----------------------------------------------------------------------------------------------------
+void Game::RunAsyncQueryTest(int numRays, int numScripts, AsyncQueryConfig const& config)
 {
     RebuildAllTrees();
 
-    int numRays = m_numOfRandomRays;
+    SceneQueryView scene = GetSceneQueryView();
+    eQueryMode     mode  = static_cast<eQueryMode>(m_rayOptimizationMode);
+    m_asyncQueries.Flush();
+    m_asyncQueries.SetConfig(config);
+    m_asyncQueries.SetScene(scene, mode);
 
-    // Generate random rays
-    std::vector<Vec2> rayStartPos(numRays);
-    std::vector<Vec2> rayForwardNormal(numRays);
-    std::vector<float> rayMaxDist(numRays);
+    int numQueries = std::max(numRays, numScripts);
+    std::vector<Vec2>  rayStartPos(numQueries);
+    std::vector<Vec2>  rayForwardNormal(numQueries);
+    std::vector<float> rayMaxDist(numQueries);
+    for (int j = 0; j < numQueries; ++j)
+    {
+        RollRandomWorldRay(rayStartPos[j], rayForwardNormal[j], rayMaxDist[j]);
+    }
 
-    AABB2 worldBounds(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y));
+    // One query per call, the way gameplay systems issue them today
+    std::vector<float> singleDists(numRays);
+    std::vector<int>   singleObjectIds(numRays);
+    std::vector<Vec2>  singleNormals(numRays);
+    double startTime = GetCurrentTimeSeconds();
     for (int j = 0; j < numRays; ++j)
     {
-        Vec2 p1(g_rng->RollRandomFloatInRange(worldBounds.m_mins.x, worldBounds.m_maxs.x),
-                g_rng->RollRandomFloatInRange(worldBounds.m_mins.y, worldBounds.m_maxs.y));
-        Vec2 p2(g_rng->RollRandomFloatInRange(worldBounds.m_mins.x, worldBounds.m_maxs.x),
-                g_rng->RollRandomFloatInRange(worldBounds.m_mins.y, worldBounds.m_maxs.y));
-        rayStartPos[j] = p1;
-        Vec2 disp = p2 - p1;
-        rayMaxDist[j] = disp.GetLength();
-        rayForwardNormal[j] = disp.GetNormalized();
+        RayBatch    ray{std::span<Vec2 const>(&rayStartPos[j], 1), std::span<Vec2 const>(&rayForwardNormal[j], 1), std::span<float const>(&rayMaxDist[j], 1)};
+        RayHitBatch hit{std::span<float>(&singleDists[j], 1), std::span<int>(&singleObjectIds[j], 1), std::span<Vec2>(&singleNormals[j], 1)};
+        RaycastBatch(scene, mode, ray, hit);
     }
+    double singleTime = GetCurrentTimeSeconds() - startTime;
 
-    RaycastResult2D rayRes;
-    double startTime = 0.0;
-    double endTime = 0.0;
-    float sumDist = 0.f;
-    int numOfRayHit = 0;
-    int correctNumOfRayHit = 0;
-    float thisAvgDist = 0.f;
-
-    // Mode 1: No optimization (baseline)
-    sumDist = 0.f;
-    numOfRayHit = 0;
+    // The same calls through the async surface; the batcher coalesces them behind the futures
+    AsyncQueryStats statsBefore = m_asyncQueries.GetStats();
     startTime = GetCurrentTimeSeconds();
+    std::vector<QueryFuture<ClosestRayHit>> futures;
+    futures.reserve(numRays);
     for (int j = 0; j < numRays; ++j)
     {
-        float minDist = FLT_MAX;
-        for (int i = 0; i < static_cast<int>(m_convexes.size()); ++i)
-        {
-            if (m_convexes[i]->RayCastVsConvex2D(rayRes, rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], false, false))
-            {
-                if (rayRes.m_impactLength < minDist)
-                {
-                    minDist = rayRes.m_impactLength;
-                }
-            }
-        }
-        if (minDist != FLT_MAX)
-        {
-            sumDist += minDist;
-            ++numOfRayHit;
-        }
+        futures.push_back(m_asyncQueries.SubmitRaycast(rayStartPos[j], rayForwardNormal[j], rayMaxDist[j]));
     }
-    endTime = GetCurrentTimeSeconds();
-    m_avgDist = sumDist / static_cast<float>(numOfRayHit);
-    correctNumOfRayHit = numOfRayHit;
-    m_lastRayTestNormalTime = static_cast<float>((endTime - startTime) * 1000.0);
-
-    // Mode 2: Disc rejection
-    sumDist = 0.f;
-    numOfRayHit = 0;
-    startTime = GetCurrentTimeSeconds();
+    int numMismatches = 0;
     for (int j = 0; j < numRays; ++j)
     {
-        float minDist = FLT_MAX;
-        for (int i = 0; i < static_cast<int>(m_convexes.size()); ++i)
-        {
-            if (m_convexes[i]->RayCastVsConvex2D(rayRes, rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], true, false))
-            {
-                if (rayRes.m_impactLength < minDist)
-                {
-                    minDist = rayRes.m_impactLength;
-                }
-            }
-        }
-        if (minDist != FLT_MAX)
+        ClosestRayHit const& hit = futures[j].Get();
+        if ((hit.m_objectId < 0) != (singleObjectIds[j] < 0) || (hit.m_objectId >= 0 && fabsf(hit.m_dist - singleDists[j]) > 1e-4f))
         {
-            sumDist += minDist;
-            ++numOfRayHit;
+            ++numMismatches;
         }
     }
-    endTime = GetCurrentTimeSeconds();
-    thisAvgDist = sumDist / static_cast<float>(numOfRayHit);
-    GUARANTEE_OR_DIE(numOfRayHit == correctNumOfRayHit, "Disc rejection mismatch");
-    m_lastRayTestDiscRejectionTime = static_cast<float>((endTime - startTime) * 1000.0);
+    double          asyncTime  = GetCurrentTimeSeconds() - startTime;
+    AsyncQueryStats statsAfter = m_asyncQueries.GetStats();
 
-    // Mode 3: AABB rejection
-    sumDist = 0.f;
-    numOfRayHit = 0;
+    // Scripts resume inside the flush that answers them and may submit again, so flush until all return
+    int numFinished = 0;
     startTime = GetCurrentTimeSeconds();
-    for (int j = 0; j < numRays; ++j)
+    for (int s = 0; s < numScripts; ++s)
     {
-        float minDist = FLT_MAX;
-        for (int i = 0; i < static_cast<int>(m_convexes.size()); ++i)
-        {
-            if (m_convexes[i]->RayCastVsConvex2D(rayRes, rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], true, true))
-            {
-                if (rayRes.m_impactLength < minDist)
-                {
-                    minDist = rayRes.m_impactLength;
-                }
-            }
-        }
-        if (minDist != FLT_MAX)
-        {
-            sumDist += minDist;
-            ++numOfRayHit;
-        }
+        RunSightlineScript(m_asyncQueries, rayStartPos[s], rayForwardNormal[s], rayMaxDist[s], numFinished);
     }
-    endTime = GetCurrentTimeSeconds();
-    thisAvgDist = sumDist / static_cast<float>(numOfRayHit);
-    GUARANTEE_OR_DIE(numOfRayHit == correctNumOfRayHit, "AABB rejection mismatch");
-    m_lastRayTestAABBRejectionTime = static_cast<float>((endTime - startTime) * 1000.0);
+    while (numFinished < numScripts && m_asyncQueries.Flush() > 0)
+    {
+    }
+    double scriptTime = GetCurrentTimeSeconds() - startTime;
 
-    // Mode 4: QuadTree
-    sumDist = 0.f;
-    numOfRayHit = 0;
-    startTime = GetCurrentTimeSeconds();
-    for (int j = 0; j < numRays; ++j)
+    int64_t numBatches = statsAfter.m_numBatches - statsBefore.m_numBatches;
+    g_devConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("%d single raycasts: %.3f ms one per call, %.3f ms as futures in %d batches (avg %.0f rays) on %d threads, %d mismatches",
+                          numRays, singleTime * 1000.0, asyncTime * 1000.0, static_cast<int>(numBatches),
+                          numBatches > 0 ? static_cast<double>(statsAfter.m_numBatchedQueries - statsBefore.m_numBatchedQueries) / static_cast<double>(numBatches) : 0.0,
+                          GetNumTaskThreads(), numMismatches));
+    g_devConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("%d of %d coroutine scripts finished in %.3f ms", numFinished, numScripts, scriptTime * 1000.0));
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateMotionSimulation - One simulation tick per frame. The scene's own trees are refit and its
+// caches patched around each mover's old and new bounds, as for an edit of the hovered convex; a run
+// with a tick count reports to the console when it ends.
+//----------------------------------------------------------------------------------------------------
+void Game::UpdateMotionSimulation(float deltaSeconds)
+{
+    if (!m_motionSimulation.Step(deltaSeconds))
     {
-        float minDist = FLT_MAX;
-        std::vector<Convex2*> candidates;
-        m_symQuadTree.SolveRayResult(rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], m_convexes, candidates);
-        for (int i = 0; i < static_cast<int>(candidates.size()); ++i)
-        {
-            if (candidates[i]->RayCastVsConvex2D(rayRes, rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], true, true))
-            {
-                if (rayRes.m_impactLength < minDist)
-                {
-                    minDist = rayRes.m_impactLength;
-                }
-            }
-        }
-        if (minDist != FLT_MAX)
-        {
-            sumDist += minDist;
-            ++numOfRayHit;
-        }
+        return;
     }
-    endTime = GetCurrentTimeSeconds();
-    thisAvgDist = sumDist / static_cast<float>(numOfRayHit);
-    GUARANTEE_OR_DIE(numOfRayHit == correctNumOfRayHit, "QuadTree mismatch");
-    m_lastRayTestSymmetricTreeTime = static_cast<float>((endTime - startTime) * 1000.0);
+    RefitAllTrees();
+    OnConvexesMoved(m_motionSimulation.GetMovedObjectIds(), m_motionSimulation.GetMovedBoundsBefore());
+    m_sceneModified = true;
 
-    // Mode 5: BVH (AABB2Tree)
-    sumDist = 0.f;
-    numOfRayHit = 0;
-    startTime = GetCurrentTimeSeconds();
-    for (int j = 0; j < numRays; ++j)
+    if (m_motionSimulation.IsFinished())
     {
-        float minDist = FLT_MAX;
-        std::vector<Convex2*> candidates;
-        m_AABB2Tree.SolveRayResult(rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], candidates);
-        for (int i = 0; i < static_cast<int>(candidates.size()); ++i)
+        g_devConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Motion simulation: %d ticks, %d of %d convexes moving, %d rays per tick, update %.2fms per tick",
+                                                              m_motionSimulation.GetNumTicks(), m_motionSimulation.GetNumMovers(), static_cast<int>(m_convexes.size()),
+                                                              m_motionSimulation.GetRaysPerTick(), m_motionSimulation.GetAvgUpdateTimeMs()));
+        for (int mode = 0; mode < SceneAccelerators::COUNT; ++mode)
         {
-            if (candidates[i]->RayCastVsConvex2D(rayRes, rayStartPos[j], rayForwardNormal[j], rayMaxDist[j], true, true))
-            {
-                if (rayRes.m_impactLength < minDist)
-                {
-                    minDist = rayRes.m_impactLength;
-                }
-            }
+            char description[256];
+            m_motionSimulation.FormatStrategyDescription(static_cast<eQueryMode>(mode), description);
+            g_devConsole->AddLine(DevConsole::INFO_MAJOR, description);
         }
-        if (minDist != FLT_MAX)
+        m_motionSimulation.Stop();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateBudgetedRays - Reports a BudgetedRays workload once its last ray is answered. Rays of one
+// priority are answered in submission order, so the last future is the last to complete.
+//----------------------------------------------------------------------------------------------------
+void Game::UpdateBudgetedRays()
+{
+    if (m_budgetedRayFutures.empty() || !m_budgetedRayFutures.back().IsReady())
+    {
+        return;
+    }
+
+    int   numHits = 0;
+    float sumDist = 0.f;
+    for (QueryFuture<ClosestRayHit> const& future : m_budgetedRayFutures)
+    {
+        ClosestRayHit const& hit = future.Get();
+        if (hit.m_objectId >= 0)
         {
-            sumDist += minDist;
-            ++numOfRayHit;
+            ++numHits;
+            sumDist += hit.m_dist;
         }
     }
-    endTime = GetCurrentTimeSeconds();
-    thisAvgDist = sumDist / static_cast<float>(numOfRayHit);
-    GUARANTEE_OR_DIE(numOfRayHit == correctNumOfRayHit, "BVH mismatch");
-    m_lastRayTestAABBTreeTime = static_cast<float>((endTime - startTime) * 1000.0);
+    g_devConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Budgeted rays: %d rays (%d hits, avg dist %.3f) answered over %d frames in %.1f ms",
+                          static_cast<int>(m_budgetedRayFutures.size()), numHits, numHits > 0 ? sumDist / static_cast<float>(numHits) : 0.f,
+                          m_frameCount - m_budgetedRayStartFrame + 1, (GetCurrentTimeSeconds() - m_budgetedRayStartTime) * 1000.0));
+    m_budgetedRayFutures.clear();
 }
 
 //----------------------------------------------------------------------------------------------------
-void Game::RebuildAllTrees()
+// TuneAccelerators - Pick the accelerator and tree depths for the current scene, then rebuild with them
+//----------------------------------------------------------------------------------------------------
+void Game::TuneAccelerators(AcceleratorTunerConfig const& config)
 {
-    AABB2 totalBounds = AABB2(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y));
+    AABB2 worldBounds(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y));
+
+    // Without a recorded TestRays batch, sample the same distribution it uses
+    if (m_recordedRayStartPos.empty())
+    {
+        m_recordedRayStartPos.resize(TUNER_WORKLOAD_RAYS);
+        m_recordedRayForwardNormal.resize(TUNER_WORKLOAD_RAYS);
+        m_recordedRayMaxDist.resize(TUNER_WORKLOAD_RAYS);
+        for (int j = 0; j < TUNER_WORKLOAD_RAYS; ++j)
+        {
+            Vec2 p1(g_rng->RollRandomFloatInRange(worldBounds.m_mins.x, worldBounds.m_maxs.x),
+                    g_rng->RollRandomFloatInRange(worldBounds.m_mins.y, worldBounds.m_maxs.y));
+            Vec2 p2(g_rng->RollRandomFloatInRange(worldBounds.m_mins.x, worldBounds.m_maxs.x),
+                    g_rng->RollRandomFloatInRange(worldBounds.m_mins.y, worldBounds.m_maxs.y));
+            Vec2 disp = p2 - p1;
+            m_recordedRayStartPos[j]      = p1;
+            m_recordedRayForwardNormal[j] = disp.GetNormalized();
+            m_recordedRayMaxDist[j]       = disp.GetLength();
+        }
+    }
+
+    AssignConvexObjectIds();
+    RayBatch workload{m_recordedRayStartPos, m_recordedRayForwardNormal, m_recordedRayMaxDist};
+    std::vector<AcceleratorTuningCandidate> candidates;
 
-    int numConvexes = static_cast<int>(m_convexes.size());
-    int bvhDepth = 0;
-    if (numConvexes > 0)
+    double startTime = GetCurrentTimeSeconds();
+    m_acceleratorTuning = TuneSceneAccelerators(m_convexes, worldBounds, workload, config, &candidates);
+    double endTime   = GetCurrentTimeSeconds();
+
+    for (AcceleratorTuningCandidate const& candidate : candidates)
     {
-        bvhDepth = static_cast<int>(log2(static_cast<double>(numConvexes))) - 3;
-        if (bvhDepth < 3) bvhDepth = 3;
+        char const* name = SceneAccelerators::GetName(static_cast<int>(candidate.m_queryMode));
+        if (candidate.m_isOverBudget)
+        {
+            g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %s depth %d: over budget (%d KB)", name, candidate.m_buildDepth, static_cast<int>(candidate.m_memoryBytes / 1024)));
+        }
+        else
+        {
+            g_devConsole->AddLine(DevConsole::INFO_MINOR, Stringf("  %s depth %d: %.3f ms query, %.3f ms build, %d KB", name, candidate.m_buildDepth,
+                                  candidate.m_queryTimeMs, candidate.m_buildTimeMs, static_cast<int>(candidate.m_memoryBytes / 1024)));
+        }
     }
+    g_devConsole->AddLine(DevConsole::INFO_MAJOR, Stringf("Tuned %d objects against %d rays in %.1f ms: %s at %.3f ms", m_acceleratorTuning.m_numObjects,
+                          m_acceleratorTuning.m_numRays, (endTime - startTime) * 1000.0,
+                          SceneAccelerators::GetName(static_cast<int>(m_acceleratorTuning.m_queryMode)), m_acceleratorTuning.m_bestTimeMs));
 
-    m_AABB2Tree.BuildTree(m_convexes, bvhDepth, totalBounds);
-    m_symQuadTree.BuildTree(m_convexes, 4, totalBounds);
+    ApplyAcceleratorTuning();
+    RebuildAllTrees();
 }
 
 //----------------------------------------------------------------------------------------------------
-void Game::ClearScene()
+// ApplyAcceleratorTuning - Tree depths take effect on the next build; an invalid tuning restores defaults
+//----------------------------------------------------------------------------------------------------
+void Game::ApplyAcceleratorTuning()
 {
-    // Delete all convexes
-    for (Convex2* convex : m_convexes)
+    m_AABB2Tree.SetBuildDepth(m_acceleratorTuning.GetBuildDepth(AABB2Tree::QUERY_MODE));
+    m_symQuadTree.SetBuildDepth(m_acceleratorTuning.GetBuildDepth(SymmetricQuadTree::QUERY_MODE));
+    if (m_acceleratorTuning.m_isValid)
     {
-        delete convex;
+        m_rayOptimizationMode = static_cast<int>(m_acceleratorTuning.m_queryMode);
     }
-    m_convexes.clear();
-
-    // Clear preserved chunks from loaded file
-    m_preservedChunks.clear();
-
-    // Reset interaction state
-    m_hoveringConvex = nullptr;
-    m_isDragging = false;
 }
 
 //----------------------------------------------------------------------------------------------------
@@ -1266,7 +2513,7 @@ bool Game::SaveSceneToFile(std::string const& filePath)
         bufWrite.AppendUshort(static_cast<unsigned short>(m_convexes.size()));
         for (Convex2 const* convex : m_convexes)
         {
-            std::vector<Vec2> const& verts = convex->m_convexPoly.GetVertexArray();
+            std::span<Vec2 const> verts = convex->GetVertices();
             bufWrite.AppendByte(static_cast<uint8_t>(verts.size()));
             for (Vec2 const& v : verts)
             {
@@ -1289,16 +2536,17 @@ bool Game::SaveSceneToFile(std::string const& filePath)
     }
 
     // --- Chunk 0x80: ConvexHulls ---
+    // Derived from the vertices; we rebuild planes on load, but other GHCS readers expect the chunk
     {
         size_t idx = BeginChunk(0x80);
         bufWrite.AppendUshort(static_cast<unsigned short>(m_convexes.size()));
         for (Convex2 const* convex : m_convexes)
         {
-            std::vector<Plane2> const& planes = convex->m_convexHull.m_boundingPlanes;
-            bufWrite.AppendByte(static_cast<uint8_t>(planes.size()));
-            for (Plane2 const& p : planes)
+            int numPlanes = convex->GetNumVertices();
+            bufWrite.AppendByte(static_cast<uint8_t>(numPlanes));
+            for (int p = 0; p < numPlanes; ++p)
             {
-                bufWrite.AppendPlane2(p);
+                bufWrite.AppendPlane2(convex->GetPlane(p));
             }
         }
         EndChunk(idx);
@@ -1360,6 +2608,66 @@ bool Game::SaveSceneToFile(std::string const& filePath)
         EndChunk(idx);
     }
 
+    // --- Chunk 0x88: Accelerator tuning (custom) ---
+    if (m_acceleratorTuning.m_isValid)
+    {
+        size_t idx = BeginChunk(0x88);
+        bufWrite.AppendByte(static_cast<uint8_t>(m_acceleratorTuning.m_queryMode));
+        bufWrite.AppendByte(static_cast<uint8_t>(eQueryMode::COUNT));
+        for (uint8_t buildDepth : m_acceleratorTuning.m_buildDepths)
+        {
+            bufWrite.AppendByte(buildDepth);
+        }
+        bufWrite.AppendUint32(static_cast<unsigned int>(m_acceleratorTuning.m_numObjects));
+        bufWrite.AppendUint32(static_cast<unsigned int>(m_acceleratorTuning.m_numRays));
+        bufWrite.AppendFloat(m_acceleratorTuning.m_bestTimeMs);
+        EndChunk(idx);
+    }
+
+    // --- Chunks 0x89/0x8A: Shape prototypes and instances (custom) ---
+    // Prototype vertices are in local space; an instance is a prototype index plus its transform
+    if (!m_instancedScene.IsEmpty())
+    {
+        size_t idx = BeginChunk(0x89);
+        bufWrite.AppendUshort(static_cast<unsigned short>(m_instancedScene.GetNumPrototypes()));
+        for (int p = 0; p < m_instancedScene.GetNumPrototypes(); ++p)
+        {
+            std::span<Vec2 const> verts = m_instancedScene.GetPrototype(p).GetVertices();
+            bufWrite.AppendByte(static_cast<uint8_t>(verts.size()));
+            for (Vec2 const& v : verts)
+            {
+                bufWrite.AppendVec2(v);
+            }
+        }
+        EndChunk(idx);
+
+        idx = BeginChunk(0x8A);
+        bufWrite.AppendUint32(static_cast<unsigned int>(m_instancedScene.GetNumInstances()));
+        for (int i = 0; i < m_instancedScene.GetNumInstances(); ++i)
+        {
+            ShapeInstance const& instance = m_instancedScene.GetInstance(i);
+            bufWrite.AppendUshort(static_cast<unsigned short>(instance.m_prototypeId));
+            bufWrite.AppendVec2(instance.m_position);
+            bufWrite.AppendFloat(instance.GetOrientationDegrees());
+            bufWrite.AppendFloat(instance.m_scale);
+        }
+        EndChunk(idx);
+    }
+
+    // --- Chunk 0x8B: Query category masks (custom) ---
+    // One mask per convex in ConvexPolys order; skipped while every convex is in the default category
+    bool hasCategories = std::any_of(m_convexes.begin(), m_convexes.end(), [](Convex2 const* convex) { return convex->m_categoryMask != QUERY_CATEGORY_DEFAULT; });
+    if (hasCategories)
+    {
+        size_t idx = BeginChunk(0x8B);
+        bufWrite.AppendUint32(static_cast<unsigned int>(m_convexes.size()));
+        for (Convex2 const* convex : m_convexes)
+        {
+            bufWrite.AppendUshort(convex->m_categoryMask);
+        }
+        EndChunk(idx);
+    }
+
     // --- Write preserved unrecognized chunks (if scene unmodified) ---
     if (!m_sceneModified)
     {
@@ -1576,13 +2884,25 @@ bool Game::LoadSceneFromFile(std::string const& filePath)
     uint16_t recordedNumObjects = static_cast<uint16_t>(-1);
     bool     hasSceneInfo       = false;
     bool     hasConvexPolys     = false;
-    bool     hasConvexHulls     = false;
     bool     hasBoundingDiscs   = false;
     bool     hasBoundingAABBs   = false;
     bool     hasAABB2Tree       = false;
     bool     hasSymQuadTree     = false;
     AABB2Tree              tempAABB2Tree;
     SymmetricQuadTree      tempSymQuadTree;
+    AcceleratorTuning      tempAcceleratorTuning;
+
+    // Instances are resolved once every chunk is read, since the ToC may list them before their prototypes
+    struct ShapeInstanceRecord
+    {
+        uint16_t prototypeId;
+        Vec2     position;
+        float    orientationDegrees;
+        float    scale;
+    };
+    InstancedScene                   tempInstancedScene;
+    std::vector<ShapeInstanceRecord> tempInstanceRecords;
+    std::vector<uint16_t>            tempCategoryMasks;
 
     for (ToCEntry const& entry : tocEntries)
     {
@@ -1658,24 +2978,14 @@ bool Game::LoadSceneFromFile(std::string const& filePath)
                     verts.push_back(bufParse.ParseVec2());
                 }
                 Convex2* newConvex = new Convex2();
-                newConvex->m_convexPoly = ConvexPoly2(verts);
+                newConvex->SetVertices(verts);
                 tempConvexes.push_back(newConvex);
             }
         }
         else if (chunkType == 0x80) // ConvexHulls
         {
-            hasConvexHulls = true;
-            uint16_t numObjects = bufParse.ParseUshort();
-            for (int i = 0; i < static_cast<int>(numObjects) && i < static_cast<int>(tempConvexes.size()); ++i)
-            {
-                uint8_t numPlanes = bufParse.ParseByte();
-                std::vector<Plane2> planes;
-                for (int j = 0; j < static_cast<int>(numPlanes); ++j)
-                {
-                    planes.push_back(bufParse.ParsePlane2());
-                }
-                tempConvexes[i]->m_convexHull = ConvexHull2(planes);
-            }
+            // Edge planes are always rederived from ConvexPolys, so the saved copy is not read;
+            // handled here so it is not preserved as an unrecognized chunk and written twice
         }
         else if (chunkType == 0x81) // BoundingDiscs
         {
@@ -1738,6 +3048,77 @@ bool Game::LoadSceneFromFile(std::string const& filePath)
                 }
             }
         }
+        else if (chunkType == 0x88) // Accelerator tuning (custom)
+        {
+            uint8_t queryMode = bufParse.ParseByte();
+            uint8_t numModes  = bufParse.ParseByte();
+            for (int m = 0; m < static_cast<int>(numModes); ++m)
+            {
+                uint8_t buildDepth = bufParse.ParseByte();
+                if (m < static_cast<int>(eQueryMode::COUNT))
+                {
+                    tempAcceleratorTuning.m_buildDepths[m] = buildDepth;
+                }
+            }
+            tempAcceleratorTuning.m_numObjects = static_cast<int>(bufParse.ParseUint32());
+            tempAcceleratorTuning.m_numRays    = static_cast<int>(bufParse.ParseUint32());
+            tempAcceleratorTuning.m_bestTimeMs = bufParse.ParseFloat();
+
+            // A mode written by a build with more accelerators than this one is ignored; the scene is retuned
+            if (queryMode < static_cast<uint8_t>(eQueryMode::COUNT))
+            {
+                tempAcceleratorTuning.m_queryMode = static_cast<eQueryMode>(queryMode);
+                tempAcceleratorTuning.m_isValid   = true;
+            }
+        }
+        else if (chunkType == 0x89) // Shape prototypes (custom)
+        {
+            uint16_t numPrototypes = bufParse.ParseUshort();
+            for (int p = 0; p < static_cast<int>(numPrototypes); ++p)
+            {
+                uint8_t numVerts = bufParse.ParseByte();
+                if (numVerts < 3)
+                {
+                    g_devConsole->AddLine(DevConsole::ERROR, Stringf("Error: Shape prototype %d has %d vertices", p, static_cast<int>(numVerts)));
+                    for (Convex2* c : tempConvexes) delete c;
+                    return false;
+                }
+                std::vector<Vec2> verts;
+                for (int j = 0; j < static_cast<int>(numVerts); ++j)
+                {
+                    verts.push_back(bufParse.ParseVec2());
+                }
+                tempInstancedScene.AddPrototype(verts);
+            }
+        }
+        else if (chunkType == 0x8A) // Shape instances (custom)
+        {
+            unsigned int numInstances = bufParse.ParseUint32();
+            for (unsigned int i = 0; i < numInstances; ++i)
+            {
+                ShapeInstanceRecord record;
+                record.prototypeId        = bufParse.ParseUshort();
+                record.position           = bufParse.ParseVec2();
+                record.orientationDegrees = bufParse.ParseFloat();
+                record.scale              = bufParse.ParseFloat();
+                tempInstanceRecords.push_back(record);
+            }
+        }
+        else if (chunkType == 0x8B) // Query category masks (custom)
+        {
+            unsigned int numMasks = bufParse.ParseUint32();
+            if (static_cast<size_t>(numMasks) * sizeof(uint16_t) > static_cast<size_t>(dataSize))
+            {
+                g_devConsole->AddLine(DevConsole::ERROR, Stringf("Error: Category chunk claims %u masks in %u bytes", numMasks, dataSize));
+                for (Convex2* c : tempConvexes) delete c;
+                return false;
+            }
+            tempCategoryMasks.resize(numMasks);
+            for (unsigned int i = 0; i < numMasks; ++i)
+            {
+                tempCategoryMasks[i] = bufParse.ParseUshort();
+            }
+        }
         else
         {
             // Unknown chunk — skip past private data for now; raw bytes captured after ENDC verification
@@ -1774,7 +3155,8 @@ bool Game::LoadSceneFromFile(std::string const& filePath)
 
         // Preserve unknown chunks as raw bytes (complete: header + data + footer)
         if (chunkType != 0x01 && chunkType != 0x02 && chunkType != 0x80 &&
-            chunkType != 0x81 && chunkType != 0x82)
+            chunkType != 0x81 && chunkType != 0x82 && chunkType != 0x88 &&
+            chunkType != 0x89 && chunkType != 0x8A && chunkType != 0x8B)
         {
             UnrecognizedChunk preserved;
             preserved.chunkType  = chunkType;
@@ -1797,26 +3179,57 @@ bool Game::LoadSceneFromFile(std::string const& filePath)
         for (Convex2* c : tempConvexes) delete c;
         return false;
     }
-
-    // --- Regenerate missing optional data ---
-    for (Convex2* convex : tempConvexes)
+    for (ShapeInstanceRecord const& record : tempInstanceRecords)
+    {
+        if (record.prototypeId >= tempInstancedScene.GetNumPrototypes())
+        {
+            g_devConsole->AddLine(DevConsole::ERROR, Stringf("Error: Shape instance refers to missing prototype %d", static_cast<int>(record.prototypeId)));
+            for (Convex2* c : tempConvexes) delete c;
+            return false;
+        }
+        if (!(record.scale > 0.f))
+        {
+            g_devConsole->AddLine(DevConsole::ERROR, Stringf("Error: Shape instance has scale %f", record.scale));
+            for (Convex2* c : tempConvexes) delete c;
+            return false;
+        }
+        tempInstancedScene.AddInstance(record.prototypeId, record.position, record.orientationDegrees, record.scale);
+    }
+    tempInstancedScene.BuildTree();
+    if (!tempCategoryMasks.empty())
     {
-        // Rebuild hull from poly if not loaded
-        if (!hasConvexHulls || convex->m_convexHull.m_boundingPlanes.empty())
+        if (tempCategoryMasks.size() != tempConvexes.size())
         {
-            convex->m_convexHull = ConvexHull2(convex->m_convexPoly);
+            g_devConsole->AddLine(DevConsole::ERROR, Stringf("Error: %d category masks for %d convexes", static_cast<int>(tempCategoryMasks.size()), static_cast<int>(tempConvexes.size())));
+            for (Convex2* c : tempConvexes) delete c;
+            return false;
         }
-
-        // Rebuild bounding volumes if not loaded
-        if (!hasBoundingDiscs || !hasBoundingAABBs)
+        for (size_t i = 0; i < tempConvexes.size(); ++i)
         {
-            convex->RebuildBoundingVolumes();
+            tempConvexes[i]->m_categoryMask = tempCategoryMasks[i];
         }
     }
 
+    // --- Regenerate missing optional data ---
+    // Each convex is independent, so large scenes regenerate on the task scheduler
+    ParallelFor(0, static_cast<int>(tempConvexes.size()), CONVEXES_PER_TASK, [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            Convex2* convex = tempConvexes[i];
+
+            // Rebuild bounding volumes if not loaded
+            if (!hasBoundingDiscs || !hasBoundingAABBs)
+            {
+                convex->RebuildBoundingVolumes();
+            }
+        }
+    });
+
     // --- Replace current scene ---
     ClearScene();
     m_convexes         = tempConvexes;
+    m_instancedScene   = std::move(tempInstancedScene);
     m_preservedChunks  = tempPreservedChunks;
     m_sceneModified    = false;
 
@@ -1849,6 +3262,7 @@ bool Game::LoadSceneFromFile(std::string const& filePath)
     }
 
     // --- Restore or rebuild spatial acceleration structures ---
+    AssignConvexObjectIds();
     if (hasAABB2Tree)
     {
         m_AABB2Tree = std::move(tempAABB2Tree);
@@ -1857,25 +3271,39 @@ bool Game::LoadSceneFromFile(std::string const& filePath)
     {
         m_symQuadTree = std::move(tempSymQuadTree);
     }
+    m_acceleratorTuning = tempAcceleratorTuning;
+    ApplyAcceleratorTuning();
     if (!hasAABB2Tree || !hasSymQuadTree)
     {
         // Rebuild any trees not loaded from file
         AABB2 totalBounds(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y));
-        int numConvexes = static_cast<int>(m_convexes.size());
-        int bvhDepth = 0;
-        if (numConvexes > 0)
-        {
-            bvhDepth = static_cast<int>(log2(static_cast<double>(numConvexes))) - 3;
-            if (bvhDepth < 3) bvhDepth = 3;
-        }
         if (!hasAABB2Tree)
         {
-            m_AABB2Tree.BuildTree(m_convexes, bvhDepth, totalBounds);
+            m_AABB2Tree.Build(m_convexes, totalBounds);
         }
         if (!hasSymQuadTree)
         {
-            m_symQuadTree.BuildTree(m_convexes, 4, totalBounds);
+            m_symQuadTree.Build(m_convexes, totalBounds);
         }
     }
+
+    // Saved trees carry no category masks; derive them from the loaded objects
+    if (hasAABB2Tree)
+    {
+        m_AABB2Tree.UpdateCategoryMasks();
+    }
+    if (hasSymQuadTree)
+    {
+        m_symQuadTree.UpdateCategoryMasks();
+    }
+
+    // Not saved; loaded objects start out static
+    m_partitionedTree.Build(m_convexes, AABB2(Vec2(0.f, 0.f), Vec2(WORLD_SIZE_X, WORLD_SIZE_Y)));
+
+    // --- Scenes saved without tuning are tuned once on load; saving then keeps the result ---
+    if (!m_acceleratorTuning.m_isValid)
+    {
+        TuneAccelerators(AcceleratorTunerConfig());
+    }
     return true;
 }
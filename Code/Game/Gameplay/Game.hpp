@@ -7,20 +7,33 @@
 //----------------------------------------------------------------------------------------------------
 #include "Engine/Core/EventSystem.hpp"
 #include "Engine/Math/Vec2.hpp"
+#include "Game/Framework/FrameArena.hpp"
+#include "Game/Gameplay/AcceleratorTuner.hpp"
+#include "Game/Gameplay/AsyncQuery.hpp"
 #include "Game/Gameplay/BVH.hpp"
+#include "Game/Gameplay/DistanceField.hpp"
+#include "Game/Gameplay/FrameQueryScheduler.hpp"
+#include "Game/Gameplay/InstancedScene.hpp"
+#include "Game/Gameplay/MotionSimulation.hpp"
+#include "Game/Gameplay/OccupancyGrid.hpp"
+#include "Game/Gameplay/OverlapPairs.hpp"
+#include "Game/Gameplay/PartitionedTree.hpp"
 #include "Game/Gameplay/QuadTree.hpp"
+#include "Game/Gameplay/QueryServer.hpp"
+#include "Game/Gameplay/RayQueryCache.hpp"
 //----------------------------------------------------------------------------------------------------
 #include <cstdint>
+#include <span>
 #include <vector>
 
 struct Rgba8;
-struct ConvexPoly2;
 struct Vertex_PCU;
 struct Vec2;
 //-Forward-Declaration--------------------------------------------------------------------------------
 class Camera;
 class Clock;
 struct Convex2;
+struct SceneQueryView;
 
 //----------------------------------------------------------------------------------------------------
 enum class eGameState : int8_t
@@ -60,6 +73,7 @@ public:
     void       SetGameState(eGameState newState);
     bool       IsAttractState() const;
     bool       IsGameState() const;
+    bool       IsQueryServerRunning() const;
 
 private:
     //------------------------------------------------------------------------------------------------
@@ -68,6 +82,19 @@ private:
     static bool OnGameStateChanged(EventArgs& args);
     static bool SaveConvexSceneCommand(EventArgs& args);
     static bool LoadConvexSceneCommand(EventArgs& args);
+    static bool FindOverlapPairsCommand(EventArgs& args);
+    static bool TuneAcceleratorsCommand(EventArgs& args);
+    static bool StartQueryServerCommand(EventArgs& args);
+    static bool StopQueryServerCommand(EventArgs& args);
+    static bool QueryLoadTestCommand(EventArgs& args);
+    static bool AsyncQueryTestCommand(EventArgs& args);
+    static bool QueryBudgetCommand(EventArgs& args);
+    static bool BudgetedRaysCommand(EventArgs& args);
+    static bool SpawnInstancesCommand(EventArgs& args);
+    static bool TagDynamicCommand(EventArgs& args);
+    static bool SetQueryFilterCommand(EventArgs& args);
+    static bool TagCategoryCommand(EventArgs& args);
+    static bool SimulateMotionCommand(EventArgs& args);
 
     //------------------------------------------------------------------------------------------------
     // Update
@@ -75,6 +102,7 @@ private:
     void UpdateGame();
     void UpdateTime() const;
     void UpdateWindow() const;
+    void AddHudLine(int& inout_lineIndex, Rgba8 const& color, char const* format, ...);
 
     //------------------------------------------------------------------------------------------------
     // Render
@@ -85,13 +113,28 @@ private:
     //------------------------------------------------------------------------------------------------
     // Convex generation
     //------------------------------------------------------------------------------------------------
-    static Convex2* CreateRandomConvex(Vec2 const& center, float minRadius, float maxRadius);
+    static FrameVector<Vec2> RollRandomConvexVertices(Vec2 const& center, float minRadius, float maxRadius);
+    static Convex2*          CreateRandomConvex(Vec2 const& center, float minRadius, float maxRadius);
+    void                     SpawnRandomConvexes(int numConvexes);
+    void                     SpawnRandomInstances(int numPrototypes, int numInstances);
 
     //------------------------------------------------------------------------------------------------
     // Scene management
     //------------------------------------------------------------------------------------------------
     void RebuildAllTrees();
+    void RefitAllTrees();
+    void AssignConvexObjectIds();
     void ClearScene();
+    SceneQueryView GetSceneQueryView() const;
+    void OnHoveringConvexEdited(AABB2 const& boundsBefore);
+    void OnConvexesMoved(std::span<int const> movedObjectIds, std::span<AABB2 const> boundsBefore);
+    void InvalidateSceneCaches();
+    void OnCategoriesChanged();
+    void TuneAccelerators(AcceleratorTunerConfig const& config);
+    void ApplyAcceleratorTuning();
+    void RunAsyncQueryTest(int numRays, int numScripts, AsyncQueryConfig const& config);
+    void UpdateBudgetedRays();
+    void UpdateMotionSimulation(float deltaSeconds);
 
     //------------------------------------------------------------------------------------------------
     // Interaction
@@ -101,9 +144,14 @@ private:
     //------------------------------------------------------------------------------------------------
     // Rendering helpers
     //------------------------------------------------------------------------------------------------
-    void AddVertsForConvexPolyEdges(std::vector<Vertex_PCU>& verts, ConvexPoly2 const& convexPoly2, float thickness, Rgba8 const& color) const;
+    void AddVertsForConvexFill(std::vector<Vertex_PCU>& verts, Convex2 const& convex, Rgba8 const& color) const;
+    void AddVertsForConvexFill(std::vector<Vertex_PCU>& verts, std::span<Vec2 const> points, Rgba8 const& color) const;
+    void AddVertsForConvexEdges(std::vector<Vertex_PCU>& verts, Convex2 const& convex, float thickness, Rgba8 const& color) const;
+    void AddVertsForConvexEdges(std::vector<Vertex_PCU>& verts, std::span<Vec2 const> points, float thickness, Rgba8 const& color) const;
+    void AddVertsForInstances(std::vector<Vertex_PCU>& verts, float edgeThickness, Rgba8 const& fillColor, Rgba8 const& edgeColor) const;
     void RenderRaycast(std::vector<Vertex_PCU>& verts) const;
     void TestRays();
+    void VerifyRefitAfterDrag();
 
     //------------------------------------------------------------------------------------------------
     // Binary test validation
@@ -135,7 +183,7 @@ private:
     bool     m_showBoundingDiscs = false;
     bool     m_showSpatialStructure = false;
     bool     m_debugDrawBVHMode     = false;
-    int      m_rayOptimizationMode = 0; // 0=None, 1=Disc, 2=AABB
+    int      m_rayOptimizationMode = 0; // Index into SceneAccelerators (F9 cycles)
 
     // Random generation
     unsigned int m_seed = 1;
@@ -144,18 +192,79 @@ private:
     Vec2 m_rayStart;
     Vec2 m_rayEnd;
     int  m_numOfRandomRays = 1024;
+    QueryFilter m_rayTestFilter; // Applied to TestRays and the interactive ray (SetQueryFilter)
 
     // Performance metrics
     float m_avgDist                      = 0.f;
-    float m_lastRayTestNormalTime        = 0.f;
-    float m_lastRayTestDiscRejectionTime = 0.f;
-    float m_lastRayTestAABBRejectionTime = 0.f;
-    float m_lastRayTestSymmetricTreeTime = 0.f;
-    float m_lastRayTestAABBTreeTime      = 0.f;
+    float m_lastRayTestTimes[static_cast<int>(eQueryMode::COUNT)] = {}; // Indexed by accelerator / query mode
+    float m_lastRayTestParallelTime      = 0.f;
+    float m_lastDistanceFieldBakeTime    = 0.f;
+    float m_lastRayTestSphereTraceTime   = 0.f;
+    float m_lastSphereTraceAgreement     = 0.f; // Percent of rays matching the exact result
+    float m_lastRayTestCacheColdTime     = 0.f;
+    float m_lastRayTestCacheWarmTime     = 0.f;
+    float m_lastRayTestHintColdTime      = 0.f;
+    float m_lastRayTestHintWarmTime      = 0.f;
+    float m_lastOccupancyRasterTime      = 0.f;
+    float m_lastRayTestOccupancyTime     = 0.f;
+    float m_lastFanTestBVHTime           = 0.f;
+    float m_lastFanTestAngularTime       = 0.f;
+    float m_lastRayTestInstancedTime     = 0.f;
+
+    // Repeated content as prototypes plus transforms under its own top-level BVH (chunks 0x89/0x8A);
+    // queried by TestRays alongside the convexes but invisible to the other scene systems
+    InstancedScene m_instancedScene;
 
     // Spatial structures
     SymmetricQuadTree m_symQuadTree;
     AABB2Tree         m_AABB2Tree;
+    PartitionedTree   m_partitionedTree; // Edited objects are demoted to its dynamic tree
+
+    // Moves a fraction of the convexes every frame and times each accelerator keeping up with them
+    // (SimulateMotion); it points at the convexes, so deleting any stops it
+    MotionSimulation m_motionSimulation;
+
+    // Accelerator and tree depths picked for this scene (saved in chunk 0x88); the tuner replays a
+    // subsample of the last TestRays batch, or random rays when nothing was recorded yet
+    AcceleratorTuning  m_acceleratorTuning;
+    std::vector<Vec2>  m_recordedRayStartPos;
+    std::vector<Vec2>  m_recordedRayForwardNormal;
+    std::vector<float> m_recordedRayMaxDist;
+
+    // Scene-wide overlap pairs (content validation / contacts)
+    OverlapPairFinder       m_overlapPairFinder;
+    std::vector<ConvexPair> m_overlapPairs;
+    bool                    m_trackOverlapPairs = false; // Set once pairs were requested; edits then update incrementally
+
+    // Single queries from gameplay code, batched behind futures; flushed at the end of every Update
+    AsyncSceneQueries m_asyncQueries;
+
+    // Prioritized queries run within a per-frame budget after UpdateGame; BudgetedRays feeds it a
+    // TestRays-sized workload to spread over as many frames as the budget needs
+    FrameQueryScheduler                     m_frameQueries;
+    std::vector<QueryFuture<ClosestRayHit>> m_budgetedRayFutures;
+    double                                  m_budgetedRayStartTime  = 0.0;
+    int                                     m_budgetedRayStartFrame = 0;
+    int                                     m_frameCount            = 0;
+
+    // Serves a saved scene to other local processes; it keeps its own copy, so edits here don't affect it
+    QueryServer m_queryServer;
+
+    // Signed distance field, baked by TestRays and rebaked over dirty tiles after edits
+    SceneDistanceField m_distanceField;
+
+    // Bit-per-cell occupancy raster for fast conservative line of sight, patched on edits
+    SceneOccupancyGrid m_occupancyGrid;
+
+    // Closest-hit cache for repeated probes; edits invalidate only the rays they can affect
+    RayQueryCache m_rayQueryCache;
+
+    // Vertex lists rebuilt every frame; they keep their capacity so steady frames do not allocate
+    mutable std::vector<Vertex_PCU>              m_renderVerts;
+    mutable std::vector<std::vector<Vertex_PCU>> m_renderChunkVerts;
+
+    // HUD text, one string per screen line, reformatted in place every frame (AddHudLine)
+    std::vector<String> m_hudLines;
 
     // Loaded scene state (for letterbox/pillarbox rendering)
     AABB2 m_loadedSceneBounds;
@@ -0,0 +1,359 @@
+//----------------------------------------------------------------------------------------------------
+// InstancedScene.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/InstancedScene.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/MathUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int INSTANCE_TREE_LEAF_SIZE = 4;
+
+//----------------------------------------------------------------------------------------------------
+float ShapeInstance::GetOrientationDegrees() const
+{
+	return Atan2Degrees(m_rotation.y, m_rotation.x);
+}
+
+//----------------------------------------------------------------------------------------------------
+// AddPrototype - Returns the new prototype's id; its vertices are in the space instances transform from
+//----------------------------------------------------------------------------------------------------
+int InstancedScene::AddPrototype(std::span<Vec2 const> localCcwVertices)
+{
+	m_prototypes.emplace_back(localCcwVertices);
+	m_prototypes.back().m_objectId = static_cast<int>(m_prototypes.size()) - 1;
+	return m_prototypes.back().m_objectId;
+}
+
+//----------------------------------------------------------------------------------------------------
+// AddInstance - Returns the new instance's index, which is also its object id in query results
+//----------------------------------------------------------------------------------------------------
+int InstancedScene::AddInstance(int prototypeId, Vec2 const& position, float orientationDegrees, float scale)
+{
+	ShapeInstance instance;
+	instance.m_position    = position;
+	instance.m_rotation    = Vec2(CosDegrees(orientationDegrees), SinDegrees(orientationDegrees));
+	instance.m_scale       = scale;
+	instance.m_prototypeId = prototypeId;
+	m_instances.push_back(instance);
+	return static_cast<int>(m_instances.size()) - 1;
+}
+
+//----------------------------------------------------------------------------------------------------
+void InstancedScene::Clear()
+{
+	m_prototypes.clear();
+	m_instances.clear();
+	m_nodes.clear();
+	m_leafInstanceIds.clear();
+	m_leafBounds.clear();
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetInstanceBounds - Exact world bounds of the transformed prototype
+//----------------------------------------------------------------------------------------------------
+AABB2 InstancedScene::GetInstanceBounds(int instanceIndex) const
+{
+	ShapeInstance const&  instance = m_instances[instanceIndex];
+	std::span<Vec2 const> verts    = m_prototypes[instance.m_prototypeId].GetVertices();
+
+	Vec2 first = instance.LocalToWorld(verts[0]);
+	AABB2 bounds(first, first);
+	for (int i = 1; i < static_cast<int>(verts.size()); ++i)
+	{
+		Vec2 world = instance.LocalToWorld(verts[i]);
+		bounds.m_mins.x = std::min(bounds.m_mins.x, world.x);
+		bounds.m_mins.y = std::min(bounds.m_mins.y, world.y);
+		bounds.m_maxs.x = std::max(bounds.m_maxs.x, world.x);
+		bounds.m_maxs.y = std::max(bounds.m_maxs.y, world.y);
+	}
+	return bounds;
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetInstanceVertices - World-space CCW vertices, for rendering and export; a uniform scale and a
+// rotation keep the winding
+//----------------------------------------------------------------------------------------------------
+void InstancedScene::GetInstanceVertices(int instanceIndex, std::span<Vec2> out_worldVertices) const
+{
+	ShapeInstance const&  instance = m_instances[instanceIndex];
+	std::span<Vec2 const> verts    = m_prototypes[instance.m_prototypeId].GetVertices();
+	for (int i = 0; i < static_cast<int>(verts.size()); ++i)
+	{
+		out_worldVertices[i] = instance.LocalToWorld(verts[i]);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// BuildTree - Top-level BVH over instance bounds, split at the median center along the wider axis
+//----------------------------------------------------------------------------------------------------
+void InstancedScene::BuildTree()
+{
+	int numInstances = GetNumInstances();
+	m_nodes.clear();
+	m_leafInstanceIds.resize(numInstances);
+	m_leafBounds.resize(numInstances);
+	if (numInstances == 0)
+	{
+		return;
+	}
+
+	std::vector<AABB2> instanceBounds(numInstances);
+	std::vector<Vec2>  centers(numInstances);
+	for (int i = 0; i < numInstances; ++i)
+	{
+		m_leafInstanceIds[i] = i;
+		instanceBounds[i]    = GetInstanceBounds(i);
+		centers[i]           = instanceBounds[i].GetCenter();
+	}
+
+	m_nodes.reserve(2 * (numInstances / INSTANCE_TREE_LEAF_SIZE + 1));
+	m_nodes.emplace_back();
+	BuildNode(0, 0, numInstances, instanceBounds, centers);
+
+	for (int i = 0; i < numInstances; ++i)
+	{
+		m_leafBounds[i] = instanceBounds[m_leafInstanceIds[i]];
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void InstancedScene::BuildNode(int nodeIndex, int first, int count, std::span<AABB2 const> instanceBounds, std::span<Vec2 const> centers)
+{
+	AABB2 bounds       = instanceBounds[m_leafInstanceIds[first]];
+	AABB2 centerBounds(centers[m_leafInstanceIds[first]], centers[m_leafInstanceIds[first]]);
+	for (int i = first + 1; i < first + count; ++i)
+	{
+		AABB2 const& box    = instanceBounds[m_leafInstanceIds[i]];
+		Vec2 const&  center = centers[m_leafInstanceIds[i]];
+		bounds.m_mins.x       = std::min(bounds.m_mins.x, box.m_mins.x);
+		bounds.m_mins.y       = std::min(bounds.m_mins.y, box.m_mins.y);
+		bounds.m_maxs.x       = std::max(bounds.m_maxs.x, box.m_maxs.x);
+		bounds.m_maxs.y       = std::max(bounds.m_maxs.y, box.m_maxs.y);
+		centerBounds.m_mins.x = std::min(centerBounds.m_mins.x, center.x);
+		centerBounds.m_mins.y = std::min(centerBounds.m_mins.y, center.y);
+		centerBounds.m_maxs.x = std::max(centerBounds.m_maxs.x, center.x);
+		centerBounds.m_maxs.y = std::max(centerBounds.m_maxs.y, center.y);
+	}
+	m_nodes[nodeIndex].m_bounds = bounds;
+
+	if (count <= INSTANCE_TREE_LEAF_SIZE)
+	{
+		m_nodes[nodeIndex].m_first        = first;
+		m_nodes[nodeIndex].m_numInstances = count;
+		return;
+	}
+
+	Vec2 extent = centerBounds.GetDimensions();
+	bool splitX = extent.x >= extent.y;
+	int  middle = first + count / 2;
+	std::nth_element(m_leafInstanceIds.begin() + first, m_leafInstanceIds.begin() + middle, m_leafInstanceIds.begin() + first + count, [&](int a, int b)
+	{
+		return splitX ? centers[a].x < centers[b].x : centers[a].y < centers[b].y;
+	});
+
+	int leftChild = static_cast<int>(m_nodes.size());
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+	m_nodes[nodeIndex].m_first        = leftChild;
+	m_nodes[nodeIndex].m_numInstances = 0;
+	BuildNode(leftChild, first, middle - first, instanceBounds, centers);
+	BuildNode(leftChild + 1, middle, first + count - middle, instanceBounds, centers);
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetInstanceRayPenetration - Narrow phase in prototype space. The scale is uniform, so the ray's
+// direction stays unit length and distances only need scaling back.
+//----------------------------------------------------------------------------------------------------
+bool InstancedScene::GetInstanceRayPenetration(RayPenetration& out_penetration, int instanceIndex, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const
+{
+	ShapeInstance const& instance = m_instances[instanceIndex];
+	Vec2 localStart   = instance.WorldToLocal(startPos);
+	Vec2 localForward = instance.RotateToLocal(forwardNormal);
+	if (!m_prototypes[instance.m_prototypeId].GetRayPenetration(out_penetration, localStart, localForward, maxDist / instance.m_scale))
+	{
+		return false;
+	}
+
+	out_penetration.m_entryDist   *= instance.m_scale;
+	out_penetration.m_exitDist    *= instance.m_scale;
+	out_penetration.m_entryNormal  = instance.RotateToWorld(out_penetration.m_entryNormal);
+	out_penetration.m_exitNormal   = instance.RotateToWorld(out_penetration.m_exitNormal);
+	out_penetration.m_objectId     = instanceIndex;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RaycastClosest - Near-to-far traversal; the best hit so far prunes both nodes and leaf boxes
+//----------------------------------------------------------------------------------------------------
+bool InstancedScene::RaycastClosest(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	float rootEntry = 0.f;
+	if (m_nodes.empty() || !GetRayEntryDistVsAABB2D(rootEntry, startPos, forwardNormal, std::min(maxDist, inout_best.m_dist), m_nodes[0].m_bounds))
+	{
+		return inout_best.m_objectId != -1;
+	}
+	stack.push_back({0, rootEntry});
+
+	RayPenetration penetration;
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		float searchDist = std::min(maxDist, inout_best.m_dist);
+		if (entry.m_entryDist > searchDist)
+		{
+			continue;
+		}
+
+		InstanceTreeNode const& node = m_nodes[entry.m_nodeIndex];
+		if (node.m_numInstances > 0)
+		{
+			for (int i = node.m_first; i < node.m_first + node.m_numInstances; ++i)
+			{
+				float boxEntry = 0.f;
+				if (GetRayEntryDistVsAABB2D(boxEntry, startPos, forwardNormal, searchDist, m_leafBounds[i]) &&
+					GetInstanceRayPenetration(penetration, m_leafInstanceIds[i], startPos, forwardNormal, searchDist) &&
+					penetration.m_entryDist < inout_best.m_dist)
+				{
+					inout_best.m_dist     = penetration.m_entryDist;
+					inout_best.m_objectId = penetration.m_objectId;
+					inout_best.m_normal   = penetration.m_entryNormal;
+					searchDist            = std::min(maxDist, inout_best.m_dist);
+				}
+			}
+			continue;
+		}
+
+		float leftEntry  = 0.f;
+		float rightEntry = 0.f;
+		bool  hitsLeft   = GetRayEntryDistVsAABB2D(leftEntry, startPos, forwardNormal, searchDist, m_nodes[node.m_first].m_bounds);
+		bool  hitsRight  = GetRayEntryDistVsAABB2D(rightEntry, startPos, forwardNormal, searchDist, m_nodes[node.m_first + 1].m_bounds);
+
+		// Push the farther child first so the nearer one is processed next
+		if (hitsLeft && hitsRight && leftEntry < rightEntry)
+		{
+			stack.push_back({node.m_first + 1, rightEntry});
+			stack.push_back({node.m_first, leftEntry});
+		}
+		else
+		{
+			if (hitsLeft)  stack.push_back({node.m_first, leftEntry});
+			if (hitsRight) stack.push_back({node.m_first + 1, rightEntry});
+		}
+	}
+	return inout_best.m_objectId != -1;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool InstancedScene::RaycastAny(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, QueryScratch& scratch) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	if (!m_nodes.empty())
+	{
+		stack.push_back({0, 0.f});
+	}
+
+	RayPenetration penetration;
+	while (!stack.empty())
+	{
+		InstanceTreeNode const& node = m_nodes[stack.back().m_nodeIndex];
+		stack.pop_back();
+
+		float entryDist = 0.f;
+		if (!GetRayEntryDistVsAABB2D(entryDist, startPos, forwardNormal, maxDist, node.m_bounds))
+		{
+			continue;
+		}
+		if (node.m_numInstances == 0)
+		{
+			stack.push_back({node.m_first, 0.f});
+			stack.push_back({node.m_first + 1, 0.f});
+			continue;
+		}
+		for (int i = node.m_first; i < node.m_first + node.m_numInstances; ++i)
+		{
+			if (GetRayEntryDistVsAABB2D(entryDist, startPos, forwardNormal, maxDist, m_leafBounds[i]) &&
+				GetInstanceRayPenetration(penetration, m_leafInstanceIds[i], startPos, forwardNormal, maxDist))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------------------------------
+int InstancedScene::RaycastBatch(RayBatch const& rays, RayHitBatch const& out_hits) const
+{
+	QueryScratch& scratch = QueryScratch::GetForThisThread();
+	int           numHits = 0;
+	for (int j = 0; j < rays.GetNumRays(); ++j)
+	{
+		ClosestRayHit best;
+		if (RaycastClosest(rays.m_startPositions[j], rays.m_forwardNormals[j], rays.m_maxDists[j], scratch, best))
+		{
+			++numHits;
+		}
+		out_hits.m_impactDists[j]     = best.m_dist;
+		out_hits.m_impactObjectIds[j] = best.m_objectId;
+		out_hits.m_impactNormals[j]   = best.m_normal;
+	}
+	return numHits;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t InstancedScene::GetMemoryBytes() const
+{
+	size_t bytes = m_prototypes.capacity() * sizeof(Convex2);
+	for (Convex2 const& prototype : m_prototypes)
+	{
+		bytes += prototype.GetMemoryBytes() - sizeof(Convex2);
+	}
+	bytes += m_instances.capacity() * sizeof(ShapeInstance);
+	bytes += m_nodes.capacity() * sizeof(InstanceTreeNode);
+	bytes += m_leafInstanceIds.capacity() * sizeof(int);
+	bytes += m_leafBounds.capacity() * sizeof(AABB2);
+	return bytes;
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetFlattenedMemoryBytes - What the scene's own list would hold for the same content: a pointer and
+// a Convex2 with its own vertices and normals per instance, not counting its tree references
+//----------------------------------------------------------------------------------------------------
+size_t InstancedScene::GetFlattenedMemoryBytes() const
+{
+	size_t bytes = 0;
+	for (ShapeInstance const& instance : m_instances)
+	{
+		bytes += sizeof(Convex2*) + sizeof(Convex2) + 2 * m_prototypes[instance.m_prototypeId].GetVertices().size() * sizeof(Vec2);
+	}
+	return bytes;
+}
+
+//----------------------------------------------------------------------------------------------------
+AcceleratorStats InstancedScene::GetStats() const
+{
+	AcceleratorStats stats;
+	stats.m_numNodes = static_cast<int>(m_nodes.size());
+	for (InstanceTreeNode const& node : m_nodes)
+	{
+		if (node.m_numInstances > 0)
+		{
+			++stats.m_numLeaves;
+			stats.m_numObjectRefs += node.m_numInstances;
+			stats.m_maxLeafObjects = std::max(stats.m_maxLeafObjects, node.m_numInstances);
+		}
+	}
+	return stats;
+}
@@ -0,0 +1,98 @@
+//----------------------------------------------------------------------------------------------------
+// InstancedScene.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct ClosestRayHit;
+struct RayBatch;
+struct RayHitBatch;
+struct RayPenetration;
+
+//----------------------------------------------------------------------------------------------------
+// ShapeInstance - One placement of a prototype: rotate and uniformly scale about the prototype's
+// origin, then move to m_position
+//----------------------------------------------------------------------------------------------------
+struct ShapeInstance
+{
+	Vec2  m_position;
+	Vec2  m_rotation    = Vec2(1.f, 0.f); // (cos, sin) of the orientation
+	float m_scale       = 1.f;
+	int   m_prototypeId = -1;
+
+	Vec2  RotateToWorld(Vec2 const& dir) const { return Vec2(dir.x * m_rotation.x - dir.y * m_rotation.y, dir.x * m_rotation.y + dir.y * m_rotation.x); }
+	Vec2  RotateToLocal(Vec2 const& dir) const { return Vec2(dir.x * m_rotation.x + dir.y * m_rotation.y, dir.y * m_rotation.x - dir.x * m_rotation.y); }
+	Vec2  LocalToWorld(Vec2 const& point) const { return m_position + RotateToWorld(point) * m_scale; }
+	Vec2  WorldToLocal(Vec2 const& point) const { return RotateToLocal(point - m_position) / m_scale; }
+	float GetOrientationDegrees() const;
+};
+
+//----------------------------------------------------------------------------------------------------
+// Top-level tree node; a leaf owns m_numInstances entries of the leaf arrays from m_first, an inner
+// node (m_numInstances == 0) has its children at m_first and m_first + 1
+//----------------------------------------------------------------------------------------------------
+struct InstanceTreeNode
+{
+	AABB2 m_bounds;
+	int   m_first        = 0;
+	int   m_numInstances = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+// InstancedScene - Two-level scene for content that repeats a few shapes many times
+//
+// Each prototype is stored once, in its own local space. Instances store only a transform and a
+// prototype id, and a top-level BVH is built over their world bounds. Rays walk the top level in world
+// space and are moved into prototype space for the narrow phase, so a hit costs one transform of the
+// ray rather than a transformed copy of the shape. Hit object ids are instance indices.
+//
+// The layer is separate from the scene's Convex2 list: the accelerators, caches and edits see only
+// that list. BuildTree must be called after instances are added before querying.
+//----------------------------------------------------------------------------------------------------
+class InstancedScene
+{
+public:
+	int  AddPrototype(std::span<Vec2 const> localCcwVertices);
+	int  AddInstance(int prototypeId, Vec2 const& position, float orientationDegrees, float scale);
+	void BuildTree();
+	void Clear();
+
+	bool                 IsEmpty() const { return m_instances.empty(); }
+	int                  GetNumPrototypes() const { return static_cast<int>(m_prototypes.size()); }
+	int                  GetNumInstances() const { return static_cast<int>(m_instances.size()); }
+	Convex2 const&       GetPrototype(int prototypeId) const { return m_prototypes[prototypeId]; }
+	ShapeInstance const& GetInstance(int instanceIndex) const { return m_instances[instanceIndex]; }
+	AABB2                GetInstanceBounds(int instanceIndex) const;
+	void                 GetInstanceVertices(int instanceIndex, std::span<Vec2> out_worldVertices) const; // Sized to the prototype's vertex count
+
+	bool RaycastClosest(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best) const;
+	bool RaycastAny(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, QueryScratch& scratch) const;
+	int  RaycastBatch(RayBatch const& rays, RayHitBatch const& out_hits) const;
+
+	size_t           GetMemoryBytes() const;
+	size_t           GetFlattenedMemoryBytes() const; // The same content as one heap Convex2 per instance
+	AcceleratorStats GetStats() const;
+
+private:
+	bool GetInstanceRayPenetration(RayPenetration& out_penetration, int instanceIndex, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const;
+	void BuildNode(int nodeIndex, int first, int count, std::span<AABB2 const> instanceBounds, std::span<Vec2 const> centers);
+
+	std::vector<Convex2>          m_prototypes;
+	std::vector<ShapeInstance>    m_instances;
+
+	// Top level; the leaf arrays are in tree order so a leaf's bounds are contiguous
+	std::vector<InstanceTreeNode> m_nodes;
+	std::vector<int>              m_leafInstanceIds;
+	std::vector<AABB2>            m_leafBounds;
+};
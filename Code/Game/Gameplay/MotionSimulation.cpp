@@ -0,0 +1,257 @@
+//----------------------------------------------------------------------------------------------------
+// MotionSimulation.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/MotionSimulation.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/Time.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+
+//----------------------------------------------------------------------------------------------------
+// A scan has no structure to maintain, so only its query time is reported
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+constexpr bool IS_BRUTE_FORCE_SCAN = std::is_same_v<T, BruteForceScan<T::QUERY_MODE>>;
+
+//----------------------------------------------------------------------------------------------------
+// Start - Movers are marked dynamic before the accelerators are built, so split trees put them in
+// their dynamic tree from the first tick. They stay marked after Stop.
+//----------------------------------------------------------------------------------------------------
+void MotionSimulation::Start(std::vector<Convex2*> const& convexes, AABB2 const& bounds, MotionSimulationConfig const& config)
+{
+	Stop();
+	m_config   = config;
+	m_convexes = convexes;
+	m_bounds   = bounds;
+	m_rng.seed(config.m_seed);
+	for (auto& modeStats : m_stats)
+	{
+		std::fill(std::begin(modeStats), std::end(modeStats), MotionStrategyStats());
+	}
+	m_lastUpdateTimeMs  = 0.f;
+	m_totalUpdateTimeMs = 0.f;
+	m_numTicks          = 0;
+
+	int const        numConvexes = static_cast<int>(m_convexes.size());
+	int const        numMovers   = std::clamp(static_cast<int>(std::lround(config.m_dynamicFraction * static_cast<float>(numConvexes))), 0, numConvexes);
+	std::vector<int> order(numConvexes);
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), m_rng);
+
+	std::uniform_real_distribution<float> randomAngle(0.f, 6.2831853f);
+	std::uniform_real_distribution<float> randomSpeed(0.f, config.m_maxSpeed);
+	std::uniform_real_distribution<float> randomSpin(-config.m_maxSpinDegrees, config.m_maxSpinDegrees);
+	m_movers.reserve(numMovers);
+	for (int i = 0; i < numMovers; ++i)
+	{
+		float const angle = randomAngle(m_rng);
+		float const speed = randomSpeed(m_rng);
+
+		Mover mover;
+		mover.m_convex      = m_convexes[order[i]];
+		mover.m_velocity    = Vec2(std::cos(angle), std::sin(angle)) * speed;
+		mover.m_spinDegrees = randomSpin(m_rng);
+		mover.m_convex->m_isDynamic = true;
+		m_movers.push_back(mover);
+	}
+
+	SceneAccelerators::ForEach([&]<typename Accelerator>()
+	{
+		std::get<Accelerator>(m_refitAccelerators).Build(m_convexes, m_bounds);
+		std::get<Accelerator>(m_rebuildAccelerators).Build(m_convexes, m_bounds);
+	});
+	m_isRunning = true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Stop - Drops the private accelerators; they hold pointers the caller may be about to delete
+//----------------------------------------------------------------------------------------------------
+void MotionSimulation::Stop()
+{
+	m_isRunning           = false;
+	m_refitAccelerators   = SceneAccelerators::Instances();
+	m_rebuildAccelerators = SceneAccelerators::Instances();
+	m_movers.clear();
+	m_movedObjectIds.clear();
+	m_movedBoundsBefore.clear();
+	m_convexes.clear();
+}
+
+//----------------------------------------------------------------------------------------------------
+// Step - One tick: move, then maintain and query every accelerator. Rolling the rays is not timed.
+//----------------------------------------------------------------------------------------------------
+bool MotionSimulation::Step(float deltaSeconds)
+{
+	if (!m_isRunning || deltaSeconds <= 0.f)
+	{
+		return false;
+	}
+
+	double updateStartTime = GetCurrentTimeSeconds();
+	IntegrateMovers(deltaSeconds);
+	double updateEndTime   = GetCurrentTimeSeconds();
+	m_lastUpdateTimeMs   = static_cast<float>((updateEndTime - updateStartTime) * 1000.0);
+	m_totalUpdateTimeMs += m_lastUpdateTimeMs;
+
+	RollRays();
+	RayBatch    rays{m_rayStartPositions, m_rayForwardNormals, m_rayMaxDists};
+	RayHitBatch hits{m_hitDists, m_hitObjectIds, m_hitNormals};
+
+	SceneAccelerators::ForEach([&]<typename Accelerator>()
+	{
+		Accelerator& refitted       = std::get<Accelerator>(m_refitAccelerators);
+		double       refitStartTime = GetCurrentTimeSeconds();
+		refitted.Refit();
+		double       queryStartTime = GetCurrentTimeSeconds();
+		int          numHits        = RaycastBatchWith(refitted, rays, hits);
+		double       queryEndTime   = GetCurrentTimeSeconds();
+		RecordTiming(Accelerator::QUERY_MODE, eTreeMaintenance::REFIT, queryStartTime - refitStartTime, queryEndTime - queryStartTime, numHits);
+
+		if constexpr (!IS_BRUTE_FORCE_SCAN<Accelerator>)
+		{
+			Accelerator& rebuilt               = std::get<Accelerator>(m_rebuildAccelerators);
+			double       buildStartTime        = GetCurrentTimeSeconds();
+			rebuilt.Build(m_convexes, m_bounds);
+			double       rebuiltQueryStartTime = GetCurrentTimeSeconds();
+			int          rebuiltNumHits        = RaycastBatchWith(rebuilt, rays, hits);
+			double       rebuiltQueryEndTime   = GetCurrentTimeSeconds();
+			RecordTiming(Accelerator::QUERY_MODE, eTreeMaintenance::REBUILD, rebuiltQueryStartTime - buildStartTime, rebuiltQueryEndTime - rebuiltQueryStartTime, rebuiltNumHits);
+		}
+	});
+
+	++m_numTicks;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+float MotionSimulation::GetAvgUpdateTimeMs() const
+{
+	return m_numTicks > 0 ? m_totalUpdateTimeMs / static_cast<float>(m_numTicks) : 0.f;
+}
+
+//----------------------------------------------------------------------------------------------------
+MotionStrategyStats const& MotionSimulation::GetStrategyStats(eQueryMode mode, eTreeMaintenance maintenance) const
+{
+	return m_stats[static_cast<int>(mode)][static_cast<int>(maintenance)];
+}
+
+//----------------------------------------------------------------------------------------------------
+// FormatStrategyDescription - Per-tick averages for one accelerator, with the worst maintenance tick
+//----------------------------------------------------------------------------------------------------
+void MotionSimulation::FormatStrategyDescription(eQueryMode mode, std::span<char> out_text) const
+{
+	if (out_text.empty())
+	{
+		return;
+	}
+
+	MotionStrategyStats const& refit     = GetStrategyStats(mode, eTreeMaintenance::REFIT);
+	MotionStrategyStats const& rebuild   = GetStrategyStats(mode, eTreeMaintenance::REBUILD);
+	float const                tickScale = m_numTicks > 0 ? 1.f / static_cast<float>(m_numTicks) : 0.f;
+	char const*                name      = SceneAccelerators::GetName(static_cast<int>(mode));
+
+	if (!rebuild.m_isUsed)
+	{
+		std::snprintf(out_text.data(), out_text.size(), "%s: query %.2fms, %d hits", name, refit.m_totalQueryTimeMs * tickScale, refit.m_lastNumHits);
+		return;
+	}
+	std::snprintf(out_text.data(), out_text.size(), "%s: refit %.2fms (max %.2f) + query %.2fms | rebuild %.2fms (max %.2f) + query %.2fms | %d hits", name,
+				  refit.m_totalMaintainTimeMs * tickScale, refit.m_maxMaintainTimeMs, refit.m_totalQueryTimeMs * tickScale,
+				  rebuild.m_totalMaintainTimeMs * tickScale, rebuild.m_maxMaintainTimeMs, rebuild.m_totalQueryTimeMs * tickScale, refit.m_lastNumHits);
+}
+
+//----------------------------------------------------------------------------------------------------
+// IntegrateMovers - A mover leaving the bounds is pushed back in and its velocity turned inwards on
+// that axis; spinning is about its own bounding disc center, which rotation leaves in place. Ids are
+// read every tick since the caller's rebuilds may reassign them.
+//----------------------------------------------------------------------------------------------------
+void MotionSimulation::IntegrateMovers(float deltaSeconds)
+{
+	m_movedObjectIds.clear();
+	m_movedBoundsBefore.clear();
+	for (Mover& mover : m_movers)
+	{
+		Convex2& convex = *mover.m_convex;
+		m_movedObjectIds.push_back(convex.m_objectId);
+		m_movedBoundsBefore.push_back(convex.m_boundingAABB);
+		convex.Translate(mover.m_velocity * deltaSeconds);
+		Vec2 const pivot = convex.m_boundingDiscCenter; // Copied; Rotate moves the center before reading the pivot
+		convex.Rotate(mover.m_spinDegrees * deltaSeconds, pivot);
+
+		AABB2 const& box = convex.m_boundingAABB;
+		Vec2         pushBack;
+		if (box.m_mins.x < m_bounds.m_mins.x)
+		{
+			pushBack.x         = m_bounds.m_mins.x - box.m_mins.x;
+			mover.m_velocity.x = std::fabs(mover.m_velocity.x);
+		}
+		else if (box.m_maxs.x > m_bounds.m_maxs.x)
+		{
+			pushBack.x         = m_bounds.m_maxs.x - box.m_maxs.x;
+			mover.m_velocity.x = -std::fabs(mover.m_velocity.x);
+		}
+		if (box.m_mins.y < m_bounds.m_mins.y)
+		{
+			pushBack.y         = m_bounds.m_mins.y - box.m_mins.y;
+			mover.m_velocity.y = std::fabs(mover.m_velocity.y);
+		}
+		else if (box.m_maxs.y > m_bounds.m_maxs.y)
+		{
+			pushBack.y         = m_bounds.m_maxs.y - box.m_maxs.y;
+			mover.m_velocity.y = -std::fabs(mover.m_velocity.y);
+		}
+		if (pushBack.x != 0.f || pushBack.y != 0.f)
+		{
+			convex.Translate(pushBack);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// RollRays - A fresh workload every tick, so no accelerator benefits from the previous tick's rays
+//----------------------------------------------------------------------------------------------------
+void MotionSimulation::RollRays()
+{
+	int const numRays = std::max(m_config.m_raysPerTick, 0);
+	m_rayStartPositions.resize(numRays);
+	m_rayForwardNormals.resize(numRays);
+	m_rayMaxDists.resize(numRays);
+	m_hitDists.resize(numRays);
+	m_hitObjectIds.resize(numRays);
+	m_hitNormals.resize(numRays);
+
+	std::uniform_real_distribution<float> randomX(m_bounds.m_mins.x, m_bounds.m_maxs.x);
+	std::uniform_real_distribution<float> randomY(m_bounds.m_mins.y, m_bounds.m_maxs.y);
+	std::uniform_real_distribution<float> randomAngle(0.f, 6.2831853f);
+	std::uniform_real_distribution<float> randomLength(0.f, m_config.m_maxRayLength);
+	for (int j = 0; j < numRays; ++j)
+	{
+		float const angle = randomAngle(m_rng);
+		m_rayStartPositions[j] = Vec2(randomX(m_rng), randomY(m_rng));
+		m_rayForwardNormals[j] = Vec2(std::cos(angle), std::sin(angle));
+		m_rayMaxDists[j]       = randomLength(m_rng);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void MotionSimulation::RecordTiming(eQueryMode mode, eTreeMaintenance maintenance, double maintainSeconds, double querySeconds, int numHits)
+{
+	MotionStrategyStats& stats = m_stats[static_cast<int>(mode)][static_cast<int>(maintenance)];
+	stats.m_lastMaintainTimeMs   = static_cast<float>(maintainSeconds * 1000.0);
+	stats.m_lastQueryTimeMs      = static_cast<float>(querySeconds * 1000.0);
+	stats.m_totalMaintainTimeMs += stats.m_lastMaintainTimeMs;
+	stats.m_totalQueryTimeMs    += stats.m_lastQueryTimeMs;
+	stats.m_maxMaintainTimeMs    = std::max(stats.m_maxMaintainTimeMs, stats.m_lastMaintainTimeMs);
+	stats.m_lastNumHits          = numHits;
+	stats.m_isUsed               = true;
+}
@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------------------------------
+// MotionSimulation.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct Convex2;
+
+//----------------------------------------------------------------------------------------------------
+struct MotionSimulationConfig
+{
+	float    m_dynamicFraction = 0.1f;  // Of the convexes, picked at random to move
+	float    m_maxSpeed        = 20.f;  // World units per second
+	float    m_maxSpinDegrees  = 90.f;  // Degrees per second, either way
+	int      m_raysPerTick     = 1024;
+	float    m_maxRayLength    = 50.f;
+	int      m_numTicks        = 0;     // Ticks to run before IsFinished; 0 runs until stopped
+	uint32_t m_seed            = 1;
+};
+
+//----------------------------------------------------------------------------------------------------
+// How an accelerator catches up with moved objects before the tick's queries
+//----------------------------------------------------------------------------------------------------
+enum class eTreeMaintenance : uint8_t
+{
+	REFIT,   // Keep the structure, update bounds (Refit)
+	REBUILD, // Build from scratch every tick
+	COUNT
+};
+
+//----------------------------------------------------------------------------------------------------
+// MotionStrategyStats - Timings of one accelerator under one maintenance strategy
+//----------------------------------------------------------------------------------------------------
+struct MotionStrategyStats
+{
+	float m_lastMaintainTimeMs  = 0.f;
+	float m_lastQueryTimeMs     = 0.f;
+	float m_totalMaintainTimeMs = 0.f;
+	float m_totalQueryTimeMs    = 0.f;
+	float m_maxMaintainTimeMs   = 0.f; // Catches spikes such as the split tree's static rebuilds
+	int   m_lastNumHits         = 0;   // Same for every strategy on a given tick
+	bool  m_isUsed              = false;
+};
+
+//----------------------------------------------------------------------------------------------------
+// MotionSimulation - Moves a fraction of the scene every tick and times how each accelerator keeps up
+//
+// Movers get a random velocity and spin, bounce off the scene bounds and are marked m_isDynamic so
+// split trees keep them out of their static tree. Every tick integrates the movers, then brings each
+// registered accelerator up to date, once by Refit and once by a full Build in a second instance, and
+// times a fresh batch of random closest-hit rays against it. The accelerators are private instances
+// over the same convexes; the caller's own trees still need refitting after Step, and its caches can
+// be patched from the movers' object ids and their bounds before the tick.
+//----------------------------------------------------------------------------------------------------
+class MotionSimulation
+{
+public:
+	void Start(std::vector<Convex2*> const& convexes, AABB2 const& bounds, MotionSimulationConfig const& config);
+	void Stop();
+	bool Step(float deltaSeconds);
+
+	bool IsRunning() const { return m_isRunning; }
+	bool IsFinished() const { return m_isRunning && m_config.m_numTicks > 0 && m_numTicks >= m_config.m_numTicks; }
+	int  GetNumTicks() const { return m_numTicks; }
+	int  GetNumMovers() const { return static_cast<int>(m_movers.size()); }
+	int  GetRaysPerTick() const { return m_config.m_raysPerTick; }
+
+	std::span<int const>   GetMovedObjectIds() const { return m_movedObjectIds; }       // As of the last Step
+	std::span<AABB2 const> GetMovedBoundsBefore() const { return m_movedBoundsBefore; } // Parallel to GetMovedObjectIds
+
+	float                      GetLastUpdateTimeMs() const { return m_lastUpdateTimeMs; }
+	float                      GetAvgUpdateTimeMs() const;
+	MotionStrategyStats const& GetStrategyStats(eQueryMode mode, eTreeMaintenance maintenance) const;
+	void                       FormatStrategyDescription(eQueryMode mode, std::span<char> out_text) const; // No allocation; the HUD calls it every frame
+
+private:
+	struct Mover
+	{
+		Convex2* m_convex = nullptr;
+		Vec2     m_velocity;
+		float    m_spinDegrees = 0.f;
+	};
+
+	void IntegrateMovers(float deltaSeconds);
+	void RollRays();
+	void RecordTiming(eQueryMode mode, eTreeMaintenance maintenance, double maintainSeconds, double querySeconds, int numHits);
+
+	MotionSimulationConfig       m_config;
+	std::vector<Convex2*>        m_convexes; // Copy of the caller's list; the accelerators point at it
+	AABB2                        m_bounds;
+	std::vector<Mover>           m_movers;
+	std::vector<int>             m_movedObjectIds;
+	std::vector<AABB2>           m_movedBoundsBefore;
+	std::mt19937                 m_rng;
+	SceneAccelerators::Instances m_refitAccelerators;
+	SceneAccelerators::Instances m_rebuildAccelerators;
+	std::vector<Vec2>            m_rayStartPositions;
+	std::vector<Vec2>            m_rayForwardNormals;
+	std::vector<float>           m_rayMaxDists;
+	std::vector<float>           m_hitDists;
+	std::vector<int>             m_hitObjectIds;
+	std::vector<Vec2>            m_hitNormals;
+	MotionStrategyStats          m_stats[static_cast<int>(eQueryMode::COUNT)][static_cast<int>(eTreeMaintenance::COUNT)];
+	float                        m_lastUpdateTimeMs  = 0.f;
+	float                        m_totalUpdateTimeMs = 0.f;
+	int                          m_numTicks          = 0;
+	bool                         m_isRunning         = false;
+};
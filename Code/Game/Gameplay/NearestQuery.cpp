@@ -0,0 +1,129 @@
+//----------------------------------------------------------------------------------------------------
+// NearestQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/NearestQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/Convex.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------
+NearestConvexCollector::NearestConvexCollector(std::span<NearestConvexResult> buffer, float maxSearchDist)
+	: m_buffer(buffer)
+	, m_maxSearchDist(maxSearchDist)
+{
+}
+
+//----------------------------------------------------------------------------------------------------
+// Consider - Exact distance test, skipped when the object's box is already beyond the radius
+//----------------------------------------------------------------------------------------------------
+void NearestConvexCollector::Consider(Convex2 const& convex)
+{
+	float radius = GetSearchRadius();
+	if (GetDistanceToAABB2(m_queryPoint, convex.m_boundingAABB) > radius)
+	{
+		return;
+	}
+
+	NearestConvexResult result;
+	result.m_objectId = convex.m_objectId;
+	result.m_distance = convex.GetNearestPointOnBoundary(m_queryPoint, result.m_nearestPoint, result.m_normal);
+	if (convex.IsPointInside(m_queryPoint))
+	{
+		result.m_distance = 0.f;
+	}
+	if (result.m_distance > radius)
+	{
+		return;
+	}
+
+	int capacity = static_cast<int>(m_buffer.size());
+	int slot     = (m_numResults == capacity) ? m_numResults - 1 : m_numResults++;
+	while (slot > 0 && m_buffer[slot - 1].m_distance > result.m_distance)
+	{
+		m_buffer[slot] = m_buffer[slot - 1];
+		--slot;
+	}
+	m_buffer[slot] = result;
+}
+
+//----------------------------------------------------------------------------------------------------
+float NearestConvexCollector::GetSearchRadius() const
+{
+	if (m_buffer.empty())
+	{
+		return -1.f;
+	}
+	if (m_numResults == static_cast<int>(m_buffer.size()) && m_buffer[m_numResults - 1].m_distance < m_maxSearchDist)
+	{
+		return m_buffer[m_numResults - 1].m_distance;
+	}
+	return m_maxSearchDist;
+}
+
+//----------------------------------------------------------------------------------------------------
+float GetDistanceToAABB2(Vec2 const& point, AABB2 const& box)
+{
+	float dx = fmaxf(fmaxf(box.m_mins.x - point.x, 0.f), point.x - box.m_maxs.x);
+	float dy = fmaxf(fmaxf(box.m_mins.y - point.y, 0.f), point.y - box.m_maxs.y);
+	return sqrtf(dx * dx + dy * dy);
+}
+
+//----------------------------------------------------------------------------------------------------
+void CollectNearestConvexesBruteForce(std::vector<Convex2*> const& convexes, eQueryMode rejectionMode, NearestConvexCollector& collector, QueryFilter const& filter)
+{
+	for (Convex2 const* convex : convexes)
+	{
+		if (!filter.Accepts(convex->m_categoryMask))
+		{
+			continue;
+		}
+		// Bounding disc gives a cheap lower bound on the boundary distance
+		if (rejectionMode == eQueryMode::DISC_REJECTION &&
+			(collector.m_queryPoint - convex->m_boundingDiscCenter).GetLength() - convex->m_boundingRadius > collector.GetSearchRadius())
+		{
+			continue;
+		}
+		collector.Consider(*convex);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+static void CollectNearestConvexes(SceneQueryView const& scene, eQueryMode mode, NearestConvexCollector& collector)
+{
+	QueryScratch& scratch = QueryScratch::GetForThisThread();
+
+	DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+	{
+		accelerator.CollectNearestConvexes(scratch, collector, scene.m_filter);
+	});
+}
+
+//----------------------------------------------------------------------------------------------------
+int QueryNearestConvexes(SceneQueryView const& scene, eQueryMode mode, Vec2 const& point, std::span<NearestConvexResult> out_results, float maxSearchDist)
+{
+	if (out_results.empty())
+	{
+		return 0;
+	}
+
+	NearestConvexCollector collector(out_results, maxSearchDist);
+	collector.m_queryPoint = point;
+	CollectNearestConvexes(scene, mode, collector);
+	return collector.m_numResults;
+}
+
+//----------------------------------------------------------------------------------------------------
+void QueryNearestConvexBatch(SceneQueryView const& scene, eQueryMode mode, std::span<Vec2 const> points, std::span<NearestConvexResult> out_results, float maxSearchDist)
+{
+	for (int i = 0; i < static_cast<int>(points.size()); ++i)
+	{
+		out_results[i] = NearestConvexResult();
+		QueryNearestConvexes(scene, mode, points[i], out_results.subspan(static_cast<size_t>(i), 1), maxSearchDist);
+	}
+}
@@ -0,0 +1,66 @@
+//----------------------------------------------------------------------------------------------------
+// NearestQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cfloat>
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct AABB2;
+struct Convex2;
+
+//----------------------------------------------------------------------------------------------------
+// NearestConvexResult - Distance is to the polygon boundary and 0 when the point is inside;
+// the nearest point and outward normal are always on the boundary.
+//----------------------------------------------------------------------------------------------------
+struct NearestConvexResult
+{
+	float m_distance = FLT_MAX;
+	Vec2  m_nearestPoint;
+	Vec2  m_normal;
+	int   m_objectId = -1;
+};
+
+//----------------------------------------------------------------------------------------------------
+// NearestConvexCollector - Keeps the k best results sorted in a caller-owned buffer; the search
+// radius shrinks to the k-th best distance once the buffer is full.
+//----------------------------------------------------------------------------------------------------
+struct NearestConvexCollector
+{
+	NearestConvexCollector(std::span<NearestConvexResult> buffer, float maxSearchDist);
+
+	void  Consider(Convex2 const& convex);
+	float GetSearchRadius() const;
+
+	std::span<NearestConvexResult> m_buffer;
+	Vec2                           m_queryPoint;
+	float                          m_maxSearchDist = FLT_MAX;
+	int                            m_numResults    = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+// Every convex offered to the collector, behind the bounding disc when rejectionMode asks for it;
+// the no-tree baselines of the accelerator registry
+//----------------------------------------------------------------------------------------------------
+void CollectNearestConvexesBruteForce(std::vector<Convex2*> const& convexes, eQueryMode rejectionMode, NearestConvexCollector& collector, QueryFilter const& filter = QueryFilter());
+
+//----------------------------------------------------------------------------------------------------
+// k nearest convexes to a point, k = out_results.size(), sorted by distance; returns the count found
+//----------------------------------------------------------------------------------------------------
+int QueryNearestConvexes(SceneQueryView const& scene, eQueryMode mode, Vec2 const& point, std::span<NearestConvexResult> out_results, float maxSearchDist = FLT_MAX);
+
+//----------------------------------------------------------------------------------------------------
+// Single nearest convex for each point; misses (nothing within maxSearchDist) get object id -1
+//----------------------------------------------------------------------------------------------------
+void QueryNearestConvexBatch(SceneQueryView const& scene, eQueryMode mode, std::span<Vec2 const> points, std::span<NearestConvexResult> out_results, float maxSearchDist = FLT_MAX);
+
+//----------------------------------------------------------------------------------------------------
+float GetDistanceToAABB2(Vec2 const& point, AABB2 const& box);
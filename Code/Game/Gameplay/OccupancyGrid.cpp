@@ -0,0 +1,347 @@
+//----------------------------------------------------------------------------------------------------
+// OccupancyGrid.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/OccupancyGrid.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/RaycastUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int   OCCUPANCY_ROWS_PER_BAND = 16;
+constexpr float OCCUPANCY_CELL_EPSILON  = 0.001f; // Fraction of a cell; keeps touching contacts conservative
+
+//----------------------------------------------------------------------------------------------------
+// OccupancyScratch - Per-thread buffers for the exact tests in occupied cells
+//----------------------------------------------------------------------------------------------------
+struct OccupancyScratch
+{
+	std::vector<int> m_objectIds;
+	std::vector<int> m_testedIds; // Convexes already tested against the current ray
+
+	static OccupancyScratch& GetForThisThread()
+	{
+		thread_local OccupancyScratch s_scratch;
+		return s_scratch;
+	}
+};
+
+//----------------------------------------------------------------------------------------------------
+static uint64_t GetRunMask(int firstBit, int lastBit)
+{
+	uint64_t highMask = (lastBit == 63) ? ~0ull : ((1ull << (lastBit + 1)) - 1ull);
+	return highMask & ~((1ull << firstBit) - 1ull);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Rasterize - Row bands write disjoint words, so workers only share the band counter
+//----------------------------------------------------------------------------------------------------
+void SceneOccupancyGrid::Rasterize(SceneQueryView const& scene, AABB2 const& bounds, float cellSize, int numThreads)
+{
+	Vec2 dims     = bounds.GetDimensions();
+	m_bounds      = bounds;
+	m_cellSize    = cellSize;
+	m_numCellsX   = std::max(static_cast<int>(ceilf(dims.x / cellSize)), 1);
+	m_numCellsY   = std::max(static_cast<int>(ceilf(dims.y / cellSize)), 1);
+	m_wordsPerRow = (m_numCellsX + 63) / 64;
+	m_words.assign(static_cast<size_t>(m_wordsPerRow) * m_numCellsY, 0ull);
+
+	std::vector<int> objectIds(scene.m_convexes->size());
+	for (int i = 0; i < static_cast<int>(objectIds.size()); ++i)
+	{
+		objectIds[i] = i;
+	}
+
+	int numBands = (m_numCellsY + OCCUPANCY_ROWS_PER_BAND - 1) / OCCUPANCY_ROWS_PER_BAND;
+	if (numThreads <= 0)
+	{
+		numThreads = GetNumTaskThreads();
+	}
+	numThreads = std::clamp(numThreads, 1, numBands);
+
+	std::atomic<int> nextBand = 0;
+	auto worker = [&](int)
+	{
+		for (int band = nextBand.fetch_add(1); band < numBands; band = nextBand.fetch_add(1))
+		{
+			int firstCellY = band * OCCUPANCY_ROWS_PER_BAND;
+			int lastCellY  = std::min(firstCellY + OCCUPANCY_ROWS_PER_BAND, m_numCellsY) - 1;
+			RasterizeRows(scene, objectIds, 0, firstCellY, m_numCellsX - 1, lastCellY);
+		}
+	};
+
+	RunOnWorkers(numThreads, worker);
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateRegion - Clear the cells under the region and re-rasterize whatever still touches them, as
+// found by the mode's accelerator. Call with both the old and the new bounds of an edited object.
+//----------------------------------------------------------------------------------------------------
+void SceneOccupancyGrid::UpdateRegion(SceneQueryView const& scene, eQueryMode mode, AABB2 const& region)
+{
+	if (!IsRasterized())
+	{
+		return;
+	}
+
+	float margin     = m_cellSize * OCCUPANCY_CELL_EPSILON;
+	int   firstCellX = std::max(static_cast<int>(floorf((region.m_mins.x - margin - m_bounds.m_mins.x) / m_cellSize)), 0);
+	int   firstCellY = std::max(static_cast<int>(floorf((region.m_mins.y - margin - m_bounds.m_mins.y) / m_cellSize)), 0);
+	int   lastCellX  = std::min(static_cast<int>(floorf((region.m_maxs.x + margin - m_bounds.m_mins.x) / m_cellSize)), m_numCellsX - 1);
+	int   lastCellY  = std::min(static_cast<int>(floorf((region.m_maxs.y + margin - m_bounds.m_mins.y) / m_cellSize)), m_numCellsY - 1);
+	if (firstCellX > lastCellX || firstCellY > lastCellY)
+	{
+		return;
+	}
+
+	for (int cellY = firstCellY; cellY <= lastCellY; ++cellY)
+	{
+		ClearCellRun(cellY, firstCellX, lastCellX);
+	}
+
+	AABB2 cellRangeBounds(GetCellBounds(firstCellX, firstCellY).m_mins, GetCellBounds(lastCellX, lastCellY).m_maxs);
+	OccupancyScratch& scratch = OccupancyScratch::GetForThisThread();
+	scratch.m_objectIds.resize(scene.m_convexes->size());
+
+	RegionOverlapCollector collector;
+	collector.m_buffer = scratch.m_objectIds;
+	collector.m_isDone = scratch.m_objectIds.empty();
+	if (!collector.m_isDone)
+	{
+		RegionQueryShape const cellRangeShape = RegionQueryShape::MakeAABB(cellRangeBounds);
+		QueryScratch&          queryScratch   = QueryScratch::GetForThisThread();
+		DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+		{
+			accelerator.CollectRegionOverlaps(cellRangeShape, queryScratch, collector, scene.m_filter);
+		});
+	}
+	RasterizeRows(scene, std::span<int const>(scratch.m_objectIds.data(), collector.m_numHits), firstCellX, firstCellY, lastCellX, lastCellY);
+}
+
+//----------------------------------------------------------------------------------------------------
+void SceneOccupancyGrid::Clear()
+{
+	m_words.clear();
+	m_numCellsX   = 0;
+	m_numCellsY   = 0;
+	m_wordsPerRow = 0;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool SceneOccupancyGrid::IsCellOccupied(int cellX, int cellY) const
+{
+	uint64_t word = m_words[static_cast<size_t>(cellY) * m_wordsPerRow + (cellX >> 6)];
+	return (word >> (cellX & 63)) & 1ull;
+}
+
+//----------------------------------------------------------------------------------------------------
+int SceneOccupancyGrid::GetNumOccupiedCells() const
+{
+	int numOccupied = 0;
+	for (uint64_t word : m_words)
+	{
+		numOccupied += std::popcount(word);
+	}
+	return numOccupied;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t SceneOccupancyGrid::GetMemoryBytes() const
+{
+	return m_words.capacity() * sizeof(uint64_t);
+}
+
+//----------------------------------------------------------------------------------------------------
+int SceneOccupancyGrid::LineOfSightBatch(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, std::span<uint8_t> out_isVisible) const
+{
+	int numVisible = 0;
+	for (int j = 0; j < rays.GetNumRays(); ++j)
+	{
+		bool isVisible   = HasLineOfSight(scene, mode, rays.m_startPositions[j], rays.m_forwardNormals[j], rays.m_maxDists[j]);
+		out_isVisible[j] = isVisible ? 1 : 0;
+		numVisible      += isVisible ? 1 : 0;
+	}
+	return numVisible;
+}
+
+//----------------------------------------------------------------------------------------------------
+// HasLineOfSight - Grid walk over the bitset. An all-empty word is crossed in one jump as long as
+// the ray stays in its row; set cells drop to exact tests against the convexes touching them.
+//----------------------------------------------------------------------------------------------------
+bool SceneOccupancyGrid::HasLineOfSight(SceneQueryView const& scene, eQueryMode mode, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const
+{
+	Vec2 endPos = startPos + forwardNormal * maxDist;
+	if (!IsRasterized() || !m_bounds.IsPointInside(startPos) || !m_bounds.IsPointInside(endPos))
+	{
+		float hitDist     = 0.f;
+		int   hitObjectId = -1;
+		Vec2  hitNormal;
+		RayBatch    ray{std::span<Vec2 const>(&startPos, 1), std::span<Vec2 const>(&forwardNormal, 1), std::span<float const>(&maxDist, 1)};
+		RayHitBatch hit{std::span<float>(&hitDist, 1), std::span<int>(&hitObjectId, 1), std::span<Vec2>(&hitNormal, 1)};
+		return RaycastBatch(scene, mode, ray, hit) == 0;
+	}
+
+	OccupancyScratch::GetForThisThread().m_testedIds.clear();
+
+	Vec2 localStart = (startPos - m_bounds.m_mins) / m_cellSize;
+	Vec2 localEnd   = (endPos - m_bounds.m_mins) / m_cellSize;
+	int  cellX      = std::min(static_cast<int>(localStart.x), m_numCellsX - 1);
+	int  cellY      = std::min(static_cast<int>(localStart.y), m_numCellsY - 1);
+	int  endCellX   = std::min(static_cast<int>(localEnd.x), m_numCellsX - 1);
+	int  endCellY   = std::min(static_cast<int>(localEnd.y), m_numCellsY - 1);
+	Vec2 disp       = localEnd - localStart;
+	int  stepX      = (disp.x > 0.f) ? 1 : -1;
+	int  stepY      = (disp.y > 0.f) ? 1 : -1;
+
+	float tDeltaX = (disp.x != 0.f) ? 1.f / fabsf(disp.x) : FLT_MAX;
+	float tDeltaY = (disp.y != 0.f) ? 1.f / fabsf(disp.y) : FLT_MAX;
+	float tMaxX   = (disp.x != 0.f) ? (static_cast<float>(cellX + (stepX > 0 ? 1 : 0)) - localStart.x) / disp.x : FLT_MAX;
+	float tMaxY   = (disp.y != 0.f) ? (static_cast<float>(cellY + (stepY > 0 ? 1 : 0)) - localStart.y) / disp.y : FLT_MAX;
+
+	for (;;)
+	{
+		uint64_t word = m_words[static_cast<size_t>(cellY) * m_wordsPerRow + (cellX >> 6)];
+		if ((word >> (cellX & 63)) & 1ull)
+		{
+			if (IsSegmentBlockedInCell(scene, mode, startPos, forwardNormal, maxDist, cellX, cellY))
+			{
+				return false;
+			}
+		}
+
+		bool canStepX = (cellX != endCellX);
+		bool canStepY = (cellY != endCellY);
+		if (!canStepX && !canStepY)
+		{
+			return true;
+		}
+
+		if (canStepX && (!canStepY || tMaxX < tMaxY))
+		{
+			int numSteps = 1;
+			if (word == 0ull)
+			{
+				// Jump straight out of this empty word unless the ray changes rows first; the row
+				// bound is rounded down, so rounding can only cost a step, never skip a cell
+				int stepsToWordEdge = (stepX > 0) ? 64 - (cellX & 63) : (cellX & 63) + 1;
+				int stepsToEnd      = abs(endCellX - cellX);
+				int stepsBeforeRow  = canStepY ? static_cast<int>(std::min((tMaxY - tMaxX) / tDeltaX, 64.f)) : 64;
+				numSteps = std::max(std::min({stepsToWordEdge, stepsToEnd, stepsBeforeRow}), 1);
+			}
+			cellX += stepX * numSteps;
+			tMaxX += tDeltaX * static_cast<float>(numSteps);
+		}
+		else
+		{
+			cellY += stepY;
+			tMaxY += tDeltaY;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// RasterizeRows - Each convex covers one contiguous run per row, so only the run ends are searched
+//----------------------------------------------------------------------------------------------------
+void SceneOccupancyGrid::RasterizeRows(SceneQueryView const& scene, std::span<int const> objectIds, int firstCellX, int firstCellY, int lastCellX, int lastCellY)
+{
+	std::vector<Convex2*> const& convexes = *scene.m_convexes;
+	float                        margin   = m_cellSize * OCCUPANCY_CELL_EPSILON;
+
+	for (int objectId : objectIds)
+	{
+		AABB2 const& box = convexes[objectId]->m_boundingAABB;
+		int minCellX = std::max(static_cast<int>(floorf((box.m_mins.x - margin - m_bounds.m_mins.x) / m_cellSize)), firstCellX);
+		int minCellY = std::max(static_cast<int>(floorf((box.m_mins.y - margin - m_bounds.m_mins.y) / m_cellSize)), firstCellY);
+		int maxCellX = std::min(static_cast<int>(floorf((box.m_maxs.x + margin - m_bounds.m_mins.x) / m_cellSize)), lastCellX);
+		int maxCellY = std::min(static_cast<int>(floorf((box.m_maxs.y + margin - m_bounds.m_mins.y) / m_cellSize)), lastCellY);
+
+		for (int cellY = minCellY; cellY <= maxCellY; ++cellY)
+		{
+			int runFirst = minCellX;
+			while (runFirst <= maxCellX && !convexes[objectId]->OverlapsAABB2(GetCellBounds(runFirst, cellY)))
+			{
+				++runFirst;
+			}
+			if (runFirst > maxCellX)
+			{
+				continue;
+			}
+			int runLast = maxCellX;
+			while (runLast > runFirst && !convexes[objectId]->OverlapsAABB2(GetCellBounds(runLast, cellY)))
+			{
+				--runLast;
+			}
+			SetCellRun(cellY, runFirst, runLast);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void SceneOccupancyGrid::SetCellRun(int cellY, int firstCellX, int lastCellX)
+{
+	uint64_t* row = &m_words[static_cast<size_t>(cellY) * m_wordsPerRow];
+	for (int wordIndex = firstCellX >> 6; wordIndex <= (lastCellX >> 6); ++wordIndex)
+	{
+		int firstBit = (wordIndex == (firstCellX >> 6)) ? (firstCellX & 63) : 0;
+		int lastBit  = (wordIndex == (lastCellX >> 6)) ? (lastCellX & 63) : 63;
+		row[wordIndex] |= GetRunMask(firstBit, lastBit);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void SceneOccupancyGrid::ClearCellRun(int cellY, int firstCellX, int lastCellX)
+{
+	uint64_t* row = &m_words[static_cast<size_t>(cellY) * m_wordsPerRow];
+	for (int wordIndex = firstCellX >> 6; wordIndex <= (lastCellX >> 6); ++wordIndex)
+	{
+		int firstBit = (wordIndex == (firstCellX >> 6)) ? (firstCellX & 63) : 0;
+		int lastBit  = (wordIndex == (lastCellX >> 6)) ? (lastCellX & 63) : 63;
+		row[wordIndex] &= ~GetRunMask(firstBit, lastBit);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetCellBounds - Grown by a small margin so a convex merely touching the cell still sets it
+//----------------------------------------------------------------------------------------------------
+AABB2 SceneOccupancyGrid::GetCellBounds(int cellX, int cellY) const
+{
+	float margin = m_cellSize * OCCUPANCY_CELL_EPSILON;
+	Vec2  mins   = m_bounds.m_mins + Vec2(static_cast<float>(cellX), static_cast<float>(cellY)) * m_cellSize;
+	return AABB2(mins - Vec2(margin, margin), mins + Vec2(m_cellSize + margin, m_cellSize + margin));
+}
+
+//----------------------------------------------------------------------------------------------------
+bool SceneOccupancyGrid::IsSegmentBlockedInCell(SceneQueryView const& scene, eQueryMode mode, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, int cellX, int cellY) const
+{
+	OccupancyScratch& scratch = OccupancyScratch::GetForThisThread();
+	scratch.m_objectIds.resize(scene.m_convexes->size());
+	int numOverlaps = QueryRegionOverlaps(scene, mode, RegionQueryShape::MakeAABB(GetCellBounds(cellX, cellY)), scratch.m_objectIds);
+
+	RaycastResult2D rayRes;
+	for (int i = 0; i < numOverlaps; ++i)
+	{
+		int objectId = scratch.m_objectIds[i];
+		if (std::find(scratch.m_testedIds.begin(), scratch.m_testedIds.end(), objectId) != scratch.m_testedIds.end())
+		{
+			continue;
+		}
+		scratch.m_testedIds.push_back(objectId);
+		if ((*scene.m_convexes)[objectId]->RayCastVsConvex2D(rayRes, startPos, forwardNormal, maxDist, true, true))
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,56 @@
+//----------------------------------------------------------------------------------------------------
+// OccupancyGrid.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct RayBatch;
+
+//----------------------------------------------------------------------------------------------------
+// SceneOccupancyGrid - One bit per cell, set when any convex touches the cell
+//
+// Rows are packed 64 cells to a word. Rasterization is conservative (a touched cell is always set),
+// so an empty cell proves nothing blocks it and only set cells need exact convex tests. Edits are
+// patched by re-rasterizing the cells under the edited object's old and new bounds.
+//----------------------------------------------------------------------------------------------------
+class SceneOccupancyGrid
+{
+public:
+	void Rasterize(SceneQueryView const& scene, AABB2 const& bounds, float cellSize, int numThreads = 0);
+	void UpdateRegion(SceneQueryView const& scene, eQueryMode mode, AABB2 const& region);
+	void Clear();
+
+	bool   IsRasterized() const { return !m_words.empty(); }
+	bool   IsCellOccupied(int cellX, int cellY) const;
+	int    GetNumOccupiedCells() const;
+	size_t GetMemoryBytes() const;
+
+	// Line of sight along each ray's full length: out_isVisible[j] is 1 when nothing blocks it.
+	// Segments that leave the grid bounds fall back to an exact closest-hit query.
+	int  LineOfSightBatch(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, std::span<uint8_t> out_isVisible) const;
+	bool HasLineOfSight(SceneQueryView const& scene, eQueryMode mode, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const;
+
+private:
+	void  RasterizeRows(SceneQueryView const& scene, std::span<int const> objectIds, int firstCellX, int firstCellY, int lastCellX, int lastCellY);
+	void  SetCellRun(int cellY, int firstCellX, int lastCellX);
+	void  ClearCellRun(int cellY, int firstCellX, int lastCellX);
+	AABB2 GetCellBounds(int cellX, int cellY) const;
+	bool  IsSegmentBlockedInCell(SceneQueryView const& scene, eQueryMode mode, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, int cellX, int cellY) const;
+
+	AABB2                 m_bounds;
+	float                 m_cellSize     = 1.f;
+	int                   m_numCellsX    = 0;
+	int                   m_numCellsY    = 0;
+	int                   m_wordsPerRow  = 0;
+	std::vector<uint64_t> m_words;        // Row-major; bit (x & 63) of word x >> 6 in row y
+};
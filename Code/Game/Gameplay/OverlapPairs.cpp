@@ -0,0 +1,245 @@
+//----------------------------------------------------------------------------------------------------
+// OverlapPairs.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/OverlapPairs.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Convex.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/MathUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int SWEEP_BLOCK_SIZE       = 256;
+constexpr int MIN_OBJECTS_PER_WORKER = 2048;
+
+//----------------------------------------------------------------------------------------------------
+static bool IsPairLess(ConvexPair const& a, ConvexPair const& b)
+{
+	if (a.m_objectIdA != b.m_objectIdA)
+	{
+		return a.m_objectIdA < b.m_objectIdA;
+	}
+	return a.m_objectIdB < b.m_objectIdB;
+}
+
+//----------------------------------------------------------------------------------------------------
+static ConvexPair MakeOrderedPair(int idA, int idB)
+{
+	return (idA < idB) ? ConvexPair{idA, idB} : ConvexPair{idB, idA};
+}
+
+//----------------------------------------------------------------------------------------------------
+// Cheap cross-axis reject, then the exact SAT test
+//----------------------------------------------------------------------------------------------------
+static bool DoConvexesOverlap(Convex2 const& a, Convex2 const& b)
+{
+	return DoAABB2sOverlap2D(a.m_boundingAABB, b.m_boundingAABB) && a.OverlapsConvex(b);
+}
+
+//----------------------------------------------------------------------------------------------------
+float OverlapPairFinder::GetIntervalMin(Convex2 const& convex) const
+{
+	return (m_axis == eSweepAxis::X) ? convex.m_boundingAABB.m_mins.x : convex.m_boundingAABB.m_mins.y;
+}
+
+//----------------------------------------------------------------------------------------------------
+float OverlapPairFinder::GetIntervalMax(Convex2 const& convex) const
+{
+	return (m_axis == eSweepAxis::X) ? convex.m_boundingAABB.m_maxs.x : convex.m_boundingAABB.m_maxs.y;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RebuildIntervals - Pick the axis of greatest center variance, then sort intervals along it
+//----------------------------------------------------------------------------------------------------
+void OverlapPairFinder::RebuildIntervals(std::vector<Convex2*> const& convexes)
+{
+	int numConvexes = static_cast<int>(convexes.size());
+
+	double sumX  = 0.0, sumY  = 0.0;
+	double sumXX = 0.0, sumYY = 0.0;
+	for (Convex2 const* convex : convexes)
+	{
+		Vec2 const& center = convex->m_boundingDiscCenter;
+		sumX  += center.x;
+		sumY  += center.y;
+		sumXX += static_cast<double>(center.x) * center.x;
+		sumYY += static_cast<double>(center.y) * center.y;
+	}
+	double varianceX = sumXX - sumX * sumX / static_cast<double>(std::max(numConvexes, 1));
+	double varianceY = sumYY - sumY * sumY / static_cast<double>(std::max(numConvexes, 1));
+	m_axis = (varianceY > varianceX) ? eSweepAxis::Y : eSweepAxis::X;
+
+	m_intervals.resize(numConvexes);
+	m_maxExtent = 0.f;
+	for (int i = 0; i < numConvexes; ++i)
+	{
+		SweepInterval& interval = m_intervals[i];
+		interval.m_min      = GetIntervalMin(*convexes[i]);
+		interval.m_max      = GetIntervalMax(*convexes[i]);
+		interval.m_objectId = i;
+		m_maxExtent = std::max(m_maxExtent, interval.m_max - interval.m_min);
+	}
+	std::sort(m_intervals.begin(), m_intervals.end(), [](SweepInterval const& a, SweepInterval const& b) { return a.m_min < b.m_min; });
+
+	m_slotOfObject.resize(numConvexes);
+	for (int slot = 0; slot < numConvexes; ++slot)
+	{
+		m_slotOfObject[m_intervals[slot].m_objectId] = slot;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// SweepRange - Each slot only looks forward, so disjoint slot ranges can run on separate threads
+//----------------------------------------------------------------------------------------------------
+void OverlapPairFinder::SweepRange(std::vector<Convex2*> const& convexes, int firstSlot, int lastSlot, std::vector<ConvexPair>& out_pairs) const
+{
+	int numSlots = static_cast<int>(m_intervals.size());
+	for (int slot = firstSlot; slot < lastSlot; ++slot)
+	{
+		SweepInterval const& interval = m_intervals[slot];
+		Convex2 const&       convex   = *convexes[interval.m_objectId];
+		for (int other = slot + 1; other < numSlots && m_intervals[other].m_min <= interval.m_max; ++other)
+		{
+			int otherId = m_intervals[other].m_objectId;
+			if (DoConvexesOverlap(convex, *convexes[otherId]))
+			{
+				out_pairs.push_back(MakeOrderedPair(interval.m_objectId, otherId));
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// FindAllPairs - Full sort-and-sweep; workers pull blocks of sorted slots from a shared counter
+//----------------------------------------------------------------------------------------------------
+void OverlapPairFinder::FindAllPairs(std::vector<Convex2*> const& convexes, std::vector<ConvexPair>& out_pairs, int numThreads)
+{
+	++m_numFullPasses;
+	RebuildIntervals(convexes);
+
+	int numSlots = static_cast<int>(m_intervals.size());
+	if (numThreads <= 0)
+	{
+		numThreads = GetNumTaskThreads();
+	}
+	numThreads = std::clamp(numSlots / MIN_OBJECTS_PER_WORKER, 1, std::max(numThreads, 1));
+
+	m_threadPairs.resize(numThreads);
+	for (std::vector<ConvexPair>& threadPairs : m_threadPairs)
+	{
+		threadPairs.clear();
+	}
+
+	std::atomic<int> nextBlockStart = 0;
+	auto worker = [&](int workerIndex)
+	{
+		for (;;)
+		{
+			int firstSlot = nextBlockStart.fetch_add(SWEEP_BLOCK_SIZE);
+			if (firstSlot >= numSlots)
+			{
+				return;
+			}
+			SweepRange(convexes, firstSlot, std::min(firstSlot + SWEEP_BLOCK_SIZE, numSlots), m_threadPairs[workerIndex]);
+		}
+	};
+
+	RunOnWorkers(numThreads, worker);
+
+	m_pairs.clear();
+	for (std::vector<ConvexPair> const& threadPairs : m_threadPairs)
+	{
+		m_pairs.insert(m_pairs.end(), threadPairs.begin(), threadPairs.end());
+	}
+	std::sort(m_pairs.begin(), m_pairs.end(), IsPairLess);
+	out_pairs = m_pairs;
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateMovedPairs - Re-test only the moved objects against their sweep neighbours
+//
+// Intervals are re-sorted with an insertion sort, which is near-linear when little moved. Pairs
+// touching a moved object are dropped and rediscovered; everything else is kept from last time.
+// Falls back to FindAllPairs when the scene changed size or too much moved.
+//----------------------------------------------------------------------------------------------------
+void OverlapPairFinder::UpdateMovedPairs(std::vector<Convex2*> const& convexes, std::span<int const> movedObjectIds, std::vector<ConvexPair>& out_pairs, int numThreads)
+{
+	int numConvexes = static_cast<int>(convexes.size());
+	if (numConvexes != static_cast<int>(m_intervals.size()) ||
+		static_cast<float>(movedObjectIds.size()) > m_incrementalMovedFraction * static_cast<float>(numConvexes))
+	{
+		FindAllPairs(convexes, out_pairs, numThreads);
+		return;
+	}
+	++m_numIncrementalPasses;
+
+	m_isMoved.assign(numConvexes, 0);
+	for (int objectId : movedObjectIds)
+	{
+		m_isMoved[objectId] = 1;
+
+		SweepInterval& interval = m_intervals[m_slotOfObject[objectId]];
+		interval.m_min = GetIntervalMin(*convexes[objectId]);
+		interval.m_max = GetIntervalMax(*convexes[objectId]);
+		m_maxExtent    = std::max(m_maxExtent, interval.m_max - interval.m_min);
+	}
+
+	for (int slot = 1; slot < numConvexes; ++slot)
+	{
+		SweepInterval interval = m_intervals[slot];
+		int           dest     = slot;
+		while (dest > 0 && m_intervals[dest - 1].m_min > interval.m_min)
+		{
+			m_intervals[dest] = m_intervals[dest - 1];
+			--dest;
+		}
+		m_intervals[dest] = interval;
+	}
+	for (int slot = 0; slot < numConvexes; ++slot)
+	{
+		m_slotOfObject[m_intervals[slot].m_objectId] = slot;
+	}
+
+	std::erase_if(m_pairs, [this](ConvexPair const& pair) { return m_isMoved[pair.m_objectIdA] || m_isMoved[pair.m_objectIdB]; });
+	size_t numKeptPairs = m_pairs.size();
+
+	for (int objectId : movedObjectIds)
+	{
+		int                  slot     = m_slotOfObject[objectId];
+		SweepInterval const& interval = m_intervals[slot];
+		Convex2 const&       convex   = *convexes[objectId];
+
+		// A moved pair is seen from both sides; only the lower id reports it
+		auto testNeighbour = [&](int otherSlot)
+		{
+			int otherId = m_intervals[otherSlot].m_objectId;
+			if (m_isMoved[otherId] && otherId < objectId)
+			{
+				return;
+			}
+			if (m_intervals[otherSlot].m_max >= interval.m_min && DoConvexesOverlap(convex, *convexes[otherId]))
+			{
+				m_pairs.push_back(MakeOrderedPair(objectId, otherId));
+			}
+		};
+
+		for (int other = slot + 1; other < numConvexes && m_intervals[other].m_min <= interval.m_max; ++other)
+		{
+			testNeighbour(other);
+		}
+		// Anything starting further back than the widest interval cannot reach us
+		for (int other = slot - 1; other >= 0 && m_intervals[other].m_min >= interval.m_min - m_maxExtent; --other)
+		{
+			testNeighbour(other);
+		}
+	}
+
+	std::sort(m_pairs.begin() + static_cast<std::ptrdiff_t>(numKeptPairs), m_pairs.end(), IsPairLess);
+	std::inplace_merge(m_pairs.begin(), m_pairs.begin() + static_cast<std::ptrdiff_t>(numKeptPairs), m_pairs.end(), IsPairLess);
+	out_pairs = m_pairs;
+}
@@ -0,0 +1,75 @@
+//----------------------------------------------------------------------------------------------------
+// OverlapPairs.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct Convex2;
+
+//----------------------------------------------------------------------------------------------------
+// ConvexPair - Two intersecting convexes by scene index, always with m_objectIdA < m_objectIdB
+//----------------------------------------------------------------------------------------------------
+struct ConvexPair
+{
+	int m_objectIdA = -1;
+	int m_objectIdB = -1;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct SweepInterval
+{
+	float m_min      = 0.f;
+	float m_max      = 0.f;
+	int   m_objectId = -1;
+};
+
+//----------------------------------------------------------------------------------------------------
+enum class eSweepAxis : int8_t
+{
+	X,
+	Y
+};
+
+//----------------------------------------------------------------------------------------------------
+// OverlapPairFinder - Scene-wide intersecting pairs via sort-and-sweep plus a SAT narrow phase
+//
+// The sweep runs along whichever axis the object centers spread out most on, which keeps the
+// active interval list short. Ids are indices into the convex array passed in (the same as
+// m_objectId once the scene has assigned them). The finder keeps the sorted intervals and
+// pair list between calls so frames where only a few objects moved can be patched in place.
+//----------------------------------------------------------------------------------------------------
+class OverlapPairFinder
+{
+public:
+	void FindAllPairs(std::vector<Convex2*> const& convexes, std::vector<ConvexPair>& out_pairs, int numThreads = 0);
+	void UpdateMovedPairs(std::vector<Convex2*> const& convexes, std::span<int const> movedObjectIds, std::vector<ConvexPair>& out_pairs, int numThreads = 0);
+
+	eSweepAxis GetSweepAxis() const { return m_axis; }
+	int        GetNumFullPasses() const { return m_numFullPasses; }
+	int        GetNumIncrementalPasses() const { return m_numIncrementalPasses; }
+
+	// Above this fraction of moved objects a full sweep is cheaper than patching
+	float m_incrementalMovedFraction = 0.125f;
+
+private:
+	void  RebuildIntervals(std::vector<Convex2*> const& convexes);
+	void  SweepRange(std::vector<Convex2*> const& convexes, int firstSlot, int lastSlot, std::vector<ConvexPair>& out_pairs) const;
+	float GetIntervalMin(Convex2 const& convex) const;
+	float GetIntervalMax(Convex2 const& convex) const;
+
+	eSweepAxis                           m_axis = eSweepAxis::X;
+	std::vector<SweepInterval>           m_intervals;      // Sorted by m_min
+	std::vector<int>                     m_slotOfObject;   // Object id -> index into m_intervals
+	std::vector<ConvexPair>              m_pairs;          // Sorted current result
+	std::vector<std::vector<ConvexPair>> m_threadPairs;    // Per-worker output, reused across passes
+	std::vector<uint8_t>                 m_isMoved;
+	float                                m_maxExtent = 0.f; // Widest interval, bounds the backward scan
+	int                                  m_numFullPasses        = 0;
+	int                                  m_numIncrementalPasses = 0;
+};
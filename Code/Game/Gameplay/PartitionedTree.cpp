@@ -0,0 +1,771 @@
+//----------------------------------------------------------------------------------------------------
+// PartitionedTree.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/PartitionedTree.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/NearestQuery.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+#include "Game/Gameplay/ShapeCast.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/RaycastUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int   STATIC_BVH_NUM_BINS       = 12;
+constexpr int   STATIC_BVH_MAX_LEAF_SIZE  = 4;
+constexpr float STATIC_BVH_TRAVERSAL_COST = 0.5f;  // Relative to one convex test
+constexpr float STATIC_REBUILD_FRACTION   = 0.1f;  // Of the static set, promoted or removed since the last build
+
+//----------------------------------------------------------------------------------------------------
+static AABB2 GetUnionOfBounds(AABB2 const& boundsA, AABB2 const& boundsB)
+{
+	return AABB2(Vec2(std::min(boundsA.m_mins.x, boundsB.m_mins.x), std::min(boundsA.m_mins.y, boundsB.m_mins.y)),
+				 Vec2(std::max(boundsA.m_maxs.x, boundsB.m_maxs.x), std::max(boundsA.m_maxs.y, boundsB.m_maxs.y)));
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetHalfPerimeter - The 2D surface area heuristic: a random ray hits a box in proportion to it
+//----------------------------------------------------------------------------------------------------
+static float GetHalfPerimeter(AABB2 const& bounds)
+{
+	return (bounds.m_maxs.x - bounds.m_mins.x) + (bounds.m_maxs.y - bounds.m_mins.y);
+}
+
+//----------------------------------------------------------------------------------------------------
+static bool IsFartherEntry(QueryStackEntry const& a, QueryStackEntry const& b)
+{
+	return a.m_entryDist > b.m_entryDist;
+}
+
+//----------------------------------------------------------------------------------------------------
+static void PushNearestEntry(std::vector<QueryStackEntry>& heap, int nodeIndex, float dist)
+{
+	heap.push_back({nodeIndex, dist});
+	std::push_heap(heap.begin(), heap.end(), IsFartherEntry);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Build - Leaves and centers are indexed by object id, so objects without one (m_objectId < 0) are
+// left out rather than written out of bounds
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::Build(std::span<Convex2* const> convexes)
+{
+	m_nodes.clear();
+	m_leafConvexes.clear();
+	m_numRemoved = 0;
+
+	int maxObjectId = -1;
+	for (Convex2* convex : convexes)
+	{
+		if (convex->m_objectId >= 0)
+		{
+			m_leafConvexes.push_back(convex);
+			maxObjectId = std::max(maxObjectId, convex->m_objectId);
+		}
+	}
+	m_numObjects = static_cast<int>(m_leafConvexes.size());
+	m_leafOfObject.assign(maxObjectId + 1, -1);
+	if (m_numObjects == 0)
+	{
+		return;
+	}
+
+	// Centers are indexed by object id so the partition can reorder m_leafConvexes freely
+	std::vector<Vec2> centers(maxObjectId + 1);
+	for (Convex2 const* convex : m_leafConvexes)
+	{
+		centers[convex->m_objectId] = convex->m_boundingAABB.GetCenter();
+	}
+
+	m_nodes.reserve(2 * m_numObjects);
+	m_nodes.emplace_back();
+	BuildNode(0, 0, m_numObjects, centers);
+}
+
+//----------------------------------------------------------------------------------------------------
+// BuildNode - Binned SAH on both axes; splits in half when every center coincides
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::BuildNode(int nodeIndex, int first, int count, std::span<Vec2 const> centers)
+{
+	AABB2 bounds = m_leafConvexes[first]->m_boundingAABB;
+	Vec2  firstCenter = centers[m_leafConvexes[first]->m_objectId];
+	AABB2 centerBounds(firstCenter, firstCenter);
+	uint16_t categoryMask = m_leafConvexes[first]->m_categoryMask;
+	for (int i = first + 1; i < first + count; ++i)
+	{
+		Vec2 const& center = centers[m_leafConvexes[i]->m_objectId];
+		bounds       = GetUnionOfBounds(bounds, m_leafConvexes[i]->m_boundingAABB);
+		centerBounds = GetUnionOfBounds(centerBounds, AABB2(center, center));
+		categoryMask |= m_leafConvexes[i]->m_categoryMask;
+	}
+	m_nodes[nodeIndex].m_bounds       = bounds;
+	m_nodes[nodeIndex].m_categoryMask = categoryMask;
+
+	auto makeLeaf = [&]()
+	{
+		m_nodes[nodeIndex].m_firstChild  = -1;
+		m_nodes[nodeIndex].m_firstObject = first;
+		m_nodes[nodeIndex].m_numObjects  = count;
+		for (int i = first; i < first + count; ++i)
+		{
+			m_leafOfObject[m_leafConvexes[i]->m_objectId] = nodeIndex;
+		}
+	};
+	if (count <= 2)
+	{
+		makeLeaf();
+		return;
+	}
+
+	struct Bin
+	{
+		AABB2 m_bounds;
+		int   m_count = 0;
+	};
+
+	float bestCost  = FLT_MAX;
+	int   bestAxis  = -1;
+	int   bestSplit = 0;
+	Vec2  centerExtent = centerBounds.GetDimensions();
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		float axisMin    = (axis == 0) ? centerBounds.m_mins.x : centerBounds.m_mins.y;
+		float axisExtent = (axis == 0) ? centerExtent.x : centerExtent.y;
+		if (axisExtent <= 0.f)
+		{
+			continue;
+		}
+
+		Bin   bins[STATIC_BVH_NUM_BINS];
+		float binScale = static_cast<float>(STATIC_BVH_NUM_BINS) / axisExtent;
+		for (int i = first; i < first + count; ++i)
+		{
+			Convex2 const* convex = m_leafConvexes[i];
+			Vec2 const&    center = centers[convex->m_objectId];
+			int binIndex = std::min(static_cast<int>((((axis == 0) ? center.x : center.y) - axisMin) * binScale), STATIC_BVH_NUM_BINS - 1);
+			bins[binIndex].m_bounds = (bins[binIndex].m_count == 0) ? convex->m_boundingAABB : GetUnionOfBounds(bins[binIndex].m_bounds, convex->m_boundingAABB);
+			++bins[binIndex].m_count;
+		}
+
+		// Sweep from the right so each split plane's right-hand cost is ready for the left sweep
+		float rightCosts[STATIC_BVH_NUM_BINS] = {};
+		AABB2 rightBounds;
+		int   rightCount = 0;
+		for (int b = STATIC_BVH_NUM_BINS - 1; b > 0; --b)
+		{
+			if (bins[b].m_count > 0)
+			{
+				rightBounds = (rightCount == 0) ? bins[b].m_bounds : GetUnionOfBounds(rightBounds, bins[b].m_bounds);
+				rightCount += bins[b].m_count;
+			}
+			rightCosts[b] = (rightCount == 0) ? 0.f : GetHalfPerimeter(rightBounds) * static_cast<float>(rightCount);
+		}
+
+		AABB2 leftBounds;
+		int   leftCount = 0;
+		for (int b = 0; b < STATIC_BVH_NUM_BINS - 1; ++b)
+		{
+			if (bins[b].m_count > 0)
+			{
+				leftBounds = (leftCount == 0) ? bins[b].m_bounds : GetUnionOfBounds(leftBounds, bins[b].m_bounds);
+				leftCount += bins[b].m_count;
+			}
+			if (leftCount == 0 || leftCount == count)
+			{
+				continue;
+			}
+			float cost = GetHalfPerimeter(leftBounds) * static_cast<float>(leftCount) + rightCosts[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost  = cost;
+				bestAxis  = axis;
+				bestSplit = b + 1;
+			}
+		}
+	}
+
+	float parentArea = std::max(GetHalfPerimeter(bounds), FLT_MIN);
+	float splitCost  = STATIC_BVH_TRAVERSAL_COST + bestCost / parentArea;
+	if (count <= STATIC_BVH_MAX_LEAF_SIZE && splitCost >= static_cast<float>(count))
+	{
+		makeLeaf();
+		return;
+	}
+
+	Convex2** begin  = m_leafConvexes.data() + first;
+	Convex2** end    = begin + count;
+	int       middle = first + count / 2;
+	if (bestAxis >= 0)
+	{
+		float axisMin  = (bestAxis == 0) ? centerBounds.m_mins.x : centerBounds.m_mins.y;
+		float binScale = static_cast<float>(STATIC_BVH_NUM_BINS) / ((bestAxis == 0) ? centerExtent.x : centerExtent.y);
+		middle = first + static_cast<int>(std::partition(begin, end, [&](Convex2 const* convex)
+		{
+			Vec2 const& center = centers[convex->m_objectId];
+			return std::min(static_cast<int>((((bestAxis == 0) ? center.x : center.y) - axisMin) * binScale), STATIC_BVH_NUM_BINS - 1) < bestSplit;
+		}) - begin);
+	}
+	else if (count <= STATIC_BVH_MAX_LEAF_SIZE)
+	{
+		makeLeaf();
+		return;
+	}
+
+	int leftChild = static_cast<int>(m_nodes.size());
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+	m_nodes[nodeIndex].m_firstChild = leftChild;
+	BuildNode(leftChild, first, middle - first, centers);
+	BuildNode(leftChild + 1, middle, first + count - middle, centers);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Remove - Swap the object out of its leaf's live range; returns false if it is not in the tree
+//----------------------------------------------------------------------------------------------------
+bool StaticBVH::Remove(Convex2 const& convex)
+{
+	int objectId = convex.m_objectId;
+	if (objectId < 0 || objectId >= static_cast<int>(m_leafOfObject.size()) || m_leafOfObject[objectId] < 0)
+	{
+		return false;
+	}
+
+	StaticBVHNode& leaf = m_nodes[m_leafOfObject[objectId]];
+	int last = leaf.m_firstObject + leaf.m_numObjects - 1;
+	for (int i = leaf.m_firstObject; i <= last; ++i)
+	{
+		if (m_leafConvexes[i] == &convex)
+		{
+			std::swap(m_leafConvexes[i], m_leafConvexes[last]);
+			--leaf.m_numObjects;
+			break;
+		}
+	}
+	m_leafOfObject[objectId] = -1;
+	--m_numObjects;
+	++m_numRemoved;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::Clear()
+{
+	m_nodes.clear();
+	m_leafConvexes.clear();
+	m_leafOfObject.clear();
+	m_numObjects = 0;
+	m_numRemoved = 0;
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateCategoryMasks - Children always follow their parent in m_nodes, so a reverse sweep is bottom-up
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::UpdateCategoryMasks()
+{
+	for (int i = static_cast<int>(m_nodes.size()) - 1; i >= 0; --i)
+	{
+		StaticBVHNode& node = m_nodes[i];
+		if (!node.IsLeaf())
+		{
+			node.m_categoryMask = m_nodes[node.m_firstChild].m_categoryMask | m_nodes[node.m_firstChild + 1].m_categoryMask;
+			continue;
+		}
+		node.m_categoryMask = 0;
+		for (int j = node.m_firstObject; j < node.m_firstObject + node.m_numObjects; ++j)
+		{
+			node.m_categoryMask |= m_leafConvexes[j]->m_categoryMask;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// RaycastClosest - Near-to-far traversal; the best hit so far prunes the rest of the tree
+//----------------------------------------------------------------------------------------------------
+bool StaticBVH::RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	float rootEntry = 0.f;
+	if (m_numObjects == 0 || !filter.MayAcceptAny(m_nodes[0].m_categoryMask) || !GetRayEntryDistVsAABB2D(rootEntry, startPos, forwardVec, std::min(maxDist, inout_best.m_dist), m_nodes[0].m_bounds))
+	{
+		return inout_best.m_objectId != -1;
+	}
+	stack.push_back({0, rootEntry});
+
+	RaycastResult2D rayRes;
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		float searchDist = std::min(maxDist, inout_best.m_dist);
+		if (entry.m_entryDist > searchDist)
+		{
+			continue;
+		}
+
+		StaticBVHNode const& node = m_nodes[entry.m_nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (int i = node.m_firstObject; i < node.m_firstObject + node.m_numObjects; ++i)
+			{
+				Convex2 const* convex = m_leafConvexes[i];
+				if (filter.Accepts(convex->m_categoryMask) && convex->RayCastVsConvex2D(rayRes, startPos, forwardVec, searchDist, false, true) && rayRes.m_impactLength < inout_best.m_dist)
+				{
+					inout_best.m_dist     = rayRes.m_impactLength;
+					inout_best.m_objectId = convex->m_objectId;
+					inout_best.m_normal   = rayRes.m_impactNormal;
+					searchDist            = std::min(maxDist, inout_best.m_dist);
+				}
+			}
+			continue;
+		}
+
+		float leftEntry  = 0.f;
+		float rightEntry = 0.f;
+		bool  hitsLeft   = filter.MayAcceptAny(m_nodes[node.m_firstChild].m_categoryMask) && GetRayEntryDistVsAABB2D(leftEntry, startPos, forwardVec, searchDist, m_nodes[node.m_firstChild].m_bounds);
+		bool  hitsRight  = filter.MayAcceptAny(m_nodes[node.m_firstChild + 1].m_categoryMask) && GetRayEntryDistVsAABB2D(rightEntry, startPos, forwardVec, searchDist, m_nodes[node.m_firstChild + 1].m_bounds);
+
+		// Push the farther child first so the nearer one is processed next
+		if (hitsLeft && hitsRight && leftEntry < rightEntry)
+		{
+			stack.push_back({node.m_firstChild + 1, rightEntry});
+			stack.push_back({node.m_firstChild, leftEntry});
+		}
+		else
+		{
+			if (hitsLeft)  stack.push_back({node.m_firstChild, leftEntry});
+			if (hitsRight) stack.push_back({node.m_firstChild + 1, rightEntry});
+		}
+	}
+	return inout_best.m_objectId != -1;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool StaticBVH::RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	if (m_numObjects > 0)
+	{
+		stack.push_back({0, 0.f});
+	}
+
+	RaycastResult2D rayRes;
+	while (!stack.empty())
+	{
+		StaticBVHNode const& node = m_nodes[stack.back().m_nodeIndex];
+		stack.pop_back();
+
+		float entryDist = 0.f;
+		if (!filter.MayAcceptAny(node.m_categoryMask) || !GetRayEntryDistVsAABB2D(entryDist, startPos, forwardVec, maxDist, node.m_bounds))
+		{
+			continue;
+		}
+		if (!node.IsLeaf())
+		{
+			stack.push_back({node.m_firstChild, 0.f});
+			stack.push_back({node.m_firstChild + 1, 0.f});
+			continue;
+		}
+		for (int i = node.m_firstObject; i < node.m_firstObject + node.m_numObjects; ++i)
+		{
+			Convex2 const* convex = m_leafConvexes[i];
+			if (filter.Accepts(convex->m_categoryMask) && convex->RayCastVsConvex2D(rayRes, startPos, forwardVec, maxDist, false, true))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	float rootEntry = 0.f;
+	if (m_numObjects == 0 || !filter.MayAcceptAny(m_nodes[0].m_categoryMask) || !GetRayEntryDistVsAABB2D(rootEntry, startPos, forwardVec, maxDist, m_nodes[0].m_bounds))
+	{
+		return;
+	}
+	stack.push_back({0, rootEntry});
+
+	RayPenetration penetration;
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.m_entryDist > collector.GetPruneDist())
+		{
+			continue;
+		}
+
+		StaticBVHNode const& node = m_nodes[entry.m_nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (int i = node.m_firstObject; i < node.m_firstObject + node.m_numObjects; ++i)
+			{
+				Convex2 const* convex = m_leafConvexes[i];
+				if (filter.Accepts(convex->m_categoryMask) && convex->GetRayPenetration(penetration, startPos, forwardVec, maxDist))
+				{
+					collector.Insert(penetration);
+				}
+			}
+			continue;
+		}
+
+		float leftEntry  = 0.f;
+		float rightEntry = 0.f;
+		bool  hitsLeft   = filter.MayAcceptAny(m_nodes[node.m_firstChild].m_categoryMask) && GetRayEntryDistVsAABB2D(leftEntry, startPos, forwardVec, maxDist, m_nodes[node.m_firstChild].m_bounds);
+		bool  hitsRight  = filter.MayAcceptAny(m_nodes[node.m_firstChild + 1].m_categoryMask) && GetRayEntryDistVsAABB2D(rightEntry, startPos, forwardVec, maxDist, m_nodes[node.m_firstChild + 1].m_bounds);
+		if (hitsLeft && hitsRight && leftEntry < rightEntry)
+		{
+			stack.push_back({node.m_firstChild + 1, rightEntry});
+			stack.push_back({node.m_firstChild, leftEntry});
+		}
+		else
+		{
+			if (hitsLeft)  stack.push_back({node.m_firstChild, leftEntry});
+			if (hitsRight) stack.push_back({node.m_firstChild + 1, rightEntry});
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+
+	float rootEntry = 0.f;
+	if (m_numObjects == 0 || !filter.MayAcceptAny(m_nodes[0].m_categoryMask) || !collector.GetEntryDistVsBounds(rootEntry, m_nodes[0].m_bounds))
+	{
+		return;
+	}
+	stack.push_back({0, rootEntry});
+
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.m_entryDist > collector.GetPruneDist())
+		{
+			continue;
+		}
+
+		StaticBVHNode const& node = m_nodes[entry.m_nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (int i = node.m_firstObject; i < node.m_firstObject + node.m_numObjects; ++i)
+			{
+				if (filter.Accepts(m_leafConvexes[i]->m_categoryMask))
+				{
+					collector.Consider(*m_leafConvexes[i]);
+				}
+			}
+			continue;
+		}
+
+		float leftEntry  = 0.f;
+		float rightEntry = 0.f;
+		bool  hitsLeft   = filter.MayAcceptAny(m_nodes[node.m_firstChild].m_categoryMask) && collector.GetEntryDistVsBounds(leftEntry, m_nodes[node.m_firstChild].m_bounds);
+		bool  hitsRight  = filter.MayAcceptAny(m_nodes[node.m_firstChild + 1].m_categoryMask) && collector.GetEntryDistVsBounds(rightEntry, m_nodes[node.m_firstChild + 1].m_bounds);
+		if (hitsLeft && hitsRight && leftEntry < rightEntry)
+		{
+			stack.push_back({node.m_firstChild + 1, rightEntry});
+			stack.push_back({node.m_firstChild, leftEntry});
+		}
+		else
+		{
+			if (hitsLeft)  stack.push_back({node.m_firstChild, leftEntry});
+			if (hitsRight) stack.push_back({node.m_firstChild + 1, rightEntry});
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	if (m_numObjects > 0)
+	{
+		stack.push_back({0, 0.f});
+	}
+
+	while (!stack.empty())
+	{
+		StaticBVHNode const& node = m_nodes[stack.back().m_nodeIndex];
+		stack.pop_back();
+		if (!filter.MayAcceptAny(node.m_categoryMask) || !shape.OverlapsBounds(node.m_bounds))
+		{
+			continue;
+		}
+		if (!node.IsLeaf())
+		{
+			stack.push_back({node.m_firstChild, 0.f});
+			stack.push_back({node.m_firstChild + 1, 0.f});
+			continue;
+		}
+
+		for (int i = node.m_firstObject; i < node.m_firstObject + node.m_numObjects; ++i)
+		{
+			Convex2 const* convex = m_leafConvexes[i];
+			if (filter.Accepts(convex->m_categoryMask) && shape.OverlapsBounds(convex->m_boundingAABB) && shape.OverlapsConvex(*convex))
+			{
+				collector.Add(convex->m_objectId);
+				if (collector.m_isDone)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectNearestConvexes - Best-first descent ordered by distance to node bounds
+//----------------------------------------------------------------------------------------------------
+void StaticBVH::CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	if (m_numObjects == 0 || !filter.MayAcceptAny(m_nodes[0].m_categoryMask))
+	{
+		return;
+	}
+
+	Vec2 const& point = collector.m_queryPoint;
+	PushNearestEntry(stack, 0, GetDistanceToAABB2(point, m_nodes[0].m_bounds));
+	while (!stack.empty())
+	{
+		std::pop_heap(stack.begin(), stack.end(), IsFartherEntry);
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+
+		// Every remaining node is at least this far away
+		if (entry.m_entryDist > collector.GetSearchRadius())
+		{
+			return;
+		}
+
+		StaticBVHNode const& node = m_nodes[entry.m_nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (int i = node.m_firstObject; i < node.m_firstObject + node.m_numObjects; ++i)
+			{
+				if (filter.Accepts(m_leafConvexes[i]->m_categoryMask))
+				{
+					collector.Consider(*m_leafConvexes[i]);
+				}
+			}
+			continue;
+		}
+		for (int child = node.m_firstChild; child <= node.m_firstChild + 1; ++child)
+		{
+			if (filter.MayAcceptAny(m_nodes[child].m_categoryMask))
+			{
+				PushNearestEntry(stack, child, GetDistanceToAABB2(point, m_nodes[child].m_bounds));
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+AcceleratorStats StaticBVH::GetStats() const
+{
+	AcceleratorStats stats;
+	stats.m_numNodes = static_cast<int>(m_nodes.size());
+	for (StaticBVHNode const& node : m_nodes)
+	{
+		if (node.IsLeaf())
+		{
+			++stats.m_numLeaves;
+			stats.m_numObjectRefs += node.m_numObjects;
+			stats.m_maxLeafObjects = std::max(stats.m_maxLeafObjects, node.m_numObjects);
+		}
+	}
+	return stats;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t StaticBVH::GetMemoryBytes() const
+{
+	return m_nodes.capacity() * sizeof(StaticBVHNode) + m_leafConvexes.capacity() * sizeof(Convex2*) + m_leafOfObject.capacity() * sizeof(int);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Build - Splits the scene on each object's m_isDynamic tag
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::Build(std::vector<Convex2*> const& convexes, AABB2 const& totalBounds)
+{
+	m_convexes    = &convexes;
+	m_totalBounds = totalBounds;
+	RebuildStaticTree();
+}
+
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::RebuildStaticTree()
+{
+	m_staticScratch.clear();
+	m_dynamicConvexes.clear();
+	for (Convex2* convex : *m_convexes)
+	{
+		(convex->m_isDynamic ? m_dynamicConvexes : m_staticScratch).push_back(convex);
+	}
+	m_staticTree.Build(m_staticScratch);
+	m_dynamicTree.Build(m_dynamicConvexes, m_totalBounds);
+	m_numPendingPromotions = 0;
+	m_isDynamicTreeStale   = false;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Refit - Rebuild the static tree once promotions and removals reach STATIC_REBUILD_FRACTION of it;
+// otherwise only the dynamic tree is touched: rebuilt if its membership changed, refit if not
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::Refit()
+{
+	if (m_convexes == nullptr)
+	{
+		return;
+	}
+
+	int numStale = m_numPendingPromotions + m_staticTree.GetNumRemoved();
+	if (numStale > 0 && static_cast<float>(numStale) > STATIC_REBUILD_FRACTION * static_cast<float>(m_staticTree.GetNumObjects() + m_numPendingPromotions))
+	{
+		RebuildStaticTree();
+		++m_numStaticRebuilds;
+	}
+	else if (m_isDynamicTreeStale)
+	{
+		m_dynamicTree.Build(m_dynamicConvexes, m_totalBounds);
+		m_isDynamicTreeStale = false;
+	}
+	else
+	{
+		m_dynamicTree.Refit();
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateCategoryMasks - Call after objects change category; Refit keeps the masks as they are
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::UpdateCategoryMasks()
+{
+	m_staticTree.UpdateCategoryMasks();
+	m_dynamicTree.UpdateCategoryMasks();
+}
+
+//----------------------------------------------------------------------------------------------------
+// Promote - Tag the object static; it moves into the static tree on the next static rebuild
+//----------------------------------------------------------------------------------------------------
+bool PartitionedTree::Promote(Convex2& convex)
+{
+	if (!convex.m_isDynamic)
+	{
+		return false;
+	}
+	convex.m_isDynamic = false;
+	++m_numPendingPromotions;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Demote - Tag the object dynamic and take it out of the static tree before it moves
+//----------------------------------------------------------------------------------------------------
+bool PartitionedTree::Demote(Convex2& convex)
+{
+	if (convex.m_isDynamic)
+	{
+		return false;
+	}
+	convex.m_isDynamic = true;
+	if (m_staticTree.Remove(convex))
+	{
+		m_dynamicConvexes.push_back(&convex);
+		m_isDynamicTreeStale = true;
+	}
+	else if (std::find(m_dynamicConvexes.begin(), m_dynamicConvexes.end(), &convex) != m_dynamicConvexes.end())
+	{
+		// A pending promotion never left the dynamic tree
+		--m_numPendingPromotions;
+	}
+	else
+	{
+		// In neither tree, e.g. added to the scene since the last Build
+		m_dynamicConvexes.push_back(&convex);
+		m_isDynamicTreeStale = true;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool PartitionedTree::RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter) const
+{
+	m_staticTree.RaycastClosest(startPos, forwardVec, maxDist, scratch, inout_best, filter);
+	return m_dynamicTree.RaycastClosest(startPos, forwardVec, maxDist, scratch, inout_best, filter);
+}
+
+//----------------------------------------------------------------------------------------------------
+bool PartitionedTree::RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter) const
+{
+	return m_staticTree.RaycastAny(startPos, forwardVec, maxDist, scratch, filter) || m_dynamicTree.RaycastAny(startPos, forwardVec, maxDist, scratch, filter);
+}
+
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter) const
+{
+	m_staticTree.CollectRayPenetrations(startPos, forwardVec, maxDist, scratch, collector, filter);
+	m_dynamicTree.CollectRayPenetrations(startPos, forwardVec, maxDist, scratch, collector, filter);
+}
+
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter) const
+{
+	m_staticTree.CollectRegionOverlaps(shape, scratch, collector, filter);
+	if (!collector.m_isDone)
+	{
+		m_dynamicTree.CollectRegionOverlaps(shape, scratch, collector, filter);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter) const
+{
+	m_staticTree.CollectNearestConvexes(scratch, collector, filter);
+	m_dynamicTree.CollectNearestConvexes(scratch, collector, filter);
+}
+
+//----------------------------------------------------------------------------------------------------
+void PartitionedTree::CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter) const
+{
+	m_staticTree.CollectShapeCastHits(scratch, collector, filter);
+	m_dynamicTree.CollectShapeCastHits(scratch, collector, filter);
+}
+
+//----------------------------------------------------------------------------------------------------
+AcceleratorStats PartitionedTree::GetStats() const
+{
+	AcceleratorStats stats        = m_staticTree.GetStats();
+	AcceleratorStats dynamicStats = m_dynamicTree.GetStats();
+	stats.m_numNodes       += dynamicStats.m_numNodes;
+	stats.m_numLeaves      += dynamicStats.m_numLeaves;
+	stats.m_numObjectRefs  += dynamicStats.m_numObjectRefs;
+	stats.m_maxLeafObjects  = std::max(stats.m_maxLeafObjects, dynamicStats.m_maxLeafObjects);
+	return stats;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t PartitionedTree::GetMemoryBytes() const
+{
+	return m_staticTree.GetMemoryBytes() + m_dynamicTree.GetMemoryBytes() + (m_dynamicConvexes.capacity() + m_staticScratch.capacity()) * sizeof(Convex2*);
+}
@@ -0,0 +1,127 @@
+//----------------------------------------------------------------------------------------------------
+// PartitionedTree.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/BVH.hpp"
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct ClosestRayHit;
+struct Convex2;
+struct NearestConvexCollector;
+struct RayPenetrationCollector;
+struct RegionOverlapCollector;
+struct RegionQueryShape;
+struct ShapeCastCollector;
+struct Vec2;
+
+//----------------------------------------------------------------------------------------------------
+// Static tree node; a leaf (m_firstChild < 0) owns m_numObjects entries of the leaf array from
+// m_firstObject, an inner node has its children at m_firstChild and m_firstChild + 1
+//----------------------------------------------------------------------------------------------------
+struct StaticBVHNode
+{
+	AABB2    m_bounds;
+	int      m_firstChild   = -1;
+	int      m_firstObject  = 0;
+	int      m_numObjects   = 0;
+	uint16_t m_categoryMask = QUERY_CATEGORY_ALL; // OR of the objects' masks
+
+	bool IsLeaf() const { return m_firstChild < 0; }
+};
+
+//----------------------------------------------------------------------------------------------------
+// StaticBVH - Binned-SAH tree for geometry that does not move
+//
+// Splits are chosen by the surface area heuristic (perimeter in 2D) over centroid bins on both axes,
+// so the tree costs more to build than the fixed-depth AABB2Tree but culls far better. Objects can be
+// removed in place; their leaf shrinks but node bounds stay as built until the next Build.
+//----------------------------------------------------------------------------------------------------
+class StaticBVH
+{
+public:
+	void Build(std::span<Convex2* const> convexes);
+	bool Remove(Convex2 const& convex);
+	void Clear();
+
+	int  GetNumObjects() const { return m_numObjects; }
+	int  GetNumRemoved() const { return m_numRemoved; }
+	void UpdateCategoryMasks();
+
+	bool RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter = QueryFilter()) const;
+	bool RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter = QueryFilter()) const;
+	void CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+
+	AcceleratorStats GetStats() const;
+	size_t           GetMemoryBytes() const;
+
+private:
+	void BuildNode(int nodeIndex, int first, int count, std::span<Vec2 const> centers);
+
+	std::vector<StaticBVHNode> m_nodes;
+	std::vector<Convex2*>      m_leafConvexes;     // Tree order, so a leaf's objects are contiguous
+	std::vector<int>           m_leafOfObject;     // Indexed by m_objectId; -1 when not in the tree
+	int                        m_numObjects = 0;
+	int                        m_numRemoved = 0;   // Removed since the last Build
+};
+
+//----------------------------------------------------------------------------------------------------
+// PartitionedTree - Static objects in a StaticBVH, dynamic ones (Convex2::m_isDynamic) in an AABB2Tree
+//
+// Moving a few objects then only refits the small dynamic tree. Queries run the static tree first and
+// the dynamic tree second with the same best hit or collector, so whichever hits first bounds the
+// other. Demote removes an object from the static tree at once. A promoted object stays in the
+// dynamic tree until enough promotions and removals pile up to pay for a static rebuild, which
+// happens in Refit. Call Refit after Promote / Demote and after dynamic objects move.
+//----------------------------------------------------------------------------------------------------
+class PartitionedTree
+{
+public:
+	static constexpr eQueryMode QUERY_MODE = eQueryMode::PARTITIONED;
+	static char const*          GetName() { return "Split"; }
+
+	bool Promote(Convex2& convex);
+	bool Demote(Convex2& convex);
+
+	int GetNumStatic() const { return m_staticTree.GetNumObjects(); }
+	int GetNumDynamic() const { return static_cast<int>(m_dynamicConvexes.size()); }
+	int GetNumStaticRebuilds() const { return m_numStaticRebuilds; }
+	void UpdateCategoryMasks();
+
+	void CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+
+	// SpatialAccelerator interface (see Accelerator.hpp)
+	void             Build(std::vector<Convex2*> const& convexes, AABB2 const& totalBounds);
+	void             Refit();
+	bool             RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter = QueryFilter()) const;
+	bool             RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter = QueryFilter()) const;
+	AcceleratorStats GetStats() const;
+	size_t           GetMemoryBytes() const;
+
+private:
+	void RebuildStaticTree();
+
+	std::vector<Convex2*> const* m_convexes = nullptr;
+	AABB2                        m_totalBounds;
+	StaticBVH                    m_staticTree;
+	AABB2Tree                    m_dynamicTree;
+	std::vector<Convex2*>        m_dynamicConvexes;            // Includes promoted objects awaiting a static rebuild
+	std::vector<Convex2*>        m_staticScratch;              // Reused by static rebuilds
+	int                          m_numPendingPromotions = 0;
+	int                          m_numStaticRebuilds    = 0;
+	bool                         m_isDynamicTreeStale   = false;
+};
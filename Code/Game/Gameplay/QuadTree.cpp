@@ -3,12 +3,22 @@
 //----------------------------------------------------------------------------------------------------
 
 //----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
 #include "Game/Gameplay/Convex.hpp"
 #include "Game/Gameplay/QuadTree.hpp"
+#include "Game/Gameplay/NearestQuery.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+#include "Game/Gameplay/ShapeCast.hpp"
 
 #include "Engine/Math/MathUtils.hpp"
 #include "Engine/Math/RaycastUtils.hpp"
 
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int QUADTREE_LEAVES_PER_TASK = 16;
+
 //----------------------------------------------------------------------------------------------------
 static int IntPow(int x, unsigned int p)
 {
@@ -71,26 +81,22 @@ void SymmetricQuadTree::BuildTree(std::vector<Convex2*> const& convexArray, int
 			int numOfJInLevel = IntPow(4, i);
 			bool isLastLevel = (i == numOfRecursive - 1);
 
+			int firstOfLevel = sumK;
 			for (int j = 0; j < numOfJInLevel; ++j)
 			{
 				int parentIndex = GetParentIndex(sumK);
 				m_nodes[sumK].m_bounds = ComputeChildBounds(m_nodes[parentIndex].m_bounds, sumK, parentIndex);
-
-				// Only assign convexes at the last level (leaf nodes)
-				if (isLastLevel)
-				{
-					for (auto convex : convexArray)
-					{
-						if (DoAABB2sOverlap2D(convex->m_boundingAABB, m_nodes[sumK].m_bounds))
-						{
-							m_nodes[sumK].m_containingConvex.push_back(convex);
-						}
-					}
-				}
 				++sumK;
 			}
+
+			// Only assign convexes at the last level (leaf nodes); leaves are independent, so they split across tasks
+			if (isLastLevel)
+			{
+				BucketIntoLeaves(convexArray, firstOfLevel);
+			}
 		}
 	}
+	UpdateCategoryMasks();
 }
 
 //----------------------------------------------------------------------------------------------------
@@ -101,26 +107,23 @@ static bool RayHitsAABB2D(Vec2 const& startPos, Vec2 const& forwardVec, float ma
 }
 
 //----------------------------------------------------------------------------------------------------
-void SymmetricQuadTree::SolveRayResult(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, std::vector<Convex2*> const& convexArray, std::vector<Convex2*>& out_latentRes)
+void SymmetricQuadTree::GatherRayCandidates(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter) const
 {
-	for (auto convex : convexArray)
-	{
-		convex->m_symmetricQuadTreeFlag = false;
-	}
+	// Objects straddling several leaves are reported once per ray via the scratch visit stamps
+	scratch.BeginVisitPass();
 
 	int ptr = 0;
 	while (ptr < static_cast<int>(m_nodes.size()))
 	{
-		if (RayHitsAABB2D(startPos, forwardVec, maxDist, m_nodes[ptr].m_bounds))
+		if (filter.MayAcceptAny(m_nodes[ptr].m_categoryMask) && RayHitsAABB2D(startPos, forwardVec, maxDist, m_nodes[ptr].m_bounds))
 		{
 			if (!m_nodes[ptr].m_containingConvex.empty())
 			{
 				for (auto convex : m_nodes[ptr].m_containingConvex)
 				{
-					if (!convex->m_symmetricQuadTreeFlag)
+					if (filter.Accepts(convex->m_categoryMask) && scratch.MarkVisited(convex->m_objectId))
 					{
-						convex->m_symmetricQuadTreeFlag = true;
-						out_latentRes.push_back(convex);
+						scratch.m_candidates.push_back(convex);
 					}
 				}
 				while (ptr % 4 == 0 && ptr != 0)
@@ -161,31 +164,406 @@ void SymmetricQuadTree::SolveRayResult(Vec2 const& startPos, Vec2 const& forward
 }
 
 //----------------------------------------------------------------------------------------------------
-int SymmetricQuadTree::GetFirstLBChild(int index)
+// CollectRayPenetrations - Visits cells in the order the ray enters them
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	scratch.BeginVisitPass();
+
+	float rootEntry = 0.f;
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask) || !GetRayEntryDistVsAABB2D(rootEntry, startPos, forwardVec, maxDist, m_nodes[0].m_bounds))
+	{
+		return;
+	}
+	stack.push_back({0, rootEntry});
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	RayPenetration penetration;
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.m_entryDist > collector.GetPruneDist())
+		{
+			continue;
+		}
+
+		int firstChild = GetFirstLBChild(entry.m_nodeIndex);
+		if (firstChild >= numNodes)
+		{
+			for (Convex2 const* convex : m_nodes[entry.m_nodeIndex].m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask) && scratch.MarkVisited(convex->m_objectId) && convex->GetRayPenetration(penetration, startPos, forwardVec, maxDist))
+				{
+					collector.Insert(penetration);
+				}
+			}
+			continue;
+		}
+
+		// Sort the (at most 4) hit children far-to-near, then push in that order
+		QueryStackEntry children[4];
+		int numHitChildren = 0;
+		for (int child = firstChild; child <= GetForthRTChild(entry.m_nodeIndex); ++child)
+		{
+			float childEntry = 0.f;
+			if (filter.MayAcceptAny(m_nodes[child].m_categoryMask) && GetRayEntryDistVsAABB2D(childEntry, startPos, forwardVec, maxDist, m_nodes[child].m_bounds))
+			{
+				int slot = numHitChildren++;
+				while (slot > 0 && children[slot - 1].m_entryDist < childEntry)
+				{
+					children[slot] = children[slot - 1];
+					--slot;
+				}
+				children[slot] = {child, childEntry};
+			}
+		}
+		for (int i = 0; i < numHitChildren; ++i)
+		{
+			stack.push_back(children[i]);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectShapeCastHits - Cells inflated by the swept shape's extent, visited in entry order
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	scratch.BeginVisitPass();
+
+	float rootEntry = 0.f;
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask) || !collector.GetEntryDistVsBounds(rootEntry, m_nodes[0].m_bounds))
+	{
+		return;
+	}
+	stack.push_back({0, rootEntry});
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	while (!stack.empty())
+	{
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.m_entryDist > collector.GetPruneDist())
+		{
+			continue;
+		}
+
+		int firstChild = GetFirstLBChild(entry.m_nodeIndex);
+		if (firstChild >= numNodes)
+		{
+			for (Convex2 const* convex : m_nodes[entry.m_nodeIndex].m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask) && scratch.MarkVisited(convex->m_objectId))
+				{
+					collector.Consider(*convex);
+				}
+			}
+			continue;
+		}
+
+		QueryStackEntry children[4];
+		int numHitChildren = 0;
+		for (int child = firstChild; child <= GetForthRTChild(entry.m_nodeIndex); ++child)
+		{
+			float childEntry = 0.f;
+			if (filter.MayAcceptAny(m_nodes[child].m_categoryMask) && collector.GetEntryDistVsBounds(childEntry, m_nodes[child].m_bounds))
+			{
+				int slot = numHitChildren++;
+				while (slot > 0 && children[slot - 1].m_entryDist < childEntry)
+				{
+					children[slot] = children[slot - 1];
+					--slot;
+				}
+				children[slot] = {child, childEntry};
+			}
+		}
+		for (int i = 0; i < numHitChildren; ++i)
+		{
+			stack.push_back(children[i]);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectRegionOverlaps - Objects straddling several cells are tested once via visit stamps
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	scratch.BeginVisitPass();
+
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask))
+	{
+		return;
+	}
+	stack.push_back({0, 0.f});
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	while (!stack.empty())
+	{
+		int nodeIndex = stack.back().m_nodeIndex;
+		stack.pop_back();
+
+		SymmetricQuadTreeNode const& node = m_nodes[nodeIndex];
+		if (!shape.OverlapsBounds(node.m_bounds))
+		{
+			continue;
+		}
+
+		if (GetFirstLBChild(nodeIndex) >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask) && scratch.MarkVisited(convex->m_objectId) && shape.OverlapsBounds(convex->m_boundingAABB) && shape.OverlapsConvex(*convex))
+				{
+					collector.Add(convex->m_objectId);
+					if (collector.m_isDone)
+					{
+						return;
+					}
+				}
+			}
+			continue;
+		}
+
+		for (int child = GetFirstLBChild(nodeIndex); child <= GetForthRTChild(nodeIndex); ++child)
+		{
+			if (filter.MayAcceptAny(m_nodes[child].m_categoryMask))
+			{
+				stack.push_back({child, 0.f});
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+static bool IsFartherEntry(QueryStackEntry const& a, QueryStackEntry const& b)
+{
+	return a.m_entryDist > b.m_entryDist;
+}
+
+//----------------------------------------------------------------------------------------------------
+// PushNearestEntry - m_nodeStack doubles as a min-heap on distance for best-first queries
+//----------------------------------------------------------------------------------------------------
+static void PushNearestEntry(std::vector<QueryStackEntry>& heap, int nodeIndex, float dist)
+{
+	heap.push_back({nodeIndex, dist});
+	std::push_heap(heap.begin(), heap.end(), IsFartherEntry);
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectNearestConvexes - Best-first descent; straddling objects are measured once via visit stamps
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter) const
+{
+	std::vector<QueryStackEntry>& stack = scratch.m_nodeStack;
+	stack.clear();
+	scratch.BeginVisitPass();
+
+	if (m_nodes.empty() || !filter.MayAcceptAny(m_nodes[0].m_categoryMask))
+	{
+		return;
+	}
+
+	Vec2 const& point = collector.m_queryPoint;
+	PushNearestEntry(stack, 0, GetDistanceToAABB2(point, m_nodes[0].m_bounds));
+
+	int numNodes = static_cast<int>(m_nodes.size());
+	while (!stack.empty())
+	{
+		std::pop_heap(stack.begin(), stack.end(), IsFartherEntry);
+		QueryStackEntry entry = stack.back();
+		stack.pop_back();
+
+		// Every remaining node is at least this far away
+		if (entry.m_entryDist > collector.GetSearchRadius())
+		{
+			return;
+		}
+
+		int nodeIndex = entry.m_nodeIndex;
+		SymmetricQuadTreeNode const& node = m_nodes[nodeIndex];
+		if (GetFirstLBChild(nodeIndex) >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				if (filter.Accepts(convex->m_categoryMask) && scratch.MarkVisited(convex->m_objectId))
+				{
+					collector.Consider(*convex);
+				}
+			}
+			continue;
+		}
+
+		for (int child = GetFirstLBChild(nodeIndex); child <= GetForthRTChild(nodeIndex); ++child)
+		{
+			if (filter.MayAcceptAny(m_nodes[child].m_categoryMask))
+			{
+				PushNearestEntry(stack, child, GetDistanceToAABB2(point, m_nodes[child].m_bounds));
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+int SymmetricQuadTree::GetFirstLBChild(int index) const
 {
 	return index * 4 + 1;
 }
 
 //----------------------------------------------------------------------------------------------------
-int SymmetricQuadTree::GetSecondRBChild(int index)
+int SymmetricQuadTree::GetSecondRBChild(int index) const
 {
 	return index * 4 + 2;
 }
 
 //----------------------------------------------------------------------------------------------------
-int SymmetricQuadTree::GetThirdLTChild(int index)
+int SymmetricQuadTree::GetThirdLTChild(int index) const
 {
 	return index * 4 + 3;
 }
 
 //----------------------------------------------------------------------------------------------------
-int SymmetricQuadTree::GetForthRTChild(int index)
+int SymmetricQuadTree::GetForthRTChild(int index) const
 {
 	return index * 4 + 4;
 }
 
 //----------------------------------------------------------------------------------------------------
-int SymmetricQuadTree::GetParentIndex(int index)
+int SymmetricQuadTree::GetParentIndex(int index) const
 {
 	return (index - 1) / 4;
 }
+
+//----------------------------------------------------------------------------------------------------
+// Build - Uses the tuned depth when one is set; otherwise four levels, an 8x8 grid of leaf cells
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::Build(std::vector<Convex2*> const& convexArray, AABB2 const& totalBounds)
+{
+	m_convexes = &convexArray;
+	BuildTree(convexArray, (m_buildDepth > 0) ? m_buildDepth : 4, totalBounds);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Refit - Leaf cells are fixed by the subdivision, so refitting re-buckets the whole scene passed to
+// Build. Objects that overlapped no leaf when they were last bucketed (moved outside the root
+// bounds) are picked up again once they move back in.
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::Refit()
+{
+	if (m_convexes == nullptr || m_nodes.empty())
+	{
+		return;
+	}
+	BucketIntoLeaves(*m_convexes, GetStartOfLastLevel());
+	UpdateCategoryMasks();
+}
+
+//----------------------------------------------------------------------------------------------------
+// UpdateCategoryMasks - Leaves OR their objects' masks, inner nodes their children's. Objects move
+// between leaves, so Build and Refit both end with this.
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::UpdateCategoryMasks()
+{
+	int numNodes = static_cast<int>(m_nodes.size());
+	for (int i = numNodes - 1; i >= 0; --i)
+	{
+		SymmetricQuadTreeNode& node = m_nodes[i];
+		node.m_categoryMask = 0;
+		if (GetFirstLBChild(i) >= numNodes)
+		{
+			for (Convex2 const* convex : node.m_containingConvex)
+			{
+				node.m_categoryMask |= convex->m_categoryMask;
+			}
+			continue;
+		}
+		for (int child = GetFirstLBChild(i); child <= GetForthRTChild(i); ++child)
+		{
+			node.m_categoryMask |= m_nodes[child].m_categoryMask;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// BucketIntoLeaves - Every leaf from startOfLastLevel on gets the objects whose box overlaps it
+//----------------------------------------------------------------------------------------------------
+void SymmetricQuadTree::BucketIntoLeaves(std::span<Convex2* const> objects, int startOfLastLevel)
+{
+	ParallelFor(startOfLastLevel, static_cast<int>(m_nodes.size()), QUADTREE_LEAVES_PER_TASK, [&](int firstLeaf, int lastLeaf)
+	{
+		for (int i = firstLeaf; i < lastLeaf; ++i)
+		{
+			SymmetricQuadTreeNode& node = m_nodes[i];
+			node.m_containingConvex.clear();
+			for (Convex2* convex : objects)
+			{
+				if (DoAABB2sOverlap2D(convex->m_boundingAABB, node.m_bounds))
+				{
+					node.m_containingConvex.push_back(convex);
+				}
+			}
+		}
+	});
+}
+
+//----------------------------------------------------------------------------------------------------
+bool SymmetricQuadTree::RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter) const
+{
+	float searchDist = std::min(maxDist, inout_best.m_dist);
+	scratch.m_candidates.clear();
+	GatherRayCandidates(startPos, forwardVec, searchDist, scratch, filter);
+	NarrowPhaseClosestHit(scratch.m_candidates, startPos, forwardVec, searchDist, true, true, inout_best);
+	return inout_best.m_objectId != -1;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool SymmetricQuadTree::RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter) const
+{
+	scratch.m_candidates.clear();
+	GatherRayCandidates(startPos, forwardVec, maxDist, scratch, filter);
+	return NarrowPhaseAnyHit(scratch.m_candidates, startPos, forwardVec, maxDist, true, true);
+}
+
+//----------------------------------------------------------------------------------------------------
+AcceleratorStats SymmetricQuadTree::GetStats() const
+{
+	int startOfLastLevel = GetStartOfLastLevel();
+
+	AcceleratorStats stats;
+	stats.m_numNodes  = static_cast<int>(m_nodes.size());
+	stats.m_numLeaves = static_cast<int>(m_nodes.size()) - startOfLastLevel;
+	for (int i = startOfLastLevel; i < static_cast<int>(m_nodes.size()); ++i)
+	{
+		int numObjects = static_cast<int>(m_nodes[i].m_containingConvex.size());
+		stats.m_numObjectRefs += numObjects;
+		stats.m_maxLeafObjects = std::max(stats.m_maxLeafObjects, numObjects);
+	}
+	return stats;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t SymmetricQuadTree::GetMemoryBytes() const
+{
+	size_t bytes = m_nodes.capacity() * sizeof(SymmetricQuadTreeNode);
+	for (SymmetricQuadTreeNode const& node : m_nodes)
+	{
+		bytes += node.m_containingConvex.capacity() * sizeof(Convex2*);
+	}
+	return bytes;
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetStartOfLastLevel - A full quadtree of N nodes has (3N + 1) / 4 leaves, stored last
+//----------------------------------------------------------------------------------------------------
+int SymmetricQuadTree::GetStartOfLastLevel() const
+{
+	int numNodes = static_cast<int>(m_nodes.size());
+	return numNodes - (3 * numNodes + 1) / 4;
+}
@@ -5,12 +5,22 @@
 //----------------------------------------------------------------------------------------------------
 #pragma once
 //----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
 #include "Engine/Math/AABB2.hpp"
 //----------------------------------------------------------------------------------------------------
+#include <span>
 #include <vector>
 
 //----------------------------------------------------------------------------------------------------
+struct ClosestRayHit;
 struct Convex2;
+struct NearestConvexCollector;
+struct RayPenetrationCollector;
+struct RegionOverlapCollector;
+struct RegionQueryShape;
+struct ShapeCastCollector;
+struct QueryScratch;
 struct Vec2;
 
 //----------------------------------------------------------------------------------------------------
@@ -18,21 +28,50 @@ struct SymmetricQuadTreeNode
 {
 	AABB2                  m_bounds;
 	std::vector<Convex2*>  m_containingConvex;
+	uint16_t               m_categoryMask = QUERY_CATEGORY_ALL; // OR of the masks of every object below
 };
 
 //----------------------------------------------------------------------------------------------------
 class SymmetricQuadTree
 {
 public:
+	static constexpr eQueryMode QUERY_MODE = eQueryMode::SYMMETRIC_QUADTREE;
+	static char const*          GetName() { return "QuadTree"; }
+
 	void BuildTree(std::vector<Convex2*> const& convexArray, int numOfRecursive, AABB2 const& totalBounds);
-	void SolveRayResult(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, std::vector<Convex2*> const& convexArray, std::vector<Convex2*>& out_latentRes);
+	void GatherRayCandidates(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter = QueryFilter()) const;
+	void CollectRayPenetrations(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, RayPenetrationCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectRegionOverlaps(RegionQueryShape const& shape, QueryScratch& scratch, RegionOverlapCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectNearestConvexes(QueryScratch& scratch, NearestConvexCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void CollectShapeCastHits(QueryScratch& scratch, ShapeCastCollector& collector, QueryFilter const& filter = QueryFilter()) const;
+	void UpdateCategoryMasks();
+
+	// SpatialAccelerator interface (see Accelerator.hpp)
+	void             Build(std::vector<Convex2*> const& convexArray, AABB2 const& totalBounds);
+	void             Refit();
+	bool             RaycastClosest(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, ClosestRayHit& inout_best, QueryFilter const& filter = QueryFilter()) const;
+	bool             RaycastAny(Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, QueryScratch& scratch, QueryFilter const& filter = QueryFilter()) const;
+	AcceleratorStats GetStats() const;
+	size_t           GetMemoryBytes() const;
+
+	// Tunable build parameter (see AcceleratorTuner.hpp): depth in levels, a 2^(depth-1) square leaf grid; 0 uses the default
+	static constexpr int MIN_BUILD_DEPTH = 2;
+	static constexpr int MAX_BUILD_DEPTH = 7;
+	int  GetBuildDepth() const { return m_buildDepth; }
+	void SetBuildDepth(int depth) { m_buildDepth = depth; }
 
 	std::vector<SymmetricQuadTreeNode> m_nodes;
 
 protected:
-	int GetFirstLBChild(int index);
-	int GetSecondRBChild(int index);
-	int GetThirdLTChild(int index);
-	int GetForthRTChild(int index);
-	int GetParentIndex(int index);
+	int GetFirstLBChild(int index) const;
+	int GetSecondRBChild(int index) const;
+	int GetThirdLTChild(int index) const;
+	int GetForthRTChild(int index) const;
+	int GetParentIndex(int index) const;
+	int GetStartOfLastLevel() const;
+
+	void BucketIntoLeaves(std::span<Convex2* const> objects, int startOfLastLevel);
+
+	int                          m_buildDepth = 0;
+	std::vector<Convex2*> const* m_convexes   = nullptr; // The scene passed to Build; Refit re-buckets all of it
 };
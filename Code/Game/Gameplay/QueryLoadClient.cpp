@@ -0,0 +1,212 @@
+//----------------------------------------------------------------------------------------------------
+// QueryLoadClient.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/QueryLoadClient.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/StringUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <latch>
+#include <random>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+using LoadClock = std::chrono::steady_clock;
+
+//----------------------------------------------------------------------------------------------------
+std::string QueryLoadTestReport::GetDescription() const
+{
+	if (!m_isValid)
+	{
+		return Stringf("Query load test failed: %s", m_error.c_str());
+	}
+	return Stringf("%lld requests (%lld records) in %.2fs: %.0f req/s, %.0f records/s, latency p50 %.3fms p99 %.3fms max %.3fms, %lld errors",
+		static_cast<long long>(m_numRequests), static_cast<long long>(m_numRecords), m_elapsedSeconds, m_requestsPerSecond, m_recordsPerSecond,
+		m_p50LatencyMs, m_p99LatencyMs, m_maxLatencyMs, static_cast<long long>(m_numErrors));
+}
+
+//----------------------------------------------------------------------------------------------------
+static bool SendQueryRequest(QuerySocket const& socket, eQueryRequestType type, uint32_t requestId, uint32_t count, std::vector<uint8_t> const& payload)
+{
+	QueryMessageHeader header;
+	header.m_type         = static_cast<uint8_t>(type);
+	header.m_requestId    = requestId;
+	header.m_count        = count;
+	header.m_payloadBytes = static_cast<uint32_t>(payload.size());
+	return socket.SendAll(&header, sizeof(header)) && (payload.empty() || socket.SendAll(payload.data(), payload.size()));
+}
+
+//----------------------------------------------------------------------------------------------------
+static bool ReceiveQueryResponse(QuerySocket const& socket, QueryMessageHeader& out_header, std::vector<uint8_t>& out_payload)
+{
+	if (!socket.ReceiveAll(&out_header, sizeof(out_header)) || out_header.m_magic != QUERY_PROTOCOL_MAGIC)
+	{
+		return false;
+	}
+	out_payload.resize(out_header.m_payloadBytes);
+	return out_payload.empty() || socket.ReceiveAll(out_payload.data(), out_payload.size());
+}
+
+//----------------------------------------------------------------------------------------------------
+// Random records inside the scene bounds for one request
+//----------------------------------------------------------------------------------------------------
+static void MakeLoadTestPayload(QueryLoadTestConfig const& config, QueryBoxRecord const& bounds, std::mt19937& rng, std::vector<uint8_t>& out_payload)
+{
+	std::uniform_real_distribution<float> randomX(bounds.m_minX, bounds.m_maxX);
+	std::uniform_real_distribution<float> randomY(bounds.m_minY, bounds.m_maxY);
+	std::uniform_real_distribution<float> randomAngle(0.f, 6.2831853f);
+	std::uniform_real_distribution<float> randomLength(0.f, config.m_maxRayLength);
+
+	out_payload.clear();
+	for (int i = 0; i < config.m_recordsPerRequest; ++i)
+	{
+		if (config.m_requestType == eQueryRequestType::REGION_AABB)
+		{
+			float x = randomX(rng), y = randomY(rng);
+			float halfWidth  = randomLength(rng) * 0.1f;
+			float halfHeight = randomLength(rng) * 0.1f;
+			QueryBoxRecord box{x - halfWidth, y - halfHeight, x + halfWidth, y + halfHeight};
+			AppendQueryRecords(out_payload, std::span<QueryBoxRecord const>(&box, 1));
+		}
+		else
+		{
+			float angle = randomAngle(rng);
+			QueryRayRecord ray{randomX(rng), randomY(rng), std::cos(angle), std::sin(angle), randomLength(rng)};
+			AppendQueryRecords(out_payload, std::span<QueryRayRecord const>(&ray, 1));
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryLoadTestReport RunQueryLoadTest(QueryLoadTestConfig const& config)
+{
+	QueryLoadTestReport report;
+
+	// One round trip for the scene bounds, so queries land where the objects are
+	QueryBoxRecord bounds;
+	{
+		QuerySocket control = QuerySocket::Connect(config.m_endpoint, report.m_error);
+		QueryMessageHeader   header;
+		std::vector<uint8_t> payload;
+		if (!control.IsValid())
+		{
+			return report;
+		}
+		if (!SendQueryRequest(control, eQueryRequestType::SCENE_INFO, 0, 0, payload) || !ReceiveQueryResponse(control, header, payload) ||
+			header.m_status != static_cast<uint8_t>(eQueryStatus::OK) || payload.size() != sizeof(QuerySceneInfoRecord))
+		{
+			report.m_error = "Server did not answer SCENE_INFO";
+			return report;
+		}
+		QuerySceneInfoRecord info = ReadQueryRecord<QuerySceneInfoRecord>(payload, 0);
+		bounds                    = info.m_bounds;
+		report.m_numSceneObjects  = static_cast<int>(info.m_numObjects);
+	}
+
+	int const numClients  = std::max(config.m_numClients, 1);
+	int const numRequests = std::max(config.m_requestsPerClient, 1);
+	int const maxInFlight = std::max(config.m_maxInFlight, 1);
+
+	std::vector<std::vector<float>> latenciesMs(numClients);
+	std::atomic<int64_t>            numErrors      = 0;
+	std::atomic<int>                numFailedLinks = 0;
+	std::latch                      startLatch(numClients + 1);
+	std::vector<std::thread>        clients;
+
+	// Plain threads, not tasks: clients spend their time blocked on sockets
+	for (int clientIndex = 0; clientIndex < numClients; ++clientIndex)
+	{
+		clients.emplace_back([&, clientIndex]()
+		{
+			std::string error;
+			QuerySocket socket = QuerySocket::Connect(config.m_endpoint, error);
+			startLatch.arrive_and_wait();
+			if (!socket.IsValid())
+			{
+				++numFailedLinks;
+				return;
+			}
+
+			std::mt19937                       rng(config.m_seed + static_cast<uint32_t>(clientIndex) * 7919u);
+			std::vector<LoadClock::time_point> sendTimes(numRequests);
+			std::vector<float>&                latencies = latenciesMs[clientIndex];
+			std::vector<uint8_t>               payload;
+			QueryMessageHeader                 header;
+			latencies.reserve(numRequests);
+
+			int numSent = 0;
+			while (static_cast<int>(latencies.size()) < numRequests)
+			{
+				while (numSent < numRequests && numSent - static_cast<int>(latencies.size()) < maxInFlight)
+				{
+					MakeLoadTestPayload(config, bounds, rng, payload);
+					sendTimes[numSent] = LoadClock::now();
+					if (!SendQueryRequest(socket, config.m_requestType, static_cast<uint32_t>(numSent), static_cast<uint32_t>(config.m_recordsPerRequest), payload))
+					{
+						++numFailedLinks;
+						return;
+					}
+					++numSent;
+				}
+
+				if (!ReceiveQueryResponse(socket, header, payload) || header.m_requestId >= static_cast<uint32_t>(numSent))
+				{
+					++numFailedLinks;
+					return;
+				}
+				std::chrono::duration<float, std::milli> latency = LoadClock::now() - sendTimes[header.m_requestId];
+				latencies.push_back(latency.count());
+				if (header.m_status != static_cast<uint8_t>(eQueryStatus::OK))
+				{
+					++numErrors;
+				}
+			}
+		});
+	}
+
+	startLatch.arrive_and_wait();
+	LoadClock::time_point startTime = LoadClock::now();
+	for (std::thread& client : clients)
+	{
+		client.join();
+	}
+	std::chrono::duration<double> elapsed = LoadClock::now() - startTime;
+
+	if (numFailedLinks > 0)
+	{
+		report.m_error = Stringf("%d of %d clients lost their connection", numFailedLinks.load(), numClients);
+		return report;
+	}
+
+	std::vector<float> allLatencies;
+	for (std::vector<float> const& latencies : latenciesMs)
+	{
+		allLatencies.insert(allLatencies.end(), latencies.begin(), latencies.end());
+	}
+	std::sort(allLatencies.begin(), allLatencies.end());
+
+	// Nearest-rank percentiles
+	auto percentile = [&](float fraction)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<float>(allLatencies.size())));
+		return allLatencies[std::clamp(rank, static_cast<size_t>(1), allLatencies.size()) - 1];
+	};
+
+	report.m_isValid           = true;
+	report.m_numRequests       = static_cast<int64_t>(allLatencies.size());
+	report.m_numRecords        = report.m_numRequests * config.m_recordsPerRequest;
+	report.m_numErrors         = numErrors;
+	report.m_elapsedSeconds    = elapsed.count();
+	report.m_requestsPerSecond = static_cast<double>(report.m_numRequests) / std::max(report.m_elapsedSeconds, 1e-9);
+	report.m_recordsPerSecond  = static_cast<double>(report.m_numRecords) / std::max(report.m_elapsedSeconds, 1e-9);
+	report.m_p50LatencyMs      = percentile(0.50f);
+	report.m_p99LatencyMs      = percentile(0.99f);
+	report.m_maxLatencyMs      = allLatencies.back();
+	return report;
+}
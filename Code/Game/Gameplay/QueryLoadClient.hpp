@@ -0,0 +1,52 @@
+//----------------------------------------------------------------------------------------------------
+// QueryLoadClient.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/QueryProtocol.hpp"
+#include "Game/Gameplay/QuerySocket.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------
+struct QueryLoadTestConfig
+{
+	QueryEndpoint     m_endpoint;
+	eQueryRequestType m_requestType       = eQueryRequestType::RAYCAST_CLOSEST;
+	int               m_numClients        = 4;    // Connections, each on its own thread
+	int               m_requestsPerClient = 1000;
+	int               m_recordsPerRequest = 64;   // Rays or boxes per request
+	int               m_maxInFlight       = 4;    // Pipelined requests each client keeps outstanding
+	float             m_maxRayLength      = 50.f; // Boxes are up to a fifth of this across
+	uint32_t          m_seed              = 1;
+};
+
+//----------------------------------------------------------------------------------------------------
+// QueryLoadTestReport - Latency is from a request being sent to its whole response being read
+//----------------------------------------------------------------------------------------------------
+struct QueryLoadTestReport
+{
+	bool        m_isValid           = false;
+	std::string m_error;
+	int64_t     m_numRequests       = 0;
+	int64_t     m_numRecords        = 0;
+	int64_t     m_numErrors         = 0; // Responses with a status other than OK
+	double      m_elapsedSeconds    = 0.0;
+	double      m_requestsPerSecond = 0.0;
+	double      m_recordsPerSecond  = 0.0;
+	float       m_p50LatencyMs      = 0.f;
+	float       m_p99LatencyMs      = 0.f;
+	float       m_maxLatencyMs      = 0.f;
+	int         m_numSceneObjects   = 0;
+
+	std::string GetDescription() const;
+};
+
+//----------------------------------------------------------------------------------------------------
+// RunQueryLoadTest - Asks the server for its scene bounds, then drives it from several connections
+// with random queries inside them. Blocks until every client has its last response.
+//----------------------------------------------------------------------------------------------------
+QueryLoadTestReport RunQueryLoadTest(QueryLoadTestConfig const& config);
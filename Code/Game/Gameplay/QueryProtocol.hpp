@@ -0,0 +1,165 @@
+//----------------------------------------------------------------------------------------------------
+// QueryProtocol.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+// Wire format of the ray-query server
+//
+// Every message, request or response, is a 20-byte QueryMessageHeader followed by m_payloadBytes of
+// fixed-size little-endian records. A request carries m_count records of one kind; its response
+// echoes the request id and type, so a client may pipeline requests and match answers by id.
+// Responses on one connection arrive in request order. Ray forward vectors are normalized by the
+// server; a request with a zero or non-finite ray is rejected as BAD_REQUEST.
+//
+//   RAYCAST_CLOSEST  request: QueryRayRecord x count   response: QueryHitRecord x count
+//   RAYCAST_ANY      request: QueryRayRecord x count   response: uint8_t x count (1 = blocked)
+//   REGION_AABB      request: QueryBoxRecord x count   response: per box, QueryRegionCountRecord then n int32_t ids
+//   SCENE_INFO       request: empty                    response: QuerySceneInfoRecord
+//   RELOAD_SCENE     request: empty                    response: empty, m_count = objects now loaded
+//   SHUTDOWN         request: empty                    response: empty; the server then stops
+//----------------------------------------------------------------------------------------------------
+static_assert(std::endian::native == std::endian::little, "Query records are copied to the wire as-is");
+
+constexpr uint32_t QUERY_PROTOCOL_MAGIC   = 0x52514847; // "GHQR"
+constexpr uint8_t  QUERY_PROTOCOL_VERSION = 2; // 2: region responses flag truncated id lists
+
+//----------------------------------------------------------------------------------------------------
+enum class eQueryRequestType : uint8_t
+{
+	RAYCAST_CLOSEST = 1,
+	RAYCAST_ANY     = 2,
+	REGION_AABB     = 3,
+	SCENE_INFO      = 4,
+	RELOAD_SCENE    = 5,
+	SHUTDOWN        = 6
+};
+
+//----------------------------------------------------------------------------------------------------
+enum class eQueryStatus : uint8_t
+{
+	OK,
+	BAD_REQUEST,  // Unknown type, payload size does not match the record count, or a degenerate ray
+	TOO_LARGE,    // More records than the server accepts in one request
+	NO_SCENE,     // The scene failed to load; nothing to query
+	RELOAD_FAILED // The old scene is still being served
+};
+
+//----------------------------------------------------------------------------------------------------
+struct QueryMessageHeader
+{
+	uint32_t m_magic        = QUERY_PROTOCOL_MAGIC;
+	uint8_t  m_version      = QUERY_PROTOCOL_VERSION;
+	uint8_t  m_type         = 0;
+	uint8_t  m_status       = 0; // eQueryStatus; always OK in requests
+	uint8_t  m_reserved     = 0;
+	uint32_t m_requestId    = 0;
+	uint32_t m_count        = 0;
+	uint32_t m_payloadBytes = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct QueryRayRecord
+{
+	float m_startX   = 0.f;
+	float m_startY   = 0.f;
+	float m_forwardX = 0.f; // Any finite non-zero length; the server normalizes
+	float m_forwardY = 0.f;
+	float m_maxDist  = 0.f;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct QueryHitRecord
+{
+	float   m_dist     = 0.f; // FLT_MAX on a miss
+	int32_t m_objectId = -1;
+	float   m_normalX  = 0.f;
+	float   m_normalY  = 0.f;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct QueryBoxRecord
+{
+	float m_minX = 0.f;
+	float m_minY = 0.f;
+	float m_maxX = 0.f;
+	float m_maxY = 0.f;
+};
+
+//----------------------------------------------------------------------------------------------------
+// QueryRegionCountRecord - Leads each box's ids. The server returns at most its configured number of
+// ids per box; when more convexes overlap, the list is cut and m_isTruncated is 1.
+//----------------------------------------------------------------------------------------------------
+struct QueryRegionCountRecord
+{
+	uint32_t m_numIds      = 0;
+	uint32_t m_isTruncated = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct QuerySceneInfoRecord
+{
+	QueryBoxRecord m_bounds;
+	uint32_t       m_numObjects      = 0;
+	uint32_t       m_sceneGeneration = 0; // Bumped by every successful reload
+	uint32_t       m_queryMode       = 0; // eQueryMode the server answers with
+};
+
+static_assert(sizeof(QueryMessageHeader) == 20, "QueryMessageHeader must match the wire layout");
+static_assert(sizeof(QueryRayRecord) == 20, "QueryRayRecord must match the wire layout");
+static_assert(sizeof(QueryHitRecord) == 16, "QueryHitRecord must match the wire layout");
+static_assert(sizeof(QueryBoxRecord) == 16, "QueryBoxRecord must match the wire layout");
+static_assert(sizeof(QueryRegionCountRecord) == 8, "QueryRegionCountRecord must match the wire layout");
+static_assert(sizeof(QuerySceneInfoRecord) == 28, "QuerySceneInfoRecord must match the wire layout");
+
+//----------------------------------------------------------------------------------------------------
+// Bytes per request record for a type, or 0 for types whose requests carry no records
+//----------------------------------------------------------------------------------------------------
+inline size_t GetQueryRequestRecordSize(eQueryRequestType type)
+{
+	switch (type)
+	{
+	case eQueryRequestType::RAYCAST_CLOSEST:
+	case eQueryRequestType::RAYCAST_ANY:     return sizeof(QueryRayRecord);
+	case eQueryRequestType::REGION_AABB:     return sizeof(QueryBoxRecord);
+	default:                                 return 0;
+	}
+}
+
+inline bool IsKnownQueryRequestType(uint8_t type)
+{
+	return type >= static_cast<uint8_t>(eQueryRequestType::RAYCAST_CLOSEST) && type <= static_cast<uint8_t>(eQueryRequestType::SHUTDOWN);
+}
+
+//----------------------------------------------------------------------------------------------------
+// AppendQueryRecords - Raw copy of trivially copyable records onto a message buffer
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+void AppendQueryRecords(std::vector<uint8_t>& out_bytes, std::span<T const> records)
+{
+	size_t offset = out_bytes.size();
+	out_bytes.resize(offset + records.size_bytes());
+	if (!records.empty())
+	{
+		std::memcpy(out_bytes.data() + offset, records.data(), records.size_bytes());
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// ReadQueryRecord - Copy out the index-th record of a payload (payloads carry no alignment guarantee)
+//----------------------------------------------------------------------------------------------------
+template <typename T>
+T ReadQueryRecord(std::span<uint8_t const> payload, size_t index)
+{
+	T record;
+	std::memcpy(&record, payload.data() + index * sizeof(T), sizeof(T));
+	return record;
+}
@@ -0,0 +1,843 @@
+//----------------------------------------------------------------------------------------------------
+// QueryServer.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/QueryServer.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/AcceleratorTuner.hpp"
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/BufferParser.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/StringUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int SERVER_CONVEXES_PER_TASK = 32;
+constexpr int SERVER_RECORDS_PER_TASK  = 256;
+
+//----------------------------------------------------------------------------------------------------
+// AreRayRecordsValid - Forward vectors from the network are normalized before use, so each needs a
+// finite, non-zero length. Call once the payload size has been checked against the record count.
+//----------------------------------------------------------------------------------------------------
+static bool AreRayRecordsValid(QueryMessageHeader const& header, std::span<uint8_t const> payload)
+{
+	if (GetQueryRequestRecordSize(static_cast<eQueryRequestType>(header.m_type)) != sizeof(QueryRayRecord))
+	{
+		return true;
+	}
+
+	for (uint32_t i = 0; i < header.m_count; ++i)
+	{
+		QueryRayRecord ray           = ReadQueryRecord<QueryRayRecord>(payload, i);
+		float          lengthSquared = ray.m_forwardX * ray.m_forwardX + ray.m_forwardY * ray.m_forwardY;
+		if (!std::isfinite(lengthSquared) || lengthSquared <= 0.f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryServerScene::~QueryServerScene()
+{
+	for (Convex2* convex : m_convexes)
+	{
+		delete convex;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// LoadFromFile - Walks the GHCS table of contents for the chunks the server needs. Every offset is
+// checked against the buffer, so a file caught mid-write by a hot reload fails cleanly.
+//----------------------------------------------------------------------------------------------------
+STATIC std::unique_ptr<QueryServerScene> QueryServerScene::LoadFromFile(std::string const& filePath, std::string& out_error)
+{
+	std::error_code errorCode;
+	if (!std::filesystem::exists(filePath, errorCode) || std::filesystem::file_size(filePath, errorCode) < 33)
+	{
+		out_error = Stringf("Not a GHCS file: %s", filePath.c_str());
+		return nullptr;
+	}
+
+	std::vector<uint8_t> buffer;
+	if (!FileReadToBuffer(buffer, filePath) || buffer.size() < 33)
+	{
+		out_error = Stringf("Could not read %s", filePath.c_str());
+		return nullptr;
+	}
+
+	BufferParser bufParse(buffer);
+	if (bufParse.ParseChar() != 'G' || bufParse.ParseChar() != 'H' || bufParse.ParseChar() != 'C' || bufParse.ParseChar() != 'S')
+	{
+		out_error = "Invalid GHCS file header";
+		return nullptr;
+	}
+	bufParse.ParseByte(); // Cohort
+	bufParse.ParseByte(); // Major version
+	bufParse.ParseByte(); // Minor version
+	uint8_t endianByte = bufParse.ParseByte();
+	if (endianByte != 1 && endianByte != 2)
+	{
+		out_error = Stringf("Invalid endianness byte %d", endianByte);
+		return nullptr;
+	}
+	bufParse.SetEndianMode(endianByte == 1 ? eEndianMode::LITTLE : eEndianMode::BIG);
+	bufParse.ParseUint32(); // Total file size
+	bufParse.ParseUint32(); // Data hash
+	unsigned int tocOffset = bufParse.ParseUint32();
+
+	if (static_cast<size_t>(tocOffset) + 9 > buffer.size())
+	{
+		out_error = "ToC offset past end of file";
+		return nullptr;
+	}
+	bufParse.SetCurrentPosition(static_cast<size_t>(tocOffset));
+	if (bufParse.ParseChar() != 'G' || bufParse.ParseChar() != 'H' || bufParse.ParseChar() != 'T' || bufParse.ParseChar() != 'C')
+	{
+		out_error = "Invalid ToC magic (expected GHTC)";
+		return nullptr;
+	}
+	uint8_t numChunks = bufParse.ParseByte();
+	if (static_cast<size_t>(tocOffset) + 9 + static_cast<size_t>(numChunks) * 9 > buffer.size())
+	{
+		out_error = "ToC entries past end of file";
+		return nullptr;
+	}
+	std::vector<unsigned int> chunkStarts;
+	for (int i = 0; i < static_cast<int>(numChunks); ++i)
+	{
+		bufParse.ParseByte(); // Type, checked again at the chunk itself
+		chunkStarts.push_back(bufParse.ParseUint32());
+		bufParse.ParseUint32(); // Total size
+	}
+
+	std::unique_ptr<QueryServerScene> scene = std::make_unique<QueryServerScene>();
+	std::vector<std::vector<Vec2>>    polys;
+	AcceleratorTuning                 tuning;
+	bool                              hasSceneInfo   = false;
+	bool                              hasConvexPolys = false;
+
+	for (unsigned int chunkStart : chunkStarts)
+	{
+		// GHCK(4) + type(1) + endian(1) + dataSize(4) + ENDC(4)
+		if (static_cast<size_t>(chunkStart) + 14 > buffer.size())
+		{
+			out_error = Stringf("Chunk at offset %u past end of file", chunkStart);
+			return nullptr;
+		}
+		bufParse.SetCurrentPosition(static_cast<size_t>(chunkStart));
+		if (bufParse.ParseChar() != 'G' || bufParse.ParseChar() != 'H' || bufParse.ParseChar() != 'C' || bufParse.ParseChar() != 'K')
+		{
+			out_error = Stringf("Invalid chunk header at offset %u", chunkStart);
+			return nullptr;
+		}
+		uint8_t chunkType   = bufParse.ParseByte();
+		uint8_t chunkEndian = bufParse.ParseByte();
+		bufParse.SetEndianMode(chunkEndian == 2 ? eEndianMode::BIG : eEndianMode::LITTLE);
+		unsigned int dataSize     = bufParse.ParseUint32();
+		size_t       dataStartPos = bufParse.GetCurrentPosition();
+		size_t       dataEndPos   = dataStartPos + static_cast<size_t>(dataSize);
+		if (dataEndPos + 4 > buffer.size())
+		{
+			out_error = Stringf("Chunk at offset %u claims more data than the file holds", chunkStart);
+			return nullptr;
+		}
+
+		if (chunkType == 0x01 && dataSize >= 18) // SceneInfo
+		{
+			hasSceneInfo    = true;
+			scene->m_bounds = bufParse.ParseAABB2();
+		}
+		else if (chunkType == 0x02 && dataSize >= 2) // ConvexPolys
+		{
+			hasConvexPolys = true;
+			uint16_t numObjects = bufParse.ParseUshort();
+			polys.resize(numObjects);
+			for (std::vector<Vec2>& verts : polys)
+			{
+				if (bufParse.GetCurrentPosition() + 1 > dataEndPos)
+				{
+					out_error = "ConvexPolys chunk is truncated";
+					return nullptr;
+				}
+				uint8_t numVerts = bufParse.ParseByte();
+				if (numVerts < 3)
+				{
+					// Without edges to clip against, the penetration test would report a hit at distance 0
+					out_error = Stringf("Convex %d has %d vertices", static_cast<int>(&verts - polys.data()), static_cast<int>(numVerts));
+					return nullptr;
+				}
+				if (bufParse.GetCurrentPosition() + static_cast<size_t>(numVerts) * 8 > dataEndPos)
+				{
+					out_error = "ConvexPolys chunk is truncated";
+					return nullptr;
+				}
+				for (int j = 0; j < static_cast<int>(numVerts); ++j)
+				{
+					verts.push_back(bufParse.ParseVec2());
+				}
+			}
+		}
+		else if (chunkType == 0x88 && dataSize >= 2) // Accelerator tuning
+		{
+			uint8_t queryMode = bufParse.ParseByte();
+			uint8_t numModes  = bufParse.ParseByte();
+			if (dataSize >= 2u + numModes && queryMode < static_cast<uint8_t>(eQueryMode::COUNT))
+			{
+				for (int m = 0; m < static_cast<int>(numModes); ++m)
+				{
+					uint8_t buildDepth = bufParse.ParseByte();
+					if (m < static_cast<int>(eQueryMode::COUNT))
+					{
+						tuning.m_buildDepths[m] = buildDepth;
+					}
+				}
+				tuning.m_queryMode = static_cast<eQueryMode>(queryMode);
+				tuning.m_isValid   = true;
+			}
+		}
+	}
+
+	if (!hasSceneInfo || !hasConvexPolys)
+	{
+		out_error = "Missing required SceneInfo or ConvexPolys chunk";
+		return nullptr;
+	}
+
+	// Hulls and bounding volumes are the expensive part of a load; each convex is independent
+	int numConvexes = static_cast<int>(polys.size());
+	scene->m_convexes.resize(numConvexes, nullptr);
+	ParallelFor(0, numConvexes, SERVER_CONVEXES_PER_TASK, [&](int first, int last)
+	{
+		for (int i = first; i < last; ++i)
+		{
+			scene->m_convexes[i] = new Convex2(polys[i]);
+			scene->m_convexes[i]->m_objectId = i;
+		}
+	});
+
+	if (tuning.m_isValid)
+	{
+		scene->m_queryMode = tuning.m_queryMode;
+		scene->m_AABB2Tree.SetBuildDepth(tuning.GetBuildDepth(eQueryMode::AABB2_TREE));
+		scene->m_symQuadTree.SetBuildDepth(tuning.GetBuildDepth(eQueryMode::SYMMETRIC_QUADTREE));
+	}
+	scene->m_AABB2Tree.Build(scene->m_convexes, scene->m_bounds);
+	scene->m_symQuadTree.Build(scene->m_convexes, scene->m_bounds);
+	scene->m_partitionedTree.Build(scene->m_convexes, scene->m_bounds);
+	return scene;
+}
+
+//----------------------------------------------------------------------------------------------------
+SceneQueryView QueryServerScene::GetView() const
+{
+	SceneQueryView view;
+	view.m_convexes        = &m_convexes;
+	view.m_symQuadTree     = &m_symQuadTree;
+	view.m_AABB2Tree       = &m_AABB2Tree;
+	view.m_partitionedTree = &m_partitionedTree;
+	return view;
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryServer::~QueryServer()
+{
+	Stop();
+}
+
+//----------------------------------------------------------------------------------------------------
+bool QueryServer::Start(QueryServerConfig const& config, std::string& out_error)
+{
+	if (m_isRunning)
+	{
+		out_error = "Query server is already running";
+		return false;
+	}
+
+	m_config = config;
+	m_scene  = QueryServerScene::LoadFromFile(m_config.m_scenePath, out_error);
+	if (!m_scene)
+	{
+		return false;
+	}
+	std::error_code errorCode;
+	m_sceneWriteTime = std::filesystem::last_write_time(m_config.m_scenePath, errorCode);
+
+	m_listener = QuerySocket::Listen(m_config.m_endpoint, out_error);
+	if (!m_listener.IsValid())
+	{
+		m_scene.reset();
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats              = QueryServerStats();
+		m_stats.m_hasScene   = true;
+		m_stats.m_numObjects = static_cast<int>(m_scene->m_convexes.size());
+	}
+	m_isStopping          = false;
+	m_isReloadRequested   = false;
+	m_isShutdownRequested = false;
+	m_isRunning           = true;
+	m_listenThread  = std::thread(&QueryServer::ListenMain, this);
+	m_batcherThread = std::thread(&QueryServer::BatcherMain, this);
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// Stop - Listener first (woken by a connection of our own), then the batcher, then every reader
+//----------------------------------------------------------------------------------------------------
+void QueryServer::Stop()
+{
+	if (!m_isRunning)
+	{
+		return;
+	}
+
+	m_isStopping = true;
+	{
+		std::string ignoredError;
+		QuerySocket wakeConnection = QuerySocket::Connect(m_config.m_endpoint, ignoredError);
+		m_listenThread.join();
+	}
+
+	m_queueCondition.notify_all();
+	m_batcherThread.join();
+
+	{
+		std::lock_guard<std::mutex> lock(m_connectionsMutex);
+		for (std::shared_ptr<Connection> const& connection : m_connections)
+		{
+			connection->m_socket.Shutdown();
+		}
+		for (std::shared_ptr<Connection> const& connection : m_connections)
+		{
+			connection->m_readerThread.join();
+		}
+		m_connections.clear();
+	}
+
+	m_queue.clear();
+	m_numQueuedRecords = 0;
+	m_listener.Close();
+	if (!m_config.m_endpoint.m_unixSocketPath.empty())
+	{
+		std::error_code errorCode;
+		std::filesystem::remove(m_config.m_endpoint.m_unixSocketPath, errorCode);
+	}
+	m_scene.reset();
+	m_isRunning = false;
+}
+
+//----------------------------------------------------------------------------------------------------
+void QueryServer::RequestReload()
+{
+	m_isReloadRequested = true;
+	m_queueCondition.notify_one();
+}
+
+//----------------------------------------------------------------------------------------------------
+QueryServerStats QueryServer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+//----------------------------------------------------------------------------------------------------
+std::string QueryServer::GetDescription() const
+{
+	char text[512];
+	FormatDescription(text);
+	return text;
+}
+
+//----------------------------------------------------------------------------------------------------
+void QueryServer::FormatDescription(std::span<char> out_text) const
+{
+	if (out_text.empty())
+	{
+		return;
+	}
+	if (!m_isRunning)
+	{
+		std::snprintf(out_text.data(), out_text.size(), "Query server stopped");
+		return;
+	}
+	QueryServerStats     stats    = GetStats();
+	QueryEndpoint const& endpoint = m_config.m_endpoint;
+	char                 endpointText[128];
+	if (endpoint.m_unixSocketPath.empty())
+	{
+		std::snprintf(endpointText, sizeof(endpointText), "127.0.0.1:%d", static_cast<int>(endpoint.m_port));
+	}
+	else
+	{
+		std::snprintf(endpointText, sizeof(endpointText), "unix:%s", endpoint.m_unixSocketPath.c_str());
+	}
+	std::snprintf(out_text.data(), out_text.size(), "Query server on %s: %s (%d objects, gen %d), %d clients, %lld requests in %lld batches",
+		endpointText, m_config.m_scenePath.c_str(), stats.m_numObjects, stats.m_sceneGeneration,
+		stats.m_numConnections, static_cast<long long>(stats.m_numRequests), static_cast<long long>(stats.m_numBatches));
+}
+
+//----------------------------------------------------------------------------------------------------
+void QueryServer::ListenMain()
+{
+	for (;;)
+	{
+		QuerySocket socket = m_listener.Accept();
+		if (m_isStopping.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		if (!socket.IsValid())
+		{
+			// Usually a client that gave up mid-handshake; back off in case the listener itself is failing
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+
+		ReapClosedConnections();
+
+		std::shared_ptr<Connection> connection = std::make_shared<Connection>();
+		connection->m_socket = std::move(socket);
+
+		std::lock_guard<std::mutex> lock(m_connectionsMutex);
+		m_connections.push_back(connection);
+		connection->m_readerThread = std::thread(&QueryServer::ReaderMain, this, connection);
+
+		std::lock_guard<std::mutex> statsLock(m_statsMutex);
+		m_stats.m_numConnections = static_cast<int>(m_connections.size());
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// ReaderMain - A bad header means the stream can no longer be framed, so the connection is dropped;
+// a well-framed but invalid request is queued with an error status to keep responses in order.
+//----------------------------------------------------------------------------------------------------
+void QueryServer::ReaderMain(std::shared_ptr<Connection> connection)
+{
+	size_t const maxPayloadBytes = static_cast<size_t>(m_config.m_maxRequestRecords) * sizeof(QueryRayRecord);
+
+	while (!m_isStopping.load(std::memory_order_acquire))
+	{
+		PendingRequest request;
+		request.m_connection = connection;
+		if (!connection->m_socket.ReceiveAll(&request.m_header, sizeof(request.m_header)) ||
+			request.m_header.m_magic != QUERY_PROTOCOL_MAGIC || request.m_header.m_version != QUERY_PROTOCOL_VERSION)
+		{
+			break;
+		}
+
+		QueryMessageHeader const& header = request.m_header;
+		if (header.m_payloadBytes > maxPayloadBytes)
+		{
+			// Not worth draining; answer and hang up
+			request.m_status = eQueryStatus::TOO_LARGE;
+			Enqueue(std::move(request));
+			break;
+		}
+
+		request.m_payload.resize(header.m_payloadBytes);
+		if (!connection->m_socket.ReceiveAll(request.m_payload.data(), request.m_payload.size()))
+		{
+			break;
+		}
+
+		if (!IsKnownQueryRequestType(header.m_type) ||
+			header.m_payloadBytes != static_cast<uint64_t>(header.m_count) * GetQueryRequestRecordSize(static_cast<eQueryRequestType>(header.m_type)) ||
+			!AreRayRecordsValid(header, request.m_payload))
+		{
+			request.m_status = eQueryStatus::BAD_REQUEST;
+		}
+		else if (header.m_count > static_cast<uint32_t>(m_config.m_maxRequestRecords))
+		{
+			request.m_status = eQueryStatus::TOO_LARGE;
+		}
+		Enqueue(std::move(request));
+	}
+
+	connection->m_isClosed = true;
+}
+
+//----------------------------------------------------------------------------------------------------
+void QueryServer::Enqueue(PendingRequest&& request)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (request.m_status == eQueryStatus::OK)
+		{
+			m_numQueuedRecords += static_cast<int>(request.m_header.m_count);
+		}
+		m_queue.push_back(std::move(request));
+	}
+	m_queueCondition.notify_one();
+}
+
+//----------------------------------------------------------------------------------------------------
+// BatcherMain - Sleep until work arrives, hold the batch open for the window (or until it is big
+// enough), then answer everything queued in one pass. Scene file changes are checked between batches.
+//----------------------------------------------------------------------------------------------------
+void QueryServer::BatcherMain()
+{
+	using Clock = std::chrono::steady_clock;
+
+	auto const batchWindow  = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(std::max(m_config.m_batchWindowMs, 0.f)));
+	auto const pollInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_config.m_reloadPollSeconds > 0.f ? m_config.m_reloadPollSeconds : 3600.f));
+	Clock::time_point nextPollTime = Clock::now() + pollInterval;
+
+	std::vector<PendingRequest> batch;
+	std::unique_lock<std::mutex> lock(m_queueMutex);
+	while (!m_isStopping.load(std::memory_order_acquire))
+	{
+		m_queueCondition.wait_until(lock, nextPollTime, [this]()
+		{
+			return m_isStopping.load(std::memory_order_acquire) || m_isReloadRequested.load(std::memory_order_acquire) || !m_queue.empty();
+		});
+		if (m_isStopping.load(std::memory_order_acquire))
+		{
+			break;
+		}
+
+		if (!m_queue.empty())
+		{
+			Clock::time_point windowEnd = Clock::now() + batchWindow;
+			m_queueCondition.wait_until(lock, windowEnd, [this]()
+			{
+				return m_isStopping.load(std::memory_order_acquire) || m_numQueuedRecords >= m_config.m_maxBatchRecords;
+			});
+			batch.swap(m_queue);
+			m_numQueuedRecords = 0;
+		}
+		lock.unlock();
+
+		bool isPollDue = m_config.m_reloadPollSeconds > 0.f && Clock::now() >= nextPollTime;
+		if (isPollDue)
+		{
+			nextPollTime = Clock::now() + pollInterval;
+		}
+		if (m_isReloadRequested.exchange(false) || (isPollDue && HasSceneFileChanged()))
+		{
+			ReloadScene();
+		}
+		if (!batch.empty())
+		{
+			ProcessBatch(batch);
+			batch.clear();
+		}
+
+		lock.lock();
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// ProcessBatch - Data requests between two control requests (reload, info, shutdown) form one segment:
+// each kind of query in the segment runs as a single batch. Control requests take effect in order,
+// so a query sent after a RELOAD_SCENE is answered against the reloaded scene.
+//----------------------------------------------------------------------------------------------------
+void QueryServer::ProcessBatch(std::vector<PendingRequest>& batch)
+{
+	std::vector<std::vector<uint8_t>> payloads(batch.size());
+	std::vector<eQueryStatus>         statuses(batch.size(), eQueryStatus::OK);
+	std::vector<uint32_t>             counts(batch.size(), 0);
+	std::vector<PendingRequest*>      closestRequests;
+	std::vector<PendingRequest*>      anyRequests;
+	std::vector<PendingRequest*>      regionRequests;
+	std::vector<std::vector<uint8_t>> segmentPayloads;
+	int64_t                           numRecords = 0;
+
+	auto indexOf = [&](PendingRequest const* request) { return static_cast<size_t>(request - batch.data()); };
+
+	auto flushSegment = [&]()
+	{
+		auto run = [&](std::vector<PendingRequest*>& requests, auto&& process)
+		{
+			if (requests.empty())
+			{
+				return;
+			}
+			if (!m_scene)
+			{
+				for (PendingRequest* request : requests)
+				{
+					statuses[indexOf(request)] = eQueryStatus::NO_SCENE;
+				}
+			}
+			else
+			{
+				segmentPayloads.assign(requests.size(), std::vector<uint8_t>());
+				process(requests, segmentPayloads);
+				for (size_t i = 0; i < requests.size(); ++i)
+				{
+					size_t index     = indexOf(requests[i]);
+					payloads[index]  = std::move(segmentPayloads[i]);
+					counts[index]    = requests[i]->m_header.m_count;
+					numRecords      += requests[i]->m_header.m_count;
+				}
+			}
+			requests.clear();
+		};
+		run(closestRequests, [&](auto const& requests, auto& out_payloads) { ProcessRaycasts(requests, true, out_payloads); });
+		run(anyRequests,     [&](auto const& requests, auto& out_payloads) { ProcessRaycasts(requests, false, out_payloads); });
+		run(regionRequests,  [&](auto const& requests, auto& out_payloads) { ProcessRegions(requests, out_payloads); });
+	};
+
+	for (PendingRequest& request : batch)
+	{
+		size_t index = indexOf(&request);
+		if (request.m_status != eQueryStatus::OK)
+		{
+			statuses[index] = request.m_status;
+			continue;
+		}
+
+		switch (static_cast<eQueryRequestType>(request.m_header.m_type))
+		{
+		case eQueryRequestType::RAYCAST_CLOSEST: closestRequests.push_back(&request); break;
+		case eQueryRequestType::RAYCAST_ANY:     anyRequests.push_back(&request);     break;
+		case eQueryRequestType::REGION_AABB:     regionRequests.push_back(&request);  break;
+
+		case eQueryRequestType::SCENE_INFO:
+			flushSegment();
+			if (!m_scene)
+			{
+				statuses[index] = eQueryStatus::NO_SCENE;
+			}
+			else
+			{
+				QuerySceneInfoRecord info;
+				info.m_bounds          = QueryBoxRecord{m_scene->m_bounds.m_mins.x, m_scene->m_bounds.m_mins.y, m_scene->m_bounds.m_maxs.x, m_scene->m_bounds.m_maxs.y};
+				info.m_numObjects      = static_cast<uint32_t>(m_scene->m_convexes.size());
+				info.m_sceneGeneration = static_cast<uint32_t>(GetStats().m_sceneGeneration);
+				info.m_queryMode       = static_cast<uint32_t>(m_scene->m_queryMode);
+				AppendQueryRecords(payloads[index], std::span<QuerySceneInfoRecord const>(&info, 1));
+				counts[index] = 1;
+			}
+			break;
+
+		case eQueryRequestType::RELOAD_SCENE:
+			flushSegment();
+			statuses[index] = ReloadScene() ? eQueryStatus::OK : eQueryStatus::RELOAD_FAILED;
+			counts[index]   = m_scene ? static_cast<uint32_t>(m_scene->m_convexes.size()) : 0;
+			break;
+
+		case eQueryRequestType::SHUTDOWN:
+			flushSegment();
+			m_isShutdownRequested = true;
+			break;
+		}
+	}
+	flushSegment();
+
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		SendResponse(batch[i], statuses[i], counts[i], payloads[i]);
+	}
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.m_numRequests += static_cast<int64_t>(batch.size());
+	m_stats.m_numRecords  += numRecords;
+	m_stats.m_numBatches  += 1;
+}
+
+//----------------------------------------------------------------------------------------------------
+// ProcessRaycasts - Every ray of every request goes into one structure-of-arrays batch
+//----------------------------------------------------------------------------------------------------
+void QueryServer::ProcessRaycasts(std::vector<PendingRequest*> const& requests, bool isClosestHit, std::vector<std::vector<uint8_t>>& out_payloads)
+{
+	int numRays = 0;
+	for (PendingRequest const* request : requests)
+	{
+		numRays += static_cast<int>(request->m_header.m_count);
+	}
+
+	std::vector<Vec2>  startPositions(numRays);
+	std::vector<Vec2>  forwardNormals(numRays);
+	std::vector<float> maxDists(numRays);
+	int rayIndex = 0;
+	for (PendingRequest const* request : requests)
+	{
+		for (uint32_t i = 0; i < request->m_header.m_count; ++i, ++rayIndex)
+		{
+			QueryRayRecord ray = ReadQueryRecord<QueryRayRecord>(request->m_payload, i);
+			startPositions[rayIndex] = Vec2(ray.m_startX, ray.m_startY);
+			forwardNormals[rayIndex] = Vec2(ray.m_forwardX, ray.m_forwardY).GetNormalized();
+			maxDists[rayIndex]       = ray.m_maxDist;
+		}
+	}
+	RayBatch       rays{startPositions, forwardNormals, maxDists};
+	SceneQueryView scene = m_scene->GetView();
+
+	if (isClosestHit)
+	{
+		std::vector<float> hitDists(numRays);
+		std::vector<int>   hitObjectIds(numRays);
+		std::vector<Vec2>  hitNormals(numRays);
+		RaycastBatchParallel(scene, m_scene->m_queryMode, rays, RayHitBatch{hitDists, hitObjectIds, hitNormals});
+
+		rayIndex = 0;
+		for (size_t r = 0; r < requests.size(); ++r)
+		{
+			std::vector<QueryHitRecord> records(requests[r]->m_header.m_count);
+			for (QueryHitRecord& record : records)
+			{
+				record = QueryHitRecord{hitDists[rayIndex], hitObjectIds[rayIndex], hitNormals[rayIndex].x, hitNormals[rayIndex].y};
+				++rayIndex;
+			}
+			AppendQueryRecords(out_payloads[r], std::span<QueryHitRecord const>(records));
+		}
+		return;
+	}
+
+	std::vector<uint8_t> isBlocked(numRays);
+	DispatchSceneAccelerator(scene, m_scene->m_queryMode, [&](auto const& accelerator)
+	{
+		ParallelFor(0, numRays, SERVER_RECORDS_PER_TASK, [&](int first, int last)
+		{
+			QueryScratch& scratch = QueryScratch::GetForThisThread();
+			for (int j = first; j < last; ++j)
+			{
+				isBlocked[j] = accelerator.RaycastAny(startPositions[j], forwardNormals[j], maxDists[j], scratch, scene.m_filter) ? 1 : 0;
+			}
+		});
+	});
+
+	rayIndex = 0;
+	for (size_t r = 0; r < requests.size(); ++r)
+	{
+		uint32_t count = requests[r]->m_header.m_count;
+		out_payloads[r].assign(isBlocked.begin() + rayIndex, isBlocked.begin() + rayIndex + count);
+		rayIndex += static_cast<int>(count);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// ProcessRegions - Each box gets a fixed slot of m_maxRegionResults ids, filled in parallel. The slot
+// has one spare entry: a box that fills it has more overlaps than are returned.
+//----------------------------------------------------------------------------------------------------
+void QueryServer::ProcessRegions(std::vector<PendingRequest*> const& requests, std::vector<std::vector<uint8_t>>& out_payloads)
+{
+	std::vector<QueryBoxRecord> boxes;
+	for (PendingRequest const* request : requests)
+	{
+		for (uint32_t i = 0; i < request->m_header.m_count; ++i)
+		{
+			boxes.push_back(ReadQueryRecord<QueryBoxRecord>(request->m_payload, i));
+		}
+	}
+
+	int const        numBoxes    = static_cast<int>(boxes.size());
+	int const        maxIds      = std::max(m_config.m_maxRegionResults, 1);
+	int const        slotSize    = maxIds + 1;
+	std::vector<int> objectIds(static_cast<size_t>(numBoxes) * slotSize);
+	std::vector<int> numResults(numBoxes);
+	SceneQueryView   scene = m_scene->GetView();
+
+	ParallelFor(0, numBoxes, SERVER_RECORDS_PER_TASK / 4, [&](int first, int last)
+	{
+		for (int b = first; b < last; ++b)
+		{
+			AABB2 box(Vec2(boxes[b].m_minX, boxes[b].m_minY), Vec2(boxes[b].m_maxX, boxes[b].m_maxY));
+			std::span<int> slot(objectIds.data() + static_cast<size_t>(b) * slotSize, slotSize);
+			numResults[b] = QueryRegionOverlaps(scene, m_scene->m_queryMode, RegionQueryShape::MakeAABB(box), slot);
+		}
+	});
+
+	int boxIndex = 0;
+	for (size_t r = 0; r < requests.size(); ++r)
+	{
+		for (uint32_t i = 0; i < requests[r]->m_header.m_count; ++i, ++boxIndex)
+		{
+			QueryRegionCountRecord countRecord;
+			countRecord.m_numIds      = static_cast<uint32_t>(std::min(numResults[boxIndex], maxIds));
+			countRecord.m_isTruncated = (numResults[boxIndex] > maxIds) ? 1 : 0;
+			AppendQueryRecords(out_payloads[r], std::span<QueryRegionCountRecord const>(&countRecord, 1));
+			AppendQueryRecords(out_payloads[r], std::span<int const>(objectIds.data() + static_cast<size_t>(boxIndex) * slotSize, countRecord.m_numIds));
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// ReloadScene - The old scene keeps serving if the new file does not load (e.g. still being written)
+//----------------------------------------------------------------------------------------------------
+bool QueryServer::ReloadScene()
+{
+	std::error_code errorCode;
+	m_sceneWriteTime = std::filesystem::last_write_time(m_config.m_scenePath, errorCode);
+
+	std::string                       error;
+	std::unique_ptr<QueryServerScene> scene = QueryServerScene::LoadFromFile(m_config.m_scenePath, error);
+	if (!scene)
+	{
+		return false;
+	}
+	m_scene = std::move(scene);
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.m_hasScene         = true;
+	m_stats.m_numObjects       = static_cast<int>(m_scene->m_convexes.size());
+	m_stats.m_numReloads      += 1;
+	m_stats.m_sceneGeneration += 1;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool QueryServer::HasSceneFileChanged() const
+{
+	std::error_code                 errorCode;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(m_config.m_scenePath, errorCode);
+	return !errorCode && writeTime != m_sceneWriteTime;
+}
+
+//----------------------------------------------------------------------------------------------------
+void QueryServer::SendResponse(PendingRequest const& request, eQueryStatus status, uint32_t count, std::vector<uint8_t> const& payload)
+{
+	QueryMessageHeader header;
+	header.m_type         = request.m_header.m_type;
+	header.m_status       = static_cast<uint8_t>(status);
+	header.m_requestId    = request.m_header.m_requestId;
+	header.m_count        = count;
+	header.m_payloadBytes = static_cast<uint32_t>(payload.size());
+
+	std::vector<uint8_t> message;
+	message.reserve(sizeof(header) + payload.size());
+	AppendQueryRecords(message, std::span<QueryMessageHeader const>(&header, 1));
+	message.insert(message.end(), payload.begin(), payload.end());
+
+	// A failed send means the client went away; its reader notices and closes the connection
+	std::lock_guard<std::mutex> lock(request.m_connection->m_sendMutex);
+	request.m_connection->m_socket.SendAll(message.data(), message.size());
+}
+
+//----------------------------------------------------------------------------------------------------
+void QueryServer::ReapClosedConnections()
+{
+	std::lock_guard<std::mutex> lock(m_connectionsMutex);
+	for (size_t i = 0; i < m_connections.size();)
+	{
+		if (m_connections[i]->m_isClosed.load(std::memory_order_acquire))
+		{
+			m_connections[i]->m_readerThread.join();
+			m_connections[i] = m_connections.back();
+			m_connections.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	std::lock_guard<std::mutex> statsLock(m_statsMutex);
+	m_stats.m_numConnections = static_cast<int>(m_connections.size());
+}
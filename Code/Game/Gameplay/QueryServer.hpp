@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------------------------------
+// QueryServer.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/BVH.hpp"
+#include "Game/Gameplay/PartitionedTree.hpp"
+#include "Game/Gameplay/QueryProtocol.hpp"
+#include "Game/Gameplay/QuadTree.hpp"
+#include "Game/Gameplay/QuerySocket.hpp"
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct Convex2;
+
+//----------------------------------------------------------------------------------------------------
+struct QueryServerConfig
+{
+	std::string   m_scenePath;                 // GHCS file served, and watched for hot reload
+	QueryEndpoint m_endpoint;
+	float         m_batchWindowMs     = 0.5f;  // After the first queued request, wait this long for more
+	int           m_maxBatchRecords   = 16384; // ...unless this many rays / boxes are already queued
+	int           m_maxRequestRecords = 65536; // Larger requests are answered TOO_LARGE
+	int           m_maxRegionResults  = 256;   // Ids returned per box; the rest are dropped and the box flagged truncated
+	float         m_reloadPollSeconds = 0.5f;  // How often the scene file's timestamp is checked; 0 = never
+};
+
+//----------------------------------------------------------------------------------------------------
+struct QueryServerStats
+{
+	int     m_numConnections  = 0; // Currently open
+	int64_t m_numRequests     = 0;
+	int64_t m_numBatches      = 0;
+	int64_t m_numRecords      = 0; // Rays and boxes answered
+	int     m_numReloads      = 0;
+	int     m_numObjects      = 0;
+	int     m_sceneGeneration = 0;
+	bool    m_hasScene        = false;
+};
+
+//----------------------------------------------------------------------------------------------------
+// QueryServerScene - One loaded copy of a scene with its own trees, owned by the server
+//
+// Only the geometry (0x01 SceneInfo, 0x02 ConvexPolys) and the accelerator tuning (0x88) chunks are
+// read; hulls, bounding volumes and trees are rebuilt, so the file's other chunks are not needed.
+//----------------------------------------------------------------------------------------------------
+struct QueryServerScene
+{
+	QueryServerScene() = default;
+	~QueryServerScene();
+	QueryServerScene(QueryServerScene const&)            = delete;
+	QueryServerScene& operator=(QueryServerScene const&) = delete;
+
+	static std::unique_ptr<QueryServerScene> LoadFromFile(std::string const& filePath, std::string& out_error);
+
+	SceneQueryView GetView() const;
+
+	std::vector<Convex2*> m_convexes;
+	AABB2Tree             m_AABB2Tree;
+	SymmetricQuadTree     m_symQuadTree;
+	PartitionedTree       m_partitionedTree; // Everything is static; the server never moves objects
+	AABB2                 m_bounds;
+	eQueryMode            m_queryMode = eQueryMode::AABB2_TREE;
+};
+
+//----------------------------------------------------------------------------------------------------
+// QueryServer - Serves batched scene queries to local processes from one shared copy of a scene
+//
+// A reader thread per connection parses requests onto a queue. One batcher thread drains it: requests
+// that arrive within the batch window are coalesced, so many small client requests become one large
+// ray batch on the task scheduler, and the answers are scattered back to each connection in order.
+// The batcher is the only thread touching the scene, so a hot reload between batches needs no locking;
+// requests that arrive during a reload simply wait and are answered against the new scene.
+//----------------------------------------------------------------------------------------------------
+class QueryServer
+{
+public:
+	QueryServer() = default;
+	~QueryServer();
+	QueryServer(QueryServer const&)            = delete;
+	QueryServer& operator=(QueryServer const&) = delete;
+
+	bool Start(QueryServerConfig const& config, std::string& out_error);
+	void Stop();
+	bool IsRunning() const { return m_isRunning; }
+	bool IsShutdownRequested() const { return m_isShutdownRequested.load(std::memory_order_acquire); } // A client sent SHUTDOWN; the owner should Stop
+
+	void             RequestReload();
+	QueryServerStats GetStats() const;
+	std::string      GetDescription() const;
+	void             FormatDescription(std::span<char> out_text) const; // Same text without allocating, for per-frame use
+
+private:
+	struct Connection
+	{
+		QuerySocket       m_socket;
+		std::mutex        m_sendMutex;
+		std::thread       m_readerThread;
+		std::atomic<bool> m_isClosed = false;
+	};
+
+	struct PendingRequest
+	{
+		std::shared_ptr<Connection> m_connection;
+		QueryMessageHeader          m_header;
+		std::vector<uint8_t>        m_payload;
+		eQueryStatus                m_status = eQueryStatus::OK; // Set by the reader for malformed requests
+	};
+
+	void ListenMain();
+	void ReaderMain(std::shared_ptr<Connection> connection);
+	void BatcherMain();
+
+	void Enqueue(PendingRequest&& request);
+	void ProcessBatch(std::vector<PendingRequest>& batch);
+	void ProcessRaycasts(std::vector<PendingRequest*> const& requests, bool isClosestHit, std::vector<std::vector<uint8_t>>& out_payloads);
+	void ProcessRegions(std::vector<PendingRequest*> const& requests, std::vector<std::vector<uint8_t>>& out_payloads);
+	bool ReloadScene();
+	bool HasSceneFileChanged() const;
+	void SendResponse(PendingRequest const& request, eQueryStatus status, uint32_t count, std::vector<uint8_t> const& payload);
+	void ReapClosedConnections();
+
+	QueryServerConfig                        m_config;
+	QuerySocket                              m_listener;
+	std::thread                              m_listenThread;
+	std::thread                              m_batcherThread;
+	bool                                     m_isRunning = false;
+	std::atomic<bool>                        m_isStopping = false;
+	std::atomic<bool>                        m_isReloadRequested = false;
+	std::atomic<bool>                        m_isShutdownRequested = false;
+
+	std::mutex                               m_connectionsMutex;
+	std::vector<std::shared_ptr<Connection>> m_connections;
+
+	std::mutex                               m_queueMutex;
+	std::condition_variable                  m_queueCondition;
+	std::vector<PendingRequest>              m_queue;
+	int                                      m_numQueuedRecords = 0;
+
+	std::unique_ptr<QueryServerScene>        m_scene; // Batcher thread only, once started
+	std::filesystem::file_time_type          m_sceneWriteTime;
+
+	mutable std::mutex                       m_statsMutex;
+	QueryServerStats                         m_stats;
+};
@@ -0,0 +1,280 @@
+//----------------------------------------------------------------------------------------------------
+// QuerySocket.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/QuerySocket.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+//----------------------------------------------------------------------------------------------------
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN		// Always #define this before #including <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------------------------
+#if defined(_WIN32)
+constexpr intptr_t QUERY_INVALID_SOCKET = static_cast<intptr_t>(INVALID_SOCKET);
+
+static SOCKET ToNative(intptr_t handle) { return static_cast<SOCKET>(handle); }
+static void   CloseNative(intptr_t handle) { closesocket(ToNative(handle)); }
+static int    GetLastSocketError() { return WSAGetLastError(); }
+
+//----------------------------------------------------------------------------------------------------
+// Winsock is reference counted per process; one startup that lives until exit is enough
+//----------------------------------------------------------------------------------------------------
+static bool EnsureSocketsInitialized()
+{
+	static bool const s_isInitialized = []()
+	{
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}();
+	return s_isInitialized;
+}
+#else
+constexpr intptr_t QUERY_INVALID_SOCKET = -1;
+
+static int  ToNative(intptr_t handle) { return static_cast<int>(handle); }
+static void CloseNative(intptr_t handle) { close(ToNative(handle)); }
+static int  GetLastSocketError() { return errno; }
+static bool EnsureSocketsInitialized() { return true; }
+#endif
+
+//----------------------------------------------------------------------------------------------------
+std::string QueryEndpoint::GetDescription() const
+{
+	return m_unixSocketPath.empty() ? Stringf("127.0.0.1:%d", static_cast<int>(m_port)) : Stringf("unix:%s", m_unixSocketPath.c_str());
+}
+
+//----------------------------------------------------------------------------------------------------
+// Fill a socket address for the endpoint; returns its length, or 0 if the path does not fit
+//----------------------------------------------------------------------------------------------------
+static int MakeSocketAddress(QueryEndpoint const& endpoint, sockaddr_storage& out_address)
+{
+	std::memset(&out_address, 0, sizeof(out_address));
+	if (!endpoint.m_unixSocketPath.empty())
+	{
+		sockaddr_un& address = reinterpret_cast<sockaddr_un&>(out_address);
+		if (endpoint.m_unixSocketPath.size() >= sizeof(address.sun_path))
+		{
+			return 0;
+		}
+		address.sun_family = AF_UNIX;
+		std::memcpy(address.sun_path, endpoint.m_unixSocketPath.c_str(), endpoint.m_unixSocketPath.size() + 1);
+		return static_cast<int>(sizeof(sockaddr_un));
+	}
+
+	sockaddr_in& address    = reinterpret_cast<sockaddr_in&>(out_address);
+	address.sin_family      = AF_INET;
+	address.sin_port        = htons(endpoint.m_port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return static_cast<int>(sizeof(sockaddr_in));
+}
+
+//----------------------------------------------------------------------------------------------------
+// Small requests and responses must not wait on Nagle's algorithm
+//----------------------------------------------------------------------------------------------------
+static void DisableNagle(intptr_t handle)
+{
+	int enable = 1;
+	setsockopt(ToNative(handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char const*>(&enable), sizeof(enable));
+}
+
+//----------------------------------------------------------------------------------------------------
+QuerySocket::~QuerySocket()
+{
+	Close();
+}
+
+//----------------------------------------------------------------------------------------------------
+QuerySocket::QuerySocket(QuerySocket&& other) noexcept
+	: m_handle(std::exchange(other.m_handle, QUERY_INVALID_SOCKET))
+	, m_isUnix(other.m_isUnix)
+{
+}
+
+//----------------------------------------------------------------------------------------------------
+QuerySocket& QuerySocket::operator=(QuerySocket&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_handle = std::exchange(other.m_handle, QUERY_INVALID_SOCKET);
+		m_isUnix = other.m_isUnix;
+	}
+	return *this;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC QuerySocket QuerySocket::Listen(QueryEndpoint const& endpoint, std::string& out_error)
+{
+	if (!EnsureSocketsInitialized())
+	{
+		out_error = "Could not initialize sockets";
+		return QuerySocket();
+	}
+
+	sockaddr_storage address;
+	int addressLength = MakeSocketAddress(endpoint, address);
+	if (addressLength == 0)
+	{
+		out_error = Stringf("Socket path too long: %s", endpoint.m_unixSocketPath.c_str());
+		return QuerySocket();
+	}
+
+	QuerySocket listener(static_cast<intptr_t>(socket(address.ss_family, SOCK_STREAM, 0)));
+	listener.m_isUnix = !endpoint.m_unixSocketPath.empty();
+	if (!listener.IsValid())
+	{
+		out_error = Stringf("Could not create socket (error %d)", GetLastSocketError());
+		return QuerySocket();
+	}
+
+	if (listener.m_isUnix)
+	{
+		// A stale socket file from a previous run would make bind fail
+		std::remove(endpoint.m_unixSocketPath.c_str());
+	}
+	else
+	{
+		int enable = 1;
+		setsockopt(ToNative(listener.m_handle), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char const*>(&enable), sizeof(enable));
+	}
+
+	if (bind(ToNative(listener.m_handle), reinterpret_cast<sockaddr const*>(&address), addressLength) != 0 ||
+		listen(ToNative(listener.m_handle), SOMAXCONN) != 0)
+	{
+		out_error = Stringf("Could not listen on %s (error %d)", endpoint.GetDescription().c_str(), GetLastSocketError());
+		return QuerySocket();
+	}
+	return listener;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC QuerySocket QuerySocket::Connect(QueryEndpoint const& endpoint, std::string& out_error)
+{
+	if (!EnsureSocketsInitialized())
+	{
+		out_error = "Could not initialize sockets";
+		return QuerySocket();
+	}
+
+	sockaddr_storage address;
+	int addressLength = MakeSocketAddress(endpoint, address);
+	if (addressLength == 0)
+	{
+		out_error = Stringf("Socket path too long: %s", endpoint.m_unixSocketPath.c_str());
+		return QuerySocket();
+	}
+
+	QuerySocket connection(static_cast<intptr_t>(socket(address.ss_family, SOCK_STREAM, 0)));
+	connection.m_isUnix = !endpoint.m_unixSocketPath.empty();
+	if (!connection.IsValid() || connect(ToNative(connection.m_handle), reinterpret_cast<sockaddr const*>(&address), addressLength) != 0)
+	{
+		out_error = Stringf("Could not connect to %s (error %d)", endpoint.GetDescription().c_str(), GetLastSocketError());
+		return QuerySocket();
+	}
+	if (!connection.m_isUnix)
+	{
+		DisableNagle(connection.m_handle);
+	}
+	return connection;
+}
+
+//----------------------------------------------------------------------------------------------------
+QuerySocket QuerySocket::Accept() const
+{
+	QuerySocket connection(static_cast<intptr_t>(accept(ToNative(m_handle), nullptr, nullptr)));
+	connection.m_isUnix = m_isUnix;
+	if (connection.IsValid() && !connection.m_isUnix)
+	{
+		DisableNagle(connection.m_handle);
+	}
+	return connection;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool QuerySocket::SendAll(void const* data, size_t numBytes) const
+{
+	char const* bytes = static_cast<char const*>(data);
+	while (numBytes > 0)
+	{
+		int chunk = static_cast<int>(std::min(numBytes, static_cast<size_t>(1 << 30)));
+#if defined(_WIN32)
+		int numSent = send(ToNative(m_handle), bytes, chunk, 0);
+#else
+		int numSent = static_cast<int>(send(ToNative(m_handle), bytes, chunk, MSG_NOSIGNAL));
+#endif
+		if (numSent <= 0)
+		{
+			return false;
+		}
+		bytes    += numSent;
+		numBytes -= static_cast<size_t>(numSent);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool QuerySocket::ReceiveAll(void* data, size_t numBytes) const
+{
+	char* bytes = static_cast<char*>(data);
+	while (numBytes > 0)
+	{
+		int chunk       = static_cast<int>(std::min(numBytes, static_cast<size_t>(1 << 30)));
+		int numReceived = static_cast<int>(recv(ToNative(m_handle), bytes, chunk, 0));
+		if (numReceived <= 0)
+		{
+			return false;
+		}
+		bytes    += numReceived;
+		numBytes -= static_cast<size_t>(numReceived);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+void QuerySocket::Shutdown() const
+{
+	if (IsValid())
+	{
+#if defined(_WIN32)
+		shutdown(ToNative(m_handle), SD_BOTH);
+#else
+		shutdown(ToNative(m_handle), SHUT_RDWR);
+#endif
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void QuerySocket::Close()
+{
+	if (IsValid())
+	{
+		CloseNative(m_handle);
+		m_handle = QUERY_INVALID_SOCKET;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+bool QuerySocket::IsValid() const
+{
+	return m_handle != QUERY_INVALID_SOCKET;
+}
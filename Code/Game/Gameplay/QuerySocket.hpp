@@ -0,0 +1,55 @@
+//----------------------------------------------------------------------------------------------------
+// QuerySocket.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------
+// QueryEndpoint - Where the query server listens. Always local: TCP binds to 127.0.0.1 only, and a
+// non-empty socket path selects a Unix domain socket instead (AF_UNIX, Windows 10 1803 or later).
+//----------------------------------------------------------------------------------------------------
+struct QueryEndpoint
+{
+	uint16_t    m_port = 27270;
+	std::string m_unixSocketPath;
+
+	std::string GetDescription() const;
+};
+
+//----------------------------------------------------------------------------------------------------
+// QuerySocket - Move-only blocking stream socket for the query server and its clients
+//
+// Shutdown may be called from another thread to unblock a pending Receive on a connection. A pending
+// Accept is woken portably only by a connection, so listeners are stopped by connecting to them.
+//----------------------------------------------------------------------------------------------------
+class QuerySocket
+{
+public:
+	QuerySocket() = default;
+	~QuerySocket();
+	QuerySocket(QuerySocket&& other) noexcept;
+	QuerySocket& operator=(QuerySocket&& other) noexcept;
+	QuerySocket(QuerySocket const&)            = delete;
+	QuerySocket& operator=(QuerySocket const&) = delete;
+
+	static QuerySocket Listen(QueryEndpoint const& endpoint, std::string& out_error);
+	static QuerySocket Connect(QueryEndpoint const& endpoint, std::string& out_error);
+
+	QuerySocket Accept() const;
+	bool        SendAll(void const* data, size_t numBytes) const;
+	bool        ReceiveAll(void* data, size_t numBytes) const;
+	void        Shutdown() const;
+	void        Close();
+	bool        IsValid() const;
+
+private:
+	explicit QuerySocket(intptr_t handle) : m_handle(handle) {}
+
+	intptr_t m_handle = -1; // SOCKET on Windows, file descriptor elsewhere
+	bool     m_isUnix = false;
+};
@@ -0,0 +1,259 @@
+//----------------------------------------------------------------------------------------------------
+// RayQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/BVH.hpp"
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/QuadTree.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/RaycastUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+
+//----------------------------------------------------------------------------------------------------
+constexpr int RAYS_PER_TASK = 256;
+
+//----------------------------------------------------------------------------------------------------
+RayPenetrationCollector::RayPenetrationCollector(std::span<RayPenetration> buffer, int maxHits)
+	: m_buffer(buffer)
+	, m_capacity(static_cast<int>(buffer.size()))
+{
+	if (maxHits >= 0 && maxHits < m_capacity)
+	{
+		m_capacity = maxHits;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// Entry distance order, ties (a ray starting inside several convexes) broken by object id so every
+// accelerator reports the same list whatever order it visits objects in
+//----------------------------------------------------------------------------------------------------
+static bool IsNearerPenetration(RayPenetration const& a, RayPenetration const& b)
+{
+	if (a.m_entryDist != b.m_entryDist)
+	{
+		return a.m_entryDist < b.m_entryDist;
+	}
+	return a.m_objectId < b.m_objectId;
+}
+
+//----------------------------------------------------------------------------------------------------
+void RayPenetrationCollector::Insert(RayPenetration const& penetration)
+{
+	if (m_capacity == 0)
+	{
+		return;
+	}
+	if (IsFull() && !IsNearerPenetration(penetration, m_buffer[m_numHits - 1]))
+	{
+		return;
+	}
+
+	// Drop the farthest when full, then shift farther hits back to open the slot
+	int slot = IsFull() ? m_numHits - 1 : m_numHits++;
+	while (slot > 0 && IsNearerPenetration(penetration, m_buffer[slot - 1]))
+	{
+		m_buffer[slot] = m_buffer[slot - 1];
+		--slot;
+	}
+	m_buffer[slot] = penetration;
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetPruneDist - Nodes entered beyond this distance cannot contribute to the kept hits
+//----------------------------------------------------------------------------------------------------
+float RayPenetrationCollector::GetPruneDist() const
+{
+	if (m_capacity == 0)
+	{
+		return -1.f;
+	}
+	return IsFull() ? m_buffer[m_numHits - 1].m_entryDist : FLT_MAX;
+}
+
+//----------------------------------------------------------------------------------------------------
+void NarrowPhaseClosestHit(std::vector<Convex2*> const& candidates, Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, bool discRejection, bool boxRejection, ClosestRayHit& inout_best, QueryFilter const& filter)
+{
+	RaycastResult2D rayRes;
+	for (int i = 0; i < static_cast<int>(candidates.size()); ++i)
+	{
+		if (filter.Accepts(candidates[i]->m_categoryMask) && candidates[i]->RayCastVsConvex2D(rayRes, startPos, forwardVec, maxDist, discRejection, boxRejection))
+		{
+			if (rayRes.m_impactLength < inout_best.m_dist)
+			{
+				inout_best.m_dist     = rayRes.m_impactLength;
+				inout_best.m_objectId = candidates[i]->m_objectId;
+				inout_best.m_normal   = rayRes.m_impactNormal;
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+bool NarrowPhaseAnyHit(std::vector<Convex2*> const& candidates, Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, bool discRejection, bool boxRejection, QueryFilter const& filter)
+{
+	RaycastResult2D rayRes;
+	for (int i = 0; i < static_cast<int>(candidates.size()); ++i)
+	{
+		if (filter.Accepts(candidates[i]->m_categoryMask) && candidates[i]->RayCastVsConvex2D(rayRes, startPos, forwardVec, maxDist, discRejection, boxRejection))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RaycastBatch - Mode is dispatched once per batch, never per ray
+//----------------------------------------------------------------------------------------------------
+int RaycastBatch(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, RayHitBatch const& out_hits)
+{
+	int numHits = 0;
+	DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+	{
+		numHits = RaycastBatchWith(accelerator, rays, out_hits, scene.m_filter);
+	});
+	return numHits;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RaycastBatchParallel - Each block runs the same statically dispatched loop on its thread's scratch
+//----------------------------------------------------------------------------------------------------
+int RaycastBatchParallel(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, RayHitBatch const& out_hits)
+{
+	std::atomic<int> numHits = 0;
+	DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+	{
+		ParallelFor(0, rays.GetNumRays(), RAYS_PER_TASK, [&](int first, int last)
+		{
+			size_t      count = static_cast<size_t>(last - first);
+			RayBatch    blockRays{rays.m_startPositions.subspan(first, count), rays.m_forwardNormals.subspan(first, count), rays.m_maxDists.subspan(first, count)};
+			RayHitBatch blockHits{out_hits.m_impactDists.subspan(first, count), out_hits.m_impactObjectIds.subspan(first, count), out_hits.m_impactNormals.subspan(first, count)};
+			numHits += RaycastBatchWith(accelerator, blockRays, blockHits, scene.m_filter);
+		});
+	});
+	return numHits;
+}
+
+//----------------------------------------------------------------------------------------------------
+// RaycastBatchWithHints - The hint's hit distance becomes the traversal's max distance, so only
+// objects that could be nearer are gathered at all. A hint the scene filter rejects is ignored.
+//----------------------------------------------------------------------------------------------------
+int RaycastBatchWithHints(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, std::span<int> inout_hintObjectIds, RayHitBatch const& out_hits)
+{
+	std::vector<Convex2*> const& convexes    = *scene.m_convexes;
+	QueryScratch&               scratch     = QueryScratch::GetForThisThread();
+	int                          numConvexes = static_cast<int>(convexes.size());
+	int                          numHits     = 0;
+
+	DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+	{
+		RaycastResult2D rayRes;
+		for (int j = 0; j < rays.GetNumRays(); ++j)
+		{
+			Vec2 const& startPos   = rays.m_startPositions[j];
+			Vec2 const& forwardVec = rays.m_forwardNormals[j];
+			float       maxDist    = rays.m_maxDists[j];
+			int         hintId     = inout_hintObjectIds[j];
+
+			ClosestRayHit best;
+			if (hintId >= 0 && hintId < numConvexes && scene.m_filter.Accepts(convexes[hintId]->m_categoryMask) &&
+				convexes[hintId]->RayCastVsConvex2D(rayRes, startPos, forwardVec, maxDist, false, false))
+			{
+				best.m_dist     = rayRes.m_impactLength;
+				best.m_objectId = hintId;
+				best.m_normal   = rayRes.m_impactNormal;
+			}
+			if (accelerator.RaycastClosest(startPos, forwardVec, maxDist, scratch, best, scene.m_filter))
+			{
+				++numHits;
+			}
+
+			out_hits.m_impactDists[j]     = best.m_dist;
+			out_hits.m_impactObjectIds[j] = best.m_objectId;
+			out_hits.m_impactNormals[j]   = best.m_normal;
+			inout_hintObjectIds[j]        = best.m_objectId;
+		}
+	});
+	return numHits;
+}
+
+//----------------------------------------------------------------------------------------------------
+int RaycastAllHits(SceneQueryView const& scene, eQueryMode mode, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, std::span<RayPenetration> out_penetrations, int maxHits)
+{
+	RayPenetrationCollector collector(out_penetrations, maxHits);
+	QueryScratch&           scratch = QueryScratch::GetForThisThread();
+
+	DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+	{
+		accelerator.CollectRayPenetrations(startPos, forwardNormal, maxDist, scratch, collector, scene.m_filter);
+	});
+	return collector.m_numHits;
+}
+
+//----------------------------------------------------------------------------------------------------
+// CollectRayPenetrationsBruteForce - No spatial order to exploit; the collector's insertion sort does
+// the ordering
+//----------------------------------------------------------------------------------------------------
+void CollectRayPenetrationsBruteForce(std::vector<Convex2*> const& convexes, Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, bool discRejection, bool boxRejection, RayPenetrationCollector& collector, QueryFilter const& filter)
+{
+	RayPenetration penetration;
+	for (Convex2 const* convex : convexes)
+	{
+		if (filter.Accepts(convex->m_categoryMask) && convex->PassesRayBroadPhase(startPos, forwardVec, maxDist, discRejection, boxRejection) &&
+			convex->GetRayPenetration(penetration, startPos, forwardVec, maxDist))
+		{
+			collector.Insert(penetration);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+bool GetRayEntryDistVsAABB2D(float& out_entryDist, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, AABB2 const& bounds)
+{
+	float entryDist = 0.f;
+	float exitDist  = maxDist;
+
+	float starts[2]   = {startPos.x, startPos.y};
+	float forwards[2] = {forwardNormal.x, forwardNormal.y};
+	float mins[2]     = {bounds.m_mins.x, bounds.m_mins.y};
+	float maxs[2]     = {bounds.m_maxs.x, bounds.m_maxs.y};
+
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		if (forwards[axis] == 0.f)
+		{
+			if (starts[axis] < mins[axis] || starts[axis] > maxs[axis])
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float oneOverForward = 1.f / forwards[axis];
+		float tMin = (mins[axis] - starts[axis]) * oneOverForward;
+		float tMax = (maxs[axis] - starts[axis]) * oneOverForward;
+		if (tMin > tMax)
+		{
+			std::swap(tMin, tMax);
+		}
+		if (tMin > entryDist) entryDist = tMin;
+		if (tMax < exitDist)  exitDist  = tMax;
+		if (entryDist > exitDist)
+		{
+			return false;
+		}
+	}
+
+	out_entryDist = entryDist;
+	return true;
+}
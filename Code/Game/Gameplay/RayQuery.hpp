@@ -0,0 +1,126 @@
+//----------------------------------------------------------------------------------------------------
+// RayQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cfloat>
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct AABB2;
+struct Convex2;
+
+//----------------------------------------------------------------------------------------------------
+// RayBatch - Structure-of-arrays ray input; all spans must have the same length
+//----------------------------------------------------------------------------------------------------
+struct RayBatch
+{
+	std::span<Vec2 const>  m_startPositions;
+	std::span<Vec2 const>  m_forwardNormals;
+	std::span<float const> m_maxDists;
+
+	int GetNumRays() const { return static_cast<int>(m_startPositions.size()); }
+};
+
+//----------------------------------------------------------------------------------------------------
+// RayHitBatch - Structure-of-arrays closest-hit output, one slot per input ray
+//
+// Misses are written as distance FLT_MAX and object id -1.
+//----------------------------------------------------------------------------------------------------
+struct RayHitBatch
+{
+	std::span<float> m_impactDists;
+	std::span<int>   m_impactObjectIds;
+	std::span<Vec2>  m_impactNormals;
+};
+
+//----------------------------------------------------------------------------------------------------
+// ClosestRayHit - Best hit found so far for one ray; a seeded hit bounds the rest of the search
+//----------------------------------------------------------------------------------------------------
+struct ClosestRayHit
+{
+	float m_dist     = FLT_MAX;
+	int   m_objectId = -1;
+	Vec2  m_normal;
+};
+
+//----------------------------------------------------------------------------------------------------
+// RayPenetration - One convex crossed by a ray: where it enters and where it leaves
+//
+// m_exitDist is the true exit and may lie past the ray's max distance.
+//----------------------------------------------------------------------------------------------------
+struct RayPenetration
+{
+	float m_entryDist = 0.f;
+	float m_exitDist  = 0.f;
+	Vec2  m_entryNormal;
+	Vec2  m_exitNormal;
+	int   m_objectId  = -1;
+};
+
+//----------------------------------------------------------------------------------------------------
+// RayPenetrationCollector - Keeps the nearest hits sorted by entry distance, then object id, in a
+// caller-owned buffer
+//
+// Inserts are an insertion sort from the back, so near-to-far traversal order makes them O(1).
+//----------------------------------------------------------------------------------------------------
+struct RayPenetrationCollector
+{
+	RayPenetrationCollector(std::span<RayPenetration> buffer, int maxHits = -1);
+
+	void  Insert(RayPenetration const& penetration);
+	bool  IsFull() const { return m_numHits == m_capacity; }
+	float GetPruneDist() const;
+
+	std::span<RayPenetration> m_buffer;
+	int                       m_capacity = 0;
+	int                       m_numHits  = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+// Closest-hit raycast for every ray in the batch; returns the number of rays that hit something
+//----------------------------------------------------------------------------------------------------
+int RaycastBatch(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, RayHitBatch const& out_hits);
+
+//----------------------------------------------------------------------------------------------------
+// RaycastBatch split into blocks of rays over the task scheduler; results match the serial batch
+//----------------------------------------------------------------------------------------------------
+int RaycastBatchParallel(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, RayHitBatch const& out_hits);
+
+//----------------------------------------------------------------------------------------------------
+// Closest hit for persistent rays (sensor slots, tracked sightlines) seeded with last frame's answer.
+// inout_hintObjectIds holds one object id per ray slot (-1 for none): the hint is narrow-phased
+// first and its distance bounds the search. Each slot is then overwritten with this frame's hit.
+//----------------------------------------------------------------------------------------------------
+int RaycastBatchWithHints(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, std::span<int> inout_hintObjectIds, RayHitBatch const& out_hits);
+
+//----------------------------------------------------------------------------------------------------
+// Exact ray tests over a candidate list, shared by every accelerator. The closest-hit form keeps only
+// hits nearer than the one already in inout_best; the any-hit form stops at the first hit.
+// Candidates the filter rejects are skipped.
+//----------------------------------------------------------------------------------------------------
+void NarrowPhaseClosestHit(std::vector<Convex2*> const& candidates, Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, bool discRejection, bool boxRejection, ClosestRayHit& inout_best, QueryFilter const& filter = QueryFilter());
+bool NarrowPhaseAnyHit(std::vector<Convex2*> const& candidates, Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, bool discRejection, bool boxRejection, QueryFilter const& filter = QueryFilter());
+
+//----------------------------------------------------------------------------------------------------
+// Every convex the segment crosses, tested one by one behind the given rejection (the scan modes)
+//----------------------------------------------------------------------------------------------------
+void CollectRayPenetrationsBruteForce(std::vector<Convex2*> const& convexes, Vec2 const& startPos, Vec2 const& forwardVec, float maxDist, bool discRejection, bool boxRejection, RayPenetrationCollector& collector, QueryFilter const& filter = QueryFilter());
+
+//----------------------------------------------------------------------------------------------------
+// Every convex the segment crosses, sorted by entry distance, then object id; returns the number written.
+// maxHits < 0 means "as many as fit in out_penetrations"; when capped, the nearest hits are kept.
+//----------------------------------------------------------------------------------------------------
+int RaycastAllHits(SceneQueryView const& scene, eQueryMode mode, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, std::span<RayPenetration> out_penetrations, int maxHits = -1);
+
+//----------------------------------------------------------------------------------------------------
+// Slab test returning the distance at which the ray enters the box (0 if it starts inside)
+//----------------------------------------------------------------------------------------------------
+bool GetRayEntryDistVsAABB2D(float& out_entryDist, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, AABB2 const& bounds);
@@ -0,0 +1,369 @@
+//----------------------------------------------------------------------------------------------------
+// RayQueryCache.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/RayQueryCache.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+//----------------------------------------------------------------------------------------------------
+constexpr float RAY_CACHE_POSITION_STEPS  = 1024.f;  // Per world unit
+constexpr float RAY_CACHE_DIRECTION_STEPS = 32767.f; // Per unit of a normal's component
+constexpr float RAY_CACHE_CELL_EPSILON    = 0.001f;  // Fraction of a cell; catches segments grazing a cell corner
+
+//----------------------------------------------------------------------------------------------------
+static int32_t Quantize(float value, float stepsPerUnit)
+{
+	return static_cast<int32_t>(lroundf(value * stepsPerUnit));
+}
+
+//----------------------------------------------------------------------------------------------------
+static uint64_t GetCellKey(int cellX, int cellY)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellY);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Only the part of the segment up to the hit can be affected by an edit: anything beyond it was
+// already occluded, and a change there cannot produce a nearer hit
+//----------------------------------------------------------------------------------------------------
+static float GetRelevantLength(float maxDist, float impactDist)
+{
+	return std::min(maxDist, impactDist);
+}
+
+//----------------------------------------------------------------------------------------------------
+// ForEachCellOnSegment - Grid walk (Amanatides-Woo) over every cell the segment passes through
+//----------------------------------------------------------------------------------------------------
+template <typename CellFunc>
+static void ForEachCellOnSegment(Vec2 const& start, Vec2 const& end, float cellSize, CellFunc&& cellFunc)
+{
+	int  cellX     = static_cast<int>(floorf(start.x / cellSize));
+	int  cellY     = static_cast<int>(floorf(start.y / cellSize));
+	int  endCellX  = static_cast<int>(floorf(end.x / cellSize));
+	int  endCellY  = static_cast<int>(floorf(end.y / cellSize));
+	Vec2 disp      = end - start;
+	int  stepX     = (disp.x > 0.f) ? 1 : -1;
+	int  stepY     = (disp.y > 0.f) ? 1 : -1;
+	int  numSteps  = abs(endCellX - cellX) + abs(endCellY - cellY);
+
+	float tDeltaX = (disp.x != 0.f) ? cellSize / fabsf(disp.x) : FLT_MAX;
+	float tDeltaY = (disp.y != 0.f) ? cellSize / fabsf(disp.y) : FLT_MAX;
+	float tMaxX   = (disp.x != 0.f) ? (static_cast<float>(cellX + (stepX > 0 ? 1 : 0)) * cellSize - start.x) / disp.x : FLT_MAX;
+	float tMaxY   = (disp.y != 0.f) ? (static_cast<float>(cellY + (stepY > 0 ? 1 : 0)) * cellSize - start.y) / disp.y : FLT_MAX;
+
+	cellFunc(cellX, cellY);
+	for (int i = 0; i < numSteps; ++i)
+	{
+		// Never leave the end cell's row or column, whatever rounding says
+		bool canStepX = (cellX != endCellX);
+		bool canStepY = (cellY != endCellY);
+		if (canStepX && (!canStepY || tMaxX < tMaxY))
+		{
+			cellX += stepX;
+			tMaxX += tDeltaX;
+		}
+		else
+		{
+			cellY += stepY;
+			tMaxY += tDeltaY;
+		}
+		cellFunc(cellX, cellY);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t RayCacheKeyHasher::operator()(RayCacheKey const& key) const
+{
+	uint64_t hash = 14695981039346656037ull;
+	int32_t const fields[] = {key.m_startX, key.m_startY, key.m_forwardX, key.m_forwardY, key.m_maxDist};
+	for (int32_t field : fields)
+	{
+		hash ^= static_cast<uint32_t>(field);
+		hash *= 1099511628211ull;
+	}
+	return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+//----------------------------------------------------------------------------------------------------
+RayQueryCache::RayQueryCache(int maxEntries, float gridCellSize)
+	: m_maxEntries(std::max(maxEntries, 1))
+	, m_gridCellSize(gridCellSize)
+{
+}
+
+//----------------------------------------------------------------------------------------------------
+int RayQueryCache::RaycastBatch(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, RayHitBatch const& out_hits)
+{
+	if (!scene.m_filter.AcceptsAll())
+	{
+		return ::RaycastBatch(scene, mode, rays, out_hits);
+	}
+
+	int numRays = rays.GetNumRays();
+	int numHits = 0;
+
+	m_missRayIndexes.clear();
+	m_missStartPositions.clear();
+	m_missForwardNormals.clear();
+	m_missMaxDists.clear();
+
+	for (int j = 0; j < numRays; ++j)
+	{
+		Vec2 const& startPos      = rays.m_startPositions[j];
+		Vec2 const& forwardNormal = rays.m_forwardNormals[j];
+		float       maxDist       = rays.m_maxDists[j];
+
+		++m_stats.m_numLookups;
+		int entryIndex = FindEntry(MakeKey(startPos, forwardNormal, maxDist), startPos, forwardNormal, maxDist);
+		if (entryIndex < 0)
+		{
+			m_missRayIndexes.push_back(j);
+			m_missStartPositions.push_back(startPos);
+			m_missForwardNormals.push_back(forwardNormal);
+			m_missMaxDists.push_back(maxDist);
+			continue;
+		}
+
+		++m_stats.m_numHits;
+		CacheEntry const& entry = m_entries[entryIndex];
+		out_hits.m_impactDists[j]     = entry.m_impactDist;
+		out_hits.m_impactObjectIds[j] = entry.m_objectId;
+		out_hits.m_impactNormals[j]   = entry.m_impactNormal;
+		if (entry.m_objectId != -1)
+		{
+			++numHits;
+		}
+	}
+
+	int numMisses = static_cast<int>(m_missRayIndexes.size());
+	if (numMisses == 0)
+	{
+		return numHits;
+	}
+
+	m_missImpactDists.resize(numMisses);
+	m_missObjectIds.resize(numMisses);
+	m_missImpactNormals.resize(numMisses);
+
+	RayBatch    missRays{m_missStartPositions, m_missForwardNormals, m_missMaxDists};
+	RayHitBatch missHits{m_missImpactDists, m_missObjectIds, m_missImpactNormals};
+	numHits += ::RaycastBatch(scene, mode, missRays, missHits);
+
+	for (int i = 0; i < numMisses; ++i)
+	{
+		int j = m_missRayIndexes[i];
+		out_hits.m_impactDists[j]     = m_missImpactDists[i];
+		out_hits.m_impactObjectIds[j] = m_missObjectIds[i];
+		out_hits.m_impactNormals[j]   = m_missImpactNormals[i];
+		InsertEntry(m_missStartPositions[i], m_missForwardNormals[i], m_missMaxDists[i], m_missImpactDists[i], m_missObjectIds[i], m_missImpactNormals[i]);
+	}
+	return numHits;
+}
+
+//----------------------------------------------------------------------------------------------------
+// InvalidateRegion - Drop every entry whose relevant segment touches the bounds
+//
+// Call with both the old and the new bounds of an edited object. A cached hit usually lies exactly
+// on a face of those bounds, where the slab test can miss by rounding, so both the bounds and the
+// segment are padded: dropping a few extra entries is harmless, keeping a stale one is not.
+//----------------------------------------------------------------------------------------------------
+void RayQueryCache::InvalidateRegion(AABB2 const& bounds)
+{
+	float margin       = m_gridCellSize * RAY_CACHE_CELL_EPSILON;
+	AABB2 paddedBounds = AABB2(bounds.m_mins - Vec2(margin, margin), bounds.m_maxs + Vec2(margin, margin));
+	int   minCellX     = static_cast<int>(floorf(paddedBounds.m_mins.x / m_gridCellSize));
+	int   minCellY     = static_cast<int>(floorf(paddedBounds.m_mins.y / m_gridCellSize));
+	int   maxCellX     = static_cast<int>(floorf(paddedBounds.m_maxs.x / m_gridCellSize));
+	int   maxCellY     = static_cast<int>(floorf(paddedBounds.m_maxs.y / m_gridCellSize));
+
+	for (int cellY = minCellY; cellY <= maxCellY; ++cellY)
+	{
+		for (int cellX = minCellX; cellX <= maxCellX; ++cellX)
+		{
+			auto cellIter = m_gridCells.find(GetCellKey(cellX, cellY));
+			if (cellIter == m_gridCells.end())
+			{
+				continue;
+			}
+
+			for (GridRef const& ref : cellIter->second)
+			{
+				if (!IsRefLive(ref))
+				{
+					continue;
+				}
+				CacheEntry const& entry = m_entries[ref.m_entryIndex];
+				float entryDist = 0.f;
+				if (GetRayEntryDistVsAABB2D(entryDist, entry.m_startPos, entry.m_forwardNormal, GetRelevantLength(entry.m_maxDist, entry.m_impactDist) + margin, paddedBounds))
+				{
+					RemoveEntry(ref.m_entryIndex);
+					++m_stats.m_numInvalidations;
+				}
+			}
+
+			CompactCell(cellIter->second);
+			if (cellIter->second.empty())
+			{
+				m_gridCells.erase(cellIter);
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void RayQueryCache::Clear()
+{
+	m_entries.clear();
+	m_freeEntries.clear();
+	m_entryIndexByKey.clear();
+	m_gridCells.clear();
+	m_nextEvictIndex = 0;
+}
+
+//----------------------------------------------------------------------------------------------------
+size_t RayQueryCache::GetMemoryBytes() const
+{
+	// Hash nodes are estimated as payload plus a next pointer and a cached hash
+	size_t bytes = m_entries.capacity() * sizeof(CacheEntry) + m_freeEntries.capacity() * sizeof(int);
+	bytes += m_entryIndexByKey.size() * (sizeof(std::pair<RayCacheKey const, int>) + 2 * sizeof(void*));
+	bytes += m_entryIndexByKey.bucket_count() * sizeof(void*);
+	for (auto const& [cellKey, refs] : m_gridCells)
+	{
+		bytes += sizeof(uint64_t) + sizeof(std::vector<GridRef>) + 2 * sizeof(void*) + refs.capacity() * sizeof(GridRef);
+	}
+	bytes += m_gridCells.bucket_count() * sizeof(void*);
+	return bytes;
+}
+
+//----------------------------------------------------------------------------------------------------
+RayCacheKey RayQueryCache::MakeKey(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const
+{
+	RayCacheKey key;
+	key.m_startX   = Quantize(startPos.x, RAY_CACHE_POSITION_STEPS);
+	key.m_startY   = Quantize(startPos.y, RAY_CACHE_POSITION_STEPS);
+	key.m_forwardX = Quantize(forwardNormal.x, RAY_CACHE_DIRECTION_STEPS);
+	key.m_forwardY = Quantize(forwardNormal.y, RAY_CACHE_DIRECTION_STEPS);
+	key.m_maxDist  = Quantize(maxDist, RAY_CACHE_POSITION_STEPS);
+	return key;
+}
+
+//----------------------------------------------------------------------------------------------------
+// FindEntry - The key only narrows the search; the stored ray must match exactly to count as a hit
+//----------------------------------------------------------------------------------------------------
+int RayQueryCache::FindEntry(RayCacheKey const& key, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const
+{
+	auto iter = m_entryIndexByKey.find(key);
+	if (iter == m_entryIndexByKey.end())
+	{
+		return -1;
+	}
+
+	CacheEntry const& entry = m_entries[iter->second];
+	bool isSameRay = entry.m_startPos.x == startPos.x && entry.m_startPos.y == startPos.y &&
+					 entry.m_forwardNormal.x == forwardNormal.x && entry.m_forwardNormal.y == forwardNormal.y &&
+					 entry.m_maxDist == maxDist;
+	return isSameRay ? iter->second : -1;
+}
+
+//----------------------------------------------------------------------------------------------------
+void RayQueryCache::InsertEntry(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, float impactDist, int objectId, Vec2 const& impactNormal)
+{
+	RayCacheKey key = MakeKey(startPos, forwardNormal, maxDist);
+
+	// A different ray that quantized to the same key is replaced
+	auto iter = m_entryIndexByKey.find(key);
+	if (iter != m_entryIndexByKey.end())
+	{
+		RemoveEntry(iter->second);
+	}
+
+	if (m_freeEntries.empty() && static_cast<int>(m_entries.size()) >= m_maxEntries)
+	{
+		// Round-robin eviction: cheap, and repeated probes are re-inserted on their next miss
+		RemoveEntry(m_nextEvictIndex);
+		m_nextEvictIndex = (m_nextEvictIndex + 1) % m_maxEntries;
+		++m_stats.m_numEvictions;
+	}
+
+	int entryIndex;
+	if (!m_freeEntries.empty())
+	{
+		entryIndex = m_freeEntries.back();
+		m_freeEntries.pop_back();
+	}
+	else
+	{
+		entryIndex = static_cast<int>(m_entries.size());
+		m_entries.emplace_back();
+	}
+
+	CacheEntry& entry     = m_entries[entryIndex];
+	entry.m_key           = key;
+	entry.m_startPos      = startPos;
+	entry.m_forwardNormal = forwardNormal;
+	entry.m_maxDist       = maxDist;
+	entry.m_impactDist    = impactDist;
+	entry.m_objectId      = objectId;
+	entry.m_impactNormal  = impactNormal;
+	entry.m_isLive        = true;
+
+	m_entryIndexByKey[key] = entryIndex;
+	RegisterInGrid(entryIndex);
+}
+
+//----------------------------------------------------------------------------------------------------
+// RemoveEntry - Grid references are left behind; the generation bump makes them stale
+//----------------------------------------------------------------------------------------------------
+void RayQueryCache::RemoveEntry(int entryIndex)
+{
+	CacheEntry& entry = m_entries[entryIndex];
+	if (!entry.m_isLive)
+	{
+		return;
+	}
+	m_entryIndexByKey.erase(entry.m_key);
+	entry.m_isLive = false;
+	++entry.m_generation;
+	m_freeEntries.push_back(entryIndex);
+}
+
+//----------------------------------------------------------------------------------------------------
+void RayQueryCache::RegisterInGrid(int entryIndex)
+{
+	CacheEntry const& entry = m_entries[entryIndex];
+	GridRef const     ref   = {entryIndex, entry.m_generation};
+	Vec2 const        end   = entry.m_startPos + entry.m_forwardNormal * GetRelevantLength(entry.m_maxDist, entry.m_impactDist);
+
+	ForEachCellOnSegment(entry.m_startPos, end, m_gridCellSize, [&](int cellX, int cellY)
+	{
+		std::vector<GridRef>& refs = m_gridCells[GetCellKey(cellX, cellY)];
+		if (!refs.empty() && refs.size() == refs.capacity())
+		{
+			// Purge stale references before the vector grows, so untouched cells stay bounded
+			CompactCell(refs);
+		}
+		refs.push_back(ref);
+	});
+}
+
+//----------------------------------------------------------------------------------------------------
+void RayQueryCache::CompactCell(std::vector<GridRef>& refs) const
+{
+	refs.erase(std::remove_if(refs.begin(), refs.end(), [this](GridRef const& ref) { return !IsRefLive(ref); }), refs.end());
+}
+
+//----------------------------------------------------------------------------------------------------
+bool RayQueryCache::IsRefLive(GridRef const& ref) const
+{
+	CacheEntry const& entry = m_entries[ref.m_entryIndex];
+	return entry.m_isLive && entry.m_generation == ref.m_generation;
+}
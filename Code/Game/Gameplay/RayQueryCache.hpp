@@ -0,0 +1,122 @@
+//----------------------------------------------------------------------------------------------------
+// RayQueryCache.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct AABB2;
+struct RayBatch;
+struct RayHitBatch;
+
+//----------------------------------------------------------------------------------------------------
+// RayCacheKey - Ray parameters snapped to fixed point so repeated probes hash stably
+//----------------------------------------------------------------------------------------------------
+struct RayCacheKey
+{
+	int32_t m_startX   = 0;
+	int32_t m_startY   = 0;
+	int32_t m_forwardX = 0;
+	int32_t m_forwardY = 0;
+	int32_t m_maxDist  = 0;
+
+	bool operator==(RayCacheKey const& other) const = default;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct RayCacheKeyHasher
+{
+	size_t operator()(RayCacheKey const& key) const;
+};
+
+//----------------------------------------------------------------------------------------------------
+struct RayQueryCacheStats
+{
+	int64_t m_numLookups       = 0;
+	int64_t m_numHits          = 0;
+	int64_t m_numInvalidations = 0; // Entries dropped because an edit touched their segment
+	int64_t m_numEvictions     = 0; // Entries dropped to stay under the capacity
+
+	float GetHitRate() const { return (m_numLookups > 0) ? static_cast<float>(m_numHits) / static_cast<float>(m_numLookups) : 0.f; }
+};
+
+//----------------------------------------------------------------------------------------------------
+// RayQueryCache - Opt-in closest-hit cache for rays that repeat frame to frame
+//
+// Entries are looked up by quantized key and confirmed against the exact ray, so a cached answer
+// is always the answer RaycastBatch would give. Each entry is registered in the coarse grid cells
+// its segment crosses; an edit drops only the entries whose segment touches the edited object's
+// old or new bounds. Object ids are cached too, so adding or removing objects must Clear().
+// Answers are cached unfiltered, so category changes keep them valid; a filtered scene bypasses
+// the cache. Not thread safe: one cache per querying thread.
+//----------------------------------------------------------------------------------------------------
+class RayQueryCache
+{
+public:
+	explicit RayQueryCache(int maxEntries = 65536, float gridCellSize = 8.f);
+
+	// Cached rays are answered in place; the misses go to RaycastBatch as one compacted batch
+	int  RaycastBatch(SceneQueryView const& scene, eQueryMode mode, RayBatch const& rays, RayHitBatch const& out_hits);
+	void InvalidateRegion(AABB2 const& bounds);
+	void Clear();
+
+	RayQueryCacheStats const& GetStats() const { return m_stats; }
+	void                      ResetStats() { m_stats = RayQueryCacheStats(); }
+	int                       GetNumEntries() const { return static_cast<int>(m_entryIndexByKey.size()); }
+	size_t                    GetMemoryBytes() const;
+
+private:
+	struct CacheEntry
+	{
+		RayCacheKey m_key;
+		Vec2        m_startPos;
+		Vec2        m_forwardNormal;
+		float       m_maxDist    = 0.f;
+		float       m_impactDist = 0.f;
+		int         m_objectId   = -1;
+		Vec2        m_impactNormal;
+		uint32_t    m_generation = 0;     // Bumped on removal so stale grid references are recognised
+		bool        m_isLive     = false;
+	};
+
+	struct GridRef
+	{
+		int      m_entryIndex = 0;
+		uint32_t m_generation = 0;
+	};
+
+	RayCacheKey MakeKey(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const;
+	int         FindEntry(RayCacheKey const& key, Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist) const;
+	void        InsertEntry(Vec2 const& startPos, Vec2 const& forwardNormal, float maxDist, float impactDist, int objectId, Vec2 const& impactNormal);
+	void        RemoveEntry(int entryIndex);
+	void        RegisterInGrid(int entryIndex);
+	void        CompactCell(std::vector<GridRef>& refs) const;
+	bool        IsRefLive(GridRef const& ref) const;
+
+	int                                                     m_maxEntries     = 0;
+	float                                                   m_gridCellSize   = 1.f;
+	std::vector<CacheEntry>                                 m_entries;
+	std::vector<int>                                        m_freeEntries;
+	int                                                     m_nextEvictIndex = 0;
+	std::unordered_map<RayCacheKey, int, RayCacheKeyHasher> m_entryIndexByKey;
+	std::unordered_map<uint64_t, std::vector<GridRef>>      m_gridCells;
+	RayQueryCacheStats                                      m_stats;
+
+	// Miss compaction buffers, reused across calls
+	std::vector<int>   m_missRayIndexes;
+	std::vector<Vec2>  m_missStartPositions;
+	std::vector<Vec2>  m_missForwardNormals;
+	std::vector<float> m_missMaxDists;
+	std::vector<float> m_missImpactDists;
+	std::vector<int>   m_missObjectIds;
+	std::vector<Vec2>  m_missImpactNormals;
+};
@@ -0,0 +1,163 @@
+//----------------------------------------------------------------------------------------------------
+// RegionQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/RegionQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/BVH.hpp"
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/QuadTree.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/MathUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cfloat>
+
+//----------------------------------------------------------------------------------------------------
+static bool DoesDiscOverlapAABB2(Vec2 const& center, float radius, AABB2 const& box)
+{
+	float nearestX = center.x < box.m_mins.x ? box.m_mins.x : (center.x > box.m_maxs.x ? box.m_maxs.x : center.x);
+	float nearestY = center.y < box.m_mins.y ? box.m_mins.y : (center.y > box.m_maxs.y ? box.m_maxs.y : center.y);
+	return (Vec2(nearestX, nearestY) - center).GetLengthSquared() <= radius * radius;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC RegionQueryShape RegionQueryShape::MakeAABB(AABB2 const& box)
+{
+	RegionQueryShape shape;
+	shape.m_shape  = eRegionShape::AABB;
+	shape.m_bounds = box;
+	return shape;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC RegionQueryShape RegionQueryShape::MakeDisc(Vec2 const& center, float radius)
+{
+	RegionQueryShape shape;
+	shape.m_shape      = eRegionShape::DISC;
+	shape.m_bounds     = AABB2(center - Vec2(radius, radius), center + Vec2(radius, radius));
+	shape.m_discCenter = center;
+	shape.m_discRadius = radius;
+	return shape;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC RegionQueryShape RegionQueryShape::MakeConvexPoly(std::span<Vec2 const> ccwVerts)
+{
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	float minY = FLT_MAX, maxY = -FLT_MAX;
+	for (Vec2 const& vert : ccwVerts)
+	{
+		if (vert.x < minX) minX = vert.x;
+		if (vert.x > maxX) maxX = vert.x;
+		if (vert.y < minY) minY = vert.y;
+		if (vert.y > maxY) maxY = vert.y;
+	}
+
+	RegionQueryShape shape;
+	shape.m_shape     = eRegionShape::CONVEX_POLY;
+	shape.m_bounds    = AABB2(Vec2(minX, minY), Vec2(maxX, maxY));
+	shape.m_polyVerts = ccwVerts;
+	return shape;
+}
+
+//----------------------------------------------------------------------------------------------------
+// OverlapsBounds - Conservative test used to cull tree nodes and per-object boxes
+//----------------------------------------------------------------------------------------------------
+bool RegionQueryShape::OverlapsBounds(AABB2 const& bounds) const
+{
+	if (m_shape == eRegionShape::DISC)
+	{
+		return DoesDiscOverlapAABB2(m_discCenter, m_discRadius, bounds);
+	}
+	return DoAABB2sOverlap2D(m_bounds, bounds);
+}
+
+//----------------------------------------------------------------------------------------------------
+bool RegionQueryShape::OverlapsConvex(Convex2 const& convex) const
+{
+	switch (m_shape)
+	{
+	case eRegionShape::AABB:        return convex.OverlapsAABB2(m_bounds);
+	case eRegionShape::DISC:        return convex.OverlapsDisc(m_discCenter, m_discRadius);
+	case eRegionShape::CONVEX_POLY: return convex.OverlapsConvexVerts(m_polyVerts);
+	default:                        return false;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void RegionOverlapCollector::Add(int objectId)
+{
+	if (m_numHits < static_cast<int>(m_buffer.size()))
+	{
+		m_buffer[m_numHits] = objectId;
+	}
+	++m_numHits;
+
+	if (m_stopAtFirst || m_numHits >= static_cast<int>(m_buffer.size()))
+	{
+		m_isDone = true;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+void CollectRegionOverlapsBruteForce(std::vector<Convex2*> const& convexes, eQueryMode rejectionMode, RegionQueryShape const& shape, RegionOverlapCollector& collector, QueryFilter const& filter)
+{
+	for (Convex2 const* convex : convexes)
+	{
+		if (!filter.Accepts(convex->m_categoryMask))
+		{
+			continue;
+		}
+		if (rejectionMode == eQueryMode::DISC_REJECTION && !DoesDiscOverlapAABB2(convex->m_boundingDiscCenter, convex->m_boundingRadius, shape.m_bounds))
+		{
+			continue;
+		}
+		if (rejectionMode == eQueryMode::AABB_REJECTION && !shape.OverlapsBounds(convex->m_boundingAABB))
+		{
+			continue;
+		}
+		if (shape.OverlapsConvex(*convex))
+		{
+			collector.Add(convex->m_objectId);
+			if (collector.m_isDone)
+			{
+				return;
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+static void CollectRegionOverlaps(SceneQueryView const& scene, eQueryMode mode, RegionQueryShape const& shape, RegionOverlapCollector& collector)
+{
+	QueryScratch& scratch = QueryScratch::GetForThisThread();
+	DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+	{
+		accelerator.CollectRegionOverlaps(shape, scratch, collector, scene.m_filter);
+	});
+}
+
+//----------------------------------------------------------------------------------------------------
+int QueryRegionOverlaps(SceneQueryView const& scene, eQueryMode mode, RegionQueryShape const& shape, std::span<int> out_objectIds)
+{
+	RegionOverlapCollector collector;
+	collector.m_buffer = out_objectIds;
+	collector.m_isDone = out_objectIds.empty();
+	if (!collector.m_isDone)
+	{
+		CollectRegionOverlaps(scene, mode, shape, collector);
+	}
+	return collector.m_numHits;
+}
+
+//----------------------------------------------------------------------------------------------------
+bool DoesRegionOverlapAny(SceneQueryView const& scene, eQueryMode mode, RegionQueryShape const& shape)
+{
+	RegionOverlapCollector collector;
+	collector.m_stopAtFirst = true;
+	CollectRegionOverlaps(scene, mode, shape, collector);
+	return collector.m_numHits > 0;
+}
@@ -0,0 +1,68 @@
+//----------------------------------------------------------------------------------------------------
+// RegionQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+enum class eRegionShape : int8_t
+{
+	AABB,
+	DISC,
+	CONVEX_POLY
+};
+
+//----------------------------------------------------------------------------------------------------
+// RegionQueryShape - The area being asked about, plus its bounds for broad-phase culling
+//
+// Convex-poly shapes reference the caller's CCW vertex array; it must outlive the query.
+//----------------------------------------------------------------------------------------------------
+struct RegionQueryShape
+{
+	static RegionQueryShape MakeAABB(AABB2 const& box);
+	static RegionQueryShape MakeDisc(Vec2 const& center, float radius);
+	static RegionQueryShape MakeConvexPoly(std::span<Vec2 const> ccwVerts);
+
+	bool OverlapsBounds(AABB2 const& bounds) const;
+	bool OverlapsConvex(Convex2 const& convex) const;
+
+	eRegionShape          m_shape = eRegionShape::AABB;
+	AABB2                 m_bounds;
+	Vec2                  m_discCenter;
+	float                 m_discRadius = 0.f;
+	std::span<Vec2 const> m_polyVerts;
+};
+
+//----------------------------------------------------------------------------------------------------
+// RegionOverlapCollector - Writes overlapping object ids into a caller-owned buffer
+//
+// Traversal stops once the buffer is full or, in any-overlap mode, after the first hit.
+//----------------------------------------------------------------------------------------------------
+struct RegionOverlapCollector
+{
+	void Add(int objectId);
+
+	std::span<int> m_buffer;
+	int            m_numHits     = 0;
+	bool           m_stopAtFirst = false;
+	bool           m_isDone      = false;
+};
+
+//----------------------------------------------------------------------------------------------------
+// Linear scan used by the no-tree accelerators; rejectionMode picks the bounding-volume pre-test
+//----------------------------------------------------------------------------------------------------
+void CollectRegionOverlapsBruteForce(std::vector<Convex2*> const& convexes, eQueryMode rejectionMode, RegionQueryShape const& shape, RegionOverlapCollector& collector, QueryFilter const& filter = QueryFilter());
+
+//----------------------------------------------------------------------------------------------------
+// Ids of every convex overlapping the shape; returns the count (truncated at the buffer size)
+//----------------------------------------------------------------------------------------------------
+int  QueryRegionOverlaps(SceneQueryView const& scene, eQueryMode mode, RegionQueryShape const& shape, std::span<int> out_objectIds);
+bool DoesRegionOverlapAny(SceneQueryView const& scene, eQueryMode mode, RegionQueryShape const& shape);
@@ -0,0 +1,49 @@
+//----------------------------------------------------------------------------------------------------
+// SceneQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------------------
+void QueryScratch::BeginVisitPass()
+{
+	++m_currentStamp;
+	if (m_currentStamp == 0)
+	{
+		// Stamp wrapped around; stale entries could alias the new pass
+		std::fill(m_visitStamps.begin(), m_visitStamps.end(), 0u);
+		m_currentStamp = 1;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// MarkVisited - Returns true the first time an object is seen in the current pass. Ids index the
+// stamps, so every convex in a queried scene needs one (Game::AssignConvexObjectIds).
+//----------------------------------------------------------------------------------------------------
+bool QueryScratch::MarkVisited(int objectId)
+{
+	GUARANTEE_OR_DIE(objectId >= 0, "QueryScratch::MarkVisited: convex has no object id; assign ids before querying the scene");
+	if (objectId >= static_cast<int>(m_visitStamps.size()))
+	{
+		m_visitStamps.resize(static_cast<size_t>(objectId) + 1, 0u);
+	}
+	if (m_visitStamps[objectId] == m_currentStamp)
+	{
+		return false;
+	}
+	m_visitStamps[objectId] = m_currentStamp;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC QueryScratch& QueryScratch::GetForThisThread()
+{
+	thread_local QueryScratch s_scratch;
+	return s_scratch;
+}
@@ -0,0 +1,105 @@
+//----------------------------------------------------------------------------------------------------
+// SceneQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+struct Convex2;
+class AABB2Tree;
+class PartitionedTree;
+class SymmetricQuadTree;
+
+//----------------------------------------------------------------------------------------------------
+// Which broad-phase a scene query runs through (matches the F9 / TestRays modes)
+//----------------------------------------------------------------------------------------------------
+enum class eQueryMode : int8_t
+{
+	NO_OPTIMIZATION,
+	DISC_REJECTION,
+	AABB_REJECTION,
+	SYMMETRIC_QUADTREE,
+	AABB2_TREE,
+	PARTITIONED,
+	COUNT
+};
+
+//----------------------------------------------------------------------------------------------------
+// Query categories - Bits of Convex2::m_categoryMask; an object may be in several. Content decides
+// what the bits mean; these are the ones the tools name.
+//----------------------------------------------------------------------------------------------------
+constexpr uint16_t QUERY_CATEGORY_DEFAULT = 1u << 0;
+constexpr uint16_t QUERY_CATEGORY_WALL    = 1u << 1;
+constexpr uint16_t QUERY_CATEGORY_GLASS   = 1u << 2;
+constexpr uint16_t QUERY_CATEGORY_FOLIAGE = 1u << 3;
+constexpr uint16_t QUERY_CATEGORY_TRIGGER = 1u << 4;
+constexpr uint16_t QUERY_CATEGORY_ALL     = 0xFFFFu;
+
+//----------------------------------------------------------------------------------------------------
+// QueryFilter - Which categories a query sees: an object passes if it is in any included category
+// and in no excluded one. Tree nodes keep the OR of their objects' masks, so a node whose mask has
+// no bit that could pass is skipped with everything under it.
+//----------------------------------------------------------------------------------------------------
+struct QueryFilter
+{
+	uint16_t m_includeMask = QUERY_CATEGORY_ALL;
+	uint16_t m_excludeMask = 0;
+
+	bool Accepts(uint16_t categoryMask) const { return (categoryMask & m_includeMask) != 0 && (categoryMask & m_excludeMask) == 0; }
+	bool MayAcceptAny(uint16_t nodeCategoryMask) const { return (nodeCategoryMask & m_includeMask & ~m_excludeMask) != 0; }
+	bool AcceptsAll() const { return m_includeMask == QUERY_CATEGORY_ALL && m_excludeMask == 0; }
+};
+
+//----------------------------------------------------------------------------------------------------
+// Traversal stack entry; ordered queries push far-to-near so the nearest pops first
+//----------------------------------------------------------------------------------------------------
+struct QueryStackEntry
+{
+	int   m_nodeIndex = 0;
+	float m_entryDist = 0.f;
+};
+
+//----------------------------------------------------------------------------------------------------
+// QueryScratch - Per-thread working memory reused across queries so they never allocate
+// once the buffers have grown to the scene's high-water mark.
+//----------------------------------------------------------------------------------------------------
+struct QueryScratch
+{
+	void BeginVisitPass();
+	bool MarkVisited(int objectId);
+
+	static QueryScratch& GetForThisThread();
+
+	std::vector<Convex2*>        m_candidates;  // Broad-phase output, cleared per query
+	std::vector<QueryStackEntry> m_nodeStack;   // Traversal stack, cleared per query
+	std::vector<uint32_t>        m_visitStamps; // Per-object dedup stamps (indexed by m_objectId)
+	uint32_t                     m_currentStamp = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+// AcceleratorStats - Shape of a broad-phase structure, for comparing accelerators side by side
+//----------------------------------------------------------------------------------------------------
+struct AcceleratorStats
+{
+	int m_numNodes       = 0;
+	int m_numLeaves      = 0;
+	int m_numObjectRefs  = 0; // Object references across all leaves (duplicates count)
+	int m_maxLeafObjects = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+// SceneQueryView - Non-owning view of everything a scene query needs, including which categories it
+// sees; a filtered query is a copy of the view with another m_filter
+//----------------------------------------------------------------------------------------------------
+struct SceneQueryView
+{
+	std::vector<Convex2*> const* m_convexes        = nullptr;
+	SymmetricQuadTree const*     m_symQuadTree     = nullptr;
+	AABB2Tree const*             m_AABB2Tree       = nullptr;
+	PartitionedTree const*       m_partitionedTree = nullptr;
+	QueryFilter                  m_filter;
+};
@@ -0,0 +1,366 @@
+//----------------------------------------------------------------------------------------------------
+// ShapeCast.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/ShapeCast.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/Accelerator.hpp"
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/RayQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Math/RaycastUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <cfloat>
+
+//----------------------------------------------------------------------------------------------------
+STATIC ShapeCastShape ShapeCastShape::MakeDisc(Vec2 const& center, float radius)
+{
+	ShapeCastShape shape;
+	shape.m_shape      = eCastShape::DISC;
+	shape.m_bounds     = AABB2(center - Vec2(radius, radius), center + Vec2(radius, radius));
+	shape.m_discCenter = center;
+	shape.m_discRadius = radius;
+	return shape;
+}
+
+//----------------------------------------------------------------------------------------------------
+STATIC ShapeCastShape ShapeCastShape::MakeConvexPoly(std::span<Vec2 const> ccwVerts)
+{
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	float minY = FLT_MAX, maxY = -FLT_MAX;
+	for (Vec2 const& vert : ccwVerts)
+	{
+		if (vert.x < minX) minX = vert.x;
+		if (vert.x > maxX) maxX = vert.x;
+		if (vert.y < minY) minY = vert.y;
+		if (vert.y > maxY) maxY = vert.y;
+	}
+
+	ShapeCastShape shape;
+	shape.m_shape     = eCastShape::CONVEX_POLY;
+	shape.m_bounds    = AABB2(Vec2(minX, minY), Vec2(maxX, maxY));
+	shape.m_polyVerts = ccwVerts;
+	return shape;
+}
+
+//----------------------------------------------------------------------------------------------------
+Vec2 ShapeCastShape::GetBoundsCenter() const
+{
+	return (m_bounds.m_mins + m_bounds.m_maxs) * 0.5f;
+}
+
+//----------------------------------------------------------------------------------------------------
+Vec2 ShapeCastShape::GetBoundsHalfExtents() const
+{
+	return (m_bounds.m_maxs - m_bounds.m_mins) * 0.5f;
+}
+
+//----------------------------------------------------------------------------------------------------
+ShapeCastCollector::ShapeCastCollector(ShapeCastShape const& shape, Vec2 const& direction, float maxDist)
+	: m_shape(shape)
+	, m_direction(direction)
+	, m_maxDist(maxDist)
+	, m_sweepStart(shape.GetBoundsCenter())
+	, m_halfExtents(shape.GetBoundsHalfExtents())
+{
+}
+
+//----------------------------------------------------------------------------------------------------
+void ShapeCastCollector::Consider(Convex2 const& convex)
+{
+	float entryDist = 0.f;
+	if (!GetEntryDistVsBounds(entryDist, convex.m_boundingAABB) || entryDist > GetPruneDist())
+	{
+		return;
+	}
+
+	ShapeCastResult result;
+	bool didImpact = (m_shape.m_shape == eCastShape::DISC)
+		? SweepDiscVsConvex2D(result, m_shape.m_discCenter, m_shape.m_discRadius, m_direction, GetPruneDist(), convex)
+		: SweepConvexPolyVsConvex2D(result, m_shape.m_polyVerts, m_direction, GetPruneDist(), convex);
+
+	if (didImpact && (!m_result.m_didImpact || result.m_timeOfImpact < m_result.m_timeOfImpact))
+	{
+		m_result = result;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// GetEntryDistVsBounds - Ray from the shape's center against bounds grown by the shape's extent
+//----------------------------------------------------------------------------------------------------
+bool ShapeCastCollector::GetEntryDistVsBounds(float& out_entryDist, AABB2 const& bounds) const
+{
+	AABB2 inflated(bounds.m_mins - m_halfExtents, bounds.m_maxs + m_halfExtents);
+	return GetRayEntryDistVsAABB2D(out_entryDist, m_sweepStart, m_direction, GetPruneDist(), inflated);
+}
+
+//----------------------------------------------------------------------------------------------------
+// Projection interval of a vertex set onto an axis
+//----------------------------------------------------------------------------------------------------
+static void ProjectVerts(float& out_min, float& out_max, std::span<Vec2 const> verts, Vec2 const& axis)
+{
+	out_min = FLT_MAX;
+	out_max = -FLT_MAX;
+	for (Vec2 const& vert : verts)
+	{
+		float proj = DotProduct2D(vert, axis);
+		if (proj < out_min) out_min = proj;
+		if (proj > out_max) out_max = proj;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+static Vec2 GetSupportPoint(std::span<Vec2 const> verts, Vec2 const& axis)
+{
+	Vec2  best     = verts[0];
+	float bestProj = DotProduct2D(verts[0], axis);
+	for (Vec2 const& vert : verts)
+	{
+		float proj = DotProduct2D(vert, axis);
+		if (proj > bestProj)
+		{
+			bestProj = proj;
+			best     = vert;
+		}
+	}
+	return best;
+}
+
+//----------------------------------------------------------------------------------------------------
+// SweptSATState - Running intersection of per-axis contact intervals
+//----------------------------------------------------------------------------------------------------
+struct SweptSATState
+{
+	float m_enterTime    = -FLT_MAX;
+	float m_exitTime     = FLT_MAX;
+	Vec2  m_enterNormal;
+	bool  m_enterOnHull  = true;   // Entering axis belongs to the target (vs. the swept shape)
+
+	// Returns false once the axis proves the sweep misses
+	bool AddAxis(Vec2 const& axis, float shapeMin, float shapeMax, float targetMin, float targetMax, Vec2 const& direction, bool isHullAxis)
+	{
+		float speed = DotProduct2D(direction, axis);
+		if (speed == 0.f)
+		{
+			return shapeMax >= targetMin && shapeMin <= targetMax;
+		}
+
+		float t0 = (targetMin - shapeMax) / speed;
+		float t1 = (targetMax - shapeMin) / speed;
+		if (t0 > t1)
+		{
+			float swap = t0;
+			t0 = t1;
+			t1 = swap;
+		}
+		if (t0 > m_enterTime)
+		{
+			// Moving along +axis means we arrive at the target's min side
+			m_enterTime   = t0;
+			m_enterNormal = (speed > 0.f) ? -axis : axis;
+			m_enterOnHull = isHullAxis;
+		}
+		if (t1 < m_exitTime)
+		{
+			m_exitTime = t1;
+		}
+		return m_enterTime <= m_exitTime;
+	}
+};
+
+//----------------------------------------------------------------------------------------------------
+// SweepConvexPolyVsConvex2D - Swept separating-axis test
+//
+// Each candidate axis gives the interval of travel during which the projections overlap; the
+// contact interval is their intersection. Axes are the hull planes and the shape's edge normals.
+//----------------------------------------------------------------------------------------------------
+bool SweepConvexPolyVsConvex2D(ShapeCastResult& out_result, std::span<Vec2 const> ccwVerts, Vec2 const& direction, float maxDist, Convex2 const& convex)
+{
+	std::span<Vec2 const> hullVerts = convex.GetVertices();
+	if (ccwVerts.empty() || hullVerts.empty())
+	{
+		return false;
+	}
+
+	SweptSATState state;
+	float shapeMin  = 0.f, shapeMax  = 0.f;
+	float targetMin = 0.f, targetMax = 0.f;
+
+	for (Vec2 const& normal : convex.GetEdgeNormals())
+	{
+		ProjectVerts(shapeMin, shapeMax, ccwVerts, normal);
+		ProjectVerts(targetMin, targetMax, hullVerts, normal);
+		if (!state.AddAxis(normal, shapeMin, shapeMax, targetMin, targetMax, direction, true))
+		{
+			return false;
+		}
+	}
+
+	int numVerts = static_cast<int>(ccwVerts.size());
+	for (int i = 0; i < numVerts; ++i)
+	{
+		Vec2 edge = ccwVerts[(i + 1) % numVerts] - ccwVerts[i];
+		if (edge.GetLengthSquared() == 0.f)
+		{
+			continue;
+		}
+		Vec2 axis = Vec2(edge.y, -edge.x).GetNormalized();
+		ProjectVerts(shapeMin, shapeMax, ccwVerts, axis);
+		ProjectVerts(targetMin, targetMax, hullVerts, axis);
+		if (!state.AddAxis(axis, shapeMin, shapeMax, targetMin, targetMax, direction, false))
+		{
+			return false;
+		}
+	}
+
+	if (state.m_exitTime < 0.f || state.m_enterTime > maxDist)
+	{
+		return false;
+	}
+
+	out_result.m_didImpact = true;
+	out_result.m_objectId  = convex.m_objectId;
+	if (state.m_enterTime <= 0.f)
+	{
+		// Already overlapping: no meaningful contact feature, push straight back
+		out_result.m_timeOfImpact  = 0.f;
+		out_result.m_contactNormal = -direction;
+		out_result.m_contactPoint  = GetSupportPoint(ccwVerts, direction);
+		return true;
+	}
+
+	out_result.m_timeOfImpact  = state.m_enterTime;
+	out_result.m_contactNormal = state.m_enterNormal;
+	if (state.m_enterOnHull)
+	{
+		// Shape vertex lands on a hull face
+		out_result.m_contactPoint = GetSupportPoint(ccwVerts, -state.m_enterNormal) + direction * state.m_enterTime;
+	}
+	else
+	{
+		// Hull vertex lands on one of our faces
+		out_result.m_contactPoint = GetSupportPoint(hullVerts, state.m_enterNormal);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+// SweepDiscVsConvex2D - Exact sweep: a ray from the center against the convex grown by the radius
+//
+// The grown shape is the union of each edge pushed out by the radius and a disc at each vertex,
+// so the earliest of those hits is the time of impact. Conservative advancement would need an
+// unbounded number of steps to converge on grazing sweeps.
+//----------------------------------------------------------------------------------------------------
+bool SweepDiscVsConvex2D(ShapeCastResult& out_result, Vec2 const& center, float radius, Vec2 const& direction, float maxDist, Convex2 const& convex)
+{
+	Vec2 nearestPoint;
+	Vec2 normal;
+	if (convex.IsPointInside(center) || convex.GetNearestPointOnBoundary(center, nearestPoint, normal) <= radius)
+	{
+		out_result.m_didImpact     = true;
+		out_result.m_timeOfImpact  = 0.f;
+		out_result.m_contactPoint  = center;
+		out_result.m_contactNormal = -direction;
+		out_result.m_objectId      = convex.m_objectId;
+		return true;
+	}
+
+	std::span<Vec2 const> verts = convex.GetVertices();
+	int   numVerts     = static_cast<int>(verts.size());
+	float bestTime     = maxDist;
+	bool  didImpact    = false;
+	Vec2  bestContact;
+	Vec2  bestNormal;
+
+	for (int i = 0; i < numVerts; ++i)
+	{
+		Vec2 const& start = verts[i];
+		Vec2 const& end   = verts[(i + 1) % numVerts];
+		Vec2        edge  = end - start;
+		float       edgeLengthSquared = edge.GetLengthSquared();
+		if (edgeLengthSquared == 0.f)
+		{
+			continue;
+		}
+
+		// Face: the edge's line pushed out by the radius, approached from outside
+		Vec2  edgeNormal = Vec2(edge.y, -edge.x).GetNormalized();
+		float approach   = DotProduct2D(direction, edgeNormal);
+		if (approach < 0.f)
+		{
+			float time = (DotProduct2D(edgeNormal, start) + radius - DotProduct2D(edgeNormal, center)) / approach;
+			if (time >= 0.f && time < bestTime)
+			{
+				Vec2  contact = center + direction * time - edgeNormal * radius;
+				float along   = DotProduct2D(contact - start, edge);
+				if (along >= 0.f && along <= edgeLengthSquared)
+				{
+					bestTime    = time;
+					bestContact = contact;
+					bestNormal  = edgeNormal;
+					didImpact   = true;
+				}
+			}
+		}
+
+		// Corner: a disc of the same radius around the vertex
+		RaycastResult2D cornerHit = RaycastVsDisc2D(center, direction, bestTime, start, radius);
+		if (cornerHit.m_didImpact && cornerHit.m_impactLength < bestTime)
+		{
+			bestTime    = cornerHit.m_impactLength;
+			bestContact = start;
+			bestNormal  = (cornerHit.m_impactPosition - start).GetNormalized();
+			didImpact   = true;
+		}
+	}
+
+	if (!didImpact)
+	{
+		return false;
+	}
+	out_result.m_didImpact     = true;
+	out_result.m_timeOfImpact  = bestTime;
+	out_result.m_contactPoint  = bestContact;
+	out_result.m_contactNormal = bestNormal;
+	out_result.m_objectId      = convex.m_objectId;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------
+void CollectShapeCastHitsBruteForce(std::vector<Convex2*> const& convexes, eQueryMode rejectionMode, ShapeCastCollector& collector, QueryFilter const& filter)
+{
+	float sweepRadius = collector.m_halfExtents.GetLength();
+	for (Convex2 const* convex : convexes)
+	{
+		if (!filter.Accepts(convex->m_categoryMask))
+		{
+			continue;
+		}
+		// Swept bounding disc: the ray from our center against their disc grown by our radius
+		if (rejectionMode == eQueryMode::DISC_REJECTION &&
+			!RaycastVsDisc2D(collector.m_sweepStart, collector.m_direction, collector.GetPruneDist(), convex->m_boundingDiscCenter, convex->m_boundingRadius + sweepRadius).m_didImpact &&
+			!DoDiscsOverlap(collector.m_sweepStart, sweepRadius, convex->m_boundingDiscCenter, convex->m_boundingRadius))
+		{
+			continue;
+		}
+		collector.Consider(*convex);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+bool ShapeCast(SceneQueryView const& scene, eQueryMode mode, ShapeCastShape const& shape, Vec2 const& direction, float maxDist, ShapeCastResult& out_result)
+{
+	ShapeCastCollector collector(shape, direction, maxDist);
+	QueryScratch&      scratch = QueryScratch::GetForThisThread();
+
+	DispatchSceneAccelerator(scene, mode, [&](auto const& accelerator)
+	{
+		accelerator.CollectShapeCastHits(scratch, collector, scene.m_filter);
+	});
+
+	out_result = collector.m_result;
+	return out_result.m_didImpact;
+}
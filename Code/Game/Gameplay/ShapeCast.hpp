@@ -0,0 +1,94 @@
+//----------------------------------------------------------------------------------------------------
+// ShapeCast.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/AABB2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+enum class eCastShape : int8_t
+{
+	DISC,
+	CONVEX_POLY
+};
+
+//----------------------------------------------------------------------------------------------------
+// ShapeCastShape - The swept shape at its starting position
+//
+// Convex-poly shapes reference the caller's CCW vertex array; it must outlive the query.
+//----------------------------------------------------------------------------------------------------
+struct ShapeCastShape
+{
+	static ShapeCastShape MakeDisc(Vec2 const& center, float radius);
+	static ShapeCastShape MakeConvexPoly(std::span<Vec2 const> ccwVerts);
+
+	Vec2 GetBoundsCenter() const;
+	Vec2 GetBoundsHalfExtents() const;
+
+	eCastShape            m_shape = eCastShape::DISC;
+	AABB2                 m_bounds;
+	Vec2                  m_discCenter;
+	float                 m_discRadius = 0.f;
+	std::span<Vec2 const> m_polyVerts;
+};
+
+//----------------------------------------------------------------------------------------------------
+// ShapeCastResult - First contact along the sweep
+//
+// m_timeOfImpact is the distance travelled along the (unit) direction; 0 means the shape already
+// overlaps at its start. The normal is on the hit convex and points back toward the shape.
+//----------------------------------------------------------------------------------------------------
+struct ShapeCastResult
+{
+	bool  m_didImpact     = false;
+	float m_timeOfImpact  = 0.f;
+	Vec2  m_contactPoint;
+	Vec2  m_contactNormal;
+	int   m_objectId      = -1;
+};
+
+//----------------------------------------------------------------------------------------------------
+// ShapeCastCollector - Keeps the earliest contact and exposes it as the traversal prune distance
+//
+// Broad-phase bounds are inflated by the shape's half extents, which turns the sweep into a ray
+// cast from the shape's bounds center.
+//----------------------------------------------------------------------------------------------------
+struct ShapeCastCollector
+{
+	ShapeCastCollector(ShapeCastShape const& shape, Vec2 const& direction, float maxDist);
+
+	void  Consider(Convex2 const& convex);
+	bool  GetEntryDistVsBounds(float& out_entryDist, AABB2 const& bounds) const;
+	float GetPruneDist() const { return m_result.m_didImpact ? m_result.m_timeOfImpact : m_maxDist; }
+
+	ShapeCastShape const& m_shape;
+	Vec2                  m_direction;
+	float                 m_maxDist = 0.f;
+	Vec2                  m_sweepStart;   // Shape bounds center
+	Vec2                  m_halfExtents;  // Shape bounds half size
+	ShapeCastResult       m_result;
+};
+
+//----------------------------------------------------------------------------------------------------
+// Every convex offered to the collector, behind the swept bounding disc when rejectionMode asks for
+// it; the no-tree baselines of the accelerator registry
+//----------------------------------------------------------------------------------------------------
+void CollectShapeCastHitsBruteForce(std::vector<Convex2*> const& convexes, eQueryMode rejectionMode, ShapeCastCollector& collector, QueryFilter const& filter = QueryFilter());
+
+//----------------------------------------------------------------------------------------------------
+// Sweep the shape along a unit direction and report the first convex it touches
+//----------------------------------------------------------------------------------------------------
+bool ShapeCast(SceneQueryView const& scene, eQueryMode mode, ShapeCastShape const& shape, Vec2 const& direction, float maxDist, ShapeCastResult& out_result);
+
+//----------------------------------------------------------------------------------------------------
+// Narrow phases, exposed for callers that already have their candidates
+//----------------------------------------------------------------------------------------------------
+bool SweepConvexPolyVsConvex2D(ShapeCastResult& out_result, std::span<Vec2 const> ccwVerts, Vec2 const& direction, float maxDist, Convex2 const& convex);
+bool SweepDiscVsConvex2D(ShapeCastResult& out_result, Vec2 const& center, float radius, Vec2 const& direction, float maxDist, Convex2 const& convex);
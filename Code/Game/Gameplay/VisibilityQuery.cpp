@@ -0,0 +1,356 @@
+//----------------------------------------------------------------------------------------------------
+// VisibilityQuery.cpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/VisibilityQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Game/Framework/TaskScheduler.hpp"
+#include "Game/Gameplay/Convex.hpp"
+#include "Game/Gameplay/RegionQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/MathUtils.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------
+constexpr float SWEEP_PI            = 3.14159265358979f;
+constexpr float SWEEP_POINT_EPSILON = 1e-4f;
+
+//----------------------------------------------------------------------------------------------------
+// Occluding edge, stored relative to the viewpoint and oriented CCW around it
+//----------------------------------------------------------------------------------------------------
+struct SweepSegment
+{
+	Vec2  m_begin;
+	Vec2  m_end;
+	float m_beginAngle = 0.f;
+	float m_endAngle   = 0.f;
+};
+
+//----------------------------------------------------------------------------------------------------
+// Front edges of one nearby convex, a range in the segment list
+//----------------------------------------------------------------------------------------------------
+struct SweepConvex
+{
+	AABB2 m_bounds;
+	int   m_firstSegment = 0;
+	int   m_endSegment   = 0;
+};
+
+//----------------------------------------------------------------------------------------------------
+enum class eSweepEvent : int8_t
+{
+	REMOVE,
+	INSERT,
+	SAMPLE    // Circle crossings, edge crossings and arc steps: no change to the active set
+};
+
+//----------------------------------------------------------------------------------------------------
+struct SweepEvent
+{
+	float       m_angle        = 0.f;
+	eSweepEvent m_type         = eSweepEvent::SAMPLE;
+	int         m_segmentIndex = -1;
+};
+
+//----------------------------------------------------------------------------------------------------
+// Distance from the viewpoint to the segment's line along the ray at the given angle
+//----------------------------------------------------------------------------------------------------
+static float GetDistAlongRay(SweepSegment const& segment, Vec2 const& direction)
+{
+	Vec2  edge  = segment.m_end - segment.m_begin;
+	float denom = CrossProduct2D(direction, edge);
+	if (fabsf(denom) < 1e-12f)
+	{
+		return std::min(segment.m_begin.GetLength(), segment.m_end.GetLength());
+	}
+	return CrossProduct2D(segment.m_begin, edge) / denom;
+}
+
+//----------------------------------------------------------------------------------------------------
+// VisibilityScratch - Per-thread buffers so repeated queries reuse their capacity
+//----------------------------------------------------------------------------------------------------
+struct VisibilityScratch
+{
+	std::vector<int>          m_objectIds;
+	std::vector<SweepConvex>  m_convexes;
+	std::vector<SweepSegment> m_segments;
+	std::vector<SweepEvent>   m_events;
+	std::vector<int>          m_active;          // Segments spanning the current sweep angle, unordered
+	std::vector<int>          m_activePositions; // Per segment, its index in m_active or -1
+
+	static VisibilityScratch& GetForThisThread()
+	{
+		thread_local VisibilityScratch s_scratch;
+		return s_scratch;
+	}
+};
+
+//----------------------------------------------------------------------------------------------------
+static void AddCircleCrossingEvents(std::vector<SweepEvent>& events, SweepSegment const& segment, float radius)
+{
+	// Solve |begin + s * edge| = radius for s in [0, 1]
+	Vec2  edge = segment.m_end - segment.m_begin;
+	float a    = DotProduct2D(edge, edge);
+	float b    = 2.f * DotProduct2D(segment.m_begin, edge);
+	float c    = DotProduct2D(segment.m_begin, segment.m_begin) - radius * radius;
+	float disc = b * b - 4.f * a * c;
+	if (a == 0.f || disc <= 0.f)
+	{
+		return;
+	}
+
+	float root = sqrtf(disc);
+	float roots[2] = {(-b - root) / (2.f * a), (-b + root) / (2.f * a)};
+	for (float s : roots)
+	{
+		if (s > 0.f && s < 1.f)
+		{
+			Vec2 point = segment.m_begin + edge * s;
+			events.push_back({atan2f(point.y, point.x), eSweepEvent::SAMPLE, -1});
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// AddEdgeCrossingEvents - Where front edges of overlapping convexes cross, the nearest edge changes
+// between endpoints. Only convexes whose boxes overlap can cross, so a sort on the box minimum x
+// prunes the pairs; a scene without overlaps adds nothing.
+//----------------------------------------------------------------------------------------------------
+static void AddEdgeCrossingEvents(std::vector<SweepEvent>& events, std::vector<SweepConvex>& convexes, std::vector<SweepSegment> const& segments)
+{
+	std::sort(convexes.begin(), convexes.end(), [](SweepConvex const& a, SweepConvex const& b) { return a.m_bounds.m_mins.x < b.m_bounds.m_mins.x; });
+
+	int numConvexes = static_cast<int>(convexes.size());
+	for (int i = 0; i < numConvexes; ++i)
+	{
+		for (int j = i + 1; j < numConvexes && convexes[j].m_bounds.m_mins.x <= convexes[i].m_bounds.m_maxs.x; ++j)
+		{
+			if (convexes[j].m_bounds.m_mins.y > convexes[i].m_bounds.m_maxs.y || convexes[j].m_bounds.m_maxs.y < convexes[i].m_bounds.m_mins.y)
+			{
+				continue;
+			}
+			for (int a = convexes[i].m_firstSegment; a < convexes[i].m_endSegment; ++a)
+			{
+				for (int b = convexes[j].m_firstSegment; b < convexes[j].m_endSegment; ++b)
+				{
+					Vec2  edgeA = segments[a].m_end - segments[a].m_begin;
+					Vec2  edgeB = segments[b].m_end - segments[b].m_begin;
+					float denom = CrossProduct2D(edgeA, edgeB);
+					if (denom == 0.f)
+					{
+						continue;
+					}
+					Vec2  offset = segments[b].m_begin - segments[a].m_begin;
+					float s      = CrossProduct2D(offset, edgeB) / denom;
+					float t      = CrossProduct2D(offset, edgeA) / denom;
+					if (s > 0.f && s < 1.f && t > 0.f && t < 1.f)
+					{
+						Vec2 point = segments[a].m_begin + edgeA * s;
+						events.push_back({atan2f(point.y, point.x), eSweepEvent::SAMPLE, -1});
+					}
+				}
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+static void ActivateSegment(VisibilityScratch& scratch, int segmentIndex)
+{
+	if (scratch.m_activePositions[segmentIndex] < 0)
+	{
+		scratch.m_activePositions[segmentIndex] = static_cast<int>(scratch.m_active.size());
+		scratch.m_active.push_back(segmentIndex);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+static void DeactivateSegment(VisibilityScratch& scratch, int segmentIndex)
+{
+	int position = scratch.m_activePositions[segmentIndex];
+	if (position < 0)
+	{
+		return;
+	}
+	int last = scratch.m_active.back();
+	scratch.m_active[position]        = last;
+	scratch.m_activePositions[last]   = position;
+	scratch.m_active.pop_back();
+	scratch.m_activePositions[segmentIndex] = -1;
+}
+
+//----------------------------------------------------------------------------------------------------
+void ComputeVisibilityPolygon(SceneQueryView const& scene, eQueryMode mode, Vec2 const& viewpoint, float radius, std::vector<Vec2>& out_polygon, int numArcSteps)
+{
+	out_polygon.clear();
+	VisibilityScratch& scratch = VisibilityScratch::GetForThisThread();
+
+	// Broad phase through the spatial index
+	std::vector<Convex2*> const& convexes = *scene.m_convexes;
+	scratch.m_objectIds.resize(convexes.size());
+	int numNearby = QueryRegionOverlaps(scene, mode, RegionQueryShape::MakeDisc(viewpoint, radius), scratch.m_objectIds);
+
+	// Keep only edges facing the viewpoint; back edges are always hidden behind their own front edges
+	std::vector<SweepSegment>& segments = scratch.m_segments;
+	segments.clear();
+	scratch.m_convexes.clear();
+	for (int i = 0; i < numNearby; ++i)
+	{
+		Convex2 const& convex = *convexes[scratch.m_objectIds[i]];
+		if (convex.IsPointInside(viewpoint))
+		{
+			return;
+		}
+
+		SweepConvex sweepConvex;
+		sweepConvex.m_bounds       = AABB2(convex.m_boundingAABB.m_mins - viewpoint, convex.m_boundingAABB.m_maxs - viewpoint);
+		sweepConvex.m_firstSegment = static_cast<int>(segments.size());
+
+		std::span<Vec2 const> verts = convex.GetVertices();
+		int numVerts = static_cast<int>(verts.size());
+		for (int v = 0; v < numVerts; ++v)
+		{
+			Vec2 from = verts[v] - viewpoint;
+			Vec2 to   = verts[(v + 1) % numVerts] - viewpoint;
+
+			// Outward normal of a CCW edge is (e.y, -e.x); we see it if we are on that side
+			Vec2 edge = to - from;
+			if (DotProduct2D(Vec2(edge.y, -edge.x), -from) <= 0.f)
+			{
+				continue;
+			}
+
+			// Front faces run clockwise around the viewpoint, so flip to sweep CCW
+			SweepSegment segment;
+			segment.m_begin      = to;
+			segment.m_end        = from;
+			segment.m_beginAngle = atan2f(to.y, to.x);
+			segment.m_endAngle   = atan2f(from.y, from.x);
+			segments.push_back(segment);
+		}
+
+		sweepConvex.m_endSegment = static_cast<int>(segments.size());
+		scratch.m_convexes.push_back(sweepConvex);
+	}
+
+	// Events: segment endpoints, circle and edge crossings, and arc steps. Between two events the
+	// nearest edge cannot change, so the outline there is a straight piece of it (or the arc).
+	std::vector<SweepEvent>& events = scratch.m_events;
+	events.clear();
+	int numSegments = static_cast<int>(segments.size());
+	for (int s = 0; s < numSegments; ++s)
+	{
+		events.push_back({segments[s].m_beginAngle, eSweepEvent::INSERT, s});
+		events.push_back({segments[s].m_endAngle, eSweepEvent::REMOVE, s});
+		AddCircleCrossingEvents(events, segments[s], radius);
+	}
+	AddEdgeCrossingEvents(events, scratch.m_convexes, segments);
+	for (int step = 0; step < numArcSteps; ++step)
+	{
+		events.push_back({-SWEEP_PI + 2.f * SWEEP_PI * static_cast<float>(step) / static_cast<float>(numArcSteps), eSweepEvent::SAMPLE, -1});
+	}
+	std::sort(events.begin(), events.end(), [](SweepEvent const& a, SweepEvent const& b)
+	{
+		if (a.m_angle != b.m_angle)
+		{
+			return a.m_angle < b.m_angle;
+		}
+		return a.m_type < b.m_type;
+	});
+
+	// Segments straddling the -pi ray are active before the first event
+	scratch.m_active.clear();
+	scratch.m_activePositions.assign(numSegments, -1);
+	for (int s = 0; s < numSegments; ++s)
+	{
+		if (segments[s].m_beginAngle > segments[s].m_endAngle)
+		{
+			ActivateSegment(scratch, s);
+		}
+	}
+
+	// The active edges along one ray are few, so the nearest is found by a scan rather than kept sorted
+	auto emitPoint = [&](float angle)
+	{
+		Vec2  direction(cosf(angle), sinf(angle));
+		float dist = radius;
+		for (int s : scratch.m_active)
+		{
+			dist = std::min(dist, GetDistAlongRay(segments[s], direction));
+		}
+		Vec2 point = viewpoint + direction * dist;
+		if (out_polygon.empty() || (out_polygon.back() - point).GetLengthSquared() > SWEEP_POINT_EPSILON * SWEEP_POINT_EPSILON)
+		{
+			out_polygon.push_back(point);
+		}
+	};
+
+	// Events sharing an angle are applied together: one point with the edges that end there, one with
+	// the edges that start there, so a vertex shared by two edges emits no spike
+	int numEvents = static_cast<int>(events.size());
+	for (int first = 0; first < numEvents;)
+	{
+		float angle = events[first].m_angle;
+		int   last  = first;
+		while (last < numEvents && events[last].m_angle == angle)
+		{
+			++last;
+		}
+
+		emitPoint(angle);
+		bool hasChanged = false;
+		for (int e = first; e < last; ++e)
+		{
+			if (events[e].m_type == eSweepEvent::REMOVE)
+			{
+				DeactivateSegment(scratch, events[e].m_segmentIndex);
+				hasChanged = true;
+			}
+			else if (events[e].m_type == eSweepEvent::INSERT)
+			{
+				ActivateSegment(scratch, events[e].m_segmentIndex);
+				hasChanged = true;
+			}
+		}
+		if (hasChanged)
+		{
+			emitPoint(angle);
+		}
+		first = last;
+	}
+
+	if (out_polygon.size() > 1 && (out_polygon.front() - out_polygon.back()).GetLengthSquared() <= SWEEP_POINT_EPSILON * SWEEP_POINT_EPSILON)
+	{
+		out_polygon.pop_back();
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// ComputeVisibilityPolygonBatch - Workers pull viewpoints from a shared counter
+//----------------------------------------------------------------------------------------------------
+void ComputeVisibilityPolygonBatch(SceneQueryView const& scene, eQueryMode mode, std::span<Vec2 const> viewpoints, float radius, std::vector<std::vector<Vec2>>& out_polygons, int numArcSteps, int numThreads)
+{
+	int numViewpoints = static_cast<int>(viewpoints.size());
+	out_polygons.resize(numViewpoints);
+
+	if (numThreads <= 0)
+	{
+		numThreads = GetNumTaskThreads();
+	}
+	numThreads = std::clamp(numThreads, 1, std::max(numViewpoints, 1));
+
+	std::atomic<int> nextViewpoint = 0;
+	auto worker = [&](int)
+	{
+		for (int i = nextViewpoint.fetch_add(1); i < numViewpoints; i = nextViewpoint.fetch_add(1))
+		{
+			ComputeVisibilityPolygon(scene, mode, viewpoints[i], radius, out_polygons[i], numArcSteps);
+		}
+	};
+
+	RunOnWorkers(numThreads, worker);
+}
@@ -0,0 +1,30 @@
+//----------------------------------------------------------------------------------------------------
+// VisibilityQuery.hpp
+//----------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------
+#pragma once
+//----------------------------------------------------------------------------------------------------
+#include "Game/Gameplay/SceneQuery.hpp"
+//----------------------------------------------------------------------------------------------------
+#include "Engine/Math/Vec2.hpp"
+//----------------------------------------------------------------------------------------------------
+#include <span>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------
+// Region visible from a point within a radius, as a CCW polygon (a star-shaped fan around the
+// viewpoint). Out-of-range stretches follow the circle, approximated with a fixed number of arc
+// steps per full turn. The result is empty when the viewpoint is inside a convex.
+//
+// Occluders are the edges facing the viewpoint on convexes the spatial index reports inside the
+// radius. An angular sweep over their endpoints tracks the edges spanning the current angle and
+// takes the nearest at every event. Overlapping blockers are allowed: where their edges cross, the
+// crossing is an event too.
+//----------------------------------------------------------------------------------------------------
+void ComputeVisibilityPolygon(SceneQueryView const& scene, eQueryMode mode, Vec2 const& viewpoint, float radius, std::vector<Vec2>& out_polygon, int numArcSteps = 64);
+
+//----------------------------------------------------------------------------------------------------
+// One visibility polygon per viewpoint, computed in parallel
+//----------------------------------------------------------------------------------------------------
+void ComputeVisibilityPolygonBatch(SceneQueryView const& scene, eQueryMode mode, std::span<Vec2 const> viewpoints, float radius, std::vector<std::vector<Vec2>>& out_polygons, int numArcSteps = 64, int numThreads = 0);